@@ -0,0 +1,88 @@
+// Bandwidth and encode cost of MetaDeltaEncoder on a synthetic tracked scene.
+//
+//   benchMetaDelta [objects=64] [frames=9000]
+//
+// Objects drift at a few pixels per frame with sub-pixel jitter; a few enter
+// and leave every second. Compares the delta stream against every message being
+// a keyframe and against a naive 32-byte-per-object struct dump.
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <metadata/meta_delta.hpp>
+
+namespace {
+
+struct Motion {
+  float vx;
+  float vy;
+};
+
+}    // namespace
+
+int main(int argc, char** argv) {
+  const auto objects = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 64UL;
+  const auto frames = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 9000UL;
+
+  std::mt19937 rng{42};
+  std::uniform_real_distribution<float> pos{0.f, 1800.f};
+  std::uniform_real_distribution<float> vel{-2.f, 2.f};
+  std::normal_distribution<float> jitter{0.f, 0.1f};
+
+  std::vector<ds::DeltaObject> scene;
+  std::vector<Motion> motion;
+  std::uint64_t next_id = 0;
+  const auto spawn = [&] {
+    scene.push_back({next_id++, static_cast<std::int32_t>(next_id % 4), {pos(rng), pos(rng) / 2, 60.f, 120.f}, 0.9f});
+    motion.push_back({vel(rng), vel(rng)});
+  };
+  for(std::size_t i = 0; i < objects; ++i) {
+    spawn();
+  }
+
+  auto delta = ds::MetaDeltaEncoder::create({0.25f, 1.f / 256, 30}).value();
+  auto keyframes_only = ds::MetaDeltaEncoder::create({0.25f, 1.f / 256, 1}).value();
+  std::uint64_t naive_bytes = 0;
+  std::chrono::nanoseconds encode_time{0};
+
+  for(std::size_t f = 0; f < frames; ++f) {
+    for(std::size_t i = 0; i < scene.size(); ++i) {
+      scene[i].box.left += motion[i].vx + jitter(rng);
+      scene[i].box.top += motion[i].vy + jitter(rng);
+    }
+    if(f % 30 == 0 && !scene.empty()) {
+      // Two objects leave, two enter.
+      for(int k = 0; k < 2 && !scene.empty(); ++k) {
+        const auto victim = rng() % scene.size();
+        scene.erase(scene.begin() + static_cast<std::ptrdiff_t>(victim));
+        motion.erase(motion.begin() + static_cast<std::ptrdiff_t>(victim));
+        spawn();
+      }
+    }
+
+    const std::uint64_t pts = f * 33'333'333ULL;
+    const auto start = std::chrono::steady_clock::now();
+    (void)delta.encode(pts, scene);
+    encode_time += std::chrono::steady_clock::now() - start;
+    (void)keyframes_only.encode(pts, scene);
+    naive_bytes += 16 + scene.size() * 32;
+  }
+
+  const auto per_frame = [frames](std::uint64_t bytes) { return static_cast<double>(bytes) / static_cast<double>(frames); };
+  fmt::print("objects/frame        {}\n", objects);
+  fmt::print("frames               {}\n", frames);
+  fmt::print("naive struct dump    {:10.1f} B/frame\n", per_frame(naive_bytes));
+  fmt::print("keyframe every frame {:10.1f} B/frame\n", per_frame(keyframes_only.bytes()));
+  fmt::print("delta (key every 30) {:10.1f} B/frame\n", per_frame(delta.bytes()));
+  fmt::print("reduction vs naive   {:10.1f} x\n", static_cast<double>(naive_bytes) / static_cast<double>(delta.bytes()));
+  fmt::print("reduction vs keyfr.  {:10.1f} x\n",
+             static_cast<double>(keyframes_only.bytes()) / static_cast<double>(delta.bytes()));
+  fmt::print("encode               {:10.1f} us/frame\n",
+             std::chrono::duration<double, std::micro>(encode_time).count() / static_cast<double>(frames));
+  return EXIT_SUCCESS;
+}
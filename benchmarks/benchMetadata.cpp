@@ -0,0 +1,100 @@
+// Per-batch cost of the metadata views and algorithms on host-built batches.
+//
+//   benchMetadata [frames=16] [objects=64] [iterations=2000]
+//
+// Runs on any machine with the DeepStream headers: the batches come from
+// ds::testing::SyntheticBatch, so no GPU, nvstreammux or nvinfer is involved.
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <string_view>
+
+#include <fmt/format.h>
+
+#include <metadata/batch_index.hpp>
+#include <metadata/batch_record.hpp>
+#include <metadata/meta_recorder.hpp>
+#include <metadata/track_history.hpp>
+#include <testing/synthetic_batch.hpp>
+
+namespace {
+
+// Keeps the optimiser from discarding the measured work.
+volatile double g_sink = 0;
+
+template <typename Fn>
+  requires std::invocable<Fn&>
+void measure(std::string_view name, std::size_t iterations, double objects_per_batch, Fn&& fn) {
+  const auto start = std::chrono::steady_clock::now();
+  for(std::size_t i = 0; i < iterations; ++i) {
+    fn();
+  }
+  const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  const auto per_batch = elapsed.count() / static_cast<double>(iterations);
+  fmt::print("{:<22} {:10.1f} ns/batch {:8.2f} ns/object\n", name, per_batch, per_batch / objects_per_batch);
+}
+
+}    // namespace
+
+int main(int argc, char** argv) {
+  const auto frames = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 16UL;
+  const auto objects = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 64UL;
+  const auto iterations = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 2000UL;
+
+  const ds::testing::SyntheticBatch batch{{.frames = static_cast<std::uint32_t>(frames),
+                                           .objects_per_frame = static_cast<std::uint32_t>(objects),
+                                           .classifiers_per_object = 1,
+                                           .labels_per_classifier = 2}};
+  const auto view = batch.view();
+  const auto total = static_cast<double>(batch.num_objects());
+
+  fmt::print("frames/batch          {}\n", frames);
+  fmt::print("objects/frame         {}\n", objects);
+
+  measure("iterate objects", iterations, total, [&] {
+    double sum = 0;
+    for(const auto frame : view.frames()) {
+      for(const auto obj : frame.objects()) {
+        sum += static_cast<double>(obj.confidence());
+      }
+    }
+    g_sink = sum;
+  });
+
+  measure("iterate labels", iterations, total, [&] {
+    double sum = 0;
+    for(const auto frame : view.frames()) {
+      for(const auto obj : frame.objects()) {
+        for(const auto classifier : obj.classifiers()) {
+          for(const auto label : classifier.labels()) {
+            sum += static_cast<double>(label.probability());
+          }
+        }
+      }
+    }
+    g_sink = sum;
+  });
+
+  ds::BatchIndex index;
+  measure("BatchIndex rebuild", iterations, total, [&] {
+    index.rebuild(view);
+    g_sink = static_cast<double>(index.size());
+  });
+
+  ds::BatchRecord record;
+  measure("capture", iterations, total, [&] {
+    ds::capture(view, record);
+    g_sink = static_cast<double>(record.num_objects());
+  });
+
+  ds::TrackHistory history{{.max_tracks = static_cast<std::uint32_t>(frames * objects * 2)}};
+  measure("TrackHistory update", iterations, total, [&] {
+    for(const auto frame : view.frames()) {
+      history.update(frame);
+    }
+    g_sink = static_cast<double>(history.size());
+  });
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,49 @@
+// Converts a ds::MetaRecorder log back into deepstream-app style KITTI files.
+//
+//   meta-log-to-kitti <log.dsmeta> <output-dir> [app-index]
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <system_error>
+
+#include <fmt/format.h>
+
+#include <metadata/meta_log.hpp>
+
+int main(int argc, char** argv) {
+  const auto usage = [argv] {
+    fmt::print(stderr, "usage: {} <log.dsmeta> <output-dir> [app-index]\n", argv[0]);
+    return EXIT_FAILURE;
+  };
+  if(argc < 3) {
+    return usage();
+  }
+  std::uint32_t app_index = 0;
+  if(argc > 3) {
+    const char* end = argv[3] + std::strlen(argv[3]);
+    const auto [ptr, ec] = std::from_chars(argv[3], end, app_index);
+    if(ec != std::errc{} || ptr != end) {
+      fmt::print(stderr, "invalid app-index '{}': expected an unsigned 32-bit number\n", argv[3]);
+      return usage();
+    }
+  }
+
+  auto log = ds::MetaLogReader::open(argv[1]);
+  if(!log) {
+    fmt::print(stderr, "{}\n", log.error().what());
+    return EXIT_FAILURE;
+  }
+  if(log->recovered()) {
+    fmt::print(stderr, "warning: '{}' was not closed cleanly; recovered {} batches\n", argv[1], log->size());
+  }
+
+  auto files = ds::write_kitti(*log, argv[2], app_index);
+  if(!files) {
+    fmt::print(stderr, "{}\n", files.error().what());
+    return EXIT_FAILURE;
+  }
+  fmt::print("wrote {} KITTI files from {} batches\n", *files, log->size());
+  return EXIT_SUCCESS;
+}
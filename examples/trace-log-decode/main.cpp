@@ -0,0 +1,64 @@
+// Renders a ds::TraceLog file as text, one line per DS_TRACE_* call.
+//
+//   trace-log-decode <log.dstrace> [min-level=debug]
+//
+// Each line is a UTC timestamp, the level, the call site and the message:
+//   2024-05-01 12:00:00.123456789 [DS WARN] file.cpp:42 — message
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <string_view>
+
+#include <fmt/chrono.h>
+#include <fmt/format.h>
+
+#include <utils/debug.hpp>
+#include <utils/trace_log.hpp>
+
+namespace {
+
+ds::DebugLevel parse_level(std::string_view name) {
+  if(name == "info") {
+    return ds::DebugLevel::Info;
+  }
+  if(name == "warn") {
+    return ds::DebugLevel::Warn;
+  }
+  if(name == "error") {
+    return ds::DebugLevel::Error;
+  }
+  return ds::DebugLevel::Debug;
+}
+
+}    // namespace
+
+int main(int argc, char** argv) {
+  if(argc < 2) {
+    fmt::print(stderr, "usage: {} <log.dstrace> [debug|info|warn|error]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  auto trace = ds::TraceLogReader::open(argv[1]);
+  if(!trace) {
+    fmt::print(stderr, "{}\n", trace.error().what());
+    return EXIT_FAILURE;
+  }
+
+  const auto min_level = argc > 2 ? parse_level(argv[2]) : ds::DebugLevel::Debug;
+  for(std::size_t i = 0; i < trace->size(); ++i) {
+    const auto event = trace->event(i);
+    if(event.level < min_level) {
+      continue;
+    }
+    const std::chrono::sys_time<std::chrono::nanoseconds> time{std::chrono::nanoseconds{event.wall_ns}};
+    const auto seconds = std::chrono::floor<std::chrono::seconds>(time);
+    fmt::print("{:%Y-%m-%d %H:%M:%S}.{:09} [DS {}] {}:{} — {}\n",
+               seconds,
+               (time - seconds).count(),
+               ds::debug_level_str(event.level),
+               event.file,
+               event.line,
+               event.message);
+  }
+  return EXIT_SUCCESS;
+}
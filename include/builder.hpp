@@ -124,7 +124,12 @@ public:
     return *this;
   }
 
+  // Each phase is timed into DebugLayer's TimedOp histograms when
+  // DebugLayer::timing_enabled().
   [[nodiscard]] nonstd::expected<gst::raii::Pipeline, PipelineError> build() {
+    ScopedTiming total{TimedOp::Build};
+    ScopedTiming validate{TimedOp::BuildValidate};
+
     // Mandatory: at least one element
     if(elements_.empty()) {
       const auto msg = std::string("Pipeline must contain at least one element");
@@ -148,6 +153,9 @@ public:
       }
     }
 
+    validate.stop();
+
+    ScopedTiming add{TimedOp::BuildAdd};
     GstElement* raw_pipeline = gst_pipeline_new(nullptr);
     if(raw_pipeline == nullptr) {
       const auto msg = std::string("Failed to create GstPipeline");
@@ -172,8 +180,10 @@ public:
       added.push_back(elements_[i]);
     }
     elements_.clear();    // pipeline now owns every element
+    add.stop();
 
     // Link sequentially
+    ScopedTiming link{TimedOp::BuildLink};
     for(std::size_t i = 0; i + 1 < added.size(); ++i) {
       if(gst_element_link(added[i], added[i + 1]) == FALSE) {
         gst_object_unref(raw_pipeline);
@@ -183,6 +193,8 @@ public:
       }
     }
 
+    link.stop();
+
     return gst::raii::Pipeline{raw_pipeline};
   }
 
@@ -193,4 +205,21 @@ private:
   std::string first_duplicate_;
 };
 
+// gst_element_set_state() with the ds:: diagnostics: a FAILURE is logged as
+// ErrorKind::ElementState and the call is timed as TimedOp::StateChange. ASYNC
+// and NO_PREROLL are successes and are returned to the caller.
+[[nodiscard]] inline nonstd::expected<GstStateChangeReturn, Error> set_state(GstElement* element, GstState state) {
+  if(element == nullptr) {
+    return nonstd::make_unexpected(Error{ErrorKind::InvalidArgument, "set_state: element is null"});
+  }
+  ScopedTiming timing{TimedOp::StateChange};
+  const auto ret = gst_element_set_state(element, state);
+  if(ret == GST_STATE_CHANGE_FAILURE) {
+    const auto msg = fmt::format("Failed to set '{}' to {}", detail::element_name(element), gst_element_state_get_name(state));
+    DebugLayer::instance().log(DebugLevel::Error, ErrorKind::ElementState, msg, __FILE__, __LINE__);
+    return nonstd::make_unexpected(Error{ErrorKind::ElementState, msg});
+  }
+  return ret;
+}
+
 }    // namespace ds
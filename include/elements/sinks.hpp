@@ -1,4 +1,5 @@
 #pragma once
+#include <chrono>
 #include <cstdint>
 #include <string>
 #include <string_view>
@@ -89,4 +90,96 @@ private:
   gst::raii::Element mElement;
 };
 
+// splitmuxsink: one muxer and sink per fragment, split at a keyframe once
+// max_size_time or max_size_bytes is reached, with no buffer lost at the cut.
+// location is a printf pattern taking the fragment index, e.g. "cam0_%05d.mp4".
+// ds::SegmentRecorder builds one of these and finalizes the fragments.
+class SplitMuxSink {
+public:
+  [[nodiscard]] static nonstd::expected<SplitMuxSink, ElementError> create(std::string_view name = {}) {
+    GstElement* raw = gst_element_factory_make("splitmuxsink", name.empty() ? nullptr : std::string(name).c_str());
+    if(raw == nullptr) {
+      return nonstd::make_unexpected(ElementError{ErrorKind::ElementCreation, "Failed to create 'splitmuxsink' element"});
+    }
+    return SplitMuxSink{gst::raii::Element{raw}};
+  }
+
+  SplitMuxSink& location(std::string_view pattern) {
+    detail::set_property(mElement.get(), "location", pattern);
+    return *this;
+  }
+
+  // 0 disables the limit.
+  SplitMuxSink& max_size_time(std::chrono::nanoseconds time) {
+    detail::set_property(mElement.get(), "max-size-time", static_cast<guint64>(time.count()));
+    return *this;
+  }
+
+  // 0 disables the limit.
+  SplitMuxSink& max_size_bytes(std::uint64_t bytes) {
+    detail::set_property(mElement.get(), "max-size-bytes", static_cast<guint64>(bytes));
+    return *this;
+  }
+
+  // Reuses file names once this many fragments exist; 0 keeps every fragment.
+  SplitMuxSink& max_files(std::uint32_t files) {
+    detail::set_property(mElement.get(), "max-files", static_cast<guint>(files));
+    return *this;
+  }
+
+  // Asks upstream encoders for a keyframe at each split point, so fragments
+  // end close to max_size_time instead of at the next natural keyframe.
+  SplitMuxSink& send_keyframe_requests(bool enable) {
+    detail::set_property(mElement.get(), "send-keyframe-requests", static_cast<gboolean>(enable));
+    return *this;
+  }
+
+  // Element factories for each fragment's muxer and sink, used with async_finalize().
+  SplitMuxSink& muxer_factory(std::string_view factory) {
+    detail::set_property(mElement.get(), "muxer-factory", factory);
+    return *this;
+  }
+
+  SplitMuxSink& sink_factory(std::string_view factory) {
+    detail::set_property(mElement.get(), "sink-factory", factory);
+    return *this;
+  }
+
+  // Finishes each fragment's muxer and sink (moov atom, file close) on a thread
+  // of their own while the next fragment already records (GStreamer 1.16+).
+  // Returns false, and changes nothing, on older GStreamer.
+  bool async_finalize(bool enable) {
+    if(g_object_class_find_property(G_OBJECT_GET_CLASS(mElement.get()), "async-finalize") == nullptr) {
+      return false;
+    }
+    detail::set_property(mElement.get(), "async-finalize", static_cast<gboolean>(enable));
+    return true;
+  }
+
+  // Starts a new fragment at the next keyframe.
+  void split_now() {
+    g_signal_emit_by_name(mElement.get(), "split-now");
+  }
+
+  [[nodiscard]] GstElement* get() const {
+    return mElement.get();
+  }
+
+  [[nodiscard]] GstElement* release() {
+    return mElement.release();
+  }
+  operator bool() const {
+    return static_cast<bool>(mElement);
+  }
+
+  SplitMuxSink(SplitMuxSink&&) = default;
+  SplitMuxSink& operator=(SplitMuxSink&&) = default;
+  SplitMuxSink(const SplitMuxSink&) = delete;
+  SplitMuxSink& operator=(const SplitMuxSink&) = delete;
+
+private:
+  explicit SplitMuxSink(gst::raii::Element element) : mElement(std::move(element)) {}
+  gst::raii::Element mElement;
+};
+
 }    // namespace ds
@@ -11,6 +11,7 @@ namespace ds {
 
 // Helper for triggering Smart Record on an nvurisrcbin element via signals.
 // Smart Record must first be enabled on the source via UriSource::smart_record().
+// For streams that do not come from nvurisrcbin, see ds::EventRecorder (runtime/event_recorder.hpp).
 struct SmartRecord {
   enum class Mode : std::uint32_t { Off = 0, Cloud = 1, Multi = 2 };
   enum class Container : std::uint32_t { MP4 = 0, MKV = 1 };
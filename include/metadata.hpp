@@ -1,8 +1,16 @@
 #pragma once
+#include <metadata/batch_index.hpp>
 #include <metadata/batch_meta.hpp>
+#include <metadata/batch_record.hpp>
 #include <metadata/classifier_meta.hpp>
 #include <metadata/frame_meta.hpp>
+#include <metadata/meta_exporter.hpp>
+#include <metadata/meta_delta.hpp>
 #include <metadata/meta_list_view.hpp>
+#include <metadata/meta_log.hpp>
+#include <metadata/meta_recorder.hpp>
 #include <metadata/object_meta.hpp>
 #include <metadata/tensor_meta.hpp>
+#include <metadata/track_history.hpp>
+#include <metadata/typed_user_meta.hpp>
 #include <metadata/user_meta.hpp>
@@ -0,0 +1,115 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include <metadata/batch_meta.hpp>
+#include <metadata/frame_meta.hpp>
+#include <nvdsmeta.h>
+
+namespace ds {
+
+// Direct-mapped lookup tables over one batch's frame list, replacing the
+// linear scan of BatchMetaView::frames() for per-source routing.
+//
+//   ds::BatchIndex index;    // keep across batches; tables are reused
+//   // in a pad probe:
+//   index.rebuild(*batch);
+//   if(auto frame = index.frame_by_source(id)) { ... }
+//
+// source_id, pad_index and batch_id are small dense integers assigned by
+// nvstreammux, so each table is a vector indexed by the id. Once the tables
+// have grown to the highest id seen, rebuild() does not allocate. Ids from
+// dense_limit up (a corrupt or unusual id) go to a hash map instead, so one
+// large id cannot make the vector allocate gigabytes. If a batch
+// carries several frames for the same source, the first one in batch order
+// wins. The index holds raw NvDs pointers: rebuild it for every batch and do
+// not use it after the buffer is released.
+class BatchIndex {
+public:
+  // Ids below this are direct-mapped.
+  static constexpr std::uint32_t dense_limit = 4096;
+
+  BatchIndex() = default;
+  explicit BatchIndex(const BatchMetaView& batch) {
+    rebuild(batch);
+  }
+
+  void rebuild(const BatchMetaView& batch) {
+    by_source_.clear();
+    by_pad_.clear();
+    by_batch_id_.clear();
+    size_ = 0;
+    for(const auto frame : batch.frames()) {
+      insert(by_source_, frame.source_id(), frame.get());
+      insert(by_pad_, frame.pad_index(), frame.get());
+      insert(by_batch_id_, frame.batch_id(), frame.get());
+      ++size_;
+    }
+  }
+
+  [[nodiscard]] std::optional<FrameMetaView> frame_by_source(std::uint32_t source_id) const noexcept {
+    return lookup(by_source_, source_id);
+  }
+  [[nodiscard]] std::optional<FrameMetaView> frame_by_pad(std::uint32_t pad_index) const noexcept {
+    return lookup(by_pad_, pad_index);
+  }
+  [[nodiscard]] std::optional<FrameMetaView> frame_by_batch_id(std::uint32_t batch_id) const noexcept {
+    return lookup(by_batch_id_, batch_id);
+  }
+
+  // Number of frames in the indexed batch.
+  [[nodiscard]] std::size_t size() const noexcept {
+    return size_;
+  }
+  [[nodiscard]] bool empty() const noexcept {
+    return size_ == 0;
+  }
+
+private:
+  struct Table {
+    std::vector<NvDsFrameMeta*> dense;
+    std::unordered_map<std::uint32_t, NvDsFrameMeta*> sparse;
+
+    void clear() noexcept {
+      std::fill(dense.begin(), dense.end(), nullptr);
+      sparse.clear();
+    }
+  };
+
+  static void insert(Table& table, std::uint32_t key, NvDsFrameMeta* frame) {
+    if(key >= dense_limit) {
+      table.sparse.try_emplace(key, frame);
+      return;
+    }
+    if(key >= table.dense.size()) {
+      table.dense.resize(static_cast<std::size_t>(key) + 1, nullptr);
+    }
+    if(table.dense[key] == nullptr) {
+      table.dense[key] = frame;
+    }
+  }
+
+  static std::optional<FrameMetaView> lookup(const Table& table, std::uint32_t key) noexcept {
+    NvDsFrameMeta* frame = nullptr;
+    if(key < table.dense.size()) {
+      frame = table.dense[key];
+    } else if(const auto it = table.sparse.find(key); it != table.sparse.end()) {
+      frame = it->second;
+    }
+    if(frame == nullptr) {
+      return std::nullopt;
+    }
+    return FrameMetaView{frame};
+  }
+
+  Table by_source_;
+  Table by_pad_;
+  Table by_batch_id_;
+  std::size_t size_{0};
+};
+
+}    // namespace ds
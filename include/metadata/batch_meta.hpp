@@ -6,6 +6,7 @@
 
 #include <metadata/frame_meta.hpp>
 #include <metadata/meta_list_view.hpp>
+#include <metadata/user_meta.hpp>
 #include <nvdsmeta.h>
 
 namespace ds {
@@ -28,6 +29,10 @@ public:
     return MetaListView<FrameMetaView, NvDsFrameMeta>{meta_->frame_meta_list};
   }
 
+  [[nodiscard]] MetaListView<UserMetaView, NvDsUserMeta> user_meta() const {
+    return MetaListView<UserMetaView, NvDsUserMeta>{meta_->batch_user_meta_list};
+  }
+
   [[nodiscard]] NvDsBatchMeta* get() const {
     return meta_;
   }
@@ -0,0 +1,107 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ds {
+
+// Host-side, columnar copy of the fields most consumers need from one
+// NvDsBatchMeta. Holds no NvDs pointers, so it can outlive the GstBuffer it was
+// captured from and cross thread boundaries.
+//
+// clear() keeps every column's capacity: a record reused across batches stops
+// allocating once it has seen the largest batch.
+struct BatchRecord {
+  struct FrameColumns {
+    std::vector<std::uint64_t> pts;
+    std::vector<std::uint32_t> source_id;
+    std::vector<std::uint32_t> pad_index;
+    std::vector<std::int32_t> frame_num;
+    std::vector<std::uint32_t> object_begin;    // index of the frame's first object
+    std::vector<std::uint32_t> object_count;
+  };
+
+  struct ObjectColumns {
+    std::vector<std::uint64_t> object_id;
+    std::vector<std::int32_t> class_id;
+    std::vector<float> confidence;
+    std::vector<float> left;
+    std::vector<float> top;
+    std::vector<float> width;
+    std::vector<float> height;
+    std::vector<std::uint32_t> label_begin;    // offset into labels
+    std::vector<std::uint32_t> label_size;
+  };
+
+  std::uint64_t sequence{0};
+  FrameColumns frames;
+  ObjectColumns objects;
+  std::string labels;    // concatenated object labels, sliced by label_begin/label_size
+
+  [[nodiscard]] std::size_t num_frames() const noexcept {
+    return frames.pts.size();
+  }
+  [[nodiscard]] std::size_t num_objects() const noexcept {
+    return objects.object_id.size();
+  }
+
+  [[nodiscard]] std::string_view label(std::size_t object) const noexcept {
+    return std::string_view{labels}.substr(objects.label_begin[object], objects.label_size[object]);
+  }
+
+  // Starts a new frame; objects added afterwards belong to it.
+  void add_frame(std::uint64_t pts, std::uint32_t source_id, std::uint32_t pad_index, std::int32_t frame_num) {
+    frames.pts.push_back(pts);
+    frames.source_id.push_back(source_id);
+    frames.pad_index.push_back(pad_index);
+    frames.frame_num.push_back(frame_num);
+    frames.object_begin.push_back(static_cast<std::uint32_t>(num_objects()));
+    frames.object_count.push_back(0);
+  }
+
+  // Appends an object to the most recently added frame.
+  void add_object(std::uint64_t object_id,
+                  std::int32_t class_id,
+                  float confidence,
+                  float left,
+                  float top,
+                  float width,
+                  float height,
+                  std::string_view label) {
+    objects.object_id.push_back(object_id);
+    objects.class_id.push_back(class_id);
+    objects.confidence.push_back(confidence);
+    objects.left.push_back(left);
+    objects.top.push_back(top);
+    objects.width.push_back(width);
+    objects.height.push_back(height);
+    objects.label_begin.push_back(static_cast<std::uint32_t>(labels.size()));
+    objects.label_size.push_back(static_cast<std::uint32_t>(label.size()));
+    labels.append(label);
+    ++frames.object_count.back();
+  }
+
+  void clear() noexcept {
+    sequence = 0;
+    frames.pts.clear();
+    frames.source_id.clear();
+    frames.pad_index.clear();
+    frames.frame_num.clear();
+    frames.object_begin.clear();
+    frames.object_count.clear();
+    objects.object_id.clear();
+    objects.class_id.clear();
+    objects.confidence.clear();
+    objects.left.clear();
+    objects.top.clear();
+    objects.width.clear();
+    objects.height.clear();
+    objects.label_begin.clear();
+    objects.label_size.clear();
+    labels.clear();
+  }
+};
+
+}    // namespace ds
@@ -5,6 +5,7 @@
 
 #include <metadata/meta_list_view.hpp>
 #include <metadata/object_meta.hpp>
+#include <metadata/user_meta.hpp>
 #include <nvdsmeta.h>
 
 namespace ds {
@@ -36,6 +37,10 @@ public:
     return MetaListView<ObjectMetaView, NvDsObjectMeta>{meta_->obj_meta_list};
   }
 
+  [[nodiscard]] MetaListView<UserMetaView, NvDsUserMeta> user_meta() const {
+    return MetaListView<UserMetaView, NvDsUserMeta>{meta_->frame_user_meta_list};
+  }
+
   [[nodiscard]] NvDsFrameMeta* get() const {
     return meta_;
   }
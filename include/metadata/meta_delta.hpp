@@ -0,0 +1,458 @@
+#pragma once
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <metadata/frame_meta.hpp>
+#include <metadata/object_meta.hpp>
+#include <nonstd/expected.hpp>
+#include <nvdsmeta.h>
+#include <utils/error.hpp>
+
+namespace ds {
+
+// One object as carried by the delta stream.
+struct DeltaObject {
+  std::uint64_t object_id{0};
+  std::int32_t class_id{0};
+  BoundingBox box{};
+  float confidence{0.f};
+};
+
+struct MetaDeltaConfig {
+  float box_quantum{0.25f};               // box coordinates are sent in multiples of this many pixels
+  float confidence_quantum{1.f / 256};    // confidence step
+  std::uint32_t keyframe_interval{30};    // every Nth message is a keyframe; 0 = only the first
+};
+
+// Wire format, one message per frame. Integers are LEB128 varints; signed
+// values are zigzag-encoded first.
+//
+//   u8 flags                   bit 0: keyframe
+//   varint sequence            increments by one per message
+//   varint pts
+//   varint quantum_bits[2]     keyframes only: box_quantum, confidence_quantum as IEEE-754 bits
+//   varint record_count
+//   record...
+//
+//   Add    = u8 0, varint object_id, zigzag class_id, zigzag left/top/width/height/confidence
+//   Update = u8 1, varint object_id, u8 field mask, zigzag delta per set field
+//            mask bits: 0 left, 1 top, 2 width, 3 height, 4 confidence, 5 class_id
+//   Remove = u8 2, varint object_id
+//
+// A keyframe carries every object as Add and replaces the decoder's state.
+// Objects whose quantized fields did not change are omitted from deltas.
+// Encoder and decoder both track the quantized integers, so deltas never drift.
+namespace meta_delta {
+
+enum class Op : std::uint8_t { Add = 0, Update = 1, Remove = 2 };
+
+inline constexpr std::uint8_t keyframe_flag = 0x01;
+
+namespace detail {
+
+// A quantum must be a positive, finite step; anything else divides by zero or
+// turns every value into NaN.
+[[nodiscard]] inline bool valid_quantum(float quantum) noexcept {
+  return std::isfinite(quantum) && quantum > 0.f;
+}
+
+struct Quantized {
+  std::int32_t class_id{0};
+  std::int64_t field[5]{};    // left, top, width, height, confidence
+};
+
+inline void put_varint(std::vector<std::byte>& out, std::uint64_t v) {
+  while(v >= 0x80) {
+    out.push_back(static_cast<std::byte>((v & 0x7F) | 0x80));
+    v >>= 7;
+  }
+  out.push_back(static_cast<std::byte>(v));
+}
+
+inline void put_zigzag(std::vector<std::byte>& out, std::int64_t v) {
+  put_varint(out, (static_cast<std::uint64_t>(v) << 1) ^ static_cast<std::uint64_t>(v >> 63));
+}
+
+// Bounds-checked cursor over one message.
+class Reader {
+public:
+  explicit Reader(std::span<const std::byte> bytes) : bytes_(bytes) {}
+
+  bool u8(std::uint8_t& v) noexcept {
+    if(pos_ >= bytes_.size()) {
+      return false;
+    }
+    v = static_cast<std::uint8_t>(bytes_[pos_++]);
+    return true;
+  }
+
+  bool varint(std::uint64_t& v) noexcept {
+    v = 0;
+    for(unsigned shift = 0; shift < 64; shift += 7) {
+      std::uint8_t b = 0;
+      if(!u8(b)) {
+        return false;
+      }
+      v |= static_cast<std::uint64_t>(b & 0x7F) << shift;
+      if((b & 0x80) == 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool zigzag(std::int64_t& v) noexcept {
+    std::uint64_t u = 0;
+    if(!varint(u)) {
+      return false;
+    }
+    v = static_cast<std::int64_t>(u >> 1) ^ -static_cast<std::int64_t>(u & 1);
+    return true;
+  }
+
+  [[nodiscard]] bool done() const noexcept {
+    return pos_ == bytes_.size();
+  }
+
+private:
+  std::span<const std::byte> bytes_;
+  std::size_t pos_{0};
+};
+
+}    // namespace detail
+}    // namespace meta_delta
+
+// Turns a per-frame object set into add/update/remove messages. Use one
+// encoder per stream (source) and feed every frame, including empty ones, so
+// objects that leave are removed. Untracked objects (UNTRACKED_OBJECT_ID)
+// have no stable key and are skipped by the FrameMetaView overload.
+//
+//   auto encoder = ds::MetaDeltaEncoder::create({.keyframe_interval = 60}).value();    // or MetaDeltaEncoder{}
+//   // per frame:
+//   auto bytes = encoder.encode(frame);
+//   publish(bytes);    // socket, NvDsPayload for nvmsgbroker, file, ...
+class MetaDeltaEncoder {
+public:
+  MetaDeltaEncoder() = default;
+
+  [[nodiscard]] static nonstd::expected<MetaDeltaEncoder, Error> create(MetaDeltaConfig config) {
+    if(!meta_delta::detail::valid_quantum(config.box_quantum) ||
+       !meta_delta::detail::valid_quantum(config.confidence_quantum)) {
+      return nonstd::make_unexpected(
+          Error{ErrorKind::InvalidArgument, "MetaDeltaEncoder: box_quantum and confidence_quantum must be finite and > 0"});
+    }
+    return MetaDeltaEncoder{config};
+  }
+
+  // Encodes one frame. The returned bytes stay valid until the next encode().
+  std::span<const std::byte> encode(std::uint64_t pts, std::span<const DeltaObject> objects) {
+    using meta_delta::Op;
+    using meta_delta::detail::put_varint;
+    using meta_delta::detail::put_zigzag;
+
+    const bool periodic = config_.keyframe_interval != 0 && sequence_ % config_.keyframe_interval == 0;
+    const bool keyframe = force_keyframe_ || sequence_ == 0 || periodic;
+    force_keyframe_ = false;
+    ++frame_stamp_;
+
+    message_.clear();
+    message_.push_back(static_cast<std::byte>(keyframe ? meta_delta::keyframe_flag : 0));
+    put_varint(message_, sequence_++);
+    put_varint(message_, pts);
+    if(keyframe) {
+      put_varint(message_, std::bit_cast<std::uint32_t>(config_.box_quantum));
+      put_varint(message_, std::bit_cast<std::uint32_t>(config_.confidence_quantum));
+      state_.clear();
+    }
+    records_.clear();
+    for(const auto& obj : objects) {
+      const auto q = quantize(obj);
+      auto [it, inserted] = state_.try_emplace(obj.object_id, Entry{q, frame_stamp_});
+      if(inserted) {
+        put_add(obj.object_id, q);
+        continue;
+      }
+      auto& prev = it->second;
+      prev.seen = frame_stamp_;
+      std::uint8_t mask = 0;
+      for(unsigned f = 0; f < 5; ++f) {
+        mask |= static_cast<std::uint8_t>((q.field[f] != prev.q.field[f] ? 1U : 0U) << f);
+      }
+      mask |= static_cast<std::uint8_t>((q.class_id != prev.q.class_id ? 1U : 0U) << 5);
+      if(mask == 0) {
+        continue;
+      }
+      records_.push_back(static_cast<std::byte>(Op::Update));
+      put_varint(records_, obj.object_id);
+      records_.push_back(static_cast<std::byte>(mask));
+      for(unsigned f = 0; f < 5; ++f) {
+        if((mask & (1U << f)) != 0) {
+          put_zigzag(records_, q.field[f] - prev.q.field[f]);
+        }
+      }
+      if((mask & (1U << 5)) != 0) {
+        put_zigzag(records_, static_cast<std::int64_t>(q.class_id) - prev.q.class_id);
+      }
+      prev.q = q;
+      ++record_count_;
+    }
+    for(auto it = state_.begin(); it != state_.end();) {
+      if(it->second.seen != frame_stamp_) {
+        records_.push_back(static_cast<std::byte>(Op::Remove));
+        put_varint(records_, it->first);
+        ++record_count_;
+        it = state_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+
+    put_varint(message_, record_count_);
+    message_.insert(message_.end(), records_.begin(), records_.end());
+    record_count_ = 0;
+
+    ++messages_;
+    keyframes_ += keyframe ? 1 : 0;
+    bytes_ += message_.size();
+    return message_;
+  }
+
+  std::span<const std::byte> encode(const FrameMetaView& frame) {
+    scratch_.clear();
+    for(const auto obj : frame.objects()) {
+      if(obj.object_id() == UNTRACKED_OBJECT_ID) {
+        continue;
+      }
+      scratch_.push_back({obj.object_id(), obj.class_id(), obj.rect(), obj.confidence()});
+    }
+    return encode(frame.buf_pts(), scratch_);
+  }
+
+  // Makes the next message a keyframe, e.g. when a consumer (re)subscribes.
+  void force_keyframe() noexcept {
+    force_keyframe_ = true;
+  }
+
+  [[nodiscard]] std::uint64_t messages() const noexcept {
+    return messages_;
+  }
+  [[nodiscard]] std::uint64_t keyframes() const noexcept {
+    return keyframes_;
+  }
+  [[nodiscard]] std::uint64_t bytes() const noexcept {
+    return bytes_;
+  }
+
+private:
+  using Quantized = meta_delta::detail::Quantized;
+
+  explicit MetaDeltaEncoder(MetaDeltaConfig config) : config_(config) {}
+
+  struct Entry {
+    Quantized q;
+    std::uint64_t seen;
+  };
+
+  [[nodiscard]] Quantized quantize(const DeltaObject& obj) const noexcept {
+    const auto box = [this](float v) { return static_cast<std::int64_t>(std::llround(v / config_.box_quantum)); };
+    Quantized q;
+    q.class_id = obj.class_id;
+    q.field[0] = box(obj.box.left);
+    q.field[1] = box(obj.box.top);
+    q.field[2] = box(obj.box.width);
+    q.field[3] = box(obj.box.height);
+    q.field[4] = static_cast<std::int64_t>(std::llround(obj.confidence / config_.confidence_quantum));
+    return q;
+  }
+
+  void put_add(std::uint64_t id, const Quantized& q) {
+    records_.push_back(static_cast<std::byte>(meta_delta::Op::Add));
+    meta_delta::detail::put_varint(records_, id);
+    meta_delta::detail::put_zigzag(records_, q.class_id);
+    for(const auto v : q.field) {
+      meta_delta::detail::put_zigzag(records_, v);
+    }
+    ++record_count_;
+  }
+
+  MetaDeltaConfig config_;
+  std::unordered_map<std::uint64_t, Entry> state_;
+  std::vector<std::byte> message_;
+  std::vector<std::byte> records_;
+  std::vector<DeltaObject> scratch_;
+  std::uint64_t record_count_{0};
+  std::uint64_t sequence_{0};
+  std::uint64_t frame_stamp_{0};
+  std::uint64_t messages_{0};
+  std::uint64_t keyframes_{0};
+  std::uint64_t bytes_{0};
+  bool force_keyframe_{false};
+};
+
+// Rebuilds the full object set from MetaDeltaEncoder messages. After a lost
+// or corrupt message decode() fails until the next keyframe arrives.
+class MetaDeltaDecoder {
+public:
+  nonstd::expected<void, Error> decode(std::span<const std::byte> message) {
+    using meta_delta::Op;
+    meta_delta::detail::Reader in{message};
+
+    std::uint8_t flags = 0;
+    std::uint64_t sequence = 0;
+    std::uint64_t pts = 0;
+    if(!in.u8(flags) || !in.varint(sequence) || !in.varint(pts)) {
+      return nonstd::make_unexpected(corrupt("truncated message header"));
+    }
+    if((flags & meta_delta::keyframe_flag) != 0) {
+      std::uint64_t box_bits = 0;
+      std::uint64_t conf_bits = 0;
+      if(!in.varint(box_bits) || !in.varint(conf_bits)) {
+        return nonstd::make_unexpected(corrupt("truncated keyframe header"));
+      }
+      const auto box_quantum = std::bit_cast<float>(static_cast<std::uint32_t>(box_bits));
+      const auto conf_quantum = std::bit_cast<float>(static_cast<std::uint32_t>(conf_bits));
+      if(!meta_delta::detail::valid_quantum(box_quantum) || !meta_delta::detail::valid_quantum(conf_quantum)) {
+        return nonstd::make_unexpected(corrupt("keyframe quantum is not a positive finite number"));
+      }
+      box_quantum_ = box_quantum;
+      conf_quantum_ = conf_quantum;
+      state_.clear();
+      objects_.clear();
+      synced_ = true;
+    } else if(!synced_ || sequence != next_sequence_) {
+      synced_ = false;
+      return nonstd::make_unexpected(Error{ErrorKind::Decode, "Delta message out of sequence; waiting for keyframe"});
+    }
+    std::uint64_t count = 0;
+    if(!in.varint(count)) {
+      return nonstd::make_unexpected(corrupt("truncated message header"));
+    }
+
+    for(std::uint64_t i = 0; i < count; ++i) {
+      std::uint8_t op = 0;
+      std::uint64_t id = 0;
+      if(!in.u8(op) || !in.varint(id)) {
+        return nonstd::make_unexpected(corrupt("truncated record"));
+      }
+      switch(static_cast<Op>(op)) {
+      case Op::Add: {
+        Slot slot{};
+        std::int64_t class_id = 0;
+        if(!in.zigzag(class_id)) {
+          return nonstd::make_unexpected(corrupt("truncated add record"));
+        }
+        slot.q.class_id = static_cast<std::int32_t>(class_id);
+        for(auto& v : slot.q.field) {
+          if(!in.zigzag(v)) {
+            return nonstd::make_unexpected(corrupt("truncated add record"));
+          }
+        }
+        slot.index = objects_.size();
+        auto [it, inserted] = state_.try_emplace(id, slot);
+        if(!inserted) {
+          return nonstd::make_unexpected(corrupt("add for an object that already exists"));
+        }
+        objects_.emplace_back();
+        store(id, it->second);
+        break;
+      }
+      case Op::Update: {
+        auto it = state_.find(id);
+        std::uint8_t mask = 0;
+        if(it == state_.end() || !in.u8(mask)) {
+          return nonstd::make_unexpected(corrupt("update for an unknown object"));
+        }
+        for(unsigned f = 0; f < 5; ++f) {
+          std::int64_t delta = 0;
+          if((mask & (1U << f)) != 0) {
+            if(!in.zigzag(delta)) {
+              return nonstd::make_unexpected(corrupt("truncated update record"));
+            }
+            it->second.q.field[f] += delta;
+          }
+        }
+        if((mask & (1U << 5)) != 0) {
+          std::int64_t delta = 0;
+          if(!in.zigzag(delta)) {
+            return nonstd::make_unexpected(corrupt("truncated update record"));
+          }
+          it->second.q.class_id = static_cast<std::int32_t>(it->second.q.class_id + delta);
+        }
+        store(id, it->second);
+        break;
+      }
+      case Op::Remove: {
+        auto it = state_.find(id);
+        if(it == state_.end()) {
+          return nonstd::make_unexpected(corrupt("remove for an unknown object"));
+        }
+        // Swap-remove: the last object takes the removed object's slot.
+        const auto index = it->second.index;
+        if(index + 1 != objects_.size()) {
+          objects_[index] = objects_.back();
+          state_.at(objects_[index].object_id).index = index;
+        }
+        objects_.pop_back();
+        state_.erase(it);
+        break;
+      }
+      default:
+        return nonstd::make_unexpected(corrupt("unknown record type"));
+      }
+    }
+    if(!in.done()) {
+      return nonstd::make_unexpected(corrupt("trailing bytes after last record"));
+    }
+    pts_ = pts;
+    next_sequence_ = sequence + 1;
+    return {};
+  }
+
+  // Current object set; order is not preserved across removals.
+  [[nodiscard]] std::span<const DeltaObject> objects() const noexcept {
+    return objects_;
+  }
+  [[nodiscard]] std::uint64_t pts() const noexcept {
+    return pts_;
+  }
+  // False after a decode error until the next keyframe.
+  [[nodiscard]] bool synced() const noexcept {
+    return synced_;
+  }
+
+private:
+  struct Slot {
+    meta_delta::detail::Quantized q;
+    std::size_t index;    // position in objects_
+  };
+
+  // Marks the stream unsynced; the caller returns the error.
+  Error corrupt(const char* what) {
+    synced_ = false;
+    return Error{ErrorKind::Decode, std::string{"Malformed delta message: "} + what};
+  }
+
+  void store(std::uint64_t id, const Slot& slot) {
+    const auto box = [this](std::int64_t v) { return static_cast<float>(v) * box_quantum_; };
+    objects_[slot.index] = {id,
+                            slot.q.class_id,
+                            {box(slot.q.field[0]), box(slot.q.field[1]), box(slot.q.field[2]), box(slot.q.field[3])},
+                            static_cast<float>(slot.q.field[4]) * conf_quantum_};
+  }
+
+  std::unordered_map<std::uint64_t, Slot> state_;
+  std::vector<DeltaObject> objects_;
+  float box_quantum_{1.f};
+  float conf_quantum_{1.f};
+  std::uint64_t pts_{0};
+  std::uint64_t next_sequence_{0};
+  bool synced_{false};
+};
+
+}    // namespace ds
@@ -0,0 +1,264 @@
+#pragma once
+#include <atomic>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <metadata/batch_meta.hpp>
+#include <metadata/batch_record.hpp>
+#include <metadata/meta_log.hpp>
+#include <metadata/meta_recorder.hpp>
+#include <nonstd/expected.hpp>
+#include <utils/bounded_queue.hpp>
+#include <utils/error.hpp>
+
+namespace ds {
+
+// What submit() does when every pooled record is still waiting to be written.
+enum class Backpressure {
+  DropNewest,    // discard the batch being submitted (never blocks)
+  DropOldest,    // overwrite the oldest batch not yet written (never blocks)
+  Block,         // wait for the writer to return a record (stalls the pipeline)
+};
+
+struct MetaExporterConfig {
+  std::size_t pool_size{8};    // records in flight between the probe and the writer
+  Backpressure backpressure{Backpressure::DropNewest};
+};
+
+struct MetaExporterStats {
+  std::uint64_t submitted{0};       // submit() calls; after close() == exported + dropped + write_errors
+  std::uint64_t exported{0};        // batches the sink wrote successfully
+  std::uint64_t dropped{0};         // batches discarded by the backpressure policy
+  std::uint64_t write_errors{0};    // batches the sink rejected
+};
+
+// Moves metadata output off the streaming thread. submit() copies the fields of
+// a batch into a pre-allocated BatchRecord and hands its index to a background
+// writer through a lock-free queue; the writer calls the sink and returns the
+// record to the pool. The probe never performs I/O and, once every record has
+// grown to the largest batch seen, never allocates.
+//
+//   auto exporter = ds::MetaExporter::to_log("/data/run.dsmeta").value();
+//   // in a pad probe:
+//   if(auto batch = ds::BatchMetaView::from_buffer(buf)) {
+//     exporter.submit(*batch);
+//   }
+//
+// Sequence numbers are assigned at submit(), so batches lost to backpressure
+// show up as gaps in the exported sequence. Stop the producers (set the
+// pipeline to NULL) before close().
+class MetaExporter {
+public:
+  using Sink = std::function<nonstd::expected<void, Error>(const BatchRecord&)>;
+
+  [[nodiscard]] static nonstd::expected<MetaExporter, Error> create(Sink sink, MetaExporterConfig config = {}) {
+    if(!sink) {
+      return nonstd::make_unexpected(Error{ErrorKind::InvalidArgument, "MetaExporter requires a sink"});
+    }
+    if(config.pool_size == 0) {
+      return nonstd::make_unexpected(Error{ErrorKind::InvalidArgument, "MetaExporter pool_size must be at least 1"});
+    }
+    auto state = std::make_unique<State>(std::move(sink), config);
+    try {
+      std::thread worker{&State::run, state.get()};
+      return MetaExporter{std::move(state), std::move(worker)};
+    } catch(const std::system_error& e) {
+      return nonstd::make_unexpected(Error{ErrorKind::Unknown, std::string{"Failed to start export thread: "} + e.what()});
+    }
+  }
+
+  // Exports into a metadata log (see meta_log.hpp) written on the background thread.
+  [[nodiscard]] static nonstd::expected<MetaExporter, Error>
+  to_log(std::string_view path, MetaExporterConfig config = {}, std::uint32_t index_interval = 64) {
+    auto writer = MetaLogWriter::create(path, index_interval);
+    if(!writer) {
+      return nonstd::make_unexpected(std::move(writer.error()));
+    }
+    auto log = std::make_shared<MetaLogWriter>(std::move(*writer));
+    return create([log](const BatchRecord& record) { return log->append(record); }, config);
+  }
+
+  // Returns false if the batch was dropped.
+  bool submit(const BatchMetaView& batch) {
+    return submit_with([&batch](BatchRecord& record) { capture(batch, record); });
+  }
+
+  // Like submit(), but fill populates the (cleared) pooled record itself. If
+  // fill throws, the record goes back to the pool, the batch counts as dropped
+  // and the exception propagates.
+  template <typename Fill>
+    requires std::invocable<Fill&, BatchRecord&>
+  bool submit_with(Fill&& fill) {
+    auto& s = *state_;
+    const auto sequence = s.submitted.fetch_add(1, std::memory_order_relaxed);
+    if(s.stopping.load(std::memory_order_acquire)) {
+      s.dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    const auto slot = s.acquire();
+    if(!slot) {
+      s.dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    auto& record = s.pool[*slot];
+    record.clear();
+    try {
+      fill(record);
+    } catch(...) {
+      s.release(*slot);
+      s.dropped.fetch_add(1, std::memory_order_relaxed);
+      throw;
+    }
+    record.sequence = sequence;
+    (void)s.ready.try_push(*slot);    // cannot fail: ready holds at most pool_size indices
+    s.wake.fetch_add(1, std::memory_order_release);
+    s.wake.notify_one();
+    return true;
+  }
+
+  // Writes everything already submitted, then stops the background thread.
+  // Idempotent; later submit() calls are counted as dropped.
+  void close() {
+    if(!state_ || !worker_.joinable()) {
+      return;
+    }
+    state_->stopping.store(true, std::memory_order_release);
+    state_->wake.fetch_add(1, std::memory_order_release);
+    state_->wake.notify_one();
+    state_->freed.fetch_add(1, std::memory_order_release);
+    state_->freed.notify_all();
+    worker_.join();
+  }
+
+  [[nodiscard]] MetaExporterStats stats() const noexcept {
+    const auto& s = *state_;
+    return {s.submitted.load(std::memory_order_relaxed),
+            s.exported.load(std::memory_order_relaxed),
+            s.dropped.load(std::memory_order_relaxed),
+            s.write_errors.load(std::memory_order_relaxed)};
+  }
+
+  [[nodiscard]] Backpressure backpressure() const noexcept {
+    return state_->policy;
+  }
+
+  ~MetaExporter() {
+    close();
+  }
+
+  MetaExporter(MetaExporter&&) noexcept = default;
+  MetaExporter& operator=(MetaExporter&& other) noexcept {
+    if(this != &other) {
+      close();
+      state_ = std::move(other.state_);
+      worker_ = std::move(other.worker_);
+    }
+    return *this;
+  }
+  MetaExporter(const MetaExporter&) = delete;
+  MetaExporter& operator=(const MetaExporter&) = delete;
+
+private:
+  // Heap-allocated so the worker's pointer survives moves of the MetaExporter.
+  struct State {
+    State(Sink s, const MetaExporterConfig& config)
+        : sink(std::move(s))
+        , policy(config.backpressure)
+        , pool(config.pool_size)
+        , idle(config.pool_size)
+        , ready(config.pool_size) {
+      for(std::uint32_t i = 0; i < config.pool_size; ++i) {
+        (void)idle.try_push(i);
+      }
+    }
+
+    // Takes a record index for the producer, applying the backpressure policy.
+    std::optional<std::uint32_t> acquire() {
+      if(auto slot = idle.try_pop()) {
+        return slot;
+      }
+      switch(policy) {
+      case Backpressure::DropNewest:
+        return std::nullopt;
+      case Backpressure::DropOldest:
+        if(auto oldest = ready.try_pop()) {
+          dropped.fetch_add(1, std::memory_order_relaxed);
+          return oldest;
+        }
+        return std::nullopt;
+      case Backpressure::Block:
+        for(;;) {
+          const auto seen = freed.load(std::memory_order_acquire);
+          if(auto slot = idle.try_pop()) {
+            return slot;
+          }
+          if(stopping.load(std::memory_order_acquire)) {
+            return std::nullopt;
+          }
+          freed.wait(seen, std::memory_order_acquire);
+        }
+      }
+      return std::nullopt;
+    }
+
+    void drain() {
+      while(auto slot = ready.try_pop()) {
+        if(sink(pool[*slot])) {
+          exported.fetch_add(1, std::memory_order_relaxed);
+        } else {
+          write_errors.fetch_add(1, std::memory_order_relaxed);
+        }
+        release(*slot);
+      }
+    }
+
+    // Returns a record index to the producers and wakes a Block producer.
+    void release(std::uint32_t slot) {
+      (void)idle.try_push(slot);    // cannot fail: idle holds at most pool_size indices
+      freed.fetch_add(1, std::memory_order_release);
+      freed.notify_all();
+    }
+
+    void run() {
+      for(;;) {
+        const auto seen = wake.load(std::memory_order_acquire);
+        drain();
+        if(stopping.load(std::memory_order_acquire)) {
+          drain();
+          return;
+        }
+        wake.wait(seen, std::memory_order_acquire);
+      }
+    }
+
+    Sink sink;
+    Backpressure policy;
+    std::vector<BatchRecord> pool;
+    BoundedQueue<std::uint32_t> idle;       // indices the producer may fill
+    BoundedQueue<std::uint32_t> ready;      // indices waiting for the sink, oldest first
+    std::atomic<std::uint32_t> wake{0};     // bumped per submit; the writer sleeps on it
+    std::atomic<std::uint32_t> freed{0};    // bumped per written record; Block producers sleep on it
+    std::atomic<bool> stopping{false};
+    std::atomic<std::uint64_t> submitted{0};    // doubles as the sequence counter
+    std::atomic<std::uint64_t> exported{0};
+    std::atomic<std::uint64_t> dropped{0};
+    std::atomic<std::uint64_t> write_errors{0};
+  };
+
+  MetaExporter(std::unique_ptr<State> state, std::thread worker) : state_(std::move(state)), worker_(std::move(worker)) {}
+
+  std::unique_ptr<State> state_;
+  std::thread worker_;
+};
+
+}    // namespace ds
@@ -0,0 +1,773 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <fcntl.h>
+#include <metadata/batch_record.hpp>
+#include <nonstd/expected.hpp>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utils/error.hpp>
+
+namespace ds {
+
+// ============================================================================
+// Metadata log — append-only, mmap-readable binary format
+// ============================================================================
+// One file per recording session. All integers are little-endian, every block
+// starts on an 8-byte boundary, and every column starts on its element's
+// natural alignment, so a reader can mmap the file and hand out spans directly.
+//
+//   FileHeader   (32 B)  magic "DSMETALG", version, index_interval
+//   Block*               BlockHeader (16 B) + payload, padded to 8 B
+//   Trailer      (16 B)  only after a clean close(): last Index block offset
+//
+// Batch block payload (type 1):
+//   BatchHeader  (32 B)  sequence, first_pts, num_frames (F), num_objects (O), num_labels (L)
+//   frame columns        u64 pts[F] | u32 source_id[F] | u32 pad_index[F] |
+//                        i32 frame_num[F] | u32 object_begin[F] | u32 object_count[F]   (pad 8)
+//   object columns       u64 object_id[O] | i32 class_id[O] | u32 label[O] |
+//                        f32 confidence[O] | f32 left[O] | f32 top[O] |
+//                        f32 width[O] | f32 height[O]                                     (pad 8)
+//   label table          u32 label_offsets[L + 1] | char chars[label_offsets[L]]         (pad 8)
+//   Each batch carries its own label table, so a batch decodes without any
+//   other block.
+//
+// Index block payload (type 2), written every index_interval batches and on close():
+//   u64 prev_index_offset (0 = first) | u32 count | u32 reserved |
+//   { u64 offset; u64 sequence; u64 first_pts; }[count]
+//
+// Readers follow the index chain backwards from the trailer. A file without a
+// trailer (writer crashed) is recovered by walking block headers; a torn final
+// block is ignored.
+namespace meta_log {
+
+inline constexpr std::array<char, 8> file_magic{'D', 'S', 'M', 'E', 'T', 'A', 'L', 'G'};
+inline constexpr std::array<char, 8> trailer_magic{'D', 'S', 'M', 'E', 'T', 'E', 'N', 'D'};
+inline constexpr std::uint32_t format_version = 1;
+inline constexpr std::uint64_t no_pts = std::numeric_limits<std::uint64_t>::max();
+
+enum class BlockType : std::uint32_t { Batch = 1, Index = 2 };
+
+struct FileHeader {
+  std::array<char, 8> magic{file_magic};
+  std::uint32_t version{format_version};
+  std::uint32_t header_size{sizeof(FileHeader)};
+  std::uint32_t index_interval{0};
+  std::uint32_t reserved0{0};
+  std::uint64_t reserved1{0};
+};
+
+struct BlockHeader {
+  BlockType type{BlockType::Batch};
+  std::uint32_t reserved{0};
+  std::uint64_t payload_size{0};    // excludes padding
+};
+
+struct BatchHeader {
+  std::uint64_t sequence{0};
+  std::uint64_t first_pts{no_pts};
+  std::uint32_t num_frames{0};
+  std::uint32_t num_objects{0};
+  std::uint32_t num_labels{0};
+  std::uint32_t reserved{0};
+};
+
+struct IndexHeader {
+  std::uint64_t prev_index_offset{0};
+  std::uint32_t count{0};
+  std::uint32_t reserved{0};
+};
+
+struct IndexEntry {
+  std::uint64_t offset{0};    // of the Batch block header
+  std::uint64_t sequence{0};
+  std::uint64_t first_pts{no_pts};
+};
+
+struct Trailer {
+  std::uint64_t last_index_offset{0};
+  std::array<char, 8> magic{trailer_magic};
+};
+
+static_assert(sizeof(FileHeader) == 32);
+static_assert(sizeof(BlockHeader) == 16);
+static_assert(sizeof(BatchHeader) == 32);
+static_assert(sizeof(IndexHeader) == 16);
+static_assert(sizeof(IndexEntry) == 24);
+static_assert(sizeof(Trailer) == 16);
+
+[[nodiscard]] constexpr std::size_t align8(std::size_t n) noexcept {
+  return (n + 7U) & ~std::size_t{7U};
+}
+
+// Byte offsets of every column inside a Batch payload.
+struct BatchLayout {
+  std::size_t pts, source_id, pad_index, frame_num, object_begin, object_count;
+  std::size_t object_id, class_id, label, confidence, left, top, width, height;
+  std::size_t label_offsets, label_chars;
+  std::size_t size_without_chars;
+
+  [[nodiscard]] static constexpr BatchLayout compute(std::size_t frames, std::size_t objects, std::size_t labels) noexcept {
+    BatchLayout l{};
+    std::size_t at = sizeof(BatchHeader);
+    l.pts = at;
+    at += frames * 8U;
+    l.source_id = at;
+    at += frames * 4U;
+    l.pad_index = at;
+    at += frames * 4U;
+    l.frame_num = at;
+    at += frames * 4U;
+    l.object_begin = at;
+    at += frames * 4U;
+    l.object_count = at;
+    at = align8(at + frames * 4U);
+    l.object_id = at;
+    at += objects * 8U;
+    l.class_id = at;
+    at += objects * 4U;
+    l.label = at;
+    at += objects * 4U;
+    l.confidence = at;
+    at += objects * 4U;
+    l.left = at;
+    at += objects * 4U;
+    l.top = at;
+    at += objects * 4U;
+    l.width = at;
+    at += objects * 4U;
+    l.height = at;
+    at = align8(at + objects * 4U);
+    l.label_offsets = at;
+    l.label_chars = at + (labels + 1U) * 4U;
+    l.size_without_chars = l.label_chars;
+    return l;
+  }
+};
+
+namespace detail {
+
+inline Error io_error(std::string_view what, std::string_view path) {
+  return Error{ErrorKind::FileIO, fmt::format("{} '{}': {}", what, path, std::strerror(errno))};
+}
+
+inline bool write_all(int fd, const void* data, std::size_t size) noexcept {
+  const auto* p = static_cast<const char*>(data);
+  while(size > 0) {
+    const ssize_t n = ::write(fd, p, size);
+    if(n < 0) {
+      if(errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    p += n;
+    size -= static_cast<std::size_t>(n);
+  }
+  return true;
+}
+
+template <typename T>
+  requires std::is_trivially_copyable_v<T>
+void put(std::vector<std::byte>& buf, std::size_t offset, std::span<const T> values) noexcept {
+  if(!values.empty()) {
+    std::memcpy(buf.data() + offset, values.data(), values.size_bytes());
+  }
+}
+
+}    // namespace detail
+
+}    // namespace meta_log
+
+// ============================================================================
+// MetaLogWriter — serializes BatchRecords into one append-only file
+// ============================================================================
+// One write(2) per batch: the block is assembled in a reusable buffer first.
+//
+//   auto log = ds::MetaLogWriter::create("/data/run.dsmeta").value();
+//   log.append(record);
+//   log.close();
+class MetaLogWriter {
+public:
+  [[nodiscard]] static nonstd::expected<MetaLogWriter, Error> create(std::string_view path,
+                                                                     std::uint32_t index_interval = 64) {
+    const std::string path_str{path};
+    const int fd = ::open(path_str.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(fd < 0) {
+      return nonstd::make_unexpected(meta_log::detail::io_error("Failed to open metadata log", path));
+    }
+    meta_log::FileHeader header{};
+    header.index_interval = index_interval == 0 ? 1 : index_interval;
+    if(!meta_log::detail::write_all(fd, &header, sizeof(header))) {
+      auto err = meta_log::detail::io_error("Failed to write metadata log header", path);
+      ::close(fd);
+      return nonstd::make_unexpected(std::move(err));
+    }
+    return MetaLogWriter{fd, path_str, header.index_interval};
+  }
+
+  ~MetaLogWriter() {
+    (void)close();
+  }
+
+  MetaLogWriter(MetaLogWriter&& other) noexcept
+      : fd_(std::exchange(other.fd_, -1))
+      , path_(std::move(other.path_))
+      , index_interval_(other.index_interval_)
+      , offset_(other.offset_)
+      , last_index_offset_(other.last_index_offset_)
+      , batches_written_(other.batches_written_)
+      , pending_(std::move(other.pending_))
+      , buffer_(std::move(other.buffer_))
+      , label_index_(std::move(other.label_index_))
+      , label_views_(std::move(other.label_views_)) {}
+
+  MetaLogWriter& operator=(MetaLogWriter&& other) noexcept {
+    if(this != &other) {
+      (void)close();
+      fd_ = std::exchange(other.fd_, -1);
+      path_ = std::move(other.path_);
+      index_interval_ = other.index_interval_;
+      offset_ = other.offset_;
+      last_index_offset_ = other.last_index_offset_;
+      batches_written_ = other.batches_written_;
+      pending_ = std::move(other.pending_);
+      buffer_ = std::move(other.buffer_);
+      label_index_ = std::move(other.label_index_);
+      label_views_ = std::move(other.label_views_);
+    }
+    return *this;
+  }
+
+  MetaLogWriter(const MetaLogWriter&) = delete;
+  MetaLogWriter& operator=(const MetaLogWriter&) = delete;
+
+  [[nodiscard]] nonstd::expected<void, Error> append(const BatchRecord& record) {
+    if(fd_ < 0) {
+      return nonstd::make_unexpected(Error{ErrorKind::FileIO, "Metadata log is closed"});
+    }
+
+    // Per-batch label table: the handful of distinct labels in a batch, by first appearance.
+    label_index_.clear();
+    std::vector<std::string_view>& labels = label_views_;
+    labels.clear();
+    for(std::size_t i = 0; i < record.num_objects(); ++i) {
+      const std::string_view label = record.label(i);
+      const auto it = std::find(labels.begin(), labels.end(), label);
+      label_index_.push_back(static_cast<std::uint32_t>(it - labels.begin()));
+      if(it == labels.end()) {
+        labels.push_back(label);
+      }
+    }
+
+    const std::size_t nf = record.num_frames();
+    const std::size_t no = record.num_objects();
+    const auto layout = meta_log::BatchLayout::compute(nf, no, labels.size());
+
+    std::size_t chars = 0;
+    for(const auto l : labels) {
+      chars += l.size();
+    }
+    const std::size_t payload = layout.size_without_chars + chars;
+    const std::size_t block = sizeof(meta_log::BlockHeader) + meta_log::align8(payload);
+    buffer_.assign(block, std::byte{0});
+
+    const meta_log::BlockHeader bh{meta_log::BlockType::Batch, 0, payload};
+    std::memcpy(buffer_.data(), &bh, sizeof(bh));
+    const std::size_t base = sizeof(meta_log::BlockHeader);
+
+    meta_log::BatchHeader hdr{};
+    hdr.sequence = record.sequence;
+    hdr.first_pts = nf > 0 ? *std::min_element(record.frames.pts.begin(), record.frames.pts.end()) : meta_log::no_pts;
+    hdr.num_frames = static_cast<std::uint32_t>(nf);
+    hdr.num_objects = static_cast<std::uint32_t>(no);
+    hdr.num_labels = static_cast<std::uint32_t>(labels.size());
+    std::memcpy(buffer_.data() + base, &hdr, sizeof(hdr));
+
+    using meta_log::detail::put;
+    const auto& f = record.frames;
+    put(buffer_, base + layout.pts, std::span{f.pts});
+    put(buffer_, base + layout.source_id, std::span{f.source_id});
+    put(buffer_, base + layout.pad_index, std::span{f.pad_index});
+    put(buffer_, base + layout.frame_num, std::span{f.frame_num});
+    put(buffer_, base + layout.object_begin, std::span{f.object_begin});
+    put(buffer_, base + layout.object_count, std::span{f.object_count});
+
+    const auto& o = record.objects;
+    put(buffer_, base + layout.object_id, std::span{o.object_id});
+    put(buffer_, base + layout.class_id, std::span{o.class_id});
+    put(buffer_, base + layout.label, std::span{std::as_const(label_index_)});
+    put(buffer_, base + layout.confidence, std::span{o.confidence});
+    put(buffer_, base + layout.left, std::span{o.left});
+    put(buffer_, base + layout.top, std::span{o.top});
+    put(buffer_, base + layout.width, std::span{o.width});
+    put(buffer_, base + layout.height, std::span{o.height});
+
+    std::uint32_t char_offset = 0;
+    std::size_t at = base + layout.label_offsets;
+    for(const auto l : labels) {
+      std::memcpy(buffer_.data() + at, &char_offset, sizeof(char_offset));
+      std::memcpy(buffer_.data() + base + layout.label_chars + char_offset, l.data(), l.size());
+      char_offset += static_cast<std::uint32_t>(l.size());
+      at += sizeof(std::uint32_t);
+    }
+    std::memcpy(buffer_.data() + at, &char_offset, sizeof(char_offset));
+
+    if(!meta_log::detail::write_all(fd_, buffer_.data(), buffer_.size())) {
+      return nonstd::make_unexpected(meta_log::detail::io_error("Failed to append to metadata log", path_));
+    }
+    pending_.push_back(meta_log::IndexEntry{offset_, hdr.sequence, hdr.first_pts});
+    offset_ += buffer_.size();
+    ++batches_written_;
+
+    if(pending_.size() >= index_interval_) {
+      return write_index();
+    }
+    return {};
+  }
+
+  // Flushes the pending index block and writes the trailer. Idempotent.
+  nonstd::expected<void, Error> close() {
+    if(fd_ < 0) {
+      return {};
+    }
+    nonstd::expected<void, Error> result{};
+    if(!pending_.empty() || last_index_offset_ == 0) {
+      result = write_index();
+    }
+    if(result) {
+      const meta_log::Trailer trailer{last_index_offset_, meta_log::trailer_magic};
+      if(!meta_log::detail::write_all(fd_, &trailer, sizeof(trailer))) {
+        result = nonstd::make_unexpected(meta_log::detail::io_error("Failed to write metadata log trailer", path_));
+      }
+    }
+    ::close(fd_);
+    fd_ = -1;
+    return result;
+  }
+
+  [[nodiscard]] bool is_open() const noexcept {
+    return fd_ >= 0;
+  }
+  [[nodiscard]] std::uint64_t batches_written() const noexcept {
+    return batches_written_;
+  }
+  [[nodiscard]] std::uint64_t bytes_written() const noexcept {
+    return offset_;
+  }
+
+private:
+  MetaLogWriter(int fd, std::string path, std::uint32_t index_interval)
+      : fd_(fd), path_(std::move(path)), index_interval_(index_interval), offset_(sizeof(meta_log::FileHeader)) {}
+
+  nonstd::expected<void, Error> write_index() {
+    const std::size_t payload = sizeof(meta_log::IndexHeader) + pending_.size() * sizeof(meta_log::IndexEntry);
+    buffer_.assign(sizeof(meta_log::BlockHeader) + payload, std::byte{0});
+
+    const meta_log::BlockHeader bh{meta_log::BlockType::Index, 0, payload};
+    const meta_log::IndexHeader ih{last_index_offset_, static_cast<std::uint32_t>(pending_.size()), 0};
+    std::memcpy(buffer_.data(), &bh, sizeof(bh));
+    std::memcpy(buffer_.data() + sizeof(bh), &ih, sizeof(ih));
+    meta_log::detail::put(buffer_, sizeof(bh) + sizeof(ih), std::span{std::as_const(pending_)});
+
+    if(!meta_log::detail::write_all(fd_, buffer_.data(), buffer_.size())) {
+      return nonstd::make_unexpected(meta_log::detail::io_error("Failed to write metadata log index", path_));
+    }
+    last_index_offset_ = offset_;
+    offset_ += buffer_.size();
+    pending_.clear();
+    return {};
+  }
+
+  int fd_{-1};
+  std::string path_;
+  std::uint32_t index_interval_{64};
+  std::uint64_t offset_{0};
+  std::uint64_t last_index_offset_{0};
+  std::uint64_t batches_written_{0};
+  std::vector<meta_log::IndexEntry> pending_;
+  std::vector<std::byte> buffer_;
+  std::vector<std::uint32_t> label_index_;
+  std::vector<std::string_view> label_views_;
+};
+
+// ============================================================================
+// MetaLogBatch — zero-copy view of one Batch block inside a mapped log
+// ============================================================================
+class MetaLogBatch {
+public:
+  MetaLogBatch(const std::byte* payload, const meta_log::BatchHeader& header)
+      : payload_(payload)
+      , header_(header)
+      , layout_(meta_log::BatchLayout::compute(header.num_frames, header.num_objects, header.num_labels)) {}
+
+  [[nodiscard]] std::uint64_t sequence() const noexcept {
+    return header_.sequence;
+  }
+  [[nodiscard]] std::uint64_t first_pts() const noexcept {
+    return header_.first_pts;
+  }
+  [[nodiscard]] std::size_t num_frames() const noexcept {
+    return header_.num_frames;
+  }
+  [[nodiscard]] std::size_t num_objects() const noexcept {
+    return header_.num_objects;
+  }
+
+  // Frame columns
+  [[nodiscard]] std::span<const std::uint64_t> pts() const noexcept {
+    return column<std::uint64_t>(layout_.pts, header_.num_frames);
+  }
+  [[nodiscard]] std::span<const std::uint32_t> source_id() const noexcept {
+    return column<std::uint32_t>(layout_.source_id, header_.num_frames);
+  }
+  [[nodiscard]] std::span<const std::uint32_t> pad_index() const noexcept {
+    return column<std::uint32_t>(layout_.pad_index, header_.num_frames);
+  }
+  [[nodiscard]] std::span<const std::int32_t> frame_num() const noexcept {
+    return column<std::int32_t>(layout_.frame_num, header_.num_frames);
+  }
+  [[nodiscard]] std::span<const std::uint32_t> object_begin() const noexcept {
+    return column<std::uint32_t>(layout_.object_begin, header_.num_frames);
+  }
+  [[nodiscard]] std::span<const std::uint32_t> object_count() const noexcept {
+    return column<std::uint32_t>(layout_.object_count, header_.num_frames);
+  }
+
+  // Object columns
+  [[nodiscard]] std::span<const std::uint64_t> object_id() const noexcept {
+    return column<std::uint64_t>(layout_.object_id, header_.num_objects);
+  }
+  [[nodiscard]] std::span<const std::int32_t> class_id() const noexcept {
+    return column<std::int32_t>(layout_.class_id, header_.num_objects);
+  }
+  [[nodiscard]] std::span<const float> confidence() const noexcept {
+    return column<float>(layout_.confidence, header_.num_objects);
+  }
+  [[nodiscard]] std::span<const float> left() const noexcept {
+    return column<float>(layout_.left, header_.num_objects);
+  }
+  [[nodiscard]] std::span<const float> top() const noexcept {
+    return column<float>(layout_.top, header_.num_objects);
+  }
+  [[nodiscard]] std::span<const float> width() const noexcept {
+    return column<float>(layout_.width, header_.num_objects);
+  }
+  [[nodiscard]] std::span<const float> height() const noexcept {
+    return column<float>(layout_.height, header_.num_objects);
+  }
+
+  [[nodiscard]] std::string_view label(std::size_t object) const noexcept {
+    const auto ids = column<std::uint32_t>(layout_.label, header_.num_objects);
+    const auto offsets = column<std::uint32_t>(layout_.label_offsets, header_.num_labels + 1U);
+    const std::uint32_t id = ids[object];
+    const auto* chars = reinterpret_cast<const char*>(payload_ + layout_.label_chars);
+    return {chars + offsets[id], offsets[id + 1U] - offsets[id]};
+  }
+
+private:
+  template <typename T>
+    requires std::is_trivially_copyable_v<T>
+  [[nodiscard]] std::span<const T> column(std::size_t offset, std::size_t count) const noexcept {
+    return {reinterpret_cast<const T*>(payload_ + offset), count};
+  }
+
+  const std::byte* payload_;
+  meta_log::BatchHeader header_;
+  meta_log::BatchLayout layout_;
+};
+
+// ============================================================================
+// MetaLogReader — mmaps a metadata log and indexes its batches
+// ============================================================================
+//   auto log = ds::MetaLogReader::open("/data/run.dsmeta").value();
+//   for(std::size_t i = log.lower_bound_pts(start); i < log.size(); ++i) {
+//     const auto batch = log.batch(i);
+//     ...
+//   }
+class MetaLogReader {
+public:
+  [[nodiscard]] static nonstd::expected<MetaLogReader, Error> open(std::string_view path) {
+    const std::string path_str{path};
+    const int fd = ::open(path_str.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0) {
+      return nonstd::make_unexpected(meta_log::detail::io_error("Failed to open metadata log", path));
+    }
+    struct stat st{};
+    if(::fstat(fd, &st) != 0) {
+      auto err = meta_log::detail::io_error("Failed to stat metadata log", path);
+      ::close(fd);
+      return nonstd::make_unexpected(std::move(err));
+    }
+    const auto size = static_cast<std::size_t>(st.st_size);
+    if(size < sizeof(meta_log::FileHeader)) {
+      ::close(fd);
+      return nonstd::make_unexpected(Error{ErrorKind::FileFormat, fmt::format("'{}' is too small to be a metadata log", path)});
+    }
+    void* map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if(map == MAP_FAILED) {
+      return nonstd::make_unexpected(meta_log::detail::io_error("Failed to mmap metadata log", path));
+    }
+
+    MetaLogReader reader{static_cast<const std::byte*>(map), size};
+    meta_log::FileHeader header{};
+    std::memcpy(&header, reader.data_, sizeof(header));
+    if(header.magic != meta_log::file_magic || header.version != meta_log::format_version) {
+      return nonstd::make_unexpected(
+          Error{ErrorKind::FileFormat, fmt::format("'{}' is not a version {} metadata log", path, meta_log::format_version)});
+    }
+    if(!reader.load_index()) {
+      reader.scan_blocks();
+    }
+    return reader;
+  }
+
+  ~MetaLogReader() {
+    if(data_ != nullptr) {
+      ::munmap(const_cast<std::byte*>(data_), size_);
+    }
+  }
+
+  MetaLogReader(MetaLogReader&& other) noexcept
+      : data_(std::exchange(other.data_, nullptr))
+      , size_(std::exchange(other.size_, 0))
+      , entries_(std::move(other.entries_))
+      , recovered_(other.recovered_) {}
+
+  MetaLogReader& operator=(MetaLogReader&& other) noexcept {
+    if(this != &other) {
+      if(data_ != nullptr) {
+        ::munmap(const_cast<std::byte*>(data_), size_);
+      }
+      data_ = std::exchange(other.data_, nullptr);
+      size_ = std::exchange(other.size_, 0);
+      entries_ = std::move(other.entries_);
+      recovered_ = other.recovered_;
+    }
+    return *this;
+  }
+
+  MetaLogReader(const MetaLogReader&) = delete;
+  MetaLogReader& operator=(const MetaLogReader&) = delete;
+
+  [[nodiscard]] std::size_t size() const noexcept {
+    return entries_.size();
+  }
+  [[nodiscard]] bool empty() const noexcept {
+    return entries_.empty();
+  }
+
+  // True when the file had no valid trailer and batches were found by scanning.
+  [[nodiscard]] bool recovered() const noexcept {
+    return recovered_;
+  }
+
+  [[nodiscard]] MetaLogBatch batch(std::size_t index) const noexcept {
+    const std::byte* payload = data_ + entries_[index].offset + sizeof(meta_log::BlockHeader);
+    meta_log::BatchHeader header{};
+    std::memcpy(&header, payload, sizeof(header));
+    return MetaLogBatch{payload, header};
+  }
+
+  // Index of the first batch whose first_pts is >= pts (size() if none).
+  // Assumes batches were appended in pts order, as a live pipeline produces them.
+  [[nodiscard]] std::size_t lower_bound_pts(std::uint64_t pts) const noexcept {
+    const auto it = std::lower_bound(
+        entries_.begin(), entries_.end(), pts, [](const meta_log::IndexEntry& e, std::uint64_t p) { return e.first_pts < p; });
+    return static_cast<std::size_t>(it - entries_.begin());
+  }
+
+private:
+  MetaLogReader(const std::byte* data, std::size_t size) : data_(data), size_(size) {}
+
+  [[nodiscard]] bool valid_batch(std::uint64_t offset) const noexcept {
+    if(offset + sizeof(meta_log::BlockHeader) + sizeof(meta_log::BatchHeader) > size_) {
+      return false;
+    }
+    meta_log::BlockHeader bh{};
+    std::memcpy(&bh, data_ + offset, sizeof(bh));
+    if(bh.type != meta_log::BlockType::Batch || bh.payload_size > size_ || offset + sizeof(bh) + bh.payload_size > size_) {
+      return false;
+    }
+    return valid_payload(data_ + offset + sizeof(bh), bh.payload_size);
+  }
+
+  // The header counts must describe exactly payload_size bytes, and every
+  // object range and label id must stay inside its table, so the MetaLogBatch
+  // views of a torn or corrupt block never read out of bounds.
+  [[nodiscard]] static bool valid_payload(const std::byte* payload, std::uint64_t payload_size) noexcept {
+    meta_log::BatchHeader header{};
+    std::memcpy(&header, payload, sizeof(header));
+    const auto layout = meta_log::BatchLayout::compute(header.num_frames, header.num_objects, header.num_labels);
+    if(layout.size_without_chars > payload_size) {
+      return false;
+    }
+    const auto read_u32 = [payload](std::size_t at) {
+      std::uint32_t v = 0;
+      std::memcpy(&v, payload + at, sizeof(v));
+      return v;
+    };
+
+    std::uint32_t previous = 0;
+    for(std::size_t i = 0; i <= header.num_labels; ++i) {
+      const auto offset = read_u32(layout.label_offsets + i * sizeof(std::uint32_t));
+      if(offset < previous || (i == 0 && offset != 0)) {
+        return false;
+      }
+      previous = offset;
+    }
+    if(layout.size_without_chars + previous != payload_size) {
+      return false;
+    }
+    for(std::size_t i = 0; i < header.num_objects; ++i) {
+      if(read_u32(layout.label + i * sizeof(std::uint32_t)) >= header.num_labels) {
+        return false;
+      }
+    }
+    for(std::size_t i = 0; i < header.num_frames; ++i) {
+      const std::uint64_t begin = read_u32(layout.object_begin + i * sizeof(std::uint32_t));
+      const std::uint64_t count = read_u32(layout.object_count + i * sizeof(std::uint32_t));
+      if(begin + count > header.num_objects) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool load_index() {
+    if(size_ < sizeof(meta_log::FileHeader) + sizeof(meta_log::Trailer)) {
+      return false;
+    }
+    meta_log::Trailer trailer{};
+    std::memcpy(&trailer, data_ + size_ - sizeof(trailer), sizeof(trailer));
+    if(trailer.magic != meta_log::trailer_magic) {
+      return false;
+    }
+
+    std::vector<meta_log::IndexEntry> reversed;
+    std::uint64_t at = trailer.last_index_offset;
+    while(at != 0) {
+      if(at + sizeof(meta_log::BlockHeader) + sizeof(meta_log::IndexHeader) > size_) {
+        return false;
+      }
+      meta_log::BlockHeader bh{};
+      meta_log::IndexHeader ih{};
+      std::memcpy(&bh, data_ + at, sizeof(bh));
+      std::memcpy(&ih, data_ + at + sizeof(bh), sizeof(ih));
+      const std::uint64_t entries_at = at + sizeof(bh) + sizeof(ih);
+      if(bh.type != meta_log::BlockType::Index || entries_at + ih.count * sizeof(meta_log::IndexEntry) > size_ ||
+         ih.prev_index_offset >= at) {
+        return false;
+      }
+      for(std::uint32_t i = ih.count; i > 0; --i) {
+        meta_log::IndexEntry e{};
+        std::memcpy(&e, data_ + entries_at + (i - 1U) * sizeof(e), sizeof(e));
+        if(!valid_batch(e.offset)) {
+          return false;
+        }
+        reversed.push_back(e);
+      }
+      at = ih.prev_index_offset;
+    }
+    entries_.assign(reversed.rbegin(), reversed.rend());
+    return true;
+  }
+
+  void scan_blocks() {
+    recovered_ = true;
+    entries_.clear();
+    std::uint64_t at = sizeof(meta_log::FileHeader);
+    while(at + sizeof(meta_log::BlockHeader) <= size_) {
+      meta_log::BlockHeader bh{};
+      std::memcpy(&bh, data_ + at, sizeof(bh));
+      const std::uint64_t next = at + sizeof(bh) + meta_log::align8(bh.payload_size);
+      if(bh.payload_size > size_ || next > size_) {
+        break;    // torn final block
+      }
+      if(bh.type == meta_log::BlockType::Batch && valid_batch(at)) {
+        meta_log::BatchHeader header{};
+        std::memcpy(&header, data_ + at + sizeof(bh), sizeof(header));
+        entries_.push_back(meta_log::IndexEntry{at, header.sequence, header.first_pts});
+      } else if(bh.type != meta_log::BlockType::Index) {
+        break;    // trailer or garbage
+      }
+      at = next;
+    }
+  }
+
+  const std::byte* data_{nullptr};
+  std::size_t size_{0};
+  std::vector<meta_log::IndexEntry> entries_;
+  bool recovered_{false};
+};
+
+// ============================================================================
+// write_kitti — converts a metadata log back into per-frame KITTI text files
+// ============================================================================
+// Produces exactly what deepstream-app's write_kitti_output() writes:
+// "<dir>/<app_index:02>_<pad_index:03>_<frame_num:06>.txt", one line per box.
+// Returns the number of files written.
+inline nonstd::expected<std::size_t, Error> write_kitti(const MetaLogReader& log,
+                                                        std::string_view dir,
+                                                        std::uint32_t app_index = 0) {
+  std::size_t files = 0;
+  fmt::memory_buffer out;
+  for(std::size_t b = 0; b < log.size(); ++b) {
+    const auto batch = log.batch(b);
+    const auto pad_index = batch.pad_index();
+    const auto frame_num = batch.frame_num();
+    const auto begin = batch.object_begin();
+    const auto count = batch.object_count();
+    const auto left = batch.left();
+    const auto top = batch.top();
+    const auto width = batch.width();
+    const auto height = batch.height();
+    const auto confidence = batch.confidence();
+
+    for(std::size_t f = 0; f < batch.num_frames(); ++f) {
+      out.clear();
+      for(std::uint32_t o = begin[f]; o < begin[f] + count[f]; ++o) {
+        fmt::format_to(std::back_inserter(out),
+                       "{} 0.0 0 0.0 {:f} {:f} {:f} {:f} 0.0 0.0 0.0 0.0 0.0 0.0 0.0 {:f}\n",
+                       batch.label(o),
+                       left[o],
+                       top[o],
+                       left[o] + width[o],
+                       top[o] + height[o],
+                       confidence[o]);
+      }
+
+      const auto file = fmt::format("{}/{:02}_{:03}_{:06}.txt", dir, app_index, pad_index[f], frame_num[f]);
+      std::FILE* fp = std::fopen(file.c_str(), "w");
+      if(fp == nullptr) {
+        return nonstd::make_unexpected(meta_log::detail::io_error("Failed to create KITTI file", file));
+      }
+      const bool ok = std::fwrite(out.data(), 1, out.size(), fp) == out.size();
+      if(std::fclose(fp) != 0 || !ok) {
+        return nonstd::make_unexpected(meta_log::detail::io_error("Failed to write KITTI file", file));
+      }
+      ++files;
+    }
+  }
+  return files;
+}
+
+}    // namespace ds
@@ -0,0 +1,74 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+#include <utility>
+
+#include <metadata/batch_meta.hpp>
+#include <metadata/batch_record.hpp>
+#include <metadata/meta_log.hpp>
+#include <nonstd/expected.hpp>
+#include <utils/error.hpp>
+
+namespace ds {
+
+// Copies the recorded fields of a batch into record (cleared first).
+// Only touches host-side NvDs metadata; no GPU surfaces are read.
+inline void capture(const BatchMetaView& batch, BatchRecord& record) {
+  record.clear();
+  for(const auto frame : batch.frames()) {
+    record.add_frame(frame.buf_pts(), frame.source_id(), frame.pad_index(), frame.frame_num());
+    for(const auto obj : frame.objects()) {
+      const auto box = obj.rect();
+      record.add_object(obj.object_id(), obj.class_id(), obj.confidence(), box.left, box.top, box.width, box.height, obj.label());
+    }
+  }
+}
+
+// Appends every batch it sees to a single metadata log (see meta_log.hpp),
+// replacing deepstream-app's one-KITTI-file-per-frame output.
+//
+//   auto rec = ds::MetaRecorder::create("/data/run.dsmeta").value();
+//   // in a pad probe:
+//   if(auto batch = ds::BatchMetaView::from_buffer(buf)) {
+//     rec.record(*batch);
+//   }
+//
+// Convert back for offline evaluation with ds::write_kitti(MetaLogReader, dir).
+class MetaRecorder {
+public:
+  [[nodiscard]] static nonstd::expected<MetaRecorder, Error> create(std::string_view path, std::uint32_t index_interval = 64) {
+    auto writer = MetaLogWriter::create(path, index_interval);
+    if(!writer) {
+      return nonstd::make_unexpected(std::move(writer.error()));
+    }
+    return MetaRecorder{std::move(*writer)};
+  }
+
+  nonstd::expected<void, Error> record(const BatchMetaView& batch) {
+    capture(batch, scratch_);
+    scratch_.sequence = sequence_++;
+    return writer_.append(scratch_);
+  }
+
+  nonstd::expected<void, Error> close() {
+    return writer_.close();
+  }
+
+  [[nodiscard]] const MetaLogWriter& writer() const noexcept {
+    return writer_;
+  }
+
+  MetaRecorder(MetaRecorder&&) = default;
+  MetaRecorder& operator=(MetaRecorder&&) = default;
+  MetaRecorder(const MetaRecorder&) = delete;
+  MetaRecorder& operator=(const MetaRecorder&) = delete;
+
+private:
+  explicit MetaRecorder(MetaLogWriter writer) : writer_(std::move(writer)) {}
+
+  MetaLogWriter writer_;
+  BatchRecord scratch_;
+  std::uint64_t sequence_{0};
+};
+
+}    // namespace ds
@@ -4,6 +4,7 @@
 
 #include <metadata/classifier_meta.hpp>
 #include <metadata/meta_list_view.hpp>
+#include <metadata/user_meta.hpp>
 #include <nvdsmeta.h>
 
 namespace ds {
@@ -57,6 +58,10 @@ public:
     return MetaListView<ClassifierMetaView, NvDsClassifierMeta>{meta_->classifier_meta_list};
   }
 
+  [[nodiscard]] MetaListView<UserMetaView, NvDsUserMeta> user_meta() const {
+    return MetaListView<UserMetaView, NvDsUserMeta>{meta_->obj_user_meta_list};
+  }
+
   [[nodiscard]] NvDsObjectMeta* get() const {
     return meta_;
   }
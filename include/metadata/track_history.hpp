@@ -0,0 +1,251 @@
+#pragma once
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include <metadata/frame_meta.hpp>
+#include <metadata/object_meta.hpp>
+#include <nvdsmeta.h>
+
+namespace ds {
+
+struct TrackPoint {
+  std::uint64_t pts;
+  BoundingBox box;
+  float confidence;
+};
+
+struct TrackHistoryConfig {
+  std::uint32_t max_tracks{256};         // tracks held at once; the least recently seen is evicted past this
+  std::uint32_t points_per_track{32};    // ring capacity per track; older points are overwritten
+  std::uint64_t max_age_frames{30};      // a track unseen for this many frames is evicted
+};
+
+// Bounded per-object trajectory store keyed by ObjectMetaView::object_id().
+//
+//   ds::TrackHistory history{{.max_tracks = 512, .points_per_track = 64}};
+//   // once per frame, after nvtracker:
+//   history.update(frame);
+//   if(auto track = history.find(obj.object_id()); track && track->size() > 1) {
+//     const auto dx = track->back().box.left - track->front().box.left;
+//   }
+//
+// All memory is allocated by the constructor: points live in one contiguous
+// max_tracks * points_per_track array, each track is a ring over its own stripe,
+// and object ids map to tracks through an open-addressing table with linear
+// probing. Nothing is allocated per frame, however long the service runs.
+//
+// The frame clock advances once per update()/advance() call, so keep one
+// TrackHistory per source when a batch carries several streams.
+class TrackHistory {
+  struct Track {
+    std::uint64_t id{0};
+    std::uint64_t last_seen{0};
+    std::uint32_t head{0};     // ring index of the oldest point
+    std::uint32_t count{0};    // 0 = slot unused
+  };
+
+public:
+  // Read-only view of one track's points, oldest first. Valid until the next
+  // advance(), record() or update().
+  class Trajectory {
+  public:
+    [[nodiscard]] std::uint64_t id() const noexcept {
+      return track_->id;
+    }
+    [[nodiscard]] std::uint64_t last_seen_frame() const noexcept {
+      return track_->last_seen;
+    }
+    [[nodiscard]] std::size_t size() const noexcept {
+      return track_->count;
+    }
+    [[nodiscard]] const TrackPoint& operator[](std::size_t i) const noexcept {
+      return points_[(track_->head + i) % capacity_];
+    }
+    [[nodiscard]] const TrackPoint& front() const noexcept {
+      return (*this)[0];
+    }
+    [[nodiscard]] const TrackPoint& back() const noexcept {
+      return (*this)[size() - 1];
+    }
+
+  private:
+    friend class TrackHistory;
+    Trajectory(const Track* track, const TrackPoint* points, std::size_t capacity)
+        : track_(track), points_(points), capacity_(capacity) {}
+
+    const Track* track_;
+    const TrackPoint* points_;
+    std::size_t capacity_;
+  };
+
+  explicit TrackHistory(TrackHistoryConfig config = {})
+      : config_(sanitize(config))
+      , tracks_(config_.max_tracks)
+      , points_(static_cast<std::size_t>(config_.max_tracks) * config_.points_per_track)
+      , table_(std::bit_ceil(static_cast<std::size_t>(config_.max_tracks) * 2), empty_slot)
+      , free_slots_(config_.max_tracks) {
+    for(std::uint32_t i = 0; i < config_.max_tracks; ++i) {
+      free_slots_[i] = config_.max_tracks - 1 - i;
+    }
+  }
+
+  // Starts a new frame and evicts tracks not seen for max_age_frames.
+  void advance() {
+    ++frame_;
+    for(std::uint32_t slot = 0; slot < config_.max_tracks; ++slot) {
+      const auto& track = tracks_[slot];
+      if(track.count != 0 && frame_ - track.last_seen > config_.max_age_frames) {
+        erase(slot);
+        ++evicted_;
+      }
+    }
+  }
+
+  // Appends a point to object_id's track in the current frame, creating the
+  // track (and evicting the least recently seen one if full) as needed.
+  void record(std::uint64_t object_id, const TrackPoint& point) {
+    auto pos = find_pos(object_id);
+    if(table_[pos] == empty_slot) {
+      if(free_slots_.empty()) {
+        erase(least_recent());
+        ++evicted_;
+        pos = find_pos(object_id);
+      }
+      const auto slot = free_slots_.back();
+      free_slots_.pop_back();
+      tracks_[slot] = Track{object_id, frame_, 0, 0};
+      table_[pos] = slot;
+      ++live_;
+    }
+    auto& track = tracks_[table_[pos]];
+    auto* ring = &points_[static_cast<std::size_t>(table_[pos]) * config_.points_per_track];
+    if(track.count < config_.points_per_track) {
+      ring[(track.head + track.count) % config_.points_per_track] = point;
+      ++track.count;
+    } else {
+      ring[track.head] = point;
+      track.head = (track.head + 1) % config_.points_per_track;
+    }
+    track.last_seen = frame_;
+  }
+
+  // advance(), then records every object in the frame that carries a tracker id.
+  void update(const FrameMetaView& frame) {
+    advance();
+    for(const auto obj : frame.objects()) {
+      if(obj.object_id() == UNTRACKED_OBJECT_ID) {
+        continue;
+      }
+      record(obj.object_id(), {frame.buf_pts(), obj.rect(), obj.confidence()});
+    }
+  }
+
+  [[nodiscard]] std::optional<Trajectory> find(std::uint64_t object_id) const noexcept {
+    const auto slot = table_[find_pos(object_id)];
+    if(slot == empty_slot) {
+      return std::nullopt;
+    }
+    const auto* ring = &points_[static_cast<std::size_t>(slot) * config_.points_per_track];
+    return Trajectory{&tracks_[slot], ring, config_.points_per_track};
+  }
+
+  [[nodiscard]] bool contains(std::uint64_t object_id) const noexcept {
+    return table_[find_pos(object_id)] != empty_slot;
+  }
+
+  // Number of live tracks.
+  [[nodiscard]] std::size_t size() const noexcept {
+    return live_;
+  }
+  [[nodiscard]] std::size_t max_tracks() const noexcept {
+    return config_.max_tracks;
+  }
+  [[nodiscard]] std::uint64_t frame() const noexcept {
+    return frame_;
+  }
+  // Tracks removed by age or to make room, since construction.
+  [[nodiscard]] std::uint64_t evicted() const noexcept {
+    return evicted_;
+  }
+
+  void clear() noexcept {
+    for(std::uint32_t slot = 0; slot < config_.max_tracks; ++slot) {
+      if(tracks_[slot].count != 0) {
+        erase(slot);
+      }
+    }
+  }
+
+private:
+  static constexpr std::uint32_t empty_slot = 0xFFFFFFFFU;
+
+  static TrackHistoryConfig sanitize(TrackHistoryConfig config) noexcept {
+    config.max_tracks = config.max_tracks == 0 ? 1 : config.max_tracks;
+    config.points_per_track = config.points_per_track == 0 ? 1 : config.points_per_track;
+    return config;
+  }
+
+  // Tracker ids are sequential; the splitmix64 finaliser spreads them over the table.
+  [[nodiscard]] std::size_t home(std::uint64_t id) const noexcept {
+    id ^= id >> 30;
+    id *= 0xBF58476D1CE4E5B9ULL;
+    id ^= id >> 27;
+    id *= 0x94D049BB133111EBULL;
+    id ^= id >> 31;
+    return id & (table_.size() - 1);
+  }
+
+  // Position holding object_id, or the empty position where it would go.
+  // The table is at most half full, so the probe always terminates.
+  [[nodiscard]] std::size_t find_pos(std::uint64_t id) const noexcept {
+    const auto mask = table_.size() - 1;
+    auto pos = home(id);
+    while(table_[pos] != empty_slot && tracks_[table_[pos]].id != id) {
+      pos = (pos + 1) & mask;
+    }
+    return pos;
+  }
+
+  [[nodiscard]] std::uint32_t least_recent() const noexcept {
+    std::uint32_t oldest = 0;
+    for(std::uint32_t slot = 1; slot < config_.max_tracks; ++slot) {
+      if(tracks_[slot].last_seen < tracks_[oldest].last_seen) {
+        oldest = slot;
+      }
+    }
+    return oldest;
+  }
+
+  // Removes a live track, closing the probe gap by backward-shift deletion so
+  // no tombstones accumulate.
+  void erase(std::uint32_t slot) noexcept {
+    const auto mask = table_.size() - 1;
+    auto hole = find_pos(tracks_[slot].id);
+    for(auto next = (hole + 1) & mask; table_[next] != empty_slot; next = (next + 1) & mask) {
+      const auto want = home(tracks_[table_[next]].id);
+      // Move next into the hole unless its home lies cyclically in (hole, next].
+      if(((next - want) & mask) >= ((next - hole) & mask)) {
+        table_[hole] = table_[next];
+        hole = next;
+      }
+    }
+    table_[hole] = empty_slot;
+    tracks_[slot] = Track{};
+    free_slots_.push_back(slot);
+    --live_;
+  }
+
+  TrackHistoryConfig config_;
+  std::vector<Track> tracks_;
+  std::vector<TrackPoint> points_;
+  std::vector<std::uint32_t> table_;         // open-addressing: object id -> index into tracks_
+  std::vector<std::uint32_t> free_slots_;    // capacity reserved up front; never reallocates
+  std::size_t live_{0};
+  std::uint64_t frame_{0};
+  std::uint64_t evicted_{0};
+};
+
+}    // namespace ds
@@ -0,0 +1,256 @@
+#pragma once
+#include <atomic>
+#include <concepts>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include <glib.h>
+
+#include <metadata/batch_meta.hpp>
+#include <metadata/frame_meta.hpp>
+#include <metadata/object_meta.hpp>
+#include <metadata/user_meta.hpp>
+#include <nonstd/expected.hpp>
+#include <nvdsmeta.h>
+#include <utils/bounded_queue.hpp>
+#include <utils/error.hpp>
+
+namespace ds {
+
+// A C++ type that can ride on a GstBuffer as NvDsUserMeta. DeepStream copies
+// metadata when buffers are duplicated (tee, nvstreamdemux) and releases it
+// when the batch meta is destroyed, so the payload must be copyable.
+template <typename T>
+concept UserMetaPayload = std::is_object_v<T> && !std::is_const_v<T> && std::copy_constructible<T> && std::destructible<T>;
+
+namespace detail {
+
+// Recycles raw storage for one payload type. Objects are constructed in place
+// on attach and destroyed on release; up to capacity blocks are kept for reuse
+// so steady-state attach/release does not touch the allocator. release() runs
+// on whichever thread frees the buffer, hence the lock-free free list.
+template <typename T>
+  requires UserMetaPayload<T>
+class UserMetaPool {
+public:
+  explicit UserMetaPool(std::size_t capacity) : free_(capacity) {}
+
+  UserMetaPool(const UserMetaPool&) = delete;
+  UserMetaPool& operator=(const UserMetaPool&) = delete;
+
+  ~UserMetaPool() {
+    while(auto block = free_.try_pop()) {
+      deallocate(*block);
+    }
+  }
+
+  template <typename... Args>
+    requires std::constructible_from<T, Args...>
+  T* create(Args&&... args) {
+    void* block = nullptr;
+    if(auto recycled = free_.try_pop()) {
+      block = *recycled;
+    } else {
+      block = ::operator new(sizeof(T), std::align_val_t{alignof(T)});
+    }
+    try {
+      return ::new(block) T(std::forward<Args>(args)...);
+    } catch(...) {
+      recycle(block);
+      throw;
+    }
+  }
+
+  void destroy(T* object) noexcept {
+    object->~T();
+    recycle(object);
+  }
+
+private:
+  void recycle(void* block) noexcept {
+    if(!free_.try_push(block)) {
+      deallocate(block);
+    }
+  }
+
+  static void deallocate(void* block) noexcept {
+    ::operator delete(block, sizeof(T), std::align_val_t{alignof(T)});
+  }
+
+  BoundedQueue<void*> free_;
+};
+
+template <typename T>
+  requires UserMetaPayload<T>
+struct UserMetaRegistration {
+  std::mutex mutex;    // serialises register_user_meta(); attach/get only read the atomics
+  std::atomic<NvDsMetaType> type{NVDS_INVALID_META};
+  std::unique_ptr<UserMetaPool<T>> pool;
+
+  static UserMetaRegistration& instance() {
+    static UserMetaRegistration registration;
+    return registration;
+  }
+
+  // NvDsMetaCopyFunc: data is the source NvDsUserMeta. Called from C, so a
+  // throwing copy constructor terminates rather than unwinding through DeepStream.
+  static gpointer copy(gpointer data, gpointer /*user_data*/) noexcept {
+    const auto* meta = static_cast<NvDsUserMeta*>(data);
+    return instance().pool->create(*static_cast<const T*>(meta->user_meta_data));
+  }
+
+  // NvDsMetaReleaseFunc: data is the NvDsUserMeta being returned to its pool.
+  static void release(gpointer data, gpointer /*user_data*/) noexcept {
+    auto* meta = static_cast<NvDsUserMeta*>(data);
+    if(meta->user_meta_data != nullptr) {
+      instance().pool->destroy(static_cast<T*>(meta->user_meta_data));
+      meta->user_meta_data = nullptr;
+    }
+  }
+};
+
+template <typename T, typename Arg>
+  requires UserMetaPayload<T> && std::constructible_from<T, Arg>
+nonstd::expected<NvDsUserMeta*, Error> acquire_user_meta(NvDsBatchMeta* batch, Arg&& value) {
+  auto& reg = UserMetaRegistration<T>::instance();
+  const auto type = reg.type.load(std::memory_order_acquire);
+  if(type == NVDS_INVALID_META) {
+    return nonstd::make_unexpected(
+        Error{ErrorKind::InvalidArgument, "User meta type is not registered; call register_user_meta<T>() first"});
+  }
+  if(batch == nullptr) {
+    return nonstd::make_unexpected(Error{ErrorKind::InvalidArgument, "Cannot attach user meta: no NvDsBatchMeta"});
+  }
+  // Construct first: if T's constructor throws, no pool meta has been taken yet.
+  T* payload = reg.pool->create(std::forward<Arg>(value));
+  NvDsUserMeta* meta = nvds_acquire_user_meta_from_pool(batch);
+  if(meta == nullptr) {
+    reg.pool->destroy(payload);
+    return nonstd::make_unexpected(Error{ErrorKind::Unknown, "nvds_acquire_user_meta_from_pool returned nullptr"});
+  }
+  meta->user_meta_data = payload;
+  meta->base_meta.meta_type = type;
+  meta->base_meta.copy_func = &UserMetaRegistration<T>::copy;
+  meta->base_meta.release_func = &UserMetaRegistration<T>::release;
+  return meta;
+}
+
+template <typename T, typename List>
+  requires UserMetaPayload<T>
+T* find_user_meta(List list) {
+  const auto type = UserMetaRegistration<T>::instance().type.load(std::memory_order_acquire);
+  if(type == NVDS_INVALID_META) {
+    return nullptr;
+  }
+  for(const auto meta : list) {
+    if(meta.meta_type() == type) {
+      return static_cast<T*>(meta.raw_data());
+    }
+  }
+  return nullptr;
+}
+
+}    // namespace detail
+
+// Allocates an NvDsMetaType for T under the descriptor name (DeepStream's
+// "ORG.COMPONENT.NAME" convention) and generates its copy/release callbacks
+// from T's copy constructor and destructor. pool_capacity bounds how many
+// released objects' storage is kept for reuse. Registering the same T again
+// returns the existing type.
+//
+//   struct Dwell { std::uint64_t object_id; double seconds; };
+//   ds::register_user_meta<Dwell>("ACME.ANALYTICS.DWELL").value();
+//   // upstream probe:
+//   ds::attach(frame, Dwell{obj.object_id(), 4.2});
+//   // downstream probe:
+//   if(const Dwell* d = ds::get<Dwell>(frame)) { ... }
+template <typename T>
+  requires UserMetaPayload<T>
+nonstd::expected<NvDsMetaType, Error> register_user_meta(std::string_view name, std::size_t pool_capacity = 64) {
+  auto& reg = detail::UserMetaRegistration<T>::instance();
+  const std::lock_guard lock{reg.mutex};
+  if(const auto type = reg.type.load(std::memory_order_relaxed); type != NVDS_INVALID_META) {
+    return type;
+  }
+  if(name.empty()) {
+    return nonstd::make_unexpected(Error{ErrorKind::InvalidArgument, "User meta descriptor must not be empty"});
+  }
+  std::string descriptor{name};
+  const NvDsMetaType type = nvds_get_user_meta_type(descriptor.data());
+  if(type == NVDS_INVALID_META) {
+    return nonstd::make_unexpected(Error{ErrorKind::Unknown, "nvds_get_user_meta_type failed for '" + descriptor + "'"});
+  }
+  reg.pool = std::make_unique<detail::UserMetaPool<T>>(pool_capacity);
+  reg.type.store(type, std::memory_order_release);
+  return type;
+}
+
+// The type registered for T, or NVDS_INVALID_META.
+template <typename T>
+  requires UserMetaPayload<T>
+[[nodiscard]] NvDsMetaType user_meta_type() noexcept {
+  return detail::UserMetaRegistration<T>::instance().type.load(std::memory_order_acquire);
+}
+
+// Moves (or copies) value into pooled storage and attaches it to the frame,
+// object or batch.
+template <typename T>
+  requires UserMetaPayload<std::remove_cvref_t<T>>
+nonstd::expected<void, Error> attach(const FrameMetaView& frame, T&& value) {
+  auto meta = detail::acquire_user_meta<std::remove_cvref_t<T>>(frame.get()->base_meta.batch_meta, std::forward<T>(value));
+  if(!meta) {
+    return nonstd::make_unexpected(std::move(meta.error()));
+  }
+  nvds_add_user_meta_to_frame(frame.get(), *meta);
+  return {};
+}
+
+template <typename T>
+  requires UserMetaPayload<std::remove_cvref_t<T>>
+nonstd::expected<void, Error> attach(const ObjectMetaView& object, T&& value) {
+  auto meta = detail::acquire_user_meta<std::remove_cvref_t<T>>(object.get()->base_meta.batch_meta, std::forward<T>(value));
+  if(!meta) {
+    return nonstd::make_unexpected(std::move(meta.error()));
+  }
+  nvds_add_user_meta_to_obj(object.get(), *meta);
+  return {};
+}
+
+template <typename T>
+  requires UserMetaPayload<std::remove_cvref_t<T>>
+nonstd::expected<void, Error> attach(const BatchMetaView& batch, T&& value) {
+  auto meta = detail::acquire_user_meta<std::remove_cvref_t<T>>(batch.get(), std::forward<T>(value));
+  if(!meta) {
+    return nonstd::make_unexpected(std::move(meta.error()));
+  }
+  nvds_add_user_meta_to_batch(batch.get(), *meta);
+  return {};
+}
+
+// First T attached to the frame, object or batch, or nullptr. The pointer is
+// owned by the batch meta and valid while the buffer is.
+template <typename T>
+  requires UserMetaPayload<T>
+[[nodiscard]] T* get(const FrameMetaView& frame) {
+  return detail::find_user_meta<T>(frame.user_meta());
+}
+
+template <typename T>
+  requires UserMetaPayload<T>
+[[nodiscard]] T* get(const ObjectMetaView& object) {
+  return detail::find_user_meta<T>(object.user_meta());
+}
+
+template <typename T>
+  requires UserMetaPayload<T>
+[[nodiscard]] T* get(const BatchMetaView& batch) {
+  return detail::find_user_meta<T>(batch.user_meta());
+}
+
+}    // namespace ds
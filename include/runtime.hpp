@@ -0,0 +1,18 @@
+#pragma once
+// Runtime controllers for PLAYING pipelines: muxer input management, per-source
+// supervision, load shedding, latency-driven frame skipping, admission control,
+// muxer tuning, per-source timing, snapshot encoding, pre-event and segmented
+// recording, multi-rendition encoding and encoder bitrate adaptation.
+// Needs GStreamer only (DeepStream elements are the defaults, not a requirement).
+#include <runtime/bitrate_controller.hpp>
+#include <runtime/capacity_model.hpp>
+#include <runtime/event_recorder.hpp>
+#include <runtime/frame_skip.hpp>
+#include <runtime/load_shedder.hpp>
+#include <runtime/mux_tuner.hpp>
+#include <runtime/rendition_ladder.hpp>
+#include <runtime/segment_recorder.hpp>
+#include <runtime/snapshot_encoder.hpp>
+#include <runtime/source_manager.hpp>
+#include <runtime/source_supervisor.hpp>
+#include <runtime/source_timing.hpp>
@@ -0,0 +1,299 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <gst/gst.h>
+#include <gstreamer.hpp>
+
+#include <nonstd/expected.hpp>
+#include <runtime/detail.hpp>
+#include <utils/debug.hpp>
+#include <utils/error.hpp>
+
+namespace ds {
+
+struct BitrateControllerConfig {
+  std::uint32_t min_bitrate{250'000};               // bit/s
+  std::uint32_t max_bitrate{8'000'000};             // bit/s
+  double decrease{0.8};                             // bitrate multiplier per congested step
+  std::uint32_t increase{250'000};                  // bit/s added per clear step
+  double high_water{0.5};                           // queue fill that counts as congestion
+  double low_water{0.1};                            // raise only while every queue is below this fill
+  std::chrono::milliseconds hold{1000};             // minimum time between two changes
+  std::chrono::milliseconds recover_after{5000};    // congestion-free time before raising again
+};
+
+// What tick() saw since the previous call, and the bitrate in effect after it.
+struct BitrateReport {
+  std::uint32_t bitrate{0};     // bit/s
+  double fill{0};               // fullest watched queue, 0..1
+  std::uint64_t overruns{0};    // times a watched queue was full
+  std::uint64_t late{0};        // QoS messages from watched sinks
+  bool changed{false};
+};
+
+namespace detail {
+
+// AIMD on the congestion signals of one tick: a multiplicative decrease on
+// congestion, an additive increase once the path has been clear for
+// recover_after, both at most once per hold.
+struct BitratePolicy {
+  BitrateControllerConfig config;
+  std::uint32_t bitrate{0};
+  std::optional<std::chrono::steady_clock::time_point> last_change;
+  std::optional<std::chrono::steady_clock::time_point> last_congestion;
+
+  // The new bitrate, or nullopt to keep the current one.
+  std::optional<std::uint32_t> step(const BitrateReport& seen, std::chrono::steady_clock::time_point now) {
+    const bool congested = seen.fill >= config.high_water || seen.overruns > 0 || seen.late > 0;
+    if(congested) {
+      last_congestion = now;
+    }
+    if(last_change && now - *last_change < config.hold) {
+      return std::nullopt;
+    }
+    auto next = bitrate;
+    if(congested) {
+      next = std::max(config.min_bitrate, static_cast<std::uint32_t>(static_cast<double>(bitrate) * config.decrease));
+    } else if(seen.fill <= config.low_water && (!last_congestion || now - *last_congestion >= config.recover_after)) {
+      next = static_cast<std::uint32_t>(
+          std::min<std::uint64_t>(config.max_bitrate, std::uint64_t{bitrate} + config.increase));
+    }
+    if(next == bitrate) {
+      return std::nullopt;
+    }
+    bitrate = next;
+    last_change = now;
+    return next;
+  }
+};
+
+}    // namespace detail
+
+// ============================================================================
+// BitrateController — encoder bitrate from downstream congestion
+// ============================================================================
+//   auto rate = ds::BitrateController::create(encoder.get(), {.min_bitrate = 500'000, .max_bitrate = 4'000'000}).value();
+//   rate.watch_queue(queue_before_udpsink);    // the queue in front of the network sink
+//   rate.watch_sink(udpsink);                  // turns on its QoS messages
+//   ... in the bus handler: rate.handle_message(msg);
+//   ... every 500 ms: rate.tick();
+//
+// Congestion is any of: a watched queue at least high_water full, a watched
+// queue overrunning (full, so it blocked or dropped), or a QoS message from a
+// watched sink (a buffer rendered late or dropped). On congestion tick() cuts
+// the bitrate by `decrease`; once nothing has been congested for recover_after
+// and every queue is below low_water it raises it by `increase`. Changes stay
+// within [min_bitrate, max_bitrate] and at least `hold` apart, which gives the
+// queues time to drain before the next step.
+//
+// The bitrate goes to the encoder's "bitrate" property in the unit its factory
+// uses (bit/s for nvv4l2h264enc / nvv4l2h265enc, kbit/s for x264enc, ...);
+// create() refuses an encoder whose unit detail::bitrate_unit() does not know.
+// The encoder must accept changes in PLAYING, as those do; if it rejects one,
+// tick() keeps the old bitrate and tries again after `hold`. Queue levels are
+// read in tick() and QoS is counted in handle_message(); neither blocks streaming.
+class BitrateController {
+public:
+  // Starts from the encoder's current bitrate, clamped to the configured range.
+  [[nodiscard]] static nonstd::expected<BitrateController, Error> create(GstElement* encoder,
+                                                                         BitrateControllerConfig config = {}) {
+    const auto current = detail::get_bitrate(encoder);
+    if(!current) {
+      return nonstd::make_unexpected(Error{current.error().kind, "BitrateController: " + current.error().message});
+    }
+    if(config.min_bitrate == 0 || config.min_bitrate > config.max_bitrate || config.decrease <= 0.0 ||
+       config.decrease >= 1.0 || config.low_water < 0.0 || config.low_water >= config.high_water || config.high_water > 1.0) {
+      return nonstd::make_unexpected(Error{ErrorKind::InvalidArgument,
+                                           "BitrateController: need 0 < min_bitrate <= max_bitrate, decrease in (0, 1) "
+                                           "and 0 <= low_water < high_water <= 1"});
+    }
+    auto state = std::make_unique<State>();
+    state->encoder.reset(GST_ELEMENT(gst_object_ref(encoder)));
+    state->policy.config = config;
+    state->policy.bitrate =
+        static_cast<std::uint32_t>(std::clamp<std::uint64_t>(*current, config.min_bitrate, config.max_bitrate));
+    if(state->policy.bitrate != *current) {
+      if(auto set = detail::set_bitrate(encoder, state->policy.bitrate); !set) {
+        return nonstd::make_unexpected(Error{set.error().kind, "BitrateController: " + set.error().message});
+      }
+    }
+    return BitrateController{std::move(state)};
+  }
+
+  BitrateController(BitrateController&&) noexcept = default;
+  BitrateController& operator=(BitrateController&&) noexcept = default;
+  BitrateController(const BitrateController&) = delete;
+  BitrateController& operator=(const BitrateController&) = delete;
+  ~BitrateController() = default;
+
+  // Watches the fill level and overruns of a queue (queue, or anything with
+  // its current-level-* / max-size-* properties and "overrun" signal).
+  [[nodiscard]] nonstd::expected<void, Error> watch_queue(GstElement* queue) {
+    if(queue == nullptr || g_object_class_find_property(G_OBJECT_GET_CLASS(queue), "current-level-buffers") == nullptr) {
+      return nonstd::make_unexpected(Error{ErrorKind::InvalidArgument, "BitrateController: not a queue"});
+    }
+    Queue watched;
+    watched.element = GST_ELEMENT(gst_object_ref(queue));
+    watched.handler = g_signal_connect_data(queue,
+                                            "overrun",
+                                            G_CALLBACK(&detail::count_overrun),
+                                            new std::shared_ptr<std::atomic<std::uint64_t>>(state_->overruns),
+                                            &detail::release_overrun_counter,
+                                            static_cast<GConnectFlags>(0));
+    std::lock_guard lk{state_->mutex};
+    state_->queues.push_back(std::move(watched));
+    return {};
+  }
+
+  // Counts QoS messages from sink (udpsink, rtspclientsink, filesink, ...) and
+  // turns on its "qos" property so it posts them.
+  [[nodiscard]] nonstd::expected<void, Error> watch_sink(GstElement* sink) {
+    if(sink == nullptr) {
+      return nonstd::make_unexpected(Error{ErrorKind::InvalidArgument, "BitrateController: sink is null"});
+    }
+    if(g_object_class_find_property(G_OBJECT_GET_CLASS(sink), "qos") != nullptr) {
+      detail::set_property(sink, "qos", TRUE);
+    }
+    std::lock_guard lk{state_->mutex};
+    state_->sinks.emplace_back(GST_ELEMENT(gst_object_ref(sink)));
+    return {};
+  }
+
+  // Counts a QoS message from a watched sink; true when it was one. The
+  // message is not consumed, so callers may still pass it on.
+  bool handle_message(GstMessage* message) {
+    if(message == nullptr || GST_MESSAGE_TYPE(message) != GST_MESSAGE_QOS) {
+      return false;
+    }
+    auto& s = *state_;
+    std::lock_guard lk{s.mutex};
+    const auto* src = GST_MESSAGE_SRC(message);
+    if(std::none_of(s.sinks.begin(), s.sinks.end(), [src](const gst::ElementPtr& sink) {
+         return GST_OBJECT(sink.get()) == src;
+       })) {
+      return false;
+    }
+    ++s.late;
+    return true;
+  }
+
+  // Reads the queues, applies at most one bitrate step and resets the window.
+  BitrateReport tick(std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now()) {
+    auto& s = *state_;
+    std::lock_guard lk{s.mutex};
+    BitrateReport report;
+    for(const auto& queue : s.queues) {
+      report.fill = std::max(report.fill, fill_of(queue.element));
+    }
+    report.overruns = s.overruns->exchange(0, std::memory_order_relaxed);
+    report.late = std::exchange(s.late, 0);
+    const auto previous = s.policy.bitrate;
+    if(const auto next = s.policy.step(report, now)) {
+      if(auto set = detail::set_bitrate(s.encoder.get(), *next); !set) {
+        s.policy.bitrate = previous;    // the encoder keeps its rate; retry after hold
+        DS_WARN("BitrateController: {}", set.error().message);
+        report.bitrate = previous;
+        return report;
+      }
+      report.changed = true;
+      DS_DEBUG("BitrateController: fill {:.2f}, {} overruns, {} late, bitrate {}",
+               report.fill,
+               report.overruns,
+               report.late,
+               *next);
+    }
+    report.bitrate = s.policy.bitrate;
+    return report;
+  }
+
+  // Bitrate in effect, bit/s.
+  [[nodiscard]] std::uint32_t bitrate() const {
+    std::lock_guard lk{state_->mutex};
+    return state_->policy.bitrate;
+  }
+
+private:
+  struct Queue {
+    Queue() = default;
+    Queue(Queue&& other) noexcept
+        : element(std::exchange(other.element, nullptr)), handler(std::exchange(other.handler, 0)) {}
+    Queue& operator=(Queue&&) = delete;
+    Queue(const Queue&) = delete;
+    Queue& operator=(const Queue&) = delete;
+
+    ~Queue() {
+      if(element == nullptr) {
+        return;
+      }
+      if(handler != 0) {
+        g_signal_handler_disconnect(element, handler);
+      }
+      gst_object_unref(element);
+    }
+
+    GstElement* element{nullptr};    // our ref
+    gulong handler{0};
+  };
+
+  struct State {
+    gst::ElementPtr encoder;
+    detail::BitratePolicy policy;
+    mutable std::mutex mutex;
+    std::vector<Queue> queues;
+    std::vector<gst::ElementPtr> sinks;
+    std::shared_ptr<std::atomic<std::uint64_t>> overruns{std::make_shared<std::atomic<std::uint64_t>>(0)};
+    std::uint64_t late{0};
+  };
+
+  // Fullest of the buffer, byte and time limits the queue enforces.
+  [[nodiscard]] static double fill_of(GstElement* queue) {
+    guint buffers = 0;
+    guint max_buffers = 0;
+    guint bytes = 0;
+    guint max_bytes = 0;
+    guint64 time = 0;
+    guint64 max_time = 0;
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-vararg, hicpp-vararg)
+    g_object_get(G_OBJECT(queue),
+                 "current-level-buffers",
+                 &buffers,
+                 "max-size-buffers",
+                 &max_buffers,
+                 "current-level-bytes",
+                 &bytes,
+                 "max-size-bytes",
+                 &max_bytes,
+                 "current-level-time",
+                 &time,
+                 "max-size-time",
+                 &max_time,
+                 nullptr);
+    double fill = 0;
+    if(max_buffers > 0) {
+      fill = std::max(fill, static_cast<double>(buffers) / max_buffers);
+    }
+    if(max_bytes > 0) {
+      fill = std::max(fill, static_cast<double>(bytes) / max_bytes);
+    }
+    if(max_time > 0) {
+      fill = std::max(fill, static_cast<double>(time) / static_cast<double>(max_time));
+    }
+    return std::min(fill, 1.0);
+  }
+
+  explicit BitrateController(std::unique_ptr<State> state) : state_(std::move(state)) {}
+
+  std::unique_ptr<State> state_;
+};
+
+}    // namespace ds
@@ -0,0 +1,346 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <gst/gst.h>
+
+#include <nonstd/expected.hpp>
+#include <runtime/detail.hpp>
+#include <runtime/source_manager.hpp>
+#include <time.h>
+#include <utils/error.hpp>
+
+namespace ds {
+
+struct CapacityModelConfig {
+  double fps_target{25.0};          // frames per second each source must keep
+  double cpu_budget{0.0};           // CPU-seconds per second the pipeline may use; 0 = 85% of all cores
+  double stage_budget{0.9};         // largest fraction of the measured stage's time it may be busy
+  double smoothing{0.2};            // EWMA weight of a new sample
+  std::uint32_t min_samples{3};     // samples before predictions are used
+  bool admit_when_unknown{true};    // admit while the model has fewer than min_samples
+};
+
+// One measurement window, usually produced by CapacitySampler::sample().
+struct CapacitySample {
+  std::chrono::nanoseconds wall{0};    // window length
+  std::uint64_t frames{0};             // frames that left the muxer in the window
+  std::chrono::nanoseconds cpu{0};     // process CPU time spent in the window
+  std::chrono::nanoseconds busy{0};    // time the measured stage was busy; 0 = not measured
+  std::uint32_t sources{0};            // sources connected during the window
+};
+
+struct CapacityEstimate {
+  std::uint64_t samples{0};
+  double cpu_per_frame_ns{0};      // learned CPU cost of one frame
+  double busy_per_frame_ns{0};     // learned stage time of one frame; 0 = not measured
+  double achieved_fps{0};          // per source, last smoothed window
+  double max_fps{0};               // total frames/s the budgets allow; 0 = unknown
+  std::uint32_t max_sources{0};    // sources at fps_target that fit in max_fps
+  [[nodiscard]] bool known() const noexcept {
+    return max_fps > 0;
+  }
+};
+
+// ============================================================================
+// CapacityModel — learned per-frame cost and admission control
+// ============================================================================
+//   auto model = ds::CapacityModel::create({.fps_target = 15}).value();
+//   auto sampler = ds::CapacitySampler::attach(mux_src_pad).value();
+//   auto sources = ds::SourceManager::attach(mux, {.admit = model.admission()}).value();
+//   ... every few seconds: model.record(sampler.sample(sources.size()));
+//   sources.add_source(uri);    // ErrorKind::Capacity once the next camera would not fit
+//
+// Every window gives the CPU time and (optionally) stage busy time spent per
+// frame; both are smoothed. Capacity is the smaller of
+//   cpu_budget / cpu_per_frame           and   stage_budget / busy_per_frame
+// in frames per second, and a new source is admitted while
+//   (current + 1) * fps_target <= capacity.
+// The per-frame costs are what scales with the number of streams, so the
+// model extrapolates from a lightly loaded pipeline as well as from a busy one.
+// It does not see GPU memory or decoder session limits; pair it with
+// SourceManagerConfig::max_sources for those.
+class CapacityModel {
+public:
+  [[nodiscard]] static nonstd::expected<CapacityModel, Error> create(CapacityModelConfig config = {}) {
+    if(!std::isfinite(config.fps_target) || config.fps_target <= 0.0 || !std::isfinite(config.cpu_budget) ||
+       config.cpu_budget < 0.0 || !std::isfinite(config.stage_budget) || config.stage_budget <= 0.0 ||
+       config.stage_budget > 1.0 || !std::isfinite(config.smoothing) || config.smoothing <= 0.0 || config.smoothing > 1.0) {
+      return nonstd::make_unexpected(Error{ErrorKind::InvalidArgument,
+                                           "CapacityModel: need fps_target > 0, cpu_budget >= 0, stage_budget in (0, 1] "
+                                           "and smoothing in (0, 1]"});
+    }
+    if(config.cpu_budget == 0.0) {
+      config.cpu_budget = 0.85 * static_cast<double>(std::max(1U, std::thread::hardware_concurrency()));
+    }
+    auto state = std::make_shared<State>();
+    state->config = config;
+    return CapacityModel{std::move(state)};
+  }
+
+  // Folds one window into the model. Windows without frames carry no cost
+  // information and are ignored.
+  void record(const CapacitySample& sample) {
+    if(sample.frames == 0 || sample.wall.count() <= 0) {
+      return;
+    }
+    auto& s = *state_;
+    std::lock_guard lk{s.mutex};
+    const auto frames = static_cast<double>(sample.frames);
+    const auto cpu = static_cast<double>(sample.cpu.count()) / frames;
+    const auto busy = static_cast<double>(sample.busy.count()) / frames;
+    const auto fps = sample.sources == 0
+                         ? 0.0
+                         : frames * 1e9 / static_cast<double>(sample.wall.count()) / static_cast<double>(sample.sources);
+    s.cpu = blend(s.cpu, cpu);
+    s.busy = sample.busy.count() > 0 ? blend(s.busy, busy) : s.busy;
+    s.fps = blend(s.fps, fps);
+    ++s.samples;
+  }
+
+  [[nodiscard]] CapacityEstimate estimate() const {
+    auto& s = *state_;
+    std::lock_guard lk{s.mutex};
+    CapacityEstimate out;
+    out.samples = s.samples;
+    out.cpu_per_frame_ns = s.cpu.value_or(0.0);
+    out.busy_per_frame_ns = s.busy.value_or(0.0);
+    out.achieved_fps = s.fps.value_or(0.0);
+    if(s.samples < s.config.min_samples) {
+      return out;
+    }
+    double max_fps = 0;
+    if(out.cpu_per_frame_ns > 0) {
+      max_fps = s.config.cpu_budget * 1e9 / out.cpu_per_frame_ns;
+    }
+    if(out.busy_per_frame_ns > 0) {
+      const auto stage = s.config.stage_budget * 1e9 / out.busy_per_frame_ns;
+      max_fps = max_fps > 0 ? std::min(max_fps, stage) : stage;
+    }
+    out.max_fps = max_fps;
+    out.max_sources = max_fps > 0 ? static_cast<std::uint32_t>(std::floor(max_fps / s.config.fps_target)) : 0;
+    return out;
+  }
+
+  // Whether one more source fits next to `current` ones.
+  [[nodiscard]] nonstd::expected<void, Error> admit(std::size_t current) const {
+    const auto est = estimate();
+    if(!est.known()) {
+      if(state_->config.admit_when_unknown) {
+        return {};
+      }
+      return nonstd::make_unexpected(Error{ErrorKind::Capacity, "CapacityModel: no capacity estimate yet"});
+    }
+    if(current + 1 > est.max_sources) {
+      return nonstd::make_unexpected(
+          Error{ErrorKind::Capacity,
+                fmt::format("CapacityModel: {} sources at {} fps need {:.0f} frames/s, capacity is {:.0f}",
+                            current + 1,
+                            state_->config.fps_target,
+                            static_cast<double>(current + 1) * state_->config.fps_target,
+                            est.max_fps)});
+    }
+    return {};
+  }
+
+  // admit() as a SourceManagerConfig::admit hook. The hook shares the model's
+  // state, so it stays valid if the model is moved or destroyed.
+  [[nodiscard]] AdmissionCheck admission() const {
+    return [model = CapacityModel{state_}](std::size_t current) { return model.admit(current); };
+  }
+
+private:
+  struct State {
+    CapacityModelConfig config;
+    mutable std::mutex mutex;
+    std::uint64_t samples{0};
+    std::optional<double> cpu;
+    std::optional<double> busy;
+    std::optional<double> fps;
+  };
+
+  explicit CapacityModel(std::shared_ptr<State> state) : state_(std::move(state)) {}
+
+  [[nodiscard]] double blend(std::optional<double> previous, double value) const {
+    return previous ? state_->config.smoothing * value + (1.0 - state_->config.smoothing) * *previous : value;
+  }
+
+  std::shared_ptr<State> state_;
+};
+
+// Frames carried by one buffer at the sampled pad; 1 for unbatched pads. For
+// nvstreammux output return BatchMetaView::from_buffer(b)->get()->num_frames_in_batch.
+using FramesPerBuffer = std::function<std::uint32_t(GstBuffer* buffer)>;
+
+namespace detail {
+
+// Counters shared with the pad probes (which own one reference each).
+struct CapacityCounters {
+  FramesPerBuffer frames_per_buffer;
+  std::atomic<std::uint64_t> frames{0};
+  std::atomic<std::uint64_t> busy_ns{0};
+  // Stage entry times, FIFO by buffer: written by the input probe, consumed by
+  // the output probe. Buffers more than ring.size() deep are not timed.
+  std::array<std::atomic<std::int64_t>, 64> ring{};
+  std::atomic<std::uint64_t> entered{0};
+  std::atomic<std::uint64_t> left{0};
+  std::atomic<std::int64_t> last_exit{0};
+};
+
+inline std::chrono::nanoseconds process_cpu_time() noexcept {
+  timespec ts{};
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return std::chrono::seconds{ts.tv_sec} + std::chrono::nanoseconds{ts.tv_nsec};
+}
+
+inline GstPadProbeReturn count_frames(GstPad* /*pad*/, GstPadProbeInfo* info, gpointer user_data) {
+  auto& c = **static_cast<std::shared_ptr<CapacityCounters>*>(user_data);
+  GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+  const std::uint32_t n = buffer != nullptr && c.frames_per_buffer ? c.frames_per_buffer(buffer) : 1U;
+  c.frames.fetch_add(n, std::memory_order_relaxed);
+  return GST_PAD_PROBE_OK;
+}
+
+inline GstPadProbeReturn stage_enter(GstPad* /*pad*/, GstPadProbeInfo* /*info*/, gpointer user_data) {
+  auto& c = **static_cast<std::shared_ptr<CapacityCounters>*>(user_data);
+  const auto slot = c.entered.fetch_add(1, std::memory_order_relaxed) % c.ring.size();
+  c.ring[slot].store(monotonic_ns(), std::memory_order_release);
+  return GST_PAD_PROBE_OK;
+}
+
+// Busy time is the union of [enter, exit] intervals, which for a stage that
+// handles one buffer at a time is its service time.
+inline GstPadProbeReturn stage_exit(GstPad* /*pad*/, GstPadProbeInfo* /*info*/, gpointer user_data) {
+  auto& c = **static_cast<std::shared_ptr<CapacityCounters>*>(user_data);
+  const auto index = c.left.fetch_add(1, std::memory_order_relaxed);
+  const auto entered = c.entered.load(std::memory_order_acquire);
+  if(index >= entered) {
+    // Entered before the probes were attached: stay in step with the inputs.
+    c.left.fetch_sub(1, std::memory_order_relaxed);
+    return GST_PAD_PROBE_OK;
+  }
+  if(entered - index > c.ring.size()) {
+    return GST_PAD_PROBE_OK;
+  }
+  const auto now = monotonic_ns();
+  const auto start = std::max(c.ring[index % c.ring.size()].load(std::memory_order_acquire),
+                              c.last_exit.exchange(now, std::memory_order_relaxed));
+  if(now > start) {
+    c.busy_ns.fetch_add(static_cast<std::uint64_t>(now - start), std::memory_order_relaxed);
+  }
+  return GST_PAD_PROBE_OK;
+}
+
+inline void delete_capacity_counters(gpointer data) {
+  delete static_cast<std::shared_ptr<CapacityCounters>*>(data);
+}
+
+}    // namespace detail
+
+// ============================================================================
+// CapacitySampler — measurement windows for CapacityModel
+// ============================================================================
+// Counts frames at one pad (normally the muxer's src pad) and, if
+// measure_stage() is called, the busy time of the stage between two pads (the
+// inference element's sink and src). Each sample() returns the window since the
+// previous call, with the process CPU time spent in it.
+//
+// Stage time assumes buffers leave in the order they entered. For elements that
+// queue internally (nvinfer pushes from its own output thread) it includes that
+// queueing, which makes the model conservative.
+class CapacitySampler {
+public:
+  [[nodiscard]] static nonstd::expected<CapacitySampler, Error> attach(GstPad* frames_pad,
+                                                                       FramesPerBuffer frames_per_buffer = {}) {
+    if(frames_pad == nullptr) {
+      return nonstd::make_unexpected(Error{ErrorKind::InvalidArgument, "CapacitySampler: pad is null"});
+    }
+    CapacitySampler sampler;
+    sampler.counters_->frames_per_buffer = std::move(frames_per_buffer);
+    if(!sampler.add_probe(frames_pad, &detail::count_frames)) {
+      return nonstd::make_unexpected(detail::log_error(ErrorKind::InvalidArgument, "CapacitySampler: cannot probe frames pad"));
+    }
+    sampler.last_wall_ = std::chrono::steady_clock::now();
+    sampler.last_cpu_ = detail::process_cpu_time();
+    return sampler;
+  }
+
+  CapacitySampler(CapacitySampler&&) noexcept = default;
+  CapacitySampler& operator=(CapacitySampler&&) = delete;
+  CapacitySampler(const CapacitySampler&) = delete;
+  CapacitySampler& operator=(const CapacitySampler&) = delete;
+
+  ~CapacitySampler() {
+    for(auto& [pad, id] : probes_) {
+      gst_pad_remove_probe(pad, id);
+      gst_object_unref(pad);
+    }
+  }
+
+  [[nodiscard]] nonstd::expected<void, Error> measure_stage(GstPad* input, GstPad* output) {
+    if(input == nullptr || output == nullptr) {
+      return nonstd::make_unexpected(Error{ErrorKind::InvalidArgument, "CapacitySampler: stage pads must not be null"});
+    }
+    if(!add_probe(input, &detail::stage_enter) || !add_probe(output, &detail::stage_exit)) {
+      return nonstd::make_unexpected(detail::log_error(ErrorKind::InvalidArgument, "CapacitySampler: cannot probe stage pads"));
+    }
+    return {};
+  }
+
+  // The window since the last call (or attach()).
+  [[nodiscard]] CapacitySample sample(std::size_t sources) {
+    const auto wall = std::chrono::steady_clock::now();
+    const auto cpu = detail::process_cpu_time();
+    const auto frames = counters_->frames.load(std::memory_order_relaxed);
+    const auto busy = counters_->busy_ns.load(std::memory_order_relaxed);
+    CapacitySample out{std::chrono::duration_cast<std::chrono::nanoseconds>(wall - last_wall_),
+                       frames - last_frames_,
+                       cpu - last_cpu_,
+                       std::chrono::nanoseconds{static_cast<std::int64_t>(busy - last_busy_)},
+                       static_cast<std::uint32_t>(sources)};
+    last_wall_ = wall;
+    last_cpu_ = cpu;
+    last_frames_ = frames;
+    last_busy_ = busy;
+    return out;
+  }
+
+private:
+  CapacitySampler() = default;
+
+  bool add_probe(GstPad* pad, GstPadProbeCallback callback) {
+    const gulong id = gst_pad_add_probe(pad,
+                                        GST_PAD_PROBE_TYPE_BUFFER,
+                                        callback,
+                                        new std::shared_ptr<detail::CapacityCounters>(counters_),
+                                        &detail::delete_capacity_counters);
+    if(id == 0) {
+      return false;
+    }
+    probes_.emplace_back(GST_PAD(gst_object_ref(pad)), id);
+    return true;
+  }
+
+  std::shared_ptr<detail::CapacityCounters> counters_{std::make_shared<detail::CapacityCounters>()};
+  std::vector<std::pair<GstPad*, gulong>> probes_;    // pads are our refs
+  std::chrono::steady_clock::time_point last_wall_{};
+  std::chrono::nanoseconds last_cpu_{0};
+  std::uint64_t last_frames_{0};
+  std::uint64_t last_busy_{0};
+};
+
+}    // namespace ds
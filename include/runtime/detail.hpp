@@ -0,0 +1,230 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <source_location>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <gst/gst.h>
+#include <gstreamer.hpp>
+
+#include <elements/detail.hpp>
+#include <nonstd/expected.hpp>
+#include <utils/debug.hpp>
+#include <utils/error.hpp>
+
+namespace ds::detail {
+
+// Reports a runtime-controller failure through DebugLayer (so it is counted
+// and delivered like Builder errors, with the caller's file and line) and
+// returns it for make_unexpected().
+inline Error log_error(ErrorKind kind, std::string msg, std::source_location loc = std::source_location::current()) {
+  DebugLayer::instance().log(DebugLevel::Error, kind, msg, loc.file_name(), static_cast<int>(loc.line()));
+  return Error{kind, std::move(msg)};
+}
+
+// steady_clock in nanoseconds, for timestamps kept in atomics by pad probes.
+inline std::int64_t monotonic_ns() noexcept {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct GstBufferDeleter final {
+  void operator()(GstBuffer* b) const noexcept {
+    if(b != nullptr) {
+      gst_buffer_unref(b);
+    }
+  }
+};
+using BufferPtr = std::unique_ptr<GstBuffer, GstBufferDeleter>;
+
+// A private pipeline of elements linked in order, for the helper pipelines
+// runtime services run next to the main one. elements[i] is made from
+// factories[i] and owned by pipeline.
+struct Chain {
+  gst::ElementPtr pipeline;
+  std::vector<GstElement*> elements;
+};
+
+[[nodiscard]] inline nonstd::expected<Chain, Error> make_chain(std::string_view owner, std::span<const char* const> factories) {
+  Chain chain;
+  chain.pipeline.reset(gst_pipeline_new(nullptr));
+  if(!chain.pipeline) {
+    return nonstd::make_unexpected(Error{ErrorKind::PipelineCreation, fmt::format("{}: cannot create pipeline", owner)});
+  }
+  gst_object_ref_sink(chain.pipeline.get());
+  for(const auto* factory : factories) {
+    GstElement* element = gst_element_factory_make(factory, nullptr);
+    if(element == nullptr) {
+      return nonstd::make_unexpected(
+          Error{ErrorKind::ElementCreation, fmt::format("{}: failed to create '{}' element", owner, factory)});
+    }
+    gst_bin_add(GST_BIN(chain.pipeline.get()), element);
+    if(!chain.elements.empty() && gst_element_link(chain.elements.back(), element) != TRUE) {
+      return nonstd::make_unexpected(Error{
+          ErrorKind::ElementLink,
+          fmt::format("{}: cannot link '{}' to '{}'", owner, factories[chain.elements.size() - 1], factory)});
+    }
+    chain.elements.push_back(element);
+  }
+  return chain;
+}
+
+// Text of an ERROR message as " (message)", or empty; appended to runtime
+// errors so they carry the element's reason.
+[[nodiscard]] inline std::string error_text(GstMessage* msg) {
+  std::string reason;
+  if(msg != nullptr && GST_MESSAGE_TYPE(msg) == GST_MESSAGE_ERROR) {
+    GError* err = nullptr;
+    gst_message_parse_error(msg, &err, nullptr);
+    if(err != nullptr) {
+      reason = fmt::format(" ({})", err->message);
+      g_error_free(err);
+    }
+  }
+  return reason;
+}
+
+// error_text() of the first ERROR waiting on the pipeline's bus.
+[[nodiscard]] inline std::string pop_bus_error(GstElement* pipeline) {
+  GstBus* bus = gst_element_get_bus(pipeline);
+  GstMessage* msg = gst_bus_pop_filtered(bus, GST_MESSAGE_ERROR);
+  gst_object_unref(bus);
+  auto reason = error_text(msg);
+  if(msg != nullptr) {
+    gst_message_unref(msg);
+  }
+  return reason;
+}
+
+enum class BitrateUnit : std::uint8_t {
+  Bps,
+  Kbps,
+};
+
+// Unit of the "bitrate" property for the encoders whose unit is known. Neither
+// the property's type nor its range tells bit/s from kbit/s, so other
+// factories are refused rather than guessed.
+[[nodiscard]] inline std::optional<BitrateUnit> bitrate_unit(std::string_view factory) noexcept {
+  struct Known {
+    std::string_view factory;
+    BitrateUnit unit;
+  };
+  constexpr Known known[] = {
+      {"nvv4l2h264enc", BitrateUnit::Bps}, {"nvv4l2h265enc", BitrateUnit::Bps}, {"nvv4l2av1enc", BitrateUnit::Bps},
+      {"openh264enc", BitrateUnit::Bps},   {"x264enc", BitrateUnit::Kbps},      {"x265enc", BitrateUnit::Kbps},
+      {"nvh264enc", BitrateUnit::Kbps},    {"nvh265enc", BitrateUnit::Kbps},    {"vaapih264enc", BitrateUnit::Kbps},
+      {"vaapih265enc", BitrateUnit::Kbps}, {"vah264enc", BitrateUnit::Kbps},    {"vah265enc", BitrateUnit::Kbps},
+      {"qsvh264enc", BitrateUnit::Kbps},   {"qsvh265enc", BitrateUnit::Kbps},   {"msdkh264enc", BitrateUnit::Kbps},
+      {"msdkh265enc", BitrateUnit::Kbps}};
+  const auto* it = std::find_if(std::begin(known), std::end(known), [factory](const Known& k) { return k.factory == factory; });
+  if(it == std::end(known)) {
+    return std::nullopt;
+  }
+  return it->unit;
+}
+
+// An encoder's "bitrate" GParamSpec and the unit its factory uses.
+struct BitrateProperty {
+  GParamSpec* spec{nullptr};
+  BitrateUnit unit{BitrateUnit::Bps};
+  std::string factory;
+};
+
+[[nodiscard]] inline nonstd::expected<BitrateProperty, Error> bitrate_property(GstElement* encoder) {
+  if(encoder == nullptr) {
+    return nonstd::make_unexpected(Error{ErrorKind::InvalidArgument, "bitrate: encoder is null"});
+  }
+  GstElementFactory* factory = gst_element_get_factory(encoder);
+  const gchar* name = factory != nullptr ? gst_plugin_feature_get_name(GST_PLUGIN_FEATURE(factory)) : nullptr;
+  BitrateProperty property;
+  property.factory = name != nullptr ? name : "unknown";
+  property.spec = g_object_class_find_property(G_OBJECT_GET_CLASS(encoder), "bitrate");
+  if(property.spec == nullptr) {
+    return nonstd::make_unexpected(
+        Error{ErrorKind::InvalidArgument, fmt::format("'{}' has no bitrate property", property.factory)});
+  }
+  const auto unit = bitrate_unit(property.factory);
+  if(!unit) {
+    return nonstd::make_unexpected(
+        Error{ErrorKind::InvalidArgument,
+              fmt::format("'{}': unit of its bitrate property (bit/s or kbit/s) is not known", property.factory)});
+  }
+  property.unit = *unit;
+  return property;
+}
+
+// Sets an encoder's target bitrate. bps is converted to the factory's unit,
+// then into the property's own value type with g_value_transform(); a value
+// that does not survive the round trip or that the spec would clamp is an
+// error. nvv4l2 encoders and x264enc accept changes while PLAYING.
+[[nodiscard]] inline nonstd::expected<void, Error> set_bitrate(GstElement* encoder, std::uint64_t bps) {
+  auto property = bitrate_property(encoder);
+  if(!property) {
+    return nonstd::make_unexpected(std::move(property.error()));
+  }
+  const std::uint64_t wanted = property->unit == BitrateUnit::Kbps ? std::max<std::uint64_t>(bps / 1000, 1) : bps;
+  GValue from = G_VALUE_INIT;
+  GValue value = G_VALUE_INIT;
+  GValue back = G_VALUE_INIT;
+  g_value_init(&from, G_TYPE_UINT64);
+  g_value_init(&value, G_PARAM_SPEC_VALUE_TYPE(property->spec));
+  g_value_init(&back, G_TYPE_UINT64);
+  g_value_set_uint64(&from, wanted);
+  const bool fits = g_value_transform(&from, &value) == TRUE && g_value_transform(&value, &back) == TRUE &&
+                    g_value_get_uint64(&back) == wanted && g_param_value_validate(property->spec, &value) == FALSE;
+  if(fits) {
+    g_object_set_property(G_OBJECT(encoder), "bitrate", &value);
+  }
+  g_value_unset(&back);
+  g_value_unset(&value);
+  g_value_unset(&from);
+  if(!fits) {
+    return nonstd::make_unexpected(Error{
+        ErrorKind::InvalidArgument,
+        fmt::format("'{}': {} bit/s is outside the range of its bitrate property", property->factory, bps)});
+  }
+  return {};
+}
+
+// An encoder's target bitrate in bit/s, read through the property's own value type.
+[[nodiscard]] inline nonstd::expected<std::uint64_t, Error> get_bitrate(GstElement* encoder) {
+  auto property = bitrate_property(encoder);
+  if(!property) {
+    return nonstd::make_unexpected(std::move(property.error()));
+  }
+  GValue value = G_VALUE_INIT;
+  GValue out = G_VALUE_INIT;
+  g_value_init(&value, G_PARAM_SPEC_VALUE_TYPE(property->spec));
+  g_value_init(&out, G_TYPE_UINT64);
+  g_object_get_property(G_OBJECT(encoder), "bitrate", &value);
+  const bool read = g_value_transform(&value, &out) == TRUE;
+  const auto raw = g_value_get_uint64(&out);
+  g_value_unset(&out);
+  g_value_unset(&value);
+  if(!read) {
+    return nonstd::make_unexpected(
+        Error{ErrorKind::InvalidArgument, fmt::format("'{}': bitrate property is not numeric", property->factory)});
+  }
+  return property->unit == BitrateUnit::Kbps ? raw * 1000U : raw;
+}
+
+// A queue's "overrun" handler: counts into the std::shared_ptr<std::atomic<std::uint64_t>>
+// passed as user_data, which release_overrun_counter() frees with the handler.
+inline void count_overrun(GstElement* /*queue*/, gpointer user_data) {
+  (*static_cast<std::shared_ptr<std::atomic<std::uint64_t>>*>(user_data))->fetch_add(1, std::memory_order_relaxed);
+}
+
+inline void release_overrun_counter(gpointer data, GClosure* /*closure*/) {
+  delete static_cast<std::shared_ptr<std::atomic<std::uint64_t>>*>(data);
+}
+
+}    // namespace ds::detail
@@ -0,0 +1,760 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <gst/gst.h>
+#include <gstreamer.hpp>
+
+#include <elements/detail.hpp>
+#include <nonstd/expected.hpp>
+#include <runtime/detail.hpp>
+#include <utils/error.hpp>
+
+namespace ds {
+
+enum class RecordContainer : std::uint8_t {
+  Mp4,    // mp4mux
+  Mkv,    // matroskamux
+};
+
+constexpr std::string_view record_container_str(RecordContainer container) noexcept {
+  switch(container) {
+  case RecordContainer::Mp4:
+    return "Mp4";
+  case RecordContainer::Mkv:
+    return "Mkv";
+  }
+  return "Unknown";
+}
+
+struct EventRecorderConfig {
+  std::chrono::milliseconds pre_event{5000};       // history kept for the start of each recording
+  std::chrono::milliseconds post_event{10000};     // recorded after trigger() unless it says otherwise
+  std::size_t max_bytes{std::size_t{32} << 20};    // ring limit; oldest GOPs go first
+  RecordContainer container{RecordContainer::Mp4};
+  std::size_t max_recordings{2};                       // concurrent recordings before trigger() refuses
+  std::chrono::milliseconds finalize_timeout{5000};    // wait for the muxer to finish a file
+};
+
+struct RecordingResult {
+  std::filesystem::path path;
+  std::uint64_t units{0};    // access units written
+  std::uint64_t bytes{0};
+  std::chrono::nanoseconds duration{0};     // first to last access unit
+  std::chrono::nanoseconds pre_event{0};    // part of duration recorded before the trigger
+};
+
+struct EventRecorderStats {
+  std::size_t ring_units{0};
+  std::size_t ring_bytes{0};
+  std::chrono::nanoseconds ring_duration{0};
+  std::uint64_t gops_dropped{0};    // GOPs trimmed from the front of the ring
+  std::uint64_t overflows{0};       // ring emptied because one GOP exceeded max_bytes
+  std::uint64_t recordings{0};      // trigger() calls accepted
+  std::uint64_t completed{0};
+  std::uint64_t failed{0};
+};
+
+namespace detail {
+
+struct AccessUnit {
+  BufferPtr buffer;
+  GstClockTime ts{0};    // DTS, or PTS when the stream has no DTS
+  std::size_t size{0};
+};
+
+// Decode-order timestamp of an encoded buffer; `last` when it has none.
+inline GstClockTime unit_time(GstBuffer* buffer, GstClockTime last) noexcept {
+  if(GST_BUFFER_DTS_IS_VALID(buffer)) {
+    return GST_BUFFER_DTS(buffer);
+  }
+  return GST_BUFFER_PTS_IS_VALID(buffer) ? GST_BUFFER_PTS(buffer) : last;
+}
+
+// A reference the ring can hold for seconds. Buffers from a pool (hardware
+// encoders, some parsers) are copied so the ring never starves the pool.
+inline BufferPtr hold(GstBuffer* buffer) {
+  return BufferPtr{buffer->pool != nullptr ? gst_buffer_copy_deep(buffer) : gst_buffer_ref(buffer)};
+}
+
+// Keyframe-aligned history of encoded access units. Always starts at a
+// keyframe; covers at least `window` once that much has been seen, plus at
+// most one GOP, and never more than max_bytes. Not thread safe.
+class GopRing {
+public:
+  GopRing(std::chrono::nanoseconds window, std::size_t max_bytes) : window_(window), max_bytes_(max_bytes) {}
+
+  // Takes its own reference on buffer. Delta units before the first keyframe
+  // are dropped, since nothing could decode them.
+  void push(GstBuffer* buffer, GstClockTime ts, bool keyframe) {
+    if(keyframe) {
+      gops_.emplace_back();
+    } else if(gops_.empty()) {
+      return;
+    }
+    const auto size = gst_buffer_get_size(buffer);
+    gops_.back().units.push_back(AccessUnit{hold(buffer), ts, size});
+    gops_.back().bytes += size;
+    bytes_ += size;
+    units_ += 1;
+    last_ = ts;
+
+    const auto window = static_cast<GstClockTime>(window_.count());
+    while(gops_.size() > 1 && (last_ - std::min(last_, gops_[1].start()) >= window || bytes_ > max_bytes_)) {
+      pop_front();
+      ++gops_dropped_;
+    }
+    if(bytes_ > max_bytes_) {
+      pop_front();
+      ++overflows_;
+    }
+  }
+
+  // New references to every unit, oldest (a keyframe) first.
+  [[nodiscard]] std::vector<AccessUnit> copy() const {
+    std::vector<AccessUnit> out;
+    out.reserve(units_);
+    for(const auto& gop : gops_) {
+      for(const auto& unit : gop.units) {
+        out.push_back(AccessUnit{BufferPtr{gst_buffer_ref(unit.buffer.get())}, unit.ts, unit.size});
+      }
+    }
+    return out;
+  }
+
+  [[nodiscard]] bool empty() const noexcept {
+    return gops_.empty();
+  }
+  [[nodiscard]] std::size_t units() const noexcept {
+    return units_;
+  }
+  [[nodiscard]] std::size_t bytes() const noexcept {
+    return bytes_;
+  }
+  [[nodiscard]] std::size_t gops() const noexcept {
+    return gops_.size();
+  }
+  [[nodiscard]] GstClockTime last() const noexcept {
+    return last_;
+  }
+  [[nodiscard]] std::chrono::nanoseconds duration() const noexcept {
+    if(gops_.empty()) {
+      return std::chrono::nanoseconds{0};
+    }
+    const auto first = gops_.front().start();
+    return std::chrono::nanoseconds{static_cast<std::int64_t>(last_ - std::min(last_, first))};
+  }
+  [[nodiscard]] std::uint64_t gops_dropped() const noexcept {
+    return gops_dropped_;
+  }
+  [[nodiscard]] std::uint64_t overflows() const noexcept {
+    return overflows_;
+  }
+
+private:
+  struct Gop {
+    std::vector<AccessUnit> units;
+    std::size_t bytes{0};
+
+    [[nodiscard]] GstClockTime start() const noexcept {
+      return units.front().ts;
+    }
+  };
+
+  void pop_front() {
+    bytes_ -= gops_.front().bytes;
+    units_ -= gops_.front().units.size();
+    gops_.pop_front();
+  }
+
+  std::chrono::nanoseconds window_;
+  std::size_t max_bytes_;
+  std::deque<Gop> gops_;
+  std::size_t bytes_{0};
+  std::size_t units_{0};
+  GstClockTime last_{0};
+  std::uint64_t gops_dropped_{0};
+  std::uint64_t overflows_{0};
+};
+
+// Parser that puts an encoded stream into the form muxers accept (AVC/HEVC
+// with codec_data for H.264/H.265); nullptr when the caps need none.
+inline const char* parser_for(GstCaps* caps) {
+  const gchar* name = gst_structure_get_name(gst_caps_get_structure(caps, 0));
+  const std::string_view media{name != nullptr ? name : ""};
+  if(media == "video/x-h264") {
+    return "h264parse";
+  }
+  if(media == "video/x-h265") {
+    return "h265parse";
+  }
+  return nullptr;
+}
+
+constexpr const char* muxer_for(RecordContainer container) noexcept {
+  return container == RecordContainer::Mkv ? "matroskamux" : "mp4mux";
+}
+
+enum class NalFormat : std::uint8_t {
+  None,    // parameter sets travel in caps (avc/hvc1 codec_data) or the codec has none
+  H264,    // Annex B byte-stream
+  H265,
+};
+
+// H.264/H.265 in byte-stream form carry SPS/PPS (and VPS) in the stream
+// itself, usually only on the first keyframe unless the parser repeats them.
+inline NalFormat byte_stream_format(GstCaps* caps) {
+  if(caps == nullptr || gst_caps_get_size(caps) == 0) {
+    return NalFormat::None;
+  }
+  const GstStructure* structure = gst_caps_get_structure(caps, 0);
+  const gchar* format = gst_structure_get_string(structure, "stream-format");
+  if(format == nullptr || std::string_view{format} != "byte-stream") {
+    return NalFormat::None;
+  }
+  if(gst_structure_has_name(structure, "video/x-h264") == TRUE) {
+    return NalFormat::H264;
+  }
+  return gst_structure_has_name(structure, "video/x-h265") == TRUE ? NalFormat::H265 : NalFormat::None;
+}
+
+// The latest parameter sets of a byte-stream, Annex B with start codes.
+struct ParameterSets {
+  NalFormat format{NalFormat::None};
+  std::vector<std::uint8_t> bytes;
+};
+
+// The VPS/SPS/PPS NAL units in front of the first slice of an Annex B access
+// unit, each behind a 4-byte start code; empty when it has none. Stops at the
+// first slice, so a keyframe is only read up to its picture data.
+inline std::vector<std::uint8_t> leading_parameter_sets(std::span<const std::uint8_t> au, NalFormat format) {
+  std::vector<std::uint8_t> out;
+  if(format == NalFormat::None) {
+    return out;
+  }
+  // Offset just past the next 00 00 01 at or after `from`, or au.size().
+  const auto next = [au](std::size_t from) {
+    for(std::size_t i = from; i + 3 <= au.size(); ++i) {
+      if(au[i] == 0 && au[i + 1] == 0 && au[i + 2] == 1) {
+        return i + 3;
+      }
+    }
+    return au.size();
+  };
+  constexpr std::array<std::uint8_t, 4> start_code{0, 0, 0, 1};
+  for(auto begin = next(0); begin < au.size();) {
+    const auto following = next(begin);
+    auto end = following == au.size() ? au.size() : following - 3;
+    while(end > begin && au[end - 1] == 0) {
+      --end;    // trailing zeros and the first byte of a 4-byte start code
+    }
+    const bool h264 = format == NalFormat::H264;
+    const unsigned type = h264 ? (au[begin] & 0x1FU) : ((au[begin] >> 1U) & 0x3FU);
+    if(h264 ? (type >= 1 && type <= 5) : type < 32) {
+      break;    // first slice
+    }
+    if(h264 ? (type == 7 || type == 8) : (type >= 32 && type <= 34)) {
+      out.insert(out.end(), start_code.begin(), start_code.end());
+      out.insert(out.end(), au.begin() + static_cast<std::ptrdiff_t>(begin), au.begin() + static_cast<std::ptrdiff_t>(end));
+    }
+    begin = following;
+  }
+  return out;
+}
+
+// Takes keyframe and returns it, or a buffer with the same timestamps and
+// flags whose memory is sets.bytes followed by keyframe's when the keyframe
+// does not carry parameter sets of its own.
+inline GstBuffer* with_parameter_sets(GstBuffer* keyframe, const ParameterSets& sets) {
+  if(sets.bytes.empty()) {
+    return keyframe;
+  }
+  GstMapInfo map;
+  if(gst_buffer_map(keyframe, &map, GST_MAP_READ) != TRUE) {
+    return keyframe;
+  }
+  const bool has_own = !leading_parameter_sets({map.data, map.size}, sets.format).empty();
+  gst_buffer_unmap(keyframe, &map);
+  if(has_own) {
+    return keyframe;
+  }
+  GstBuffer* out = gst_buffer_new_allocate(nullptr, sets.bytes.size(), nullptr);
+  gst_buffer_fill(out, 0, sets.bytes.data(), sets.bytes.size());
+  gst_buffer_copy_into(out,
+                       keyframe,
+                       static_cast<GstBufferCopyFlags>(GST_BUFFER_COPY_FLAGS | GST_BUFFER_COPY_TIMESTAMPS |
+                                                       GST_BUFFER_COPY_META | GST_BUFFER_COPY_MEMORY),
+                       0,
+                       static_cast<gsize>(-1));
+  gst_buffer_unref(keyframe);
+  return out;
+}
+
+}    // namespace detail
+
+// ============================================================================
+// EventRecorder — pre-event recording of an encoded stream, no re-encode
+// ============================================================================
+//   // probe after the parser, where buffers are whole access units
+//   auto recorder = ds::EventRecorder::attach(h264parse_src, {.pre_event = 5s, .post_event = 10s}).value();
+//   ... on an event:
+//   auto file = recorder.trigger(fmt::format("/data/cam{}_{}.mp4", id, n));
+//   ... later: file.get() holds the RecordingResult or the error
+//
+// A buffer probe keeps the last pre_event of access units in a ring aligned to
+// keyframes, holding references rather than copies. trigger() hands a copy of
+// the ring to a new recording and the probe keeps feeding it live units until
+// post_event past the trigger; a worker thread pushes them through appsrc
+// (! h264parse|h265parse) ! mp4mux|matroskamux ! filesink in a small pipeline
+// of its own, so the live pipeline never waits for muxing or disk and a
+// recording never changes its state. Nothing is decoded or re-encoded.
+//
+// Works on any encoded stream whose delta units carry DELTA_UNIT, which
+// GStreamer encoders and parsers set; one EventRecorder per source bounds the
+// memory to max_bytes each. A recording with nothing to preroll starts at the
+// next keyframe.
+//
+// A byte-stream H.264/H.265 source often sends its SPS/PPS (and VPS) only with
+// the first keyframe (h264parse/h265parse default to config-interval=0), and
+// that GOP leaves the ring after pre_event. The probe therefore keeps the
+// latest parameter sets it has seen on a keyframe and puts them in front of a
+// recording's first keyframe when that one carries none. AVC/HEVC streams
+// (stream-format=avc, hvc1, ...) have them in the caps' codec_data already.
+class EventRecorder {
+public:
+  using Result = nonstd::expected<RecordingResult, Error>;
+
+  [[nodiscard]] static nonstd::expected<EventRecorder, Error> attach(GstPad* pad, EventRecorderConfig config = {}) {
+    if(pad == nullptr) {
+      return nonstd::make_unexpected(Error{ErrorKind::InvalidArgument, "EventRecorder: no pad"});
+    }
+    if(config.pre_event.count() < 0 || config.post_event.count() < 0 || config.finalize_timeout.count() <= 0) {
+      return nonstd::make_unexpected(
+          Error{ErrorKind::InvalidArgument, "EventRecorder: durations must be >= 0 and finalize_timeout > 0"});
+    }
+    if(config.max_bytes == 0 || config.max_recordings == 0) {
+      return nonstd::make_unexpected(
+          Error{ErrorKind::InvalidArgument, "EventRecorder: max_bytes and max_recordings must be >= 1"});
+    }
+    auto state = std::make_shared<State>(config);
+    EventRecorder recorder{state};
+    try {
+      recorder.worker_ = std::thread{&State::run, state.get()};
+    } catch(const std::system_error& e) {
+      return nonstd::make_unexpected(Error{ErrorKind::Unknown, std::string{"Failed to start recording thread: "} + e.what()});
+    }
+    state->pad = GST_PAD(gst_object_ref(pad));
+    state->probe = gst_pad_add_probe(
+        pad, GST_PAD_PROBE_TYPE_BUFFER, &State::on_buffer, new std::shared_ptr<State>(state), &State::release);
+    if(state->probe == 0) {
+      return nonstd::make_unexpected(detail::log_error(ErrorKind::InvalidArgument, "EventRecorder: cannot probe pad"));
+    }
+    return recorder;
+  }
+
+  ~EventRecorder() {
+    close();
+  }
+
+  EventRecorder(EventRecorder&&) noexcept = default;
+  EventRecorder& operator=(EventRecorder&& other) noexcept {
+    if(this != &other) {
+      close();
+      state_ = std::move(other.state_);
+      worker_ = std::move(other.worker_);
+    }
+    return *this;
+  }
+  EventRecorder(const EventRecorder&) = delete;
+  EventRecorder& operator=(const EventRecorder&) = delete;
+
+  // Starts a recording of the ring plus the next post_event of the stream. A
+  // refused trigger (closed, no caps yet, max_recordings active) yields a
+  // ready future holding the error.
+  [[nodiscard]] std::future<Result> trigger(std::filesystem::path path) {
+    return trigger(std::move(path), state_->config.post_event);
+  }
+
+  [[nodiscard]] std::future<Result> trigger(std::filesystem::path path, std::chrono::milliseconds post_event) {
+    auto recording = std::make_unique<Recording>();
+    auto result = recording->promise.get_future();
+    auto refuse = [&recording](Error error) {
+      recording->promise.set_value(nonstd::make_unexpected(std::move(error)));
+    };
+    auto& s = *state_;
+    {
+      std::lock_guard lk{s.mutex};
+      if(s.stopping) {
+        refuse(Error{ErrorKind::Capacity, "EventRecorder: closed"});
+        return result;
+      }
+      if(s.recordings.size() >= s.config.max_recordings) {
+        refuse(Error{ErrorKind::Capacity, fmt::format("EventRecorder: {} recordings already active", s.recordings.size())});
+        return result;
+      }
+      recording->caps.reset(gst_pad_get_current_caps(s.pad));
+      if(!recording->caps) {
+        refuse(Error{ErrorKind::InvalidArgument, "EventRecorder: stream has no caps yet"});
+        return result;
+      }
+      recording->path = std::move(path);
+      recording->post_event = post_event;
+      recording->deadline = std::chrono::steady_clock::now() + post_event + s.config.finalize_timeout;
+      recording->pending = s.ring.copy();
+      recording->keyed = !recording->pending.empty();
+      if(recording->keyed) {
+        recording->parameter_sets = s.parameter_sets;
+      }
+      if(!s.ring.empty()) {
+        recording->trigger_ts = s.ring.last();
+        recording->end_ts = s.ring.last() + static_cast<GstClockTime>(std::chrono::nanoseconds{post_event}.count());
+      }
+      s.recordings.push_back(std::move(recording));
+      s.started.fetch_add(1, std::memory_order_relaxed);
+    }
+    s.wake.notify_one();
+    return result;
+  }
+
+  // Ends every active recording with what it has so far.
+  void stop() {
+    {
+      std::lock_guard lk{state_->mutex};
+      for(auto& recording : state_->recordings) {
+        recording->input_done = true;
+      }
+    }
+    state_->wake.notify_one();
+  }
+
+  // Detaches from the pad, finishes active recordings and stops the worker.
+  // Idempotent; later trigger() calls are refused.
+  void close() {
+    if(!state_ || !worker_.joinable()) {
+      return;
+    }
+    auto& s = *state_;
+    if(s.pad != nullptr) {
+      if(s.probe != 0) {
+        gst_pad_remove_probe(s.pad, s.probe);
+      }
+      gst_object_unref(s.pad);
+      s.pad = nullptr;
+    }
+    {
+      std::lock_guard lk{s.mutex};
+      s.stopping = true;
+    }
+    s.wake.notify_one();
+    worker_.join();
+  }
+
+  [[nodiscard]] EventRecorderStats stats() const {
+    const auto& s = *state_;
+    std::lock_guard lk{s.mutex};
+    return {s.ring.units(),
+            s.ring.bytes(),
+            s.ring.duration(),
+            s.ring.gops_dropped(),
+            s.ring.overflows(),
+            s.started.load(std::memory_order_relaxed),
+            s.completed.load(std::memory_order_relaxed),
+            s.failed.load(std::memory_order_relaxed)};
+  }
+
+private:
+  struct Recording {
+    // Called by the probe under State::mutex; true when a unit was queued.
+    bool feed(GstBuffer* buffer, GstClockTime ts, bool keyframe, const detail::ParameterSets& sets) {
+      if(input_done || (!keyed && !keyframe)) {
+        return false;
+      }
+      if(!keyed) {
+        parameter_sets = sets;
+      }
+      keyed = true;
+      if(trigger_ts == GST_CLOCK_TIME_NONE) {
+        trigger_ts = ts;
+        end_ts = ts + static_cast<GstClockTime>(std::chrono::nanoseconds{post_event}.count());
+      }
+      pending.push_back(detail::AccessUnit{detail::hold(buffer), ts, gst_buffer_get_size(buffer)});
+      input_done = ts >= end_ts;
+      return true;
+    }
+
+    // Shared with the probe, under State::mutex.
+    std::vector<detail::AccessUnit> pending;
+    std::chrono::milliseconds post_event{0};
+    GstClockTime trigger_ts{GST_CLOCK_TIME_NONE};    // first live unit's, when the ring was empty
+    GstClockTime end_ts{GST_CLOCK_TIME_NONE};
+    bool keyed{false};    // a keyframe has been queued
+    bool input_done{false};
+    detail::ParameterSets parameter_sets;    // set with the first unit; the worker prepends them to it
+    // Worker only.
+    std::filesystem::path path;
+    gst::CapsPtr caps;
+    std::chrono::steady_clock::time_point deadline;    // in case the stream stalls
+    std::promise<Result> promise;
+    detail::Chain chain;
+    GstElement* src{nullptr};
+    bool failed{false};      // promise already holds the error
+    GstClockTime base{0};    // subtracted from timestamps, so files start at 0
+    GstClockTime first{0};
+    GstClockTime last{0};
+    RecordingResult result;
+  };
+
+  // Shared with the probe, which may outlive the EventRecorder until removed.
+  struct State {
+    explicit State(const EventRecorderConfig& c) : config(c), ring(c.pre_event, c.max_bytes) {}
+
+    static GstPadProbeReturn on_buffer(GstPad* pad, GstPadProbeInfo* info, gpointer user_data) {
+      auto& s = **static_cast<std::shared_ptr<State>*>(user_data);
+      GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+      if(buffer == nullptr) {
+        return GST_PAD_PROBE_OK;
+      }
+      const bool keyframe = !GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+      auto sets = keyframe ? s.scan_parameter_sets(pad, buffer) : detail::ParameterSets{};
+      bool feeding = false;
+      {
+        std::lock_guard lk{s.mutex};
+        if(!sets.bytes.empty()) {
+          s.parameter_sets = std::move(sets);
+        }
+        const auto ts = detail::unit_time(buffer, s.ring.last());
+        s.ring.push(buffer, ts, keyframe);
+        for(auto& recording : s.recordings) {
+          feeding |= recording->feed(buffer, ts, keyframe, s.parameter_sets);
+        }
+      }
+      if(feeding) {
+        s.wake.notify_one();
+      }
+      return GST_PAD_PROBE_OK;
+    }
+
+    static void release(gpointer data) {
+      delete static_cast<std::shared_ptr<State>*>(data);
+    }
+
+    // Probe thread only: the parameter sets a byte-stream keyframe starts with.
+    detail::ParameterSets scan_parameter_sets(GstPad* probed, GstBuffer* buffer) {
+      gst::CapsPtr caps{gst_pad_get_current_caps(probed)};
+      if(caps.get() != stream_caps.get()) {
+        stream_format = detail::byte_stream_format(caps.get());
+        stream_caps = std::move(caps);
+      }
+      detail::ParameterSets sets{stream_format, {}};
+      GstMapInfo map;
+      if(stream_format == detail::NalFormat::None || gst_buffer_map(buffer, &map, GST_MAP_READ) != TRUE) {
+        return sets;
+      }
+      sets.bytes = detail::leading_parameter_sets({map.data, map.size}, stream_format);
+      gst_buffer_unmap(buffer, &map);
+      return sets;
+    }
+
+    void run() {
+      for(;;) {
+        std::vector<std::pair<Recording*, std::vector<detail::AccessUnit>>> work;
+        std::vector<Recording*> finishing;
+        {
+          std::unique_lock lk{mutex};
+          const auto ready = [this] { return stopping || has_work(); };
+          if(recordings.empty()) {
+            wake.wait(lk, ready);
+          } else {
+            wake.wait_until(lk, next_deadline(), ready);
+          }
+          const auto now = std::chrono::steady_clock::now();
+          for(auto& recording : recordings) {
+            work.emplace_back(recording.get(), std::exchange(recording->pending, {}));
+            if(stopping || recording->input_done || now >= recording->deadline) {
+              recording->input_done = true;
+              finishing.push_back(recording.get());
+            }
+          }
+          if(stopping && recordings.empty()) {
+            return;
+          }
+        }
+
+        for(auto& [recording, units] : work) {
+          write(*recording, units);
+        }
+        for(auto* recording : finishing) {
+          finish(*recording);
+        }
+        if(!finishing.empty()) {
+          std::lock_guard lk{mutex};
+          std::erase_if(recordings, [&finishing](const auto& r) {
+            return std::find(finishing.begin(), finishing.end(), r.get()) != finishing.end();
+          });
+        }
+      }
+    }
+
+    [[nodiscard]] bool has_work() const {
+      return std::any_of(
+          recordings.begin(), recordings.end(), [](const auto& r) { return !r->pending.empty() || r->input_done; });
+    }
+
+    [[nodiscard]] std::chrono::steady_clock::time_point next_deadline() const {
+      const auto earliest = std::min_element(
+          recordings.begin(), recordings.end(), [](const auto& a, const auto& b) { return a->deadline < b->deadline; });
+      return (*earliest)->deadline;
+    }
+
+    // Builds the recording pipeline on the first unit, then pushes shallow
+    // copies re-timed to start at zero.
+    void write(Recording& r, const std::vector<detail::AccessUnit>& units) {
+      if(r.failed || units.empty() || (!r.chain.pipeline && !start(r, units.front()))) {
+        return;
+      }
+      for(const auto& unit : units) {
+        GstBuffer* out = gst_buffer_copy(unit.buffer.get());
+        if(r.result.units == 0) {
+          out = detail::with_parameter_sets(out, r.parameter_sets);
+        }
+        const auto size = gst_buffer_get_size(out);
+        if(GST_BUFFER_PTS_IS_VALID(out)) {
+          GST_BUFFER_PTS(out) -= std::min(GST_BUFFER_PTS(out), r.base);
+        }
+        if(GST_BUFFER_DTS_IS_VALID(out)) {
+          GST_BUFFER_DTS(out) -= std::min(GST_BUFFER_DTS(out), r.base);
+        }
+        GstFlowReturn flow = GST_FLOW_OK;
+        g_signal_emit_by_name(r.src, "push-buffer", out, &flow);
+        gst_buffer_unref(out);
+        if(flow != GST_FLOW_OK) {
+          return;    // the muxer's error reaches the bus and finish() reports it
+        }
+        r.result.units += 1;
+        r.result.bytes += size;
+        r.last = unit.ts;
+      }
+    }
+
+    [[nodiscard]] bool start(Recording& r, const detail::AccessUnit& first) {
+      std::vector<const char*> factories{"appsrc"};
+      if(const auto* parser = detail::parser_for(r.caps.get())) {
+        factories.push_back(parser);
+      }
+      factories.push_back(detail::muxer_for(config.container));
+      factories.push_back("filesink");
+      auto chain = detail::make_chain("EventRecorder", factories);
+      if(!chain) {
+        return fail(r, std::move(chain.error()));
+      }
+      r.chain = std::move(*chain);
+      r.src = r.chain.elements.front();
+      GstElement* sink = r.chain.elements.back();
+      detail::set_property(r.src, "format", GST_FORMAT_TIME);
+      detail::set_property(r.src, "caps", r.caps.get());
+      detail::set_property(r.src, "max-bytes", static_cast<guint64>(0));
+      detail::set_property(sink, "location", r.path.string());
+      detail::set_property(sink, "sync", FALSE);
+      detail::set_property(sink, "async", FALSE);
+      if(gst_element_set_state(r.chain.pipeline.get(), GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+        r.chain.pipeline.reset();
+        return fail(r,
+                    detail::log_error(ErrorKind::ElementState,
+                                      fmt::format("EventRecorder: pipeline for '{}' refused PLAYING", r.path.string())));
+      }
+      GstBuffer* b = first.buffer.get();
+      r.base = GST_BUFFER_DTS_IS_VALID(b) ? GST_BUFFER_DTS(b) : (GST_BUFFER_PTS_IS_VALID(b) ? GST_BUFFER_PTS(b) : 0);
+      r.first = first.ts;
+      r.result.path = r.path;
+      r.result.pre_event = std::chrono::nanoseconds{static_cast<std::int64_t>(r.trigger_ts - std::min(r.trigger_ts, first.ts))};
+      return true;
+    }
+
+    // Sends EOS, waits for the muxer to write its index and fulfils the promise.
+    void finish(Recording& r) {
+      if(r.failed) {
+        failed.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+      if(!r.chain.pipeline) {
+        fail(r, Error{ErrorKind::Unknown, fmt::format("EventRecorder: nothing to record for '{}'", r.path.string())});
+        failed.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+      GstElement* pipeline = r.chain.pipeline.get();
+      GstFlowReturn flow = GST_FLOW_OK;
+      g_signal_emit_by_name(r.src, "end-of-stream", &flow);
+      GstBus* bus = gst_element_get_bus(pipeline);
+      const auto timeout = std::chrono::duration_cast<std::chrono::nanoseconds>(config.finalize_timeout).count();
+      GstMessage* msg = gst_bus_timed_pop_filtered(
+          bus, static_cast<GstClockTime>(timeout), static_cast<GstMessageType>(GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+      gst_object_unref(bus);
+      const bool eos = msg != nullptr && GST_MESSAGE_TYPE(msg) == GST_MESSAGE_EOS;
+      const auto reason = msg == nullptr ? std::string{" (timeout)"} : detail::error_text(msg);
+      if(msg != nullptr) {
+        gst_message_unref(msg);
+      }
+      gst_element_set_state(pipeline, GST_STATE_NULL);
+      r.chain.pipeline.reset();
+
+      if(!eos) {
+        fail(r,
+             detail::log_error(ErrorKind::FileIO, fmt::format("EventRecorder: '{}' not finalized{}", r.path.string(), reason)));
+        failed.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+      r.result.duration = std::chrono::nanoseconds{static_cast<std::int64_t>(r.last - std::min(r.last, r.first))};
+      completed.fetch_add(1, std::memory_order_relaxed);
+      r.promise.set_value(std::move(r.result));
+    }
+
+    static bool fail(Recording& r, Error error) {
+      if(!r.failed) {
+        r.failed = true;
+        r.promise.set_value(nonstd::make_unexpected(std::move(error)));
+      }
+      return false;
+    }
+
+    EventRecorderConfig config;
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    detail::GopRing ring;
+    detail::ParameterSets parameter_sets;    // latest seen on a keyframe
+    std::vector<std::unique_ptr<Recording>> recordings;
+    bool stopping{false};
+    GstPad* pad{nullptr};    // our ref
+    gulong probe{0};
+    gst::CapsPtr stream_caps;    // probe thread only
+    detail::NalFormat stream_format{detail::NalFormat::None};
+    std::atomic<std::uint64_t> started{0};
+    std::atomic<std::uint64_t> completed{0};
+    std::atomic<std::uint64_t> failed{0};
+  };
+
+  explicit EventRecorder(std::shared_ptr<State> state) : state_(std::move(state)) {}
+
+  std::shared_ptr<State> state_;
+  std::thread worker_;
+};
+
+}    // namespace ds
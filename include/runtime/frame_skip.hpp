@@ -0,0 +1,343 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <gst/gst.h>
+
+#include <nonstd/expected.hpp>
+#include <runtime/detail.hpp>
+#include <runtime/load_shedder.hpp>
+#include <runtime/source_manager.hpp>
+#include <utils/debug.hpp>
+#include <utils/error.hpp>
+
+namespace ds {
+
+// Applies a new skip interval to one source (1 = keep every frame).
+using SkipActuator = std::function<void(SourceId id, std::uint32_t interval)>;
+
+struct FrameSkipConfig {
+  std::chrono::milliseconds target{200};          // latency to stay under
+  double low_water{0.7};                          // relax once latency < target * low_water
+  std::uint32_t max_interval{8};                  // default cap per source
+  double smoothing{0.2};                          // EWMA weight of a new sample
+  std::chrono::milliseconds hold{1000};           // minimum time between two adjustments
+  std::chrono::milliseconds stale_after{5000};    // ignore sources without a sample this recent
+};
+
+struct FrameSkipSourceState {
+  int priority{0};
+  std::uint32_t interval{1};
+  std::uint32_t max_interval{1};
+  std::optional<std::chrono::nanoseconds> latency;    // smoothed; empty until the first sample
+};
+
+// Actuator that drives a LoadShedder's Interval mode, which takes effect on the
+// next buffer. The shedder must outlive the controller.
+inline SkipActuator skip_with(LoadShedder& shedder) {
+  return [&shedder](SourceId id, std::uint32_t interval) {
+    (void)shedder.set_action(id, interval <= 1 ? ShedAction{} : ShedAction{ShedMode::Interval, interval});
+  };
+}
+
+// Actuator that sets drop-frame-interval on the SourceManager's source element
+// (nvurisrcbin, nvv4l2decoder); sources without the property are left alone.
+// Whether a change applies while PLAYING depends on the element; skip_with()
+// always does. The manager must outlive the controller.
+inline SkipActuator skip_with_drop_frame_interval(const SourceManager& sources) {
+  return [&sources](SourceId id, std::uint32_t interval) {
+    GstElement* source = sources.source(id);
+    if(source != nullptr && g_object_class_find_property(G_OBJECT_GET_CLASS(source), "drop-frame-interval") != nullptr) {
+      g_object_set(G_OBJECT(source), "drop-frame-interval", static_cast<guint>(interval <= 1 ? 0 : interval), nullptr);
+    }
+  };
+}
+
+// ============================================================================
+// FrameSkipController — closed-loop frame skipping against a latency target
+// ============================================================================
+//   auto shedder = ds::LoadShedder::create().value();
+//   auto skip = ds::FrameSkipController::create({.target = 150ms}, ds::skip_with(shedder)).value();
+//   for(auto id : sources.ids()) {
+//     shedder.attach(sources, id);
+//     skip.add_source(id, priority_of(id));
+//   }
+//   skip.attach_latency_probe(id, pad);       // or observe(id, latency) from your own probe
+//   ... every 100 ms: skip.tick();
+//
+// Latency samples are smoothed per source (EWMA). tick() compares the worst
+// recent source against the target and changes one source by one step:
+//   - above target: the lowest-priority source below its max_interval skips more;
+//   - below target * low_water: the highest-priority source that skips, skips less.
+// Between the two thresholds nothing changes, and no two changes are closer than
+// `hold`, which gives the pipeline time to respond before the next step.
+//
+// With a shared bottleneck (one GPU running inference for every stream) the
+// latency of all sources moves together, so reacting to the worst one and
+// spending the skip budget on low-priority sources first is what keeps the
+// important cameras at full rate.
+//
+// attach_latency_probe() measures, per buffer, clock running time minus the
+// buffer's running-time PTS at the given pad: capture-to-pad latency for live
+// sources. For batched pads after nvstreammux, call observe() from a probe
+// that walks FrameMetaView::source_id() / buf_pts() instead.
+class FrameSkipController {
+public:
+  [[nodiscard]] static nonstd::expected<FrameSkipController, Error> create(FrameSkipConfig config, SkipActuator actuator) {
+    if(!actuator) {
+      return nonstd::make_unexpected(Error{ErrorKind::InvalidArgument, "FrameSkipController: actuator is empty"});
+    }
+    if(config.target.count() <= 0 || config.low_water <= 0.0 || config.low_water >= 1.0 || config.smoothing <= 0.0 ||
+       config.smoothing > 1.0 || config.max_interval == 0) {
+      return nonstd::make_unexpected(Error{ErrorKind::InvalidArgument,
+                                           "FrameSkipController: need target > 0, low_water in (0, 1), "
+                                           "smoothing in (0, 1] and max_interval >= 1"});
+    }
+    auto state = std::make_shared<State>();
+    state->config = config;
+    state->actuator = std::move(actuator);
+    return FrameSkipController{std::move(state)};
+  }
+
+  FrameSkipController(FrameSkipController&&) noexcept = default;
+  FrameSkipController& operator=(FrameSkipController&& other) noexcept {
+    if(this != &other) {
+      remove_probes();
+      state_ = std::move(other.state_);
+    }
+    return *this;
+  }
+  FrameSkipController(const FrameSkipController&) = delete;
+  FrameSkipController& operator=(const FrameSkipController&) = delete;
+
+  ~FrameSkipController() {
+    remove_probes();
+  }
+
+  // Registers a source at interval 1. max_interval 0 uses the config default;
+  // 1 means this source is never skipped.
+  void add_source(SourceId id, int priority = 0, std::uint32_t max_interval = 0) {
+    std::lock_guard lk{state_->mutex};
+    auto& source = state_->sources[id];
+    source = Source{};
+    source.priority = priority;
+    source.max_interval = max_interval != 0 ? max_interval : state_->config.max_interval;
+  }
+
+  void remove_source(SourceId id) {
+    std::lock_guard lk{state_->mutex};
+    state_->sources.erase(id);
+  }
+
+  [[nodiscard]] nonstd::expected<void, Error> set_priority(SourceId id, int priority) {
+    std::lock_guard lk{state_->mutex};
+    const auto it = state_->sources.find(id);
+    if(it == state_->sources.end()) {
+      return nonstd::make_unexpected(Error{ErrorKind::InvalidArgument, fmt::format("FrameSkipController: no source {}", id)});
+    }
+    it->second.priority = priority;
+    return {};
+  }
+
+  // Feeds one latency sample; safe from streaming threads.
+  void observe(SourceId id,
+               std::chrono::nanoseconds latency,
+               std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now()) {
+    state_->observe(id, latency, now);
+  }
+
+  // Measures latency of source id on every buffer crossing pad (see above).
+  [[nodiscard]] nonstd::expected<void, Error> attach_latency_probe(SourceId id, GstPad* pad) {
+    if(pad == nullptr) {
+      return nonstd::make_unexpected(Error{ErrorKind::InvalidArgument, "FrameSkipController: pad is null"});
+    }
+    auto* probe = new LatencyProbe{state_, id};
+    const gulong probe_id =
+        gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, &FrameSkipController::measure, probe, &FrameSkipController::free_probe);
+    if(probe_id == 0) {
+      return nonstd::make_unexpected(
+          detail::log_error(ErrorKind::InvalidArgument, fmt::format("FrameSkipController: cannot probe pad of source {}", id)));
+    }
+    std::lock_guard lk{state_->mutex};
+    state_->probes.emplace_back(GST_PAD(gst_object_ref(pad)), probe_id);
+    return {};
+  }
+
+  // Evaluates the latest samples and changes at most one source by one step.
+  // Returns the source that changed, if any.
+  std::optional<SourceId> tick(std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now()) {
+    auto& s = *state_;
+    std::unique_lock lk{s.mutex};
+    if(s.adjusted && now - s.last_adjust < s.config.hold) {
+      return std::nullopt;
+    }
+    std::optional<std::chrono::nanoseconds> worst;
+    for(const auto& [id, source] : s.sources) {
+      if(source.latency && now - source.sampled_at <= s.config.stale_after && (!worst || *source.latency > *worst)) {
+        worst = source.latency;
+      }
+    }
+    if(!worst) {
+      return std::nullopt;
+    }
+
+    const auto target = std::chrono::duration_cast<std::chrono::nanoseconds>(s.config.target);
+    std::optional<SourceId> pick;
+    if(*worst > target) {
+      pick = s.pick(true);
+      if(pick) {
+        ++s.sources.at(*pick).interval;
+      }
+    } else if(static_cast<double>(worst->count()) < static_cast<double>(target.count()) * s.config.low_water) {
+      pick = s.pick(false);
+      if(pick) {
+        --s.sources.at(*pick).interval;
+      }
+    }
+    if(!pick) {
+      return std::nullopt;
+    }
+    s.adjusted = true;
+    s.last_adjust = now;
+    const auto interval = s.sources.at(*pick).interval;
+    const auto actuator = s.actuator;
+    lk.unlock();
+
+    DS_DEBUG("FrameSkipController: worst latency {} ms, source {} interval {}", worst->count() / 1'000'000, *pick, interval);
+    actuator(*pick, interval);
+    return pick;
+  }
+
+  [[nodiscard]] std::optional<FrameSkipSourceState> source(SourceId id) const {
+    std::lock_guard lk{state_->mutex};
+    const auto it = state_->sources.find(id);
+    if(it == state_->sources.end()) {
+      return std::nullopt;
+    }
+    const auto& c = it->second;
+    return FrameSkipSourceState{c.priority, c.interval, c.max_interval, c.latency};
+  }
+
+private:
+  struct Source {
+    int priority{0};
+    std::uint32_t interval{1};
+    std::uint32_t max_interval{1};
+    std::optional<std::chrono::nanoseconds> latency;
+    std::chrono::steady_clock::time_point sampled_at{};
+  };
+
+  struct State {
+    void observe(SourceId id, std::chrono::nanoseconds latency, std::chrono::steady_clock::time_point now) {
+      std::lock_guard lk{mutex};
+      const auto it = sources.find(id);
+      if(it == sources.end()) {
+        return;
+      }
+      auto& c = it->second;
+      if(!c.latency) {
+        c.latency = latency;
+      } else {
+        const auto blended = config.smoothing * static_cast<double>(latency.count()) +
+                             (1.0 - config.smoothing) * static_cast<double>(c.latency->count());
+        c.latency = std::chrono::nanoseconds{static_cast<std::int64_t>(blended)};
+      }
+      c.sampled_at = now;
+    }
+
+    // Raising picks the lowest (priority, id) that can still skip more;
+    // relaxing picks the highest that skips at all, so the two directions undo
+    // each other's steps in reverse order.
+    [[nodiscard]] std::optional<SourceId> pick(bool raising) const {
+      std::optional<std::pair<int, SourceId>> best;
+      for(const auto& [id, source] : sources) {
+        const bool eligible = raising ? source.interval < source.max_interval : source.interval > 1;
+        const std::pair key{source.priority, id};
+        if(eligible && (!best || (raising ? key < *best : key > *best))) {
+          best = key;
+        }
+      }
+      return best ? std::optional{best->second} : std::nullopt;
+    }
+
+    FrameSkipConfig config;
+    SkipActuator actuator;
+    mutable std::mutex mutex;
+    std::map<SourceId, Source> sources;
+    std::vector<std::pair<GstPad*, gulong>> probes;    // pads are our refs
+    bool adjusted{false};
+    std::chrono::steady_clock::time_point last_adjust{};
+  };
+
+  struct LatencyProbe {
+    std::shared_ptr<State> state;
+    SourceId id;
+  };
+
+  static GstPadProbeReturn measure(GstPad* pad, GstPadProbeInfo* info, gpointer user_data) {
+    const auto* probe = static_cast<LatencyProbe*>(user_data);
+    GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+    if(buffer == nullptr || !GST_BUFFER_PTS_IS_VALID(buffer)) {
+      return GST_PAD_PROBE_OK;
+    }
+    GstElement* element = gst_pad_get_parent_element(pad);
+    if(element == nullptr) {
+      return GST_PAD_PROBE_OK;
+    }
+    GstClock* clock = gst_element_get_clock(element);
+    GstEvent* event = gst_pad_get_sticky_event(pad, GST_EVENT_SEGMENT, 0);
+    if(clock != nullptr && event != nullptr) {
+      const GstSegment* segment = nullptr;
+      gst_event_parse_segment(event, &segment);
+      const GstClockTime pts = gst_segment_to_running_time(segment, GST_FORMAT_TIME, GST_BUFFER_PTS(buffer));
+      const GstClockTime running = gst_clock_get_time(clock) - gst_element_get_base_time(element);
+      if(GST_CLOCK_TIME_IS_VALID(pts) && running >= pts) {
+        probe->state->observe(probe->id, std::chrono::nanoseconds{running - pts}, std::chrono::steady_clock::now());
+      }
+    }
+    if(event != nullptr) {
+      gst_event_unref(event);
+    }
+    if(clock != nullptr) {
+      gst_object_unref(clock);
+    }
+    gst_object_unref(element);
+    return GST_PAD_PROBE_OK;
+  }
+
+  static void free_probe(gpointer data) {
+    delete static_cast<LatencyProbe*>(data);
+  }
+
+  void remove_probes() noexcept {
+    if(!state_) {
+      return;
+    }
+    std::vector<std::pair<GstPad*, gulong>> probes;
+    {
+      std::lock_guard lk{state_->mutex};
+      probes.swap(state_->probes);
+    }
+    for(auto& [pad, id] : probes) {
+      gst_pad_remove_probe(pad, id);
+      gst_object_unref(pad);
+    }
+  }
+
+  explicit FrameSkipController(std::shared_ptr<State> state) : state_(std::move(state)) {}
+
+  std::shared_ptr<State> state_;
+};
+
+}    // namespace ds
@@ -0,0 +1,294 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <gst/gst.h>
+
+#include <nonstd/expected.hpp>
+#include <runtime/detail.hpp>
+#include <runtime/source_manager.hpp>
+#include <utils/error.hpp>
+
+namespace ds {
+
+enum class ShedMode : std::uint8_t {
+  None,             // pass everything
+  Interval,         // pass one buffer in every `interval`, like drop-frame-interval
+  KeyframesOnly,    // drop buffers flagged DELTA_UNIT
+  Pause,            // drop everything
+};
+
+constexpr std::string_view shed_mode_str(ShedMode mode) noexcept {
+  switch(mode) {
+  case ShedMode::None:
+    return "None";
+  case ShedMode::Interval:
+    return "Interval";
+  case ShedMode::KeyframesOnly:
+    return "KeyframesOnly";
+  case ShedMode::Pause:
+    return "Pause";
+  }
+  return "Unknown";
+}
+
+struct ShedAction {
+  ShedMode mode{ShedMode::None};
+  std::uint32_t interval{1};    // Interval only; 1 passes everything
+
+  friend bool operator==(const ShedAction&, const ShedAction&) = default;
+};
+
+struct LoadShedderConfig {
+  // Steps one source goes through as the load level rises, mildest first.
+  std::vector<ShedAction> ladder{{ShedMode::Interval, 2},
+                                 {ShedMode::Interval, 4},
+                                 {ShedMode::KeyframesOnly, 1},
+                                 {ShedMode::Pause, 1}};
+};
+
+struct ShedStats {
+  ShedAction action;
+  int priority{0};
+  std::uint64_t passed{0};
+  std::uint64_t dropped{0};
+};
+
+namespace detail {
+
+// Read by the buffer probe on the streaming thread, written by the control
+// thread; the probe owns one reference.
+struct ShedSlot {
+  std::atomic<ShedMode> mode{ShedMode::None};
+  std::atomic<std::uint32_t> interval{1};
+  std::atomic<std::uint64_t> seen{0};
+  std::atomic<std::uint64_t> passed{0};
+  std::atomic<std::uint64_t> dropped{0};
+
+  [[nodiscard]] bool keep(const GstBuffer* buffer) noexcept {
+    switch(mode.load(std::memory_order_relaxed)) {
+    case ShedMode::None:
+      return true;
+    case ShedMode::Interval:
+      return seen.fetch_add(1, std::memory_order_relaxed) % std::max(interval.load(std::memory_order_relaxed), 1u) == 0;
+    case ShedMode::KeyframesOnly:
+      return !GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+    case ShedMode::Pause:
+      return false;
+    }
+    return true;
+  }
+};
+
+inline GstPadProbeReturn shed_buffer(GstPad* /*pad*/, GstPadProbeInfo* info, gpointer user_data) {
+  auto& slot = **static_cast<std::shared_ptr<ShedSlot>*>(user_data);
+  GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+  if(buffer == nullptr || slot.keep(buffer)) {
+    slot.passed.fetch_add(1, std::memory_order_relaxed);
+    return GST_PAD_PROBE_OK;
+  }
+  slot.dropped.fetch_add(1, std::memory_order_relaxed);
+  return GST_PAD_PROBE_DROP;
+}
+
+inline void delete_shed_slot(gpointer data) {
+  delete static_cast<std::shared_ptr<ShedSlot>*>(data);
+}
+
+}    // namespace detail
+
+// ============================================================================
+// LoadShedder — per-source frame dropping upstream of expensive stages
+// ============================================================================
+//   auto shedder = ds::LoadShedder::create().value();
+//   for(auto id : sources.ids()) {
+//     shedder.attach(sources, id, priority_of(id));    // probe on the muxer pad
+//   }
+//   shedder.set_level(3);                              // overloaded: lowest-priority sources shed first
+//   shedder.set_action(7, {ds::ShedMode::Pause});      // or drive one source by hand
+//
+// Each attached pad gets a buffer probe that reads the source's ShedAction from
+// atomics, so changing it never blocks streaming. Put the pad in front of the
+// stage you want to protect: the muxer sink pads (attach(SourceManager&, id))
+// spare muxing, inference and everything after. KeyframesOnly needs DELTA_UNIT
+// flags, which GstVideoDecoder-based decoders set on their output and parsers
+// set on encoded data; raw sources without them pass everything.
+//
+// set_level(n) is the policy: sources are ordered by priority (lowest first,
+// then by id) and each takes up to ladder.size() steps before the next one is
+// touched, so level n applies n steps in total. set_level() overrides earlier
+// set_action() calls.
+class LoadShedder {
+public:
+  [[nodiscard]] static nonstd::expected<LoadShedder, Error> create(LoadShedderConfig config = {}) {
+    for(const auto& step : config.ladder) {
+      if(step.mode == ShedMode::Interval && step.interval == 0) {
+        return nonstd::make_unexpected(Error{ErrorKind::InvalidArgument, "LoadShedder: Interval steps need interval >= 1"});
+      }
+    }
+    auto state = std::make_unique<State>();
+    state->config = std::move(config);
+    return LoadShedder{std::move(state)};
+  }
+
+  LoadShedder(LoadShedder&&) noexcept = default;
+  LoadShedder& operator=(LoadShedder&&) noexcept = default;
+  LoadShedder(const LoadShedder&) = delete;
+  LoadShedder& operator=(const LoadShedder&) = delete;
+  ~LoadShedder() = default;
+
+  // Sheds buffers of source id as they pass pad. The pad is kept alive until
+  // detach(); re-attaching an id moves it to the new pad.
+  [[nodiscard]] nonstd::expected<void, Error> attach(SourceId id, GstPad* pad, int priority = 0) {
+    if(pad == nullptr) {
+      return nonstd::make_unexpected(Error{ErrorKind::InvalidArgument, fmt::format("LoadShedder: no pad for source {}", id)});
+    }
+    std::lock_guard lk{state_->mutex};
+    state_->entries.erase(id);
+    Entry entry;
+    entry.pad = GST_PAD(gst_object_ref(pad));
+    entry.priority = priority;
+    entry.probe = gst_pad_add_probe(pad,
+                                    GST_PAD_PROBE_TYPE_BUFFER,
+                                    &detail::shed_buffer,
+                                    new std::shared_ptr<detail::ShedSlot>(entry.slot),
+                                    &detail::delete_shed_slot);
+    if(entry.probe == 0) {
+      return nonstd::make_unexpected(
+          detail::log_error(ErrorKind::InvalidArgument, fmt::format("LoadShedder: cannot probe pad of source {}", id)));
+    }
+    state_->entries.emplace(id, std::move(entry));
+    return {};
+  }
+
+  // attach() on the muxer request pad of a SourceManager source. The pad
+  // survives restart_source(); call detach() before remove_source().
+  [[nodiscard]] nonstd::expected<void, Error> attach(const SourceManager& sources, SourceId id, int priority = 0) {
+    return attach(id, sources.sinkpad(id), priority);
+  }
+
+  void detach(SourceId id) {
+    std::lock_guard lk{state_->mutex};
+    state_->entries.erase(id);
+  }
+
+  [[nodiscard]] nonstd::expected<void, Error> set_action(SourceId id, ShedAction action) {
+    if(action.mode == ShedMode::Interval && action.interval == 0) {
+      return nonstd::make_unexpected(Error{ErrorKind::InvalidArgument, "LoadShedder: interval must be >= 1"});
+    }
+    std::lock_guard lk{state_->mutex};
+    const auto it = state_->entries.find(id);
+    if(it == state_->entries.end()) {
+      return nonstd::make_unexpected(Error{ErrorKind::InvalidArgument, fmt::format("LoadShedder: source {} not attached", id)});
+    }
+    it->second.apply(action);
+    return {};
+  }
+
+  [[nodiscard]] nonstd::expected<void, Error> set_priority(SourceId id, int priority) {
+    std::lock_guard lk{state_->mutex};
+    const auto it = state_->entries.find(id);
+    if(it == state_->entries.end()) {
+      return nonstd::make_unexpected(Error{ErrorKind::InvalidArgument, fmt::format("LoadShedder: source {} not attached", id)});
+    }
+    it->second.priority = priority;
+    return {};
+  }
+
+  // Applies `level` ladder steps, lowest-priority sources first. Levels above
+  // max_level() pause everything; 0 sheds nothing.
+  void set_level(std::size_t level) {
+    auto& s = *state_;
+    std::lock_guard lk{s.mutex};
+    std::vector<std::pair<int, SourceId>> order;
+    order.reserve(s.entries.size());
+    for(const auto& [id, entry] : s.entries) {
+      order.emplace_back(entry.priority, id);
+    }
+    std::sort(order.begin(), order.end());
+
+    const auto steps = s.config.ladder.size();
+    for(const auto& [priority, id] : order) {
+      const auto take = std::min(level, steps);
+      level -= take;
+      s.entries.at(id).apply(take == 0 ? ShedAction{} : s.config.ladder[take - 1]);
+    }
+  }
+
+  [[nodiscard]] std::size_t max_level() const {
+    std::lock_guard lk{state_->mutex};
+    return state_->entries.size() * state_->config.ladder.size();
+  }
+
+  [[nodiscard]] std::optional<ShedStats> stats(SourceId id) const {
+    std::lock_guard lk{state_->mutex};
+    const auto it = state_->entries.find(id);
+    if(it == state_->entries.end()) {
+      return std::nullopt;
+    }
+    const auto& slot = *it->second.slot;
+    return ShedStats{it->second.action,
+                     it->second.priority,
+                     slot.passed.load(std::memory_order_relaxed),
+                     slot.dropped.load(std::memory_order_relaxed)};
+  }
+
+private:
+  struct Entry {
+    Entry() = default;
+    Entry(Entry&& other) noexcept
+        : slot(std::move(other.slot)),
+          pad(std::exchange(other.pad, nullptr)),
+          probe(std::exchange(other.probe, 0)),
+          priority(other.priority),
+          action(other.action) {}
+    Entry& operator=(Entry&&) = delete;
+    Entry(const Entry&) = delete;
+    Entry& operator=(const Entry&) = delete;
+
+    ~Entry() {
+      if(pad == nullptr) {
+        return;
+      }
+      if(probe != 0) {
+        gst_pad_remove_probe(pad, probe);
+      }
+      gst_object_unref(pad);
+    }
+
+    void apply(ShedAction next) {
+      action = next;
+      slot->interval.store(std::max(next.interval, 1u), std::memory_order_relaxed);
+      slot->mode.store(next.mode, std::memory_order_relaxed);
+    }
+
+    std::shared_ptr<detail::ShedSlot> slot{std::make_shared<detail::ShedSlot>()};
+    GstPad* pad{nullptr};    // our ref, so the probe can be removed after the pad is released
+    gulong probe{0};
+    int priority{0};
+    ShedAction action;
+  };
+
+  struct State {
+    LoadShedderConfig config;
+    mutable std::mutex mutex;
+    std::map<SourceId, Entry> entries;
+  };
+
+  explicit LoadShedder(std::unique_ptr<State> state) : state_(std::move(state)) {}
+
+  std::unique_ptr<State> state_;
+};
+
+}    // namespace ds
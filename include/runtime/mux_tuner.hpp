@@ -0,0 +1,385 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <gst/gst.h>
+
+#include <elements/detail.hpp>
+#include <nonstd/expected.hpp>
+#include <runtime/capacity_model.hpp>
+#include <runtime/detail.hpp>
+#include <runtime/source_manager.hpp>
+#include <utils/debug.hpp>
+#include <utils/error.hpp>
+
+namespace ds {
+
+struct StreamMuxTunerConfig {
+  bool tune_batch_size{false};                    // also set batch-size; the inference engine must accept the new size
+  std::uint32_t max_batch_size{0};                // cap for tune_batch_size; 0 = no cap
+  double jitter_margin{2.0};                      // timeout = frame period + jitter_margin * jitter
+  std::chrono::microseconds min_timeout{1000};    // clamp for batched-push-timeout
+  std::chrono::microseconds max_timeout{200000};
+  double change_threshold{0.1};           // skip timeout changes smaller than this fraction
+  double smoothing{0.1};                  // EWMA weight of a new inter-arrival sample
+  FramesPerBuffer frames_per_buffer{};    // frames in one muxer output buffer; empty = 1
+
+  // batched-push-timeout for sources whose fastest runs at fps with the given
+  // inter-arrival jitter: one frame period of that source plus the margin, so
+  // a batch waits for every on-time frame and no longer.
+  [[nodiscard]] std::chrono::microseconds timeout_for(double fps, std::chrono::microseconds jitter) const {
+    if(fps <= 0) {
+      return max_timeout;
+    }
+    const auto period = 1e6 / fps;
+    const auto wanted = std::llround(period + jitter_margin * static_cast<double>(jitter.count()));
+    return std::clamp(std::chrono::microseconds{wanted}, min_timeout, max_timeout);
+  }
+};
+
+struct MuxSourceTiming {
+  double fps{0};                          // from the smoothed inter-arrival time
+  std::chrono::microseconds jitter{0};    // smoothed |interval - mean interval|
+  std::uint64_t frames{0};
+};
+
+// What tune() saw in the window since the previous call, and what it set.
+struct StreamMuxTunerReport {
+  std::uint32_t batch_size{0};             // in effect after tune()
+  std::chrono::microseconds timeout{0};    // in effect after tune()
+  bool changed{false};
+  std::uint64_t batches{0};
+  std::uint64_t frames{0};
+  double fill_ratio{0};                      // frames / (batches * batch_size)
+  std::chrono::microseconds mean_wait{0};    // first arrival → batch push, averaged
+  std::chrono::microseconds max_wait{0};
+};
+
+namespace detail {
+
+// Muxer-wide counters, shared with every probe.
+struct MuxCounters {
+  FramesPerBuffer frames_per_buffer;
+  std::atomic<std::int64_t> window_start{0};    // first arrival since the last push; 0 = none
+  std::atomic<std::uint64_t> batches{0};
+  std::atomic<std::uint64_t> frames{0};
+  std::atomic<std::uint64_t> wait_ns{0};
+  std::atomic<std::uint64_t> max_wait_ns{0};
+};
+
+// Per-source arrival statistics; each is written by that source's streaming
+// thread only, and read by tune().
+struct ArrivalStats {
+  std::shared_ptr<MuxCounters> mux;
+  std::atomic<std::int64_t> last_ns{0};
+  std::atomic<double> interval_ns{0};
+  std::atomic<double> jitter_ns{0};
+  std::atomic<std::uint64_t> frames{0};
+  double smoothing{0.1};
+};
+
+inline GstPadProbeReturn mux_arrival(GstPad* /*pad*/, GstPadProbeInfo* /*info*/, gpointer user_data) {
+  auto& a = **static_cast<std::shared_ptr<ArrivalStats>*>(user_data);
+  const auto now = monotonic_ns();
+  std::int64_t none = 0;
+  a.mux->window_start.compare_exchange_strong(none, now, std::memory_order_relaxed);
+
+  const auto last = a.last_ns.exchange(now, std::memory_order_relaxed);
+  a.frames.fetch_add(1, std::memory_order_relaxed);
+  if(last == 0) {
+    return GST_PAD_PROBE_OK;
+  }
+  const auto interval = static_cast<double>(now - last);
+  const auto mean = a.interval_ns.load(std::memory_order_relaxed);
+  if(mean == 0) {
+    a.interval_ns.store(interval, std::memory_order_relaxed);
+    return GST_PAD_PROBE_OK;
+  }
+  a.interval_ns.store(mean + a.smoothing * (interval - mean), std::memory_order_relaxed);
+  const auto jitter = a.jitter_ns.load(std::memory_order_relaxed);
+  a.jitter_ns.store(jitter + a.smoothing * (std::abs(interval - mean) - jitter), std::memory_order_relaxed);
+  return GST_PAD_PROBE_OK;
+}
+
+inline GstPadProbeReturn mux_push(GstPad* /*pad*/, GstPadProbeInfo* info, gpointer user_data) {
+  auto& m = **static_cast<std::shared_ptr<MuxCounters>*>(user_data);
+  GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+  const std::uint32_t n = buffer != nullptr && m.frames_per_buffer ? m.frames_per_buffer(buffer) : 1U;
+  m.batches.fetch_add(1, std::memory_order_relaxed);
+  m.frames.fetch_add(n, std::memory_order_relaxed);
+  if(const auto start = m.window_start.exchange(0, std::memory_order_relaxed); start != 0) {
+    const auto wait = static_cast<std::uint64_t>(std::max<std::int64_t>(monotonic_ns() - start, 0));
+    m.wait_ns.fetch_add(wait, std::memory_order_relaxed);
+    auto seen = m.max_wait_ns.load(std::memory_order_relaxed);
+    while(wait > seen && !m.max_wait_ns.compare_exchange_weak(seen, wait, std::memory_order_relaxed)) {
+    }
+  }
+  return GST_PAD_PROBE_OK;
+}
+
+inline void delete_arrival_stats(gpointer data) {
+  delete static_cast<std::shared_ptr<ArrivalStats>*>(data);
+}
+
+inline void delete_mux_counters(gpointer data) {
+  delete static_cast<std::shared_ptr<MuxCounters>*>(data);
+}
+
+}    // namespace detail
+
+// ============================================================================
+// StreamMuxTuner — batch-size / batched-push-timeout from observed arrivals
+// ============================================================================
+//   auto tuner = ds::StreamMuxTuner::attach(mux.get()).value();
+//   for(auto id : sources.ids()) {
+//     tuner.watch(sources, id);
+//   }
+//   ... every few seconds:
+//   auto report = tuner.tune();    // fill_ratio, mean_wait, timeout in effect
+//
+// Probes on the muxer sink pads time every arriving frame (smoothed interval
+// and jitter per source); the probe on the src pad counts batches and measures
+// how long each batch waited after its first frame arrived.
+//
+// tune() sets batched-push-timeout to one frame period of the fastest source
+// plus jitter_margin times the worst jitter (StreamMuxTunerConfig::timeout_for),
+// so a batch is pushed once every on-time frame could have arrived. With
+// tune_batch_size it also sets batch-size to the number of watched sources.
+// Changes below change_threshold are skipped, which keeps the muxer from
+// being reconfigured on every call. Properties the muxer does not have are
+// left alone, so the tuner also reports on non-DeepStream muxers.
+class StreamMuxTuner {
+public:
+  [[nodiscard]] static nonstd::expected<StreamMuxTuner, Error> attach(GstElement* mux, StreamMuxTunerConfig config = {}) {
+    if(mux == nullptr) {
+      return nonstd::make_unexpected(Error{ErrorKind::InvalidArgument, "StreamMuxTuner: muxer is null"});
+    }
+    if(config.min_timeout > config.max_timeout || config.smoothing <= 0.0 || config.smoothing > 1.0) {
+      return nonstd::make_unexpected(
+          Error{ErrorKind::InvalidArgument, "StreamMuxTuner: need min_timeout <= max_timeout and smoothing in (0, 1]"});
+    }
+    GstPad* src = gst_element_get_static_pad(mux, "src");
+    if(src == nullptr) {
+      return nonstd::make_unexpected(Error{ErrorKind::InvalidArgument, "StreamMuxTuner: muxer has no src pad"});
+    }
+    auto state = std::make_unique<State>();
+    state->mux = GST_ELEMENT(gst_object_ref(mux));
+    state->counters->frames_per_buffer = config.frames_per_buffer;
+    state->config = std::move(config);
+    state->src = src;
+    state->src_probe = gst_pad_add_probe(src,
+                                         GST_PAD_PROBE_TYPE_BUFFER,
+                                         &detail::mux_push,
+                                         new std::shared_ptr<detail::MuxCounters>(state->counters),
+                                         &detail::delete_mux_counters);
+    if(state->src_probe == 0) {
+      return nonstd::make_unexpected(detail::log_error(ErrorKind::InvalidArgument, "StreamMuxTuner: cannot probe muxer src pad"));
+    }
+    return StreamMuxTuner{std::move(state)};
+  }
+
+  StreamMuxTuner(StreamMuxTuner&&) noexcept = default;
+  StreamMuxTuner& operator=(StreamMuxTuner&&) noexcept = default;
+  StreamMuxTuner(const StreamMuxTuner&) = delete;
+  StreamMuxTuner& operator=(const StreamMuxTuner&) = delete;
+  ~StreamMuxTuner() = default;
+
+  // Times frames of source id arriving on pad (a muxer sink pad).
+  [[nodiscard]] nonstd::expected<void, Error> watch(SourceId id, GstPad* pad) {
+    if(pad == nullptr) {
+      return nonstd::make_unexpected(Error{ErrorKind::InvalidArgument, fmt::format("StreamMuxTuner: no pad for source {}", id)});
+    }
+    auto& s = *state_;
+    std::lock_guard lk{s.mutex};
+    s.sources.erase(id);
+    Watched watched;
+    watched.stats->mux = s.counters;
+    watched.stats->smoothing = s.config.smoothing;
+    watched.pad = GST_PAD(gst_object_ref(pad));
+    watched.probe = gst_pad_add_probe(pad,
+                                      GST_PAD_PROBE_TYPE_BUFFER,
+                                      &detail::mux_arrival,
+                                      new std::shared_ptr<detail::ArrivalStats>(watched.stats),
+                                      &detail::delete_arrival_stats);
+    if(watched.probe == 0) {
+      return nonstd::make_unexpected(
+          detail::log_error(ErrorKind::InvalidArgument, fmt::format("StreamMuxTuner: cannot probe pad of source {}", id)));
+    }
+    s.sources.emplace(id, std::move(watched));
+    return {};
+  }
+
+  [[nodiscard]] nonstd::expected<void, Error> watch(const SourceManager& sources, SourceId id) {
+    return watch(id, sources.sinkpad(id));
+  }
+
+  void unwatch(SourceId id) {
+    std::lock_guard lk{state_->mutex};
+    state_->sources.erase(id);
+  }
+
+  [[nodiscard]] std::optional<MuxSourceTiming> timing(SourceId id) const {
+    std::lock_guard lk{state_->mutex};
+    const auto it = state_->sources.find(id);
+    if(it == state_->sources.end()) {
+      return std::nullopt;
+    }
+    return State::timing_of(*it->second.stats);
+  }
+
+  // Reports the window since the last call and applies new settings.
+  StreamMuxTunerReport tune() {
+    auto& s = *state_;
+    std::lock_guard lk{s.mutex};
+    StreamMuxTunerReport out;
+    auto& c = *s.counters;
+    out.batches = c.batches.exchange(0, std::memory_order_relaxed);
+    out.frames = c.frames.exchange(0, std::memory_order_relaxed);
+    const auto wait = c.wait_ns.exchange(0, std::memory_order_relaxed);
+    out.max_wait = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::nanoseconds{static_cast<std::int64_t>(c.max_wait_ns.exchange(0, std::memory_order_relaxed))});
+    if(out.batches != 0) {
+      out.mean_wait = std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::nanoseconds{static_cast<std::int64_t>(wait / out.batches)});
+    }
+
+    double fastest = 0;
+    std::chrono::microseconds worst_jitter{0};
+    for(const auto& [id, watched] : s.sources) {
+      const auto t = State::timing_of(*watched.stats);
+      fastest = std::max(fastest, t.fps);
+      worst_jitter = std::max(worst_jitter, t.jitter);
+    }
+
+    auto batch_size = s.get_uint("batch-size").value_or(static_cast<std::uint32_t>(s.sources.size()));
+    if(s.config.tune_batch_size && !s.sources.empty()) {
+      auto wanted = static_cast<std::uint32_t>(s.sources.size());
+      if(s.config.max_batch_size != 0) {
+        wanted = std::min(wanted, s.config.max_batch_size);
+      }
+      if(wanted != batch_size && s.has("batch-size")) {
+        detail::set_property(s.mux, "batch-size", static_cast<guint>(wanted));
+        batch_size = wanted;
+        out.changed = true;
+      }
+    }
+    out.batch_size = batch_size;
+    if(out.batches != 0 && batch_size != 0) {
+      out.fill_ratio = static_cast<double>(out.frames) / (static_cast<double>(out.batches) * static_cast<double>(batch_size));
+    }
+
+    out.timeout = s.timeout;
+    if(fastest > 0) {
+      const auto wanted = s.config.timeout_for(fastest, worst_jitter);
+      const auto current = static_cast<double>(s.timeout.count());
+      if(current == 0 ||
+         std::abs(static_cast<double>(wanted.count()) - current) > s.config.change_threshold * current) {
+        if(s.has("batched-push-timeout")) {
+          detail::set_property(s.mux, "batched-push-timeout", static_cast<gint>(wanted.count()));
+        }
+        s.timeout = wanted;
+        out.timeout = wanted;
+        out.changed = true;
+      }
+    }
+    if(out.changed) {
+      DS_INFO("StreamMuxTuner: batch-size {} batched-push-timeout {} us (fill {:.2f}, mean wait {} us)",
+              out.batch_size,
+              out.timeout.count(),
+              out.fill_ratio,
+              out.mean_wait.count());
+    }
+    return out;
+  }
+
+private:
+  struct Watched {
+    Watched() = default;
+    Watched(Watched&& other) noexcept
+        : stats(std::move(other.stats)), pad(std::exchange(other.pad, nullptr)), probe(std::exchange(other.probe, 0)) {}
+    Watched& operator=(Watched&&) = delete;
+    Watched(const Watched&) = delete;
+    Watched& operator=(const Watched&) = delete;
+
+    ~Watched() {
+      if(pad == nullptr) {
+        return;
+      }
+      if(probe != 0) {
+        gst_pad_remove_probe(pad, probe);
+      }
+      gst_object_unref(pad);
+    }
+
+    std::shared_ptr<detail::ArrivalStats> stats{std::make_shared<detail::ArrivalStats>()};
+    GstPad* pad{nullptr};    // our ref
+    gulong probe{0};
+  };
+
+  struct State {
+    State() = default;
+    State(const State&) = delete;
+    State& operator=(const State&) = delete;
+
+    ~State() {
+      sources.clear();
+      if(src != nullptr) {
+        if(src_probe != 0) {
+          gst_pad_remove_probe(src, src_probe);
+        }
+        gst_object_unref(src);
+      }
+      if(mux != nullptr) {
+        gst_object_unref(mux);
+      }
+    }
+
+    [[nodiscard]] bool has(const char* property) const {
+      return g_object_class_find_property(G_OBJECT_GET_CLASS(mux), property) != nullptr;
+    }
+
+    [[nodiscard]] std::optional<std::uint32_t> get_uint(const char* property) const {
+      if(!has(property)) {
+        return std::nullopt;
+      }
+      guint value = 0;
+      // NOLINTNEXTLINE(cppcoreguidelines-pro-type-vararg, hicpp-vararg)
+      g_object_get(G_OBJECT(mux), property, &value, nullptr);
+      return value;
+    }
+
+    [[nodiscard]] static MuxSourceTiming timing_of(const detail::ArrivalStats& a) {
+      const auto interval = a.interval_ns.load(std::memory_order_relaxed);
+      return MuxSourceTiming{interval > 0 ? 1e9 / interval : 0.0,
+                             std::chrono::microseconds{std::llround(a.jitter_ns.load(std::memory_order_relaxed) / 1e3)},
+                             a.frames.load(std::memory_order_relaxed)};
+    }
+
+    GstElement* mux{nullptr};
+    GstPad* src{nullptr};    // our ref
+    gulong src_probe{0};
+    std::shared_ptr<detail::MuxCounters> counters{std::make_shared<detail::MuxCounters>()};
+    StreamMuxTunerConfig config;
+    std::chrono::microseconds timeout{0};    // last value set; 0 = not yet
+    mutable std::mutex mutex;
+    std::map<SourceId, Watched> sources;
+  };
+
+  explicit StreamMuxTuner(std::unique_ptr<State> state) : state_(std::move(state)) {}
+
+  std::unique_ptr<State> state_;
+};
+
+}    // namespace ds
@@ -0,0 +1,290 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <gst/gst.h>
+#include <gstreamer.hpp>
+
+#include <elements/detail.hpp>
+#include <nonstd/expected.hpp>
+#include <runtime/detail.hpp>
+#include <utils/error.hpp>
+
+namespace ds {
+
+enum class RenditionCodec : std::uint8_t {
+  H264,
+  H265,
+};
+
+constexpr std::string_view rendition_codec_str(RenditionCodec codec) noexcept {
+  switch(codec) {
+  case RenditionCodec::H264:
+    return "H264";
+  case RenditionCodec::H265:
+    return "H265";
+  }
+  return "Unknown";
+}
+
+struct Rendition {
+  std::string name;    // name of the bin's src pad, e.g. "720p"
+  int width{0};
+  int height{0};
+  std::uint32_t bitrate{0};    // bit/s; 0 keeps the encoder's default, otherwise see detail::bitrate_unit()
+  RenditionCodec codec{RenditionCodec::H264};
+  std::string encoder{};    // factory; empty picks nvv4l2h264enc / nvv4l2h265enc
+};
+
+struct RenditionLadderConfig {
+  std::vector<Rendition> renditions;
+  std::string scaler{"nvvideoconvert"};    // scales each branch; e.g. "videoscale" for system memory
+  bool nvmm{true};                         // branches carry video/x-raw(memory:NVMM)
+  std::uint32_t queue_buffers{4};          // per-branch queue; when full the oldest frame is dropped
+};
+
+struct RenditionStats {
+  std::string name;
+  std::uint64_t dropped{0};    // frames the branch's queue discarded because its encoder fell behind
+};
+
+namespace detail {
+
+constexpr const char* default_encoder(RenditionCodec codec) noexcept {
+  return codec == RenditionCodec::H265 ? "nvv4l2h265enc" : "nvv4l2h264enc";
+}
+
+constexpr const char* codec_parser(RenditionCodec codec) noexcept {
+  return codec == RenditionCodec::H265 ? "h265parse" : "h264parse";
+}
+
+}    // namespace detail
+
+// ============================================================================
+// RenditionLadder — one decoded stream, several scaled encodes
+// ============================================================================
+//   auto ladder = ds::RenditionLadder::create({.renditions = {{.name = "1080p", .width = 1920, .height = 1080,
+//                                                               .bitrate = 6'000'000},
+//                                                              {.name = "720p", .width = 1280, .height = 720,
+//                                                               .bitrate = 3'000'000},
+//                                                              {.name = "360p", .width = 640, .height = 360,
+//                                                               .bitrate = 800'000}}})
+//                     .value();
+//   gst_bin_add(GST_BIN(pipeline), ladder.element());
+//   gst_element_link(decoder_or_osd, ladder.element());
+//   gst_element_link_pads(ladder.element(), "720p", mux720, nullptr);
+//
+// A bin with one "sink" pad and one src pad per rendition:
+//   tee ! queue leaky=downstream ! scaler ! capsfilter ! encoder ! parser
+// for each branch. The stream is decoded once and each rendition only pays for
+// its own scale and encode. tee pushes into every queue from the upstream
+// thread and a leaky queue never blocks, so an encoder that falls behind drops
+// its own oldest frames (counted in stats()) instead of stalling the decoder or
+// the other branches. Each queue starts a streaming thread of its own.
+//
+// The tee has allow-not-linked set, so a rendition whose src pad is not (or no
+// longer) linked only stops its own branch; the others keep encoding.
+class RenditionLadder {
+public:
+  [[nodiscard]] static nonstd::expected<RenditionLadder, Error> create(RenditionLadderConfig config,
+                                                                       std::string_view name = {}) {
+    if(config.renditions.empty()) {
+      return nonstd::make_unexpected(Error{ErrorKind::InvalidArgument, "RenditionLadder: no renditions"});
+    }
+    if(config.queue_buffers == 0) {
+      return nonstd::make_unexpected(Error{ErrorKind::InvalidArgument, "RenditionLadder: queue_buffers must be >= 1"});
+    }
+    for(auto it = config.renditions.begin(); it != config.renditions.end(); ++it) {
+      if(it->name.empty() || it->name == "sink" || it->width <= 0 || it->height <= 0) {
+        return nonstd::make_unexpected(Error{
+            ErrorKind::InvalidArgument,
+            fmt::format("RenditionLadder: rendition '{}' needs a name other than 'sink' and a positive size", it->name)});
+      }
+      if(std::any_of(config.renditions.begin(), it, [&it](const Rendition& r) { return r.name == it->name; })) {
+        return nonstd::make_unexpected(
+            Error{ErrorKind::InvalidArgument, fmt::format("RenditionLadder: duplicate rendition '{}'", it->name)});
+      }
+    }
+
+    auto state = std::make_unique<State>();
+    state->bin.reset(gst_bin_new(name.empty() ? nullptr : std::string{name}.c_str()));
+    if(!state->bin) {
+      return nonstd::make_unexpected(Error{ErrorKind::PipelineCreation, "RenditionLadder: cannot create bin"});
+    }
+    gst_object_ref_sink(state->bin.get());
+    auto* bin = GST_BIN(state->bin.get());
+
+    auto tee = make(bin, "tee");
+    if(!tee) {
+      return nonstd::make_unexpected(std::move(tee.error()));
+    }
+    detail::set_property(*tee, "allow-not-linked", TRUE);    // one unlinked branch must not end the others
+    if(auto ghosted = ghost(state->bin.get(), *tee, "sink", "sink"); !ghosted) {
+      return nonstd::make_unexpected(std::move(ghosted.error()));
+    }
+    for(const auto& rendition : config.renditions) {
+      auto branch = add_branch(*state, config, rendition, *tee);
+      if(!branch) {
+        return nonstd::make_unexpected(std::move(branch.error()));
+      }
+    }
+    return RenditionLadder{std::move(state)};
+  }
+
+  RenditionLadder(RenditionLadder&&) noexcept = default;
+  RenditionLadder& operator=(RenditionLadder&&) noexcept = default;
+  RenditionLadder(const RenditionLadder&) = delete;
+  RenditionLadder& operator=(const RenditionLadder&) = delete;
+  ~RenditionLadder() = default;
+
+  // The bin, for gst_bin_add() and linking; the ladder keeps its own reference.
+  [[nodiscard]] GstElement* element() const noexcept {
+    return state_->bin.get();
+  }
+
+  // The src pad of a rendition (borrowed), or nullptr.
+  [[nodiscard]] GstPad* src_pad(std::string_view name) const {
+    const auto it = find(name);
+    return it != state_->branches.end() ? it->pad : nullptr;
+  }
+
+  // The encoder of a rendition (borrowed), for bitrate control or extra properties.
+  [[nodiscard]] GstElement* encoder(std::string_view name) const {
+    const auto it = find(name);
+    return it != state_->branches.end() ? it->encoder : nullptr;
+  }
+
+  [[nodiscard]] std::size_t size() const noexcept {
+    return state_->branches.size();
+  }
+
+  [[nodiscard]] std::vector<RenditionStats> stats() const {
+    std::vector<RenditionStats> out;
+    out.reserve(state_->branches.size());
+    for(const auto& branch : state_->branches) {
+      out.push_back({branch.name, branch.dropped->load(std::memory_order_relaxed)});
+    }
+    return out;
+  }
+
+private:
+  struct Branch {
+    std::string name;
+    GstPad* pad{nullptr};            // ghost pad, owned by the bin
+    GstElement* encoder{nullptr};    // owned by the bin
+    std::shared_ptr<std::atomic<std::uint64_t>> dropped{std::make_shared<std::atomic<std::uint64_t>>(0)};
+  };
+
+  struct State {
+    gst::ElementPtr bin;
+    std::vector<Branch> branches;
+  };
+
+  [[nodiscard]] static nonstd::expected<GstElement*, Error> make(GstBin* bin, const char* factory) {
+    GstElement* element = gst_element_factory_make(factory, nullptr);
+    if(element == nullptr) {
+      return nonstd::make_unexpected(
+          Error{ErrorKind::ElementCreation, fmt::format("RenditionLadder: failed to create '{}' element", factory)});
+    }
+    gst_bin_add(bin, element);
+    return element;
+  }
+
+  [[nodiscard]] static nonstd::expected<GstPad*, Error> ghost(GstElement* bin,
+                                                             GstElement* element,
+                                                             const char* pad_name,
+                                                             const std::string& ghost_name) {
+    GstPad* target = gst_element_get_static_pad(element, pad_name);
+    GstPad* pad = target != nullptr ? gst_ghost_pad_new(ghost_name.c_str(), target) : nullptr;
+    if(target != nullptr) {
+      gst_object_unref(target);
+    }
+    if(pad == nullptr || gst_element_add_pad(bin, pad) != TRUE) {
+      return nonstd::make_unexpected(
+          Error{ErrorKind::ElementLink, fmt::format("RenditionLadder: cannot expose pad '{}'", ghost_name)});
+    }
+    return pad;
+  }
+
+  [[nodiscard]] static nonstd::expected<void, Error> add_branch(State& state,
+                                                                const RenditionLadderConfig& config,
+                                                                const Rendition& rendition,
+                                                                GstElement* tee) {
+    auto* bin = GST_BIN(state.bin.get());
+    const std::string encoder_factory =
+        rendition.encoder.empty() ? detail::default_encoder(rendition.codec) : rendition.encoder;
+    const char* factories[] = {
+        "queue", config.scaler.c_str(), "capsfilter", encoder_factory.c_str(), detail::codec_parser(rendition.codec)};
+    std::vector<GstElement*> elements;
+    for(const auto* factory : factories) {
+      auto element = make(bin, factory);
+      if(!element) {
+        return nonstd::make_unexpected(std::move(element.error()));
+      }
+      elements.push_back(*element);
+    }
+    GstElement* queue = elements[0];
+    GstElement* filter = elements[2];
+    GstElement* encoder = elements[3];
+
+    detail::set_property(queue, "leaky", 2);    // downstream: drop the oldest queued frame
+    detail::set_property(queue, "max-size-buffers", static_cast<guint>(config.queue_buffers));
+    detail::set_property(queue, "max-size-bytes", guint{0});
+    detail::set_property(queue, "max-size-time", guint64{0});
+    gst::CapsPtr caps{gst_caps_from_string(fmt::format("video/x-raw{},width={},height={}",
+                                                       config.nvmm ? "(memory:NVMM)" : "",
+                                                       rendition.width,
+                                                       rendition.height)
+                                               .c_str())};
+    detail::set_property(filter, "caps", caps.get());
+    if(rendition.bitrate != 0) {
+      if(auto set = detail::set_bitrate(encoder, rendition.bitrate); !set) {
+        return nonstd::make_unexpected(
+            Error{set.error().kind, fmt::format("RenditionLadder: rendition '{}': {}", rendition.name, set.error().message)});
+      }
+    }
+
+    if(gst_element_link(tee, queue) != TRUE ||
+       gst_element_link_many(queue, elements[1], filter, encoder, elements[4], nullptr) != TRUE) {
+      return nonstd::make_unexpected(
+          Error{ErrorKind::ElementLink, fmt::format("RenditionLadder: cannot link branch '{}'", rendition.name)});
+    }
+    auto pad = ghost(state.bin.get(), elements[4], "src", rendition.name);
+    if(!pad) {
+      return nonstd::make_unexpected(std::move(pad.error()));
+    }
+
+    Branch branch;
+    branch.name = rendition.name;
+    branch.pad = *pad;
+    branch.encoder = encoder;
+    g_signal_connect_data(queue,
+                          "overrun",
+                          G_CALLBACK(&detail::count_overrun),
+                          new std::shared_ptr<std::atomic<std::uint64_t>>(branch.dropped),
+                          &detail::release_overrun_counter,
+                          static_cast<GConnectFlags>(0));
+    state.branches.push_back(std::move(branch));
+    return {};
+  }
+
+  [[nodiscard]] std::vector<Branch>::const_iterator find(std::string_view name) const {
+    return std::find_if(
+        state_->branches.begin(), state_->branches.end(), [name](const Branch& b) { return b.name == name; });
+  }
+
+  explicit RenditionLadder(std::unique_ptr<State> state) : state_(std::move(state)) {}
+
+  std::unique_ptr<State> state_;
+};
+
+}    // namespace ds
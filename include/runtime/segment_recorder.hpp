@@ -0,0 +1,298 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <fmt/format.h>
+
+#include <gst/gst.h>
+#include <gstreamer.hpp>
+
+#include <elements/sinks.hpp>
+#include <nonstd/expected.hpp>
+#include <runtime/detail.hpp>
+#include <runtime/event_recorder.hpp>
+#include <utils/error.hpp>
+
+namespace ds {
+
+struct SegmentRecorderConfig {
+  std::string location{"segment%05d.mp4"};                            // printf pattern taking the fragment index
+  std::chrono::nanoseconds max_size_time{std::chrono::minutes{1}};    // 0: no time limit
+  std::uint64_t max_size_bytes{0};                                    // 0: no size limit
+  std::uint32_t max_files{0};                                         // file names are reused after this many; 0 keeps all
+  RecordContainer container{RecordContainer::Mp4};
+  bool request_keyframes{true};    // ask the encoder for a keyframe at each split point
+  bool sync_files{true};           // fsync each finished file before reporting it
+};
+
+struct Segment {
+  std::filesystem::path path;
+  std::uint64_t index{0};               // fragments finished before this one
+  std::chrono::nanoseconds start{0};    // running time of its first buffer
+  std::chrono::nanoseconds duration{0};
+  std::uintmax_t bytes{0};
+};
+
+struct SegmentRecorderStats {
+  std::uint64_t opened{0};       // fragments started
+  std::uint64_t closed{0};       // fragments the muxer finished
+  std::uint64_t finalized{0};    // reported as Segment
+  std::uint64_t failed{0};       // reported as an error
+};
+
+namespace detail {
+
+// Flushes a finished file to disk and returns its size.
+[[nodiscard]] inline nonstd::expected<std::uintmax_t, Error> sync_file(const std::filesystem::path& path, bool flush) {
+  std::error_code ec;
+  const auto bytes = std::filesystem::file_size(path, ec);
+  if(ec) {
+    return nonstd::make_unexpected(Error{ErrorKind::FileIO, fmt::format("{}: {}", path.string(), ec.message())});
+  }
+  if(!flush) {
+    return bytes;
+  }
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);    // NOLINT(cppcoreguidelines-pro-type-vararg, hicpp-vararg)
+  if(fd < 0) {
+    return nonstd::make_unexpected(
+        Error{ErrorKind::FileIO, fmt::format("{}: {}", path.string(), std::generic_category().message(errno))});
+  }
+  const int synced = ::fsync(fd);
+  const int err = errno;
+  ::close(fd);
+  if(synced != 0) {
+    return nonstd::make_unexpected(
+        Error{ErrorKind::FileIO, fmt::format("{}: fsync: {}", path.string(), std::generic_category().message(err))});
+  }
+  return bytes;
+}
+
+}    // namespace detail
+
+// ============================================================================
+// SegmentRecorder — continuous recording into fixed-length files, no gaps
+// ============================================================================
+//   auto recorder = ds::SegmentRecorder::create({.location = "/data/cam0_%05d.mp4", .max_size_time = 5min},
+//                                               [](ds::SegmentRecorder::Result segment) { ... upload, index ... })
+//                       .value();
+//   gst_bin_add(GST_BIN(pipeline), recorder.element());    // gst_element_link(h264parse, recorder.element())
+//   ... in the bus handler:
+//   if(recorder.handle_message(msg)) return TRUE;
+//
+// Wraps a splitmuxsink: every fragment gets its own muxer and filesink, and a
+// split happens at the first keyframe past max_size_time / max_size_bytes, so
+// no buffer is dropped or duplicated across files and nothing upstream
+// restarts. With async finalize (GStreamer 1.16+) the old fragment's muxer
+// writes its index (the mp4 moov atom) and closes the file on a thread of its
+// own while the next one already records; on older GStreamer that work stays
+// on the streaming thread.
+//
+// handle_message() only queues the fragment-closed message; a worker thread
+// fsyncs the file and then runs on_segment, so a slow disk never stalls the
+// pipeline or the bus handler. Feed it every bus message up to and including
+// EOS, which closes the last fragment. Encoded input (h264parse/h265parse
+// output) is recorded as is; raw video needs an encoder in front.
+class SegmentRecorder {
+public:
+  using Result = nonstd::expected<Segment, Error>;
+  using Callback = std::function<void(Result)>;
+
+  [[nodiscard]] static nonstd::expected<SegmentRecorder, Error> create(SegmentRecorderConfig config, Callback on_segment) {
+    if(config.location.empty()) {
+      return nonstd::make_unexpected(Error{ErrorKind::InvalidArgument, "SegmentRecorder: empty location"});
+    }
+    if(config.max_size_time.count() < 0) {
+      return nonstd::make_unexpected(Error{ErrorKind::InvalidArgument, "SegmentRecorder: max_size_time must be >= 0"});
+    }
+    auto sink = SplitMuxSink::create();
+    if(!sink) {
+      return nonstd::make_unexpected(
+          Error{ErrorKind::ElementCreation, "SegmentRecorder: failed to create 'splitmuxsink' element"});
+    }
+    sink->location(config.location)
+        .max_size_time(config.max_size_time)
+        .max_size_bytes(config.max_size_bytes)
+        .max_files(config.max_files)
+        .send_keyframe_requests(config.request_keyframes);
+    const char* muxer = detail::muxer_for(config.container);
+    if(sink->async_finalize(true)) {
+      sink->muxer_factory(muxer).sink_factory("filesink");
+    } else {
+      GstElement* element = gst_element_factory_make(muxer, nullptr);
+      if(element == nullptr) {
+        return nonstd::make_unexpected(
+            Error{ErrorKind::ElementCreation, fmt::format("SegmentRecorder: failed to create '{}' element", muxer)});
+      }
+      detail::set_property(sink->get(), "muxer", element);
+    }
+
+    auto state = std::make_unique<State>();
+    state->config = std::move(config);
+    state->on_segment = std::move(on_segment);
+    state->element.reset(sink->release());
+    gst_object_ref_sink(state->element.get());
+    SegmentRecorder recorder{std::move(state)};
+    try {
+      recorder.worker_ = std::thread{&State::run, recorder.state_.get()};
+    } catch(const std::system_error& e) {
+      return nonstd::make_unexpected(Error{ErrorKind::Unknown, std::string{"Failed to start segment thread: "} + e.what()});
+    }
+    return recorder;
+  }
+
+  ~SegmentRecorder() {
+    close();
+  }
+
+  SegmentRecorder(SegmentRecorder&&) noexcept = default;
+  SegmentRecorder& operator=(SegmentRecorder&& other) noexcept {
+    if(this != &other) {
+      close();
+      state_ = std::move(other.state_);
+      worker_ = std::move(other.worker_);
+    }
+    return *this;
+  }
+  SegmentRecorder(const SegmentRecorder&) = delete;
+  SegmentRecorder& operator=(const SegmentRecorder&) = delete;
+
+  // The splitmuxsink, for gst_bin_add() and linking; the recorder keeps its own reference.
+  [[nodiscard]] GstElement* element() const noexcept {
+    return state_->element.get();
+  }
+
+  // Consumes the splitmuxsink's fragment messages; everything else is left to
+  // the caller. Never blocks on disk.
+  bool handle_message(GstMessage* message) {
+    if(message == nullptr || GST_MESSAGE_TYPE(message) != GST_MESSAGE_ELEMENT ||
+       GST_MESSAGE_SRC(message) != GST_OBJECT(state_->element.get())) {
+      return false;
+    }
+    const GstStructure* structure = gst_message_get_structure(message);
+    const bool opened = gst_structure_has_name(structure, "splitmuxsink-fragment-opened") == TRUE;
+    if(!opened && gst_structure_has_name(structure, "splitmuxsink-fragment-closed") != TRUE) {
+      return false;
+    }
+    const gchar* location = gst_structure_get_string(structure, "location");
+    guint64 running_time = 0;
+    gst_structure_get_uint64(structure, "running-time", &running_time);
+    if(location == nullptr) {
+      return true;
+    }
+
+    auto& s = *state_;
+    {
+      std::lock_guard lk{s.mutex};
+      if(opened) {
+        s.starts[location] = running_time;
+        s.opened.fetch_add(1, std::memory_order_relaxed);
+        return true;
+      }
+      Segment segment;
+      segment.path = location;
+      segment.index = s.closed.fetch_add(1, std::memory_order_relaxed);
+      if(const auto it = s.starts.find(location); it != s.starts.end()) {
+        segment.start = std::chrono::nanoseconds{it->second};
+        segment.duration = std::chrono::nanoseconds{running_time - std::min(running_time, it->second)};
+        s.starts.erase(it);
+      }
+      s.finished.push_back(std::move(segment));
+    }
+    s.wake.notify_one();
+    return true;
+  }
+
+  // Ends the current fragment at the next keyframe, e.g. on an operator's
+  // request or at the top of the hour.
+  void split_now() {
+    g_signal_emit_by_name(state_->element.get(), "split-now");
+  }
+
+  // Finalizes the fragments already closed, then stops the worker. Idempotent.
+  void close() {
+    if(!state_ || !worker_.joinable()) {
+      return;
+    }
+    {
+      std::lock_guard lk{state_->mutex};
+      state_->stopping = true;
+    }
+    state_->wake.notify_one();
+    worker_.join();
+  }
+
+  [[nodiscard]] SegmentRecorderStats stats() const noexcept {
+    const auto& s = *state_;
+    return {s.opened.load(std::memory_order_relaxed),
+            s.closed.load(std::memory_order_relaxed),
+            s.finalized.load(std::memory_order_relaxed),
+            s.failed.load(std::memory_order_relaxed)};
+  }
+
+private:
+  // Heap-allocated so the worker's pointer survives moves of the SegmentRecorder.
+  struct State {
+    void run() {
+      for(;;) {
+        Segment segment;
+        {
+          std::unique_lock lk{mutex};
+          wake.wait(lk, [this] { return stopping || !finished.empty(); });
+          if(finished.empty()) {
+            return;
+          }
+          segment = std::move(finished.front());
+          finished.pop_front();
+        }
+        Result result = std::move(segment);
+        if(auto bytes = detail::sync_file(result->path, config.sync_files)) {
+          result->bytes = *bytes;
+          finalized.fetch_add(1, std::memory_order_relaxed);
+        } else {
+          failed.fetch_add(1, std::memory_order_relaxed);
+          result = nonstd::make_unexpected(detail::log_error(bytes.error().kind, "SegmentRecorder: " + bytes.error().message));
+        }
+        if(on_segment) {
+          on_segment(std::move(result));
+        }
+      }
+    }
+
+    SegmentRecorderConfig config;
+    Callback on_segment;
+    gst::ElementPtr element;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::map<std::string, guint64> starts;    // running time each open fragment started at
+    std::deque<Segment> finished;
+    bool stopping{false};
+    std::atomic<std::uint64_t> opened{0};
+    std::atomic<std::uint64_t> closed{0};
+    std::atomic<std::uint64_t> finalized{0};
+    std::atomic<std::uint64_t> failed{0};
+  };
+
+  explicit SegmentRecorder(std::unique_ptr<State> state) : state_(std::move(state)) {}
+
+  std::unique_ptr<State> state_;
+  std::thread worker_;
+};
+
+}    // namespace ds
@@ -0,0 +1,412 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <gst/gst.h>
+#include <gstreamer.hpp>
+
+#include <elements/detail.hpp>
+#include <nonstd/expected.hpp>
+#include <runtime/detail.hpp>
+#include <utils/error.hpp>
+
+namespace ds {
+
+enum class SnapshotFormat : std::uint8_t {
+  Jpeg,    // jpegenc
+  Png,     // pngenc
+};
+
+constexpr std::string_view snapshot_format_str(SnapshotFormat format) noexcept {
+  switch(format) {
+  case SnapshotFormat::Jpeg:
+    return "Jpeg";
+  case SnapshotFormat::Png:
+    return "Png";
+  }
+  return "Unknown";
+}
+
+struct SnapshotEncoderConfig {
+  SnapshotFormat format{SnapshotFormat::Jpeg};
+  int quality{85};                            // jpegenc quality, 0-100
+  int compression{6};                         // pngenc compression-level, 0-9
+  std::size_t pipelines{1};                   // encoding pipelines, one worker thread each
+  std::size_t queue_depth{32};                // frames waiting for a pipeline before submit() refuses more
+  std::chrono::milliseconds timeout{5000};    // per-frame limit before a pipeline is restarted
+};
+
+struct EncodedImage {
+  std::vector<std::byte> data;
+  SnapshotFormat format{SnapshotFormat::Jpeg};
+  int width{0};
+  int height{0};
+};
+
+struct SnapshotStats {
+  std::uint64_t submitted{0};    // frames accepted by submit()
+  std::uint64_t encoded{0};      // frames handed to their callback as an image
+  std::uint64_t failed{0};       // frames the pipeline could not encode
+  std::uint64_t rejected{0};     // submit() calls refused because the queue was full or closed
+};
+
+namespace detail {
+
+inline nonstd::expected<void, Error> write_file(const std::filesystem::path& path, const std::vector<std::byte>& data) {
+  std::FILE* fp = std::fopen(path.string().c_str(), "wb");
+  if(fp == nullptr) {
+    return nonstd::make_unexpected(Error{ErrorKind::FileIO, fmt::format("open '{}': {}", path.string(), std::strerror(errno))});
+  }
+  const bool written = std::fwrite(data.data(), 1, data.size(), fp) == data.size();
+  const bool closed = std::fclose(fp) == 0;
+  if(!written || !closed) {
+    return nonstd::make_unexpected(Error{ErrorKind::FileIO, fmt::format("write '{}': {}", path.string(), std::strerror(errno))});
+  }
+  return {};
+}
+
+// One appsrc → videoconvert → jpegenc|pngenc → appsink pipeline, kept in
+// PLAYING between frames. Used by a single worker thread.
+class SnapshotPipeline {
+public:
+  [[nodiscard]] static nonstd::expected<SnapshotPipeline, Error> create(const SnapshotEncoderConfig& config) {
+    const auto* encoder_factory = config.format == SnapshotFormat::Png ? "pngenc" : "jpegenc";
+    const std::vector<const char*> factories{"appsrc", "videoconvert", encoder_factory, "appsink"};
+    auto chain = make_chain("SnapshotEncoder", factories);
+    if(!chain) {
+      return nonstd::make_unexpected(std::move(chain.error()));
+    }
+    const auto& elements = chain->elements;
+    SnapshotPipeline p;
+    p.src_ = elements.front();
+    p.sink_ = elements.back();
+    p.pipeline_ = std::move(chain->pipeline);
+    set_property(p.src_, "format", GST_FORMAT_TIME);
+    set_property(p.sink_, "sync", FALSE);
+    set_property(p.sink_, "async", FALSE);
+    if(config.format == SnapshotFormat::Png) {
+      set_property(elements[2], "compression-level", static_cast<guint>(config.compression));
+    } else {
+      set_property(elements[2], "quality", static_cast<gint>(config.quality));
+    }
+    if(auto started = p.start(); !started) {
+      return nonstd::make_unexpected(std::move(started.error()));
+    }
+    return p;
+  }
+
+  SnapshotPipeline(SnapshotPipeline&&) noexcept = default;
+  SnapshotPipeline& operator=(SnapshotPipeline&&) noexcept = default;
+  SnapshotPipeline(const SnapshotPipeline&) = delete;
+  SnapshotPipeline& operator=(const SnapshotPipeline&) = delete;
+
+  ~SnapshotPipeline() {
+    if(pipeline_) {
+      gst_element_set_state(pipeline_.get(), GST_STATE_NULL);
+    }
+  }
+
+  // Encodes one raw video frame. The buffer is pushed as a shallow copy with
+  // this pipeline's own timestamps, so frames from any source can follow each
+  // other; a caps change renegotiates videoconvert and the encoder.
+  [[nodiscard]] nonstd::expected<EncodedImage, Error>
+  encode(GstBuffer* buffer, GstCaps* caps, SnapshotFormat format, std::chrono::milliseconds timeout) {
+    if(!caps_ || gst_caps_is_equal(caps_.get(), caps) != TRUE) {
+      set_property(src_, "caps", caps);
+      caps_.reset(gst_caps_ref(caps));
+    }
+    GstBuffer* frame = gst_buffer_copy(buffer);
+    GST_BUFFER_PTS(frame) = frames_ * GST_SECOND;
+    GST_BUFFER_DTS(frame) = GST_CLOCK_TIME_NONE;
+    GST_BUFFER_DURATION(frame) = GST_SECOND;
+    ++frames_;
+
+    GstFlowReturn flow = GST_FLOW_OK;
+    g_signal_emit_by_name(src_, "push-buffer", frame, &flow);
+    gst_buffer_unref(frame);
+    if(flow != GST_FLOW_OK) {
+      return nonstd::make_unexpected(fail(fmt::format("push-buffer returned {}", gst_flow_get_name(flow))));
+    }
+
+    GstSample* sample = nullptr;
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(timeout).count();
+    g_signal_emit_by_name(sink_, "try-pull-sample", static_cast<GstClockTime>(ns), &sample);
+    if(sample == nullptr) {
+      return nonstd::make_unexpected(
+          fail(fmt::format("no {} output within {} ms", snapshot_format_str(format), timeout.count())));
+    }
+
+    EncodedImage image;
+    image.format = format;
+    const GstStructure* s = gst_caps_get_structure(caps, 0);
+    gst_structure_get_int(s, "width", &image.width);
+    gst_structure_get_int(s, "height", &image.height);
+    GstBuffer* encoded = gst_sample_get_buffer(sample);
+    GstMapInfo map;
+    if(encoded != nullptr && gst_buffer_map(encoded, &map, GST_MAP_READ) == TRUE) {
+      const auto* bytes = reinterpret_cast<const std::byte*>(map.data);
+      image.data.assign(bytes, bytes + map.size);
+      gst_buffer_unmap(encoded, &map);
+    }
+    gst_sample_unref(sample);
+    if(image.data.empty()) {
+      return nonstd::make_unexpected(fail("encoder produced an empty buffer"));
+    }
+    return image;
+  }
+
+private:
+  SnapshotPipeline() = default;
+
+  [[nodiscard]] nonstd::expected<void, Error> start() {
+    if(gst_element_set_state(pipeline_.get(), GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+      return nonstd::make_unexpected(Error{ErrorKind::ElementState, "SnapshotEncoder: pipeline refused PLAYING"});
+    }
+    return {};
+  }
+
+  // Builds the error from the first bus ERROR (the cause, usually a caps the
+  // encoder cannot take) and restarts the pipeline so the next frame starts clean.
+  [[nodiscard]] Error fail(std::string_view what) {
+    const auto reason = pop_bus_error(pipeline_.get());
+    gst_element_set_state(pipeline_.get(), GST_STATE_NULL);
+    caps_.reset();
+    frames_ = 0;
+    std::ignore = start();
+    return log_error(ErrorKind::ElementState, fmt::format("SnapshotEncoder: {}{}", what, reason));
+  }
+
+  gst::ElementPtr pipeline_;
+  GstElement* src_{nullptr};     // owned by pipeline_
+  GstElement* sink_{nullptr};    // owned by pipeline_
+  gst::CapsPtr caps_;            // caps currently set on src_
+  GstClockTime frames_{0};
+};
+
+}    // namespace detail
+
+// ============================================================================
+// SnapshotEncoder — long-lived JPEG/PNG encoding off the streaming thread
+// ============================================================================
+//   auto snapshots = ds::SnapshotEncoder::create({.format = ds::SnapshotFormat::Jpeg, .pipelines = 2}).value();
+//   // in a pad probe, after nvvideoconvert to system memory:
+//   snapshots.save(buffer, caps, fmt::format("cam{}_{}.jpg", id, n));     // returns at once
+//   auto jpeg = snapshots.encode(buffer, caps);                           // std::future with the bytes
+//
+// Replaces building an appsrc ! jpegenc ! filesink pipeline per capture: the
+// pipelines are built once by create() and stay in PLAYING, so a snapshot costs
+// one buffer push instead of element creation, negotiation and teardown.
+// Frames wait in a bounded queue and are taken by the first idle pipeline;
+// submit() holds a ref on the buffer (no pixel copy) and refuses frames with
+// ErrorKind::Capacity when the queue is full, so it never blocks the caller.
+// Callbacks run on the worker threads. Input must be raw video in system memory
+// (videoconvert cannot read NVMM surfaces).
+class SnapshotEncoder {
+public:
+  using Callback = std::function<void(nonstd::expected<EncodedImage, Error>)>;
+
+  [[nodiscard]] static nonstd::expected<SnapshotEncoder, Error> create(SnapshotEncoderConfig config = {}) {
+    if(config.pipelines == 0 || config.queue_depth == 0) {
+      return nonstd::make_unexpected(
+          Error{ErrorKind::InvalidArgument, "SnapshotEncoder: pipelines and queue_depth must be >= 1"});
+    }
+    if(config.timeout <= std::chrono::milliseconds::zero()) {
+      return nonstd::make_unexpected(Error{ErrorKind::InvalidArgument, "SnapshotEncoder: timeout must be positive"});
+    }
+    auto state = std::make_unique<State>();
+    state->config = config;
+    std::vector<detail::SnapshotPipeline> pipelines;
+    for(std::size_t i = 0; i < config.pipelines; ++i) {
+      auto pipeline = detail::SnapshotPipeline::create(config);
+      if(!pipeline) {
+        return nonstd::make_unexpected(std::move(pipeline.error()));
+      }
+      pipelines.push_back(std::move(*pipeline));
+    }
+    SnapshotEncoder encoder{std::move(state)};
+    try {
+      for(auto& pipeline : pipelines) {
+        encoder.workers_.emplace_back(&State::run, encoder.state_.get(), std::move(pipeline));
+      }
+    } catch(const std::system_error& e) {
+      return nonstd::make_unexpected(Error{ErrorKind::Unknown, std::string{"Failed to start snapshot thread: "} + e.what()});
+    }
+    return encoder;
+  }
+
+  ~SnapshotEncoder() {
+    close();
+  }
+
+  SnapshotEncoder(SnapshotEncoder&&) noexcept = default;
+  SnapshotEncoder& operator=(SnapshotEncoder&& other) noexcept {
+    if(this != &other) {
+      close();
+      state_ = std::move(other.state_);
+      workers_ = std::move(other.workers_);
+    }
+    return *this;
+  }
+  SnapshotEncoder(const SnapshotEncoder&) = delete;
+  SnapshotEncoder& operator=(const SnapshotEncoder&) = delete;
+
+  // Queues one frame; done receives the image (or the error) on a worker thread.
+  [[nodiscard]] nonstd::expected<void, Error> submit(GstBuffer* buffer, GstCaps* caps, Callback done) {
+    if(buffer == nullptr || caps == nullptr || !gst_caps_is_fixed(caps)) {
+      return nonstd::make_unexpected(Error{ErrorKind::InvalidArgument, "SnapshotEncoder: need a buffer and fixed caps"});
+    }
+    auto& s = *state_;
+    {
+      std::lock_guard lk{s.mutex};
+      if(s.stopping || s.jobs.size() >= s.config.queue_depth) {
+        s.rejected.fetch_add(1, std::memory_order_relaxed);
+        return nonstd::make_unexpected(Error{
+            ErrorKind::Capacity,
+            s.stopping ? "SnapshotEncoder: closed" : fmt::format("SnapshotEncoder: {} frames already queued", s.jobs.size())});
+      }
+      s.jobs.push_back(Job{detail::BufferPtr{gst_buffer_ref(buffer)}, gst::CapsPtr{gst_caps_ref(caps)}, std::move(done)});
+      s.submitted.fetch_add(1, std::memory_order_relaxed);
+    }
+    s.wake.notify_one();
+    return {};
+  }
+
+  // submit() for a GstSample, e.g. from appsink or the "last-sample" property.
+  [[nodiscard]] nonstd::expected<void, Error> submit(GstSample* sample, Callback done) {
+    if(sample == nullptr) {
+      return nonstd::make_unexpected(Error{ErrorKind::InvalidArgument, "SnapshotEncoder: null sample"});
+    }
+    return submit(gst_sample_get_buffer(sample), gst_sample_get_caps(sample), std::move(done));
+  }
+
+  // The encoded bytes, through a future; a refused frame yields a ready future
+  // holding the submit() error.
+  [[nodiscard]] std::future<nonstd::expected<EncodedImage, Error>> encode(GstBuffer* buffer, GstCaps* caps) {
+    auto promise = std::make_shared<std::promise<nonstd::expected<EncodedImage, Error>>>();
+    auto result = promise->get_future();
+    auto queued = submit(buffer, caps, [promise](nonstd::expected<EncodedImage, Error> image) {
+      promise->set_value(std::move(image));
+    });
+    if(!queued) {
+      promise->set_value(nonstd::make_unexpected(std::move(queued.error())));
+    }
+    return result;
+  }
+
+  // Encodes and writes the image to path on a worker thread.
+  [[nodiscard]] std::future<nonstd::expected<void, Error>> save(GstBuffer* buffer, GstCaps* caps, std::filesystem::path path) {
+    auto promise = std::make_shared<std::promise<nonstd::expected<void, Error>>>();
+    auto result = promise->get_future();
+    auto queued = submit(buffer, caps, [promise, path = std::move(path)](nonstd::expected<EncodedImage, Error> image) {
+      if(!image) {
+        promise->set_value(nonstd::make_unexpected(std::move(image.error())));
+        return;
+      }
+      promise->set_value(detail::write_file(path, image->data));
+    });
+    if(!queued) {
+      promise->set_value(nonstd::make_unexpected(std::move(queued.error())));
+    }
+    return result;
+  }
+
+  // Encodes everything already submitted, then stops the workers. Idempotent;
+  // later submit() calls are refused.
+  void close() {
+    if(!state_) {
+      return;
+    }
+    {
+      std::lock_guard lk{state_->mutex};
+      state_->stopping = true;
+    }
+    state_->wake.notify_all();
+    for(auto& worker : workers_) {
+      if(worker.joinable()) {
+        worker.join();
+      }
+    }
+    workers_.clear();
+  }
+
+  [[nodiscard]] SnapshotStats stats() const noexcept {
+    const auto& s = *state_;
+    return {s.submitted.load(std::memory_order_relaxed),
+            s.encoded.load(std::memory_order_relaxed),
+            s.failed.load(std::memory_order_relaxed),
+            s.rejected.load(std::memory_order_relaxed)};
+  }
+
+  [[nodiscard]] std::size_t queued() const {
+    std::lock_guard lk{state_->mutex};
+    return state_->jobs.size();
+  }
+
+private:
+  struct Job {
+    detail::BufferPtr buffer;
+    gst::CapsPtr caps;
+    Callback done;
+  };
+
+  // Heap-allocated so the workers' pointer survives moves of the SnapshotEncoder.
+  struct State {
+    void run(detail::SnapshotPipeline pipeline) {
+      for(;;) {
+        Job job;
+        {
+          std::unique_lock lk{mutex};
+          wake.wait(lk, [this] { return stopping || !jobs.empty(); });
+          if(jobs.empty()) {
+            return;
+          }
+          job = std::move(jobs.front());
+          jobs.pop_front();
+        }
+        auto image = pipeline.encode(job.buffer.get(), job.caps.get(), config.format, config.timeout);
+        (image ? encoded : failed).fetch_add(1, std::memory_order_relaxed);
+        job.buffer.reset();    // hand the frame back to its pool before the callback runs
+        if(job.done) {
+          job.done(std::move(image));
+        }
+      }
+    }
+
+    SnapshotEncoderConfig config;
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<Job> jobs;
+    bool stopping{false};
+    std::atomic<std::uint64_t> submitted{0};
+    std::atomic<std::uint64_t> encoded{0};
+    std::atomic<std::uint64_t> failed{0};
+    std::atomic<std::uint64_t> rejected{0};
+  };
+
+  explicit SnapshotEncoder(std::unique_ptr<State> state) : state_(std::move(state)) {}
+
+  std::unique_ptr<State> state_;
+  std::vector<std::thread> workers_;
+};
+
+}    // namespace ds
@@ -0,0 +1,450 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <gst/gst.h>
+
+#include <elements/sources.hpp>
+#include <nonstd/expected.hpp>
+#include <runtime/detail.hpp>
+#include <utils/debug.hpp>
+#include <utils/error.hpp>
+
+namespace ds {
+
+// Index of a source on the muxer. For nvstreammux this is the N of the
+// sink_N request pad, which is also NvDsFrameMeta::pad_index / source_id.
+using SourceId = std::uint32_t;
+
+// Builds the element for one source. It must return a new, unparented element
+// (floating, as gst_element_factory_make returns it) with either a static
+// "src" pad or sometimes-pads that appear after PAUSED.
+using SourceFactory = std::function<nonstd::expected<GstElement*, Error>(std::string_view uri, SourceId id)>;
+
+// Decides whether one more source may join `current` running ones; an error
+// rejects add_source() with that error (see CapacityModel::admission()).
+using AdmissionCheck = std::function<nonstd::expected<void, Error>(std::size_t current)>;
+
+struct SourceManagerConfig {
+  SourceFactory make_source{};                      // default: nvurisrcbin with uri and source-id set
+  std::string pad_template{"sink_%u"};              // request-pad template on the muxer
+  std::chrono::milliseconds state_timeout{5000};    // wait for a removed source to reach NULL
+  std::uint32_t max_sources{0};                     // 0 = no limit
+  AdmissionCheck admit{};                           // empty = admit everything under max_sources
+};
+
+namespace detail {
+
+inline nonstd::expected<GstElement*, Error> make_uri_source(std::string_view uri, SourceId id) {
+  auto source = UriSource::create(fmt::format("source-{}", id));
+  if(!source) {
+    return nonstd::make_unexpected(Error{source.error().kind, source.error().message});
+  }
+  source->uri(uri).source_id(id);
+  return source->release();
+}
+
+// "pad-added" on a source with sometimes-pads: link the first pad the muxer
+// accepts. Pads of other media (audio from a uridecodebin) fail the caps check
+// and stay unlinked.
+inline void link_added_pad(GstElement* /*source*/, GstPad* pad, gpointer user_data) {
+  auto* sinkpad = static_cast<GstPad*>(user_data);
+  if(gst_pad_get_direction(pad) != GST_PAD_SRC || gst_pad_is_linked(sinkpad)) {
+    return;
+  }
+  (void)gst_pad_link(pad, sinkpad);
+}
+
+inline void unref_pad(gpointer data, GClosure* /*closure*/) {
+  gst_object_unref(data);
+}
+
+// Shared between remove_source() and the EOS probe on the muxer pad; the probe
+// owns one reference so a late EOS never touches a finished wait.
+struct EosDrain {
+  std::mutex mutex;
+  std::condition_variable done;
+  bool seen{false};
+};
+
+inline GstPadProbeReturn note_drained(GstPad* /*pad*/, GstPadProbeInfo* info, gpointer user_data) {
+  auto* event = GST_PAD_PROBE_INFO_EVENT(info);
+  if(event == nullptr || GST_EVENT_TYPE(event) != GST_EVENT_EOS) {
+    return GST_PAD_PROBE_OK;
+  }
+  auto& drain = **static_cast<std::shared_ptr<EosDrain>*>(user_data);
+  std::lock_guard lk{drain.mutex};
+  drain.seen = true;
+  drain.done.notify_all();
+  return GST_PAD_PROBE_OK;
+}
+
+inline void delete_eos_drain(gpointer data) {
+  delete static_cast<std::shared_ptr<EosDrain>*>(data);
+}
+
+}    // namespace detail
+
+// ============================================================================
+// SourceManager — add and remove muxer inputs while the pipeline is PLAYING
+// ============================================================================
+//   auto mux = ds::StreamMux::create({.batch_size = 64, .live_source = true}).value();
+//   ... build the pipeline around mux, set it PLAYING ...
+//   auto sources = ds::SourceManager::attach(mux.get()).value();
+//   auto id = sources.add_source("rtsp://cam-17/stream").value();
+//   ...
+//   sources.remove_source(id);
+//
+// add_source() creates the source (nvurisrcbin by default), adds it to the
+// muxer's bin, requests sink_N with the lowest free N, links it (now, or on
+// pad-added) and syncs its state with the pipeline.
+//
+// remove_source() sends EOS to the source element, so its own streaming thread
+// pushes it after the last buffer, and waits (up to state_timeout) until the
+// EOS has reached the muxer pad. Only then does it set the source to NULL,
+// which also waits for the muxer to finish handling that EOS, unlink, release
+// the request pad and remove the source from the bin, dropping the last
+// reference. A source that does not deliver the EOS in time is stopped first
+// and the EOS is sent into the idle muxer pad instead. Other streams keep
+// flowing and nothing is restarted. Ids are reused, so pad names and
+// per-source tables stay bounded under churn.
+//
+// restart_source() swaps in a new element for one id on the same muxer pad;
+// SourceSupervisor uses it to recover failing sources.
+//
+// Both calls block on state changes: call them from the application thread,
+// never from a pad probe or bus sync handler. Sources still attached when the
+// manager is destroyed stay in the pipeline.
+class SourceManager {
+public:
+  [[nodiscard]] static nonstd::expected<SourceManager, Error> attach(GstElement* mux, SourceManagerConfig config = {}) {
+    if(mux == nullptr) {
+      return nonstd::make_unexpected(Error{ErrorKind::InvalidArgument, "SourceManager: muxer is null"});
+    }
+    GstObject* parent = gst_element_get_parent(mux);
+    if(parent == nullptr || !GST_IS_BIN(parent)) {
+      if(parent != nullptr) {
+        gst_object_unref(parent);
+      }
+      return nonstd::make_unexpected(Error{ErrorKind::InvalidArgument, "SourceManager: add the muxer to a pipeline first"});
+    }
+    GstPadTemplate* templ = gst_element_class_get_pad_template(GST_ELEMENT_GET_CLASS(mux), config.pad_template.c_str());
+    if(templ == nullptr || GST_PAD_TEMPLATE_PRESENCE(templ) != GST_PAD_REQUEST) {
+      gst_object_unref(parent);
+      return nonstd::make_unexpected(
+          Error{ErrorKind::InvalidArgument, fmt::format("SourceManager: muxer has no request pad '{}'", config.pad_template)});
+    }
+    if(!config.make_source) {
+      config.make_source = &detail::make_uri_source;
+    }
+    auto state = std::make_unique<State>();
+    state->mux = GST_ELEMENT(gst_object_ref(mux));
+    state->bin = GST_BIN(parent);
+    state->templ = templ;
+    state->config = std::move(config);
+    return SourceManager{std::move(state)};
+  }
+
+  SourceManager(SourceManager&&) noexcept = default;
+  SourceManager& operator=(SourceManager&&) noexcept = default;
+  SourceManager(const SourceManager&) = delete;
+  SourceManager& operator=(const SourceManager&) = delete;
+  ~SourceManager() = default;
+
+  [[nodiscard]] nonstd::expected<SourceId, Error> add_source(std::string_view uri) {
+    auto& s = *state_;
+    std::lock_guard lk{s.mutex};
+    if(s.config.max_sources != 0 && s.entries.size() >= s.config.max_sources) {
+      return nonstd::make_unexpected(
+          detail::log_error(ErrorKind::InvalidArgument, fmt::format("SourceManager: at most {} sources", s.config.max_sources)));
+    }
+    if(s.config.admit) {
+      if(auto admitted = s.config.admit(s.entries.size()); !admitted) {
+        return nonstd::make_unexpected(detail::log_error(admitted.error().kind, admitted.error().message));
+      }
+    }
+    const SourceId id = s.lowest_free_id();
+    const auto pad_name = s.pad_name(id);
+
+    Entry entry{nullptr, nullptr, std::string{uri}};
+    entry.sinkpad = gst_element_request_pad(s.mux, s.templ, pad_name.c_str(), nullptr);
+    if(entry.sinkpad == nullptr) {
+      return nonstd::make_unexpected(
+          detail::log_error(ErrorKind::ElementLink, fmt::format("SourceManager: muxer refused pad '{}'", pad_name)));
+    }
+    if(auto started = s.start(entry, id); !started) {
+      s.discard(entry);
+      return nonstd::make_unexpected(started.error());
+    }
+    s.entries.emplace(id, std::move(entry));
+    return id;
+  }
+
+  // Replaces the source for id with a freshly built one for the same uri,
+  // keeping the muxer pad (and so the id and the muxer's per-stream state).
+  // The old element is taken to NULL and disposed first. If the new one cannot
+  // be built or started the id stays registered with no source; call
+  // restart_source() again or remove_source().
+  [[nodiscard]] nonstd::expected<void, Error> restart_source(SourceId id) {
+    auto& s = *state_;
+    std::lock_guard lk{s.mutex};
+    const auto it = s.entries.find(id);
+    if(it == s.entries.end()) {
+      return nonstd::make_unexpected(Error{ErrorKind::InvalidArgument, fmt::format("SourceManager: no source {}", id)});
+    }
+    (void)s.detach(it->second);
+    return s.start(it->second, id);
+  }
+
+  [[nodiscard]] nonstd::expected<void, Error> remove_source(SourceId id) {
+    auto& s = *state_;
+    std::lock_guard lk{s.mutex};
+    const auto it = s.entries.find(id);
+    if(it == s.entries.end()) {
+      return nonstd::make_unexpected(Error{ErrorKind::InvalidArgument, fmt::format("SourceManager: no source {}", id)});
+    }
+    Entry entry = std::move(it->second);
+    s.entries.erase(it);
+
+    // Finish this stream in the muxer before its input goes away. Once the
+    // source is NULL nothing else pushes into the pad, so the fallback EOS
+    // cannot race live buffers.
+    bool reached_null = true;
+    if(!s.drain(entry)) {
+      reached_null = s.detach(entry);
+      gst_pad_send_event(entry.sinkpad, gst_event_new_eos());
+    }
+    if(!s.discard(entry) || !reached_null) {
+      return nonstd::make_unexpected(
+          detail::log_error(ErrorKind::ElementState, fmt::format("SourceManager: source {} did not reach NULL in time", id)));
+    }
+    return {};
+  }
+
+  [[nodiscard]] std::size_t size() const {
+    std::lock_guard lk{state_->mutex};
+    return state_->entries.size();
+  }
+
+  [[nodiscard]] bool contains(SourceId id) const {
+    std::lock_guard lk{state_->mutex};
+    return state_->entries.contains(id);
+  }
+
+  [[nodiscard]] std::vector<SourceId> ids() const {
+    std::lock_guard lk{state_->mutex};
+    std::vector<SourceId> out;
+    out.reserve(state_->entries.size());
+    for(const auto& [id, entry] : state_->entries) {
+      out.push_back(id);
+    }
+    return out;
+  }
+
+  // The source element for id (borrowed; valid until remove_source(id)).
+  [[nodiscard]] GstElement* source(SourceId id) const {
+    std::lock_guard lk{state_->mutex};
+    const auto it = state_->entries.find(id);
+    return it == state_->entries.end() ? nullptr : it->second.source;
+  }
+
+  // The muxer's request pad for id (borrowed; valid until remove_source(id)).
+  // It survives restart_source(), so probes placed on it follow the stream.
+  [[nodiscard]] GstPad* sinkpad(SourceId id) const {
+    std::lock_guard lk{state_->mutex};
+    const auto it = state_->entries.find(id);
+    return it == state_->entries.end() ? nullptr : it->second.sinkpad;
+  }
+
+  [[nodiscard]] GstElement* mux() const noexcept {
+    return state_->mux;
+  }
+  [[nodiscard]] GstBin* bin() const noexcept {
+    return state_->bin;
+  }
+
+  [[nodiscard]] std::string uri(SourceId id) const {
+    std::lock_guard lk{state_->mutex};
+    const auto it = state_->entries.find(id);
+    return it == state_->entries.end() ? std::string{} : it->second.uri;
+  }
+
+private:
+  struct Entry {
+    GstElement* source{nullptr};    // our ref; the bin holds another. Null after a failed restart
+    GstPad* sinkpad{nullptr};       // request pad on the muxer (our ref)
+    std::string uri;
+  };
+
+  struct State {
+    State() = default;
+    State(const State&) = delete;
+    State& operator=(const State&) = delete;
+
+    ~State() {
+      for(auto& [id, entry] : entries) {
+        gst_object_unref(entry.sinkpad);
+        if(entry.source != nullptr) {
+          gst_object_unref(entry.source);
+        }
+      }
+      if(bin != nullptr) {
+        gst_object_unref(bin);
+      }
+      if(mux != nullptr) {
+        gst_object_unref(mux);
+      }
+    }
+
+    [[nodiscard]] SourceId lowest_free_id() const {
+      SourceId id = 0;
+      for(const auto& [used, entry] : entries) {
+        if(used != id) {
+          break;
+        }
+        ++id;
+      }
+      return id;
+    }
+
+    [[nodiscard]] std::string pad_name(SourceId id) const {
+      auto name = config.pad_template;
+      if(const auto at = name.find("%u"); at != std::string::npos) {
+        name.replace(at, 2, std::to_string(id));
+      }
+      return name;
+    }
+
+    // Builds the source for entry.uri, adds it to the bin, links it to
+    // entry.sinkpad and starts it. On failure the source is taken out again
+    // and entry.source is left null.
+    nonstd::expected<void, Error> start(Entry& entry, SourceId id) {
+      auto made = config.make_source(entry.uri, id);
+      if(!made) {
+        return nonstd::make_unexpected(detail::log_error(made.error().kind, made.error().message));
+      }
+      if(*made == nullptr) {
+        return nonstd::make_unexpected(detail::log_error(
+            ErrorKind::ElementCreation, fmt::format("SourceManager: factory returned no element for '{}'", entry.uri)));
+      }
+      GstElement* source = GST_ELEMENT(gst_object_ref_sink(*made));
+      if(gst_bin_add(bin, source) == FALSE) {
+        gst_object_unref(source);
+        return nonstd::make_unexpected(
+            detail::log_error(ErrorKind::BinAdd, fmt::format("SourceManager: could not add source {} to the pipeline", id)));
+      }
+      entry.source = source;
+
+      if(GstPad* srcpad = gst_element_get_static_pad(source, "src")) {
+        const auto linked = gst_pad_link(srcpad, entry.sinkpad);
+        gst_object_unref(srcpad);
+        if(linked != GST_PAD_LINK_OK) {
+          (void)detach(entry);
+          return nonstd::make_unexpected(detail::log_error(
+              ErrorKind::ElementLink, fmt::format("SourceManager: cannot link source {} to '{}'", id, pad_name(id))));
+        }
+      } else {
+        g_signal_connect_data(source,
+                              "pad-added",
+                              G_CALLBACK(&detail::link_added_pad),
+                              gst_object_ref(entry.sinkpad),
+                              &detail::unref_pad,
+                              static_cast<GConnectFlags>(0));
+      }
+
+      if(gst_element_sync_state_with_parent(source) == FALSE) {
+        (void)detach(entry);
+        return nonstd::make_unexpected(
+            detail::log_error(ErrorKind::ElementState, fmt::format("SourceManager: cannot start source {}", id)));
+      }
+      return {};
+    }
+
+    // Takes the source out of the pipeline and drops our reference, leaving
+    // the muxer pad requested. Returns false if it did not reach NULL within
+    // state_timeout (it is removed anyway).
+    bool detach(Entry& entry) {
+      if(entry.source == nullptr) {
+        return true;
+      }
+      bool reached_null = true;
+      if(gst_element_set_state(entry.source, GST_STATE_NULL) == GST_STATE_CHANGE_ASYNC) {
+        const auto timeout = std::chrono::duration_cast<std::chrono::nanoseconds>(config.state_timeout).count();
+        reached_null =
+            gst_element_get_state(entry.source, nullptr, nullptr, static_cast<GstClockTime>(timeout)) == GST_STATE_CHANGE_SUCCESS;
+      }
+      if(GstPad* peer = gst_pad_get_peer(entry.sinkpad)) {
+        gst_pad_unlink(peer, entry.sinkpad);
+        gst_object_unref(peer);
+      }
+      gst_bin_remove(bin, entry.source);
+      gst_object_unref(entry.source);
+      entry.source = nullptr;
+      return reached_null;
+    }
+
+    // Sends EOS through the source and waits until it arrives on the muxer
+    // pad. False if the source is not linked, refused the event or did not
+    // deliver it within state_timeout.
+    bool drain(Entry& entry) {
+      if(entry.source == nullptr || gst_pad_is_linked(entry.sinkpad) == FALSE) {
+        return false;
+      }
+      auto drained = std::make_shared<detail::EosDrain>();
+      const gulong probe = gst_pad_add_probe(entry.sinkpad,
+                                             GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM,
+                                             &detail::note_drained,
+                                             new std::shared_ptr<detail::EosDrain>(drained),
+                                             &detail::delete_eos_drain);
+      if(probe == 0) {
+        return false;
+      }
+      bool seen = false;
+      if(gst_element_send_event(entry.source, gst_event_new_eos()) == TRUE) {
+        std::unique_lock lk{drained->mutex};
+        seen = drained->done.wait_for(lk, config.state_timeout, [&drained] { return drained->seen; });
+      }
+      gst_pad_remove_probe(entry.sinkpad, probe);
+      if(!seen) {
+        DS_DEBUG("SourceManager: '{}' did not deliver EOS in time, stopping it first", entry.uri);
+      }
+      return seen;
+    }
+
+    // detach() plus releasing the muxer pad: nothing of the entry remains.
+    bool discard(Entry& entry) {
+      const bool reached_null = detach(entry);
+      if(entry.sinkpad != nullptr) {
+        gst_element_release_request_pad(mux, entry.sinkpad);
+        gst_object_unref(entry.sinkpad);
+        entry.sinkpad = nullptr;
+      }
+      return reached_null;
+    }
+
+    GstElement* mux{nullptr};
+    GstBin* bin{nullptr};
+    GstPadTemplate* templ{nullptr};    // owned by the muxer's class
+    SourceManagerConfig config;
+    mutable std::mutex mutex;
+    std::map<SourceId, Entry> entries;
+  };
+
+  explicit SourceManager(std::unique_ptr<State> state) : state_(std::move(state)) {}
+
+  std::unique_ptr<State> state_;
+};
+
+}    // namespace ds
@@ -0,0 +1,395 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <fmt/format.h>
+
+#include <gst/gst.h>
+
+#include <nonstd/expected.hpp>
+#include <runtime/source_manager.hpp>
+#include <utils/debug.hpp>
+#include <utils/error.hpp>
+
+namespace ds {
+
+struct BackoffPolicy {
+  std::chrono::milliseconds initial{500};           // delay before the first rebuild
+  std::chrono::milliseconds max_delay{30000};       // cap on the grown delay
+  double multiplier{2.0};                           // growth per consecutive failure
+  double jitter{0.2};                               // ± fraction applied to every delay
+  std::chrono::milliseconds stable_after{60000};    // running this long resets the failure count
+  std::uint32_t max_attempts{0};                    // consecutive rebuilds before giving up; 0 = never
+
+  // Delay before rebuild number attempt (0-based), with unit in [0, 1) picking
+  // the jitter: unit 0.5 gives the un-jittered value.
+  [[nodiscard]] std::chrono::milliseconds delay(std::uint32_t attempt, double unit) const {
+    const auto base = std::min(static_cast<double>(initial.count()) * std::pow(multiplier, static_cast<double>(attempt)),
+                               static_cast<double>(max_delay.count()));
+    const auto jittered = base * (1.0 + jitter * (2.0 * unit - 1.0));
+    return std::chrono::milliseconds{static_cast<std::int64_t>(std::max(0.0, std::round(jittered)))};
+  }
+};
+
+struct SourceSupervisorConfig {
+  BackoffPolicy backoff{};
+  bool restart_on_eos{true};    // treat end-of-stream from a source as a failure (file loops, dropped RTSP sessions)
+  std::uint64_t seed{0};        // jitter RNG seed; 0 = std::random_device
+};
+
+enum class SourceHealth : std::uint8_t {
+  Running,    // source in the pipeline and not known to have failed
+  Backoff,    // failed; rebuilt by poll() once retry_at has passed
+  Failed,     // max_attempts consecutive rebuilds failed; left alone until restart() or removal
+};
+
+constexpr std::string_view source_health_str(SourceHealth health) noexcept {
+  switch(health) {
+  case SourceHealth::Running:
+    return "Running";
+  case SourceHealth::Backoff:
+    return "Backoff";
+  case SourceHealth::Failed:
+    return "Failed";
+  }
+  return "Unknown";
+}
+
+struct SourceStatus {
+  SourceHealth health{SourceHealth::Running};
+  std::uint32_t attempts{0};    // consecutive rebuilds since the source last ran stable_after
+  std::uint64_t restarts{0};    // successful rebuilds since supervision began
+  std::string last_error;
+  std::chrono::steady_clock::time_point retry_at{};
+};
+
+namespace detail {
+
+// Shared between the supervisor and the EOS probe on the muxer pad; the probe
+// owns one reference so it stays valid until GStreamer drops the probe.
+struct EosWatch {
+  std::atomic<bool> seen{false};
+};
+
+inline GstPadProbeReturn catch_source_eos(GstPad* /*pad*/, GstPadProbeInfo* info, gpointer user_data) {
+  auto* event = GST_PAD_PROBE_INFO_EVENT(info);
+  if(event == nullptr || GST_EVENT_TYPE(event) != GST_EVENT_EOS) {
+    return GST_PAD_PROBE_OK;
+  }
+  (*static_cast<std::shared_ptr<EosWatch>*>(user_data))->seen.store(true, std::memory_order_release);
+  return GST_PAD_PROBE_DROP;
+}
+
+inline void delete_eos_watch(gpointer data) {
+  delete static_cast<std::shared_ptr<EosWatch>*>(data);
+}
+
+inline GstObject* root_of(GstObject* object) {
+  GstObject* root = GST_OBJECT(gst_object_ref(object));
+  while(GstObject* parent = gst_object_get_parent(root)) {
+    gst_object_unref(root);
+    root = parent;
+  }
+  return root;
+}
+
+}    // namespace detail
+
+// ============================================================================
+// SourceSupervisor — rebuild failing sources without restarting the pipeline
+// ============================================================================
+//   auto sources = ds::SourceManager::attach(mux.get(), {.make_source = make_rtspsrc_bin}).value();
+//   auto supervisor = ds::SourceSupervisor::create(std::move(sources)).value();
+//   for(const auto& uri : cameras) {
+//     supervisor.add_source(uri);
+//   }
+//   // bus watch on the application thread:
+//   if(supervisor.handle_message(msg)) return TRUE;     // a supervised source failed; pipeline keeps PLAYING
+//   // and a periodic timer, e.g. g_timeout_add(100, ...):
+//   supervisor.poll();
+//
+// Failures are an ERROR message from a source (or anything inside a source bin)
+// and, with restart_on_eos, an EOS leaving a source. EOS is caught by a probe on
+// the source's muxer pad and dropped there, so the muxer never finishes that
+// stream and one short file or dropped session does not end the pipeline.
+//
+// A failed source waits BackoffPolicy::delay(attempts) and is then rebuilt by
+// SourceManager::restart_source(): the old element goes to NULL and leaves the
+// bin, a new one is built for the same uri and linked to the same muxer pad.
+// Nothing else in the pipeline changes state. A source that stays up for
+// stable_after starts again from the initial delay.
+//
+// handle_message() only touches bookkeeping; poll() does the rebuilds and blocks
+// on state changes, so call both from the application thread, not from a bus
+// sync handler. ERROR messages from elements already torn down (posted before
+// the rebuild, popped after) are consumed as well. Call stop() before an
+// application-initiated EOS.
+class SourceSupervisor {
+public:
+  [[nodiscard]] static nonstd::expected<SourceSupervisor, Error> create(SourceManager manager,
+                                                                        SourceSupervisorConfig config = {}) {
+    if(config.backoff.multiplier < 1.0 || config.backoff.jitter < 0.0 || config.backoff.jitter > 1.0) {
+      return nonstd::make_unexpected(
+          Error{ErrorKind::InvalidArgument, "SourceSupervisor: backoff needs multiplier >= 1 and jitter in [0, 1]"});
+    }
+    auto state = std::make_unique<State>(std::move(manager), config);
+    for(const auto id : state->manager.ids()) {
+      state->watch(id);
+    }
+    return SourceSupervisor{std::move(state)};
+  }
+
+  SourceSupervisor(SourceSupervisor&&) noexcept = default;
+  SourceSupervisor& operator=(SourceSupervisor&&) noexcept = default;
+  SourceSupervisor(const SourceSupervisor&) = delete;
+  SourceSupervisor& operator=(const SourceSupervisor&) = delete;
+  ~SourceSupervisor() = default;
+
+  // SourceManager::add_source() plus supervision.
+  [[nodiscard]] nonstd::expected<SourceId, Error> add_source(std::string_view uri) {
+    std::lock_guard lk{state_->mutex};
+    auto id = state_->manager.add_source(uri);
+    if(id) {
+      state_->watch(*id);
+    }
+    return id;
+  }
+
+  // Ends supervision, then SourceManager::remove_source().
+  [[nodiscard]] nonstd::expected<void, Error> remove_source(SourceId id) {
+    std::lock_guard lk{state_->mutex};
+    state_->unwatch(id);
+    return state_->manager.remove_source(id);
+  }
+
+  // Removes the EOS probes and forgets every source; the manager keeps them.
+  // Call before sending EOS to the pipeline for a clean shutdown, otherwise the
+  // probes swallow it and the sources are rebuilt.
+  void stop() {
+    std::lock_guard lk{state_->mutex};
+    for(auto& [id, entry] : state_->entries) {
+      State::remove_probe(entry);
+    }
+    state_->entries.clear();
+  }
+
+  // Call for every message popped from the pipeline bus. Returns true when the
+  // message was an ERROR from a supervised source (now scheduled for rebuild)
+  // or from an element already torn down; the caller should not treat it as
+  // fatal. Everything else returns false.
+  bool handle_message(GstMessage* message) {
+    if(message == nullptr || GST_MESSAGE_TYPE(message) != GST_MESSAGE_ERROR || GST_MESSAGE_SRC(message) == nullptr) {
+      return false;
+    }
+    GError* error = nullptr;
+    gst_message_parse_error(message, &error, nullptr);
+    std::string reason = error != nullptr && error->message != nullptr ? error->message : "error";
+    if(error != nullptr) {
+      g_error_free(error);
+    }
+
+    auto& s = *state_;
+    std::lock_guard lk{s.mutex};
+    GstObject* from = GST_MESSAGE_SRC(message);
+    for(auto& [id, entry] : s.entries) {
+      GstElement* source = s.manager.source(id);
+      if(source != nullptr && gst_object_has_as_ancestor(from, GST_OBJECT(source))) {
+        s.fail(id, entry, std::move(reason), std::chrono::steady_clock::now());
+        return true;
+      }
+    }
+    return s.is_orphan(from);
+  }
+
+  // Picks up EOS seen by the probes, rebuilds every source whose retry time has
+  // passed and resets the failure count of sources that have been stable.
+  // Returns the number of sources rebuilt successfully.
+  std::size_t poll(std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now()) {
+    auto& s = *state_;
+    std::lock_guard lk{s.mutex};
+    std::size_t rebuilt = 0;
+    for(auto& [id, entry] : s.entries) {
+      if(entry.eos->seen.exchange(false, std::memory_order_acq_rel)) {
+        s.fail(id, entry, "end of stream", now);
+      }
+      switch(entry.status.health) {
+      case SourceHealth::Backoff:
+        if(entry.status.retry_at <= now) {
+          ++entry.status.attempts;
+          if(auto restarted = s.manager.restart_source(id); restarted) {
+            entry.status.health = SourceHealth::Running;
+            ++entry.status.restarts;
+            entry.started_at = now;
+            ++rebuilt;
+            DS_INFO("SourceSupervisor: source {} rebuilt (attempt {})", id, entry.status.attempts);
+          } else {
+            s.schedule(id, entry, restarted.error().message, now);
+          }
+        }
+        break;
+      case SourceHealth::Running:
+        if(entry.status.attempts != 0 && now - entry.started_at >= s.config.backoff.stable_after) {
+          entry.status.attempts = 0;
+        }
+        break;
+      case SourceHealth::Failed:
+        break;
+      }
+    }
+    return rebuilt;
+  }
+
+  // Earliest pending retry, for callers that sleep between poll() calls.
+  [[nodiscard]] std::optional<std::chrono::steady_clock::time_point> next_retry() const {
+    std::lock_guard lk{state_->mutex};
+    std::optional<std::chrono::steady_clock::time_point> next;
+    for(const auto& [id, entry] : state_->entries) {
+      if(entry.status.health == SourceHealth::Backoff && (!next || entry.status.retry_at < *next)) {
+        next = entry.status.retry_at;
+      }
+    }
+    return next;
+  }
+
+  // Schedules an immediate rebuild with a fresh failure count, e.g. for a
+  // source that is Failed after the camera was repaired.
+  [[nodiscard]] nonstd::expected<void, Error> restart(SourceId id) {
+    std::lock_guard lk{state_->mutex};
+    const auto it = state_->entries.find(id);
+    if(it == state_->entries.end()) {
+      return nonstd::make_unexpected(Error{ErrorKind::InvalidArgument, fmt::format("SourceSupervisor: no source {}", id)});
+    }
+    it->second.status.attempts = 0;
+    it->second.status.health = SourceHealth::Backoff;
+    it->second.status.retry_at = {};
+    return {};
+  }
+
+  [[nodiscard]] std::optional<SourceStatus> status(SourceId id) const {
+    std::lock_guard lk{state_->mutex};
+    const auto it = state_->entries.find(id);
+    if(it == state_->entries.end()) {
+      return std::nullopt;
+    }
+    return it->second.status;
+  }
+
+  [[nodiscard]] SourceManager& manager() noexcept {
+    return state_->manager;
+  }
+  [[nodiscard]] const SourceManager& manager() const noexcept {
+    return state_->manager;
+  }
+
+private:
+  struct Entry {
+    SourceStatus status;
+    std::shared_ptr<detail::EosWatch> eos{std::make_shared<detail::EosWatch>()};
+    GstPad* pad{nullptr};    // borrowed from the manager; carries the EOS probe
+    gulong probe{0};
+    std::chrono::steady_clock::time_point started_at{std::chrono::steady_clock::now()};
+  };
+
+  struct State {
+    State(SourceManager m, const SourceSupervisorConfig& c)
+        : manager(std::move(m)),
+          config(c),
+          pipeline(detail::root_of(GST_OBJECT(manager.bin()))),
+          rng(c.seed != 0 ? c.seed : std::random_device{}()) {}
+    State(const State&) = delete;
+    State& operator=(const State&) = delete;
+
+    ~State() {
+      for(auto& [id, entry] : entries) {
+        remove_probe(entry);
+      }
+      gst_object_unref(pipeline);
+    }
+
+    void watch(SourceId id) {
+      Entry entry;
+      entry.pad = manager.sinkpad(id);
+      if(config.restart_on_eos && entry.pad != nullptr) {
+        entry.probe = gst_pad_add_probe(entry.pad,
+                                        GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM,
+                                        &detail::catch_source_eos,
+                                        new std::shared_ptr<detail::EosWatch>(entry.eos),
+                                        &detail::delete_eos_watch);
+      }
+      entries.insert_or_assign(id, std::move(entry));
+    }
+
+    void unwatch(SourceId id) {
+      if(const auto it = entries.find(id); it != entries.end()) {
+        remove_probe(it->second);
+        entries.erase(it);
+      }
+    }
+
+    static void remove_probe(Entry& entry) {
+      if(entry.probe != 0) {
+        gst_pad_remove_probe(entry.pad, entry.probe);
+        entry.probe = 0;
+      }
+    }
+
+    // A failure while Running; repeats (e.g. several ERRORs from one bin)
+    // while already backing off are ignored.
+    void fail(SourceId id, Entry& entry, std::string reason, std::chrono::steady_clock::time_point now) {
+      if(entry.status.health != SourceHealth::Running) {
+        return;
+      }
+      schedule(id, entry, std::move(reason), now);
+    }
+
+    void schedule(SourceId id, Entry& entry, std::string reason, std::chrono::steady_clock::time_point now) {
+      entry.status.last_error = std::move(reason);
+      const auto& backoff = config.backoff;
+      if(backoff.max_attempts != 0 && entry.status.attempts >= backoff.max_attempts) {
+        entry.status.health = SourceHealth::Failed;
+        DS_ERROR("SourceSupervisor: source {} gave up after {} attempts: {}", id, entry.status.attempts,
+                 entry.status.last_error);
+        return;
+      }
+      const auto wait = backoff.delay(entry.status.attempts, unit(rng));
+      entry.status.health = SourceHealth::Backoff;
+      entry.status.retry_at = now + wait;
+      DS_WARN("SourceSupervisor: source {} failed ({}), rebuilding in {} ms", id, entry.status.last_error, wait.count());
+    }
+
+    // True for objects no longer inside the pipeline: their root is a removed
+    // source, not the pipeline the manager works in.
+    [[nodiscard]] bool is_orphan(GstObject* object) const {
+      GstObject* root = detail::root_of(object);
+      const bool orphan = root != pipeline;
+      gst_object_unref(root);
+      return orphan;
+    }
+
+    SourceManager manager;
+    SourceSupervisorConfig config;
+    GstObject* pipeline{nullptr};    // top-level parent of the manager's bin (our ref)
+    std::mt19937_64 rng;
+    std::uniform_real_distribution<double> unit{0.0, 1.0};
+    mutable std::mutex mutex;
+    std::map<SourceId, Entry> entries;
+  };
+
+  explicit SourceSupervisor(std::unique_ptr<State> state) : state_(std::move(state)) {}
+
+  std::unique_ptr<State> state_;
+};
+
+}    // namespace ds
@@ -0,0 +1,286 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <gst/gst.h>
+
+#include <nonstd/expected.hpp>
+#include <runtime/detail.hpp>
+#include <runtime/source_manager.hpp>
+#include <utils/error.hpp>
+
+namespace ds {
+
+struct SourceTimingConfig {
+  double jitter_gain{1.0 / 16.0};       // RFC 3550 interarrival-jitter gain
+  double smoothing{0.1};                // EWMA weight for the mean intervals
+  double gap_factor{1.5};               // a PTS step this many mean intervals long is a gap
+  std::uint32_t rate_change_gaps{3};    // this many gaps in a row are a new frame rate, not lost frames
+};
+
+struct SourceTiming {
+  std::uint64_t buffers{0};
+  std::uint64_t missing_pts{0};           // buffers without a PTS
+  std::uint64_t duplicate_pts{0};         // same PTS as the previous buffer
+  std::uint64_t backwards_pts{0};         // PTS below the previous one (restart, seek, broken muxing)
+  std::uint64_t pts_gaps{0};              // PTS step over gap_factor mean intervals (lost frames)
+  std::chrono::nanoseconds max_gap{0};    // longest PTS step counted as a gap
+  double fps{0};                          // effective arrival rate
+  double pts_fps{0};                      // rate implied by the PTS
+  std::chrono::nanoseconds jitter{0};     // smoothed |arrival step - PTS step|
+  std::chrono::nanoseconds drift{0};      // arrival time minus PTS, since the last discontinuity
+};
+
+namespace detail {
+
+// Per-source counters. on_buffer() runs on the source's streaming thread only,
+// so every field has a single writer; readers may run concurrently and see each
+// field's latest value.
+struct TimingCounters {
+  SourceTimingConfig config;
+  std::atomic<std::uint64_t> buffers{0};
+  std::atomic<std::uint64_t> missing_pts{0};
+  std::atomic<std::uint64_t> duplicate_pts{0};
+  std::atomic<std::uint64_t> backwards_pts{0};
+  std::atomic<std::uint64_t> pts_gaps{0};
+  std::atomic<std::int64_t> max_gap_ns{0};
+  std::atomic<double> arrival_interval_ns{0};
+  std::atomic<double> pts_interval_ns{0};
+  std::atomic<double> jitter_ns{0};
+  std::atomic<std::int64_t> drift_ns{0};
+  // Writer-side state.
+  std::int64_t last_arrival{0};
+  std::int64_t last_pts{-1};
+  std::int64_t last_pts_arrival{0};
+  std::int64_t base_arrival{0};
+  std::int64_t base_pts{0};
+  std::uint32_t consecutive_gaps{0};
+
+  void on_buffer(std::optional<std::uint64_t> pts, std::int64_t arrival) noexcept {
+    buffers.fetch_add(1, std::memory_order_relaxed);
+    const auto previous_arrival = std::exchange(last_arrival, arrival);
+    if(previous_arrival != 0) {
+      blend(arrival_interval_ns, static_cast<double>(arrival - previous_arrival), config.smoothing);
+    }
+    if(!pts) {
+      missing_pts.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    const auto p = static_cast<std::int64_t>(*pts);
+    const auto previous_pts = std::exchange(last_pts, p);
+    const auto previous_pts_arrival = std::exchange(last_pts_arrival, arrival);
+    if(previous_pts < 0) {
+      rebase(p, arrival);
+      return;
+    }
+
+    const auto step = p - previous_pts;
+    if(step == 0) {
+      duplicate_pts.fetch_add(1, std::memory_order_relaxed);
+    } else if(step < 0) {
+      backwards_pts.fetch_add(1, std::memory_order_relaxed);
+      rebase(p, arrival);
+      return;
+    } else {
+      const auto mean = pts_interval_ns.load(std::memory_order_relaxed);
+      const bool gap = mean > 0 && static_cast<double>(step) > config.gap_factor * mean;
+      if(gap && ++consecutive_gaps < config.rate_change_gaps) {
+        pts_gaps.fetch_add(1, std::memory_order_relaxed);
+        max_gap_ns.store(std::max(max_gap_ns.load(std::memory_order_relaxed), step), std::memory_order_relaxed);
+        rebase(p, arrival);
+        return;
+      }
+      if(gap) {
+        // The source slowed down (camera rate, drop-frame-interval): start
+        // the mean over from this step instead of counting every frame a gap.
+        pts_interval_ns.store(static_cast<double>(step), std::memory_order_relaxed);
+      } else {
+        blend(pts_interval_ns, static_cast<double>(step), config.smoothing);
+      }
+      consecutive_gaps = 0;
+    }
+
+    const auto d = static_cast<double>((arrival - previous_pts_arrival) - step);
+    const auto j = jitter_ns.load(std::memory_order_relaxed);
+    jitter_ns.store(j + (std::abs(d) - j) * config.jitter_gain, std::memory_order_relaxed);
+    drift_ns.store((arrival - base_arrival) - (p - base_pts), std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] SourceTiming snapshot() const noexcept {
+    const auto arrival = arrival_interval_ns.load(std::memory_order_relaxed);
+    const auto pts = pts_interval_ns.load(std::memory_order_relaxed);
+    return SourceTiming{buffers.load(std::memory_order_relaxed),
+                        missing_pts.load(std::memory_order_relaxed),
+                        duplicate_pts.load(std::memory_order_relaxed),
+                        backwards_pts.load(std::memory_order_relaxed),
+                        pts_gaps.load(std::memory_order_relaxed),
+                        std::chrono::nanoseconds{max_gap_ns.load(std::memory_order_relaxed)},
+                        arrival > 0 ? 1e9 / arrival : 0.0,
+                        pts > 0 ? 1e9 / pts : 0.0,
+                        std::chrono::nanoseconds{std::llround(jitter_ns.load(std::memory_order_relaxed))},
+                        std::chrono::nanoseconds{drift_ns.load(std::memory_order_relaxed)}};
+  }
+
+private:
+  static void blend(std::atomic<double>& mean, double sample, double weight) noexcept {
+    const auto m = mean.load(std::memory_order_relaxed);
+    mean.store(m > 0 ? m + weight * (sample - m) : sample, std::memory_order_relaxed);
+  }
+
+  // Restarts drift measurement after a discontinuity.
+  void rebase(std::int64_t pts, std::int64_t arrival) noexcept {
+    base_pts = pts;
+    base_arrival = arrival;
+    drift_ns.store(0, std::memory_order_relaxed);
+  }
+};
+
+inline GstPadProbeReturn time_buffer(GstPad* /*pad*/, GstPadProbeInfo* info, gpointer user_data) {
+  auto& counters = **static_cast<std::shared_ptr<TimingCounters>*>(user_data);
+  GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+  if(buffer != nullptr) {
+    const auto pts = GST_BUFFER_PTS_IS_VALID(buffer) ? std::optional<std::uint64_t>{GST_BUFFER_PTS(buffer)} : std::nullopt;
+    counters.on_buffer(pts, monotonic_ns());
+  }
+  return GST_PAD_PROBE_OK;
+}
+
+inline void delete_timing_counters(gpointer data) {
+  delete static_cast<std::shared_ptr<TimingCounters>*>(data);
+}
+
+}    // namespace detail
+
+// ============================================================================
+// SourceTimingMonitor — arrival jitter and PTS health per source
+// ============================================================================
+//   auto timing = ds::SourceTimingMonitor{};
+//   for(auto id : sources.ids()) {
+//     timing.watch(sources, id).value();    // or watch(id, pad) on any source src pad
+//   }
+//   ... periodically:
+//   for(const auto& [id, t] : timing.snapshot()) { ... t.jitter, t.pts_gaps, t.fps ... }
+//
+// A buffer probe per source updates atomic counters on the streaming thread;
+// snapshot() never blocks it. The readings separate the usual culprits:
+//   - jitter high, drift flat: the network delivers unevenly, frames still keep up;
+//   - drift growing: frames arrive later and later against their PTS, so
+//     something upstream of the pad (decoder, network, the pipeline pushing back)
+//     is slower than real time;
+//   - pts_gaps / duplicate_pts / backwards_pts: the source itself loses,
+//     repeats or restarts timestamps.
+// jitter follows RFC 3550: the smoothed difference between arrival steps and
+// PTS steps. Drift restarts at every gap or backwards step.
+class SourceTimingMonitor {
+public:
+  explicit SourceTimingMonitor(SourceTimingConfig config = {}) : state_(std::make_unique<State>()) {
+    state_->config = config;
+  }
+
+  SourceTimingMonitor(SourceTimingMonitor&&) noexcept = default;
+  SourceTimingMonitor& operator=(SourceTimingMonitor&&) noexcept = default;
+  SourceTimingMonitor(const SourceTimingMonitor&) = delete;
+  SourceTimingMonitor& operator=(const SourceTimingMonitor&) = delete;
+  ~SourceTimingMonitor() = default;
+
+  // Starts timing buffers of source id on pad; re-watching an id starts over.
+  [[nodiscard]] nonstd::expected<void, Error> watch(SourceId id, GstPad* pad) {
+    if(pad == nullptr) {
+      return nonstd::make_unexpected(
+          Error{ErrorKind::InvalidArgument, fmt::format("SourceTimingMonitor: no pad for source {}", id)});
+    }
+    auto& s = *state_;
+    std::lock_guard lk{s.mutex};
+    s.entries.erase(id);
+    Entry entry;
+    entry.counters->config = s.config;
+    entry.pad = GST_PAD(gst_object_ref(pad));
+    entry.probe = gst_pad_add_probe(pad,
+                                    GST_PAD_PROBE_TYPE_BUFFER,
+                                    &detail::time_buffer,
+                                    new std::shared_ptr<detail::TimingCounters>(entry.counters),
+                                    &detail::delete_timing_counters);
+    if(entry.probe == 0) {
+      return nonstd::make_unexpected(
+          detail::log_error(ErrorKind::InvalidArgument, fmt::format("SourceTimingMonitor: cannot probe pad of source {}", id)));
+    }
+    s.entries.emplace(id, std::move(entry));
+    return {};
+  }
+
+  // watch() on the muxer pad of a SourceManager source. Its probes run on the
+  // source's streaming thread, like a probe on the source's own src pad, and
+  // the pad survives restart_source().
+  [[nodiscard]] nonstd::expected<void, Error> watch(const SourceManager& sources, SourceId id) {
+    return watch(id, sources.sinkpad(id));
+  }
+
+  void unwatch(SourceId id) {
+    std::lock_guard lk{state_->mutex};
+    state_->entries.erase(id);
+  }
+
+  [[nodiscard]] std::optional<SourceTiming> timing(SourceId id) const {
+    std::lock_guard lk{state_->mutex};
+    const auto it = state_->entries.find(id);
+    if(it == state_->entries.end()) {
+      return std::nullopt;
+    }
+    return it->second.counters->snapshot();
+  }
+
+  [[nodiscard]] std::vector<std::pair<SourceId, SourceTiming>> snapshot() const {
+    std::lock_guard lk{state_->mutex};
+    std::vector<std::pair<SourceId, SourceTiming>> out;
+    out.reserve(state_->entries.size());
+    for(const auto& [id, entry] : state_->entries) {
+      out.emplace_back(id, entry.counters->snapshot());
+    }
+    return out;
+  }
+
+private:
+  struct Entry {
+    Entry() = default;
+    Entry(Entry&& other) noexcept
+        : counters(std::move(other.counters)), pad(std::exchange(other.pad, nullptr)), probe(std::exchange(other.probe, 0)) {}
+    Entry& operator=(Entry&&) = delete;
+    Entry(const Entry&) = delete;
+    Entry& operator=(const Entry&) = delete;
+
+    ~Entry() {
+      if(pad == nullptr) {
+        return;
+      }
+      if(probe != 0) {
+        gst_pad_remove_probe(pad, probe);
+      }
+      gst_object_unref(pad);
+    }
+
+    std::shared_ptr<detail::TimingCounters> counters{std::make_shared<detail::TimingCounters>()};
+    GstPad* pad{nullptr};    // our ref
+    gulong probe{0};
+  };
+
+  struct State {
+    SourceTimingConfig config;
+    mutable std::mutex mutex;
+    std::map<SourceId, Entry> entries;
+  };
+
+  std::unique_ptr<State> state_;
+};
+
+}    // namespace ds
@@ -0,0 +1,353 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+#include <gst/gst.h>
+
+#include <gstnvdsmeta.h>
+#include <metadata/batch_meta.hpp>
+#include <metadata/object_meta.hpp>
+#include <metadata/tensor_meta.hpp>
+#include <nonstd/expected.hpp>
+#include <nvdsmeta.h>
+#include <utils/error.hpp>
+
+// Host-memory NvDs metadata graphs for tests and benchmarks. Nothing here
+// touches the GPU or the nvds_* meta pools: every node is owned by a
+// SyntheticBatch, so metadata code can run on a CPU-only machine that only has
+// the DeepStream headers (plus libnvdsgst_meta for attach_batch_meta()).
+namespace ds::testing {
+
+struct SyntheticBatchConfig {
+  std::uint32_t frames{1};
+  std::uint32_t objects_per_frame{8};
+  std::uint32_t classifiers_per_object{0};
+  std::uint32_t labels_per_classifier{1};
+  std::uint32_t tensor_layers{0};       // per-frame NVDSINFER_TENSOR_OUTPUT_META with this many output layers
+  std::uint32_t tensor_elements{16};    // float elements per tensor layer
+  std::uint32_t num_classes{4};
+  std::uint32_t width{1920};
+  std::uint32_t height{1080};
+  std::int32_t frame_num{0};
+  std::uint64_t pts{0};
+  std::uint32_t seed{1};    // boxes, classes and confidences are reproducible per seed
+};
+
+// Builds an NvDsBatchMeta graph either from a config or node by node:
+//
+//   ds::testing::SyntheticBatch batch{{.frames = 32, .objects_per_frame = 64}};
+//   for(const auto frame : batch.view().frames()) { ... }
+//
+//   ds::testing::SyntheticBatch custom;
+//   auto* frame = custom.add_frame(0);
+//   custom.add_object(frame, 7, 2, {10.f, 20.f, 30.f, 40.f}, 0.9f, "car");
+//
+// Node addresses are stable for the lifetime of the batch, including across moves.
+class SyntheticBatch {
+public:
+  SyntheticBatch() : nodes_(std::make_unique<Nodes>()) {
+    nodes_->batch.base_meta.batch_meta = &nodes_->batch;
+    nodes_->batch.base_meta.meta_type = NVDS_BATCH_META;
+  }
+
+  explicit SyntheticBatch(const SyntheticBatchConfig& config) : SyntheticBatch() {
+    nodes_->batch.max_frames_in_batch = config.frames;
+    std::mt19937 rng{config.seed};
+    std::uniform_real_distribution<float> unit{0.f, 1.f};
+    const auto classes = std::max(config.num_classes, 1U);
+    const auto width = static_cast<float>(config.width);
+    const auto height = static_cast<float>(config.height);
+
+    std::uint64_t object_id = 0;
+    for(std::uint32_t f = 0; f < config.frames; ++f) {
+      auto* frame = add_frame(f, config.frame_num, config.pts);
+      frame->source_frame_width = config.width;
+      frame->source_frame_height = config.height;
+      for(std::uint32_t o = 0; o < config.objects_per_frame; ++o) {
+        const auto class_id = static_cast<std::int32_t>(rng() % classes);
+        const BoundingBox box{unit(rng) * width * 0.9f, unit(rng) * height * 0.9f, 16.f + unit(rng) * width * 0.1f,
+                              16.f + unit(rng) * height * 0.1f};
+        auto* obj = add_object(frame, ++object_id, class_id, box, 0.3f + 0.7f * unit(rng), fmt::format("class{}", class_id));
+        for(std::uint32_t c = 0; c < config.classifiers_per_object; ++c) {
+          auto* classifier = add_classifier(obj, static_cast<std::int32_t>(c + 2));
+          for(std::uint32_t l = 0; l < config.labels_per_classifier; ++l) {
+            const auto label_class = static_cast<std::uint32_t>(rng() % classes);
+            add_label(classifier, label_class, unit(rng), fmt::format("attr{}", label_class));
+          }
+        }
+      }
+      if(config.tensor_layers > 0) {
+        add_tensor_meta(frame, config.tensor_layers, config.tensor_elements);
+      }
+    }
+  }
+
+  SyntheticBatch(SyntheticBatch&&) noexcept = default;
+  SyntheticBatch& operator=(SyntheticBatch&&) noexcept = default;
+  SyntheticBatch(const SyntheticBatch&) = delete;
+  SyntheticBatch& operator=(const SyntheticBatch&) = delete;
+
+  ~SyntheticBatch() {
+    if(!nodes_) {
+      return;
+    }
+    for(auto& classifier : nodes_->classifiers) {
+      g_list_free(classifier.label_info_list);
+    }
+    for(auto& obj : nodes_->objects) {
+      g_list_free(obj.classifier_meta_list);
+      g_list_free(obj.obj_user_meta_list);
+    }
+    for(auto& frame : nodes_->frames) {
+      g_list_free(frame.obj_meta_list);
+      g_list_free(frame.frame_user_meta_list);
+    }
+    g_list_free(nodes_->batch.frame_meta_list);
+    g_list_free(nodes_->batch.batch_user_meta_list);
+  }
+
+  NvDsFrameMeta* add_frame(std::uint32_t source_id, std::int32_t frame_num = 0, std::uint64_t pts = 0) {
+    auto& batch = nodes_->batch;
+    auto& frame = nodes_->frames.emplace_back();
+    frame.base_meta.batch_meta = &batch;
+    frame.base_meta.meta_type = NVDS_FRAME_META;
+    frame.source_id = source_id;
+    frame.pad_index = source_id;
+    frame.batch_id = batch.num_frames_in_batch++;
+    frame.frame_num = frame_num;
+    frame.buf_pts = pts;
+    batch.max_frames_in_batch = std::max(batch.max_frames_in_batch, batch.num_frames_in_batch);
+    batch.frame_meta_list = g_list_append(batch.frame_meta_list, &frame);
+    return &frame;
+  }
+
+  NvDsObjectMeta* add_object(NvDsFrameMeta* frame,
+                             std::uint64_t object_id,
+                             std::int32_t class_id,
+                             BoundingBox box,
+                             float confidence,
+                             std::string_view label = {}) {
+    auto& obj = nodes_->objects.emplace_back();
+    obj.base_meta.batch_meta = &nodes_->batch;
+    obj.base_meta.meta_type = NVDS_OBJ_META;
+    obj.object_id = object_id;
+    obj.class_id = class_id;
+    obj.confidence = confidence;
+    obj.tracker_confidence = confidence;
+    obj.rect_params.left = box.left;
+    obj.rect_params.top = box.top;
+    obj.rect_params.width = box.width;
+    obj.rect_params.height = box.height;
+    copy_label(obj.obj_label, label);
+    frame->obj_meta_list = g_list_append(frame->obj_meta_list, &obj);
+    ++frame->num_obj_meta;
+    return &obj;
+  }
+
+  NvDsClassifierMeta* add_classifier(NvDsObjectMeta* obj, std::int32_t unique_component_id) {
+    auto& classifier = nodes_->classifiers.emplace_back();
+    classifier.base_meta.batch_meta = &nodes_->batch;
+    classifier.base_meta.meta_type = NVDS_CLASSIFIER_META;
+    classifier.unique_component_id = unique_component_id;
+    obj->classifier_meta_list = g_list_append(obj->classifier_meta_list, &classifier);
+    return &classifier;
+  }
+
+  NvDsLabelInfo* add_label(NvDsClassifierMeta* classifier, std::uint32_t class_id, float probability, std::string_view label) {
+    auto& info = nodes_->labels.emplace_back();
+    info.base_meta.batch_meta = &nodes_->batch;
+    info.base_meta.meta_type = NVDS_LABEL_INFO_META;
+    info.result_class_id = class_id;
+    info.result_prob = probability;
+    info.label_id = classifier->num_labels;
+    copy_label(info.result_label, label);
+    classifier->label_info_list = g_list_append(classifier->label_info_list, &info);
+    ++classifier->num_labels;
+    return &info;
+  }
+
+  // Attaches NVDSINFER_TENSOR_OUTPUT_META with `layers` 1-D FLOAT layers of
+  // `elements` host-side values each, as nvinfer does with output-tensor-meta=1.
+  NvDsInferTensorMeta* add_tensor_meta(NvDsFrameMeta* frame, std::uint32_t layers, std::uint32_t elements) {
+    auto& tensor = nodes_->tensors.emplace_back();
+    auto& infos = nodes_->layer_infos.emplace_back(layers);
+    auto& host_ptrs = nodes_->host_ptrs.emplace_back(layers);
+    for(std::uint32_t i = 0; i < layers; ++i) {
+      auto& name = nodes_->strings.emplace_back(fmt::format("output{}", i));
+      auto& buffer = nodes_->buffers.emplace_back(elements, 0.f);
+      infos[i].dataType = FLOAT;
+      infos[i].inferDims.numDims = 1;
+      infos[i].inferDims.d[0] = elements;
+      infos[i].inferDims.numElements = elements;
+      infos[i].bindingIndex = static_cast<int>(i + 1);
+      infos[i].layerName = name.c_str();
+      infos[i].buffer = buffer.data();
+      host_ptrs[i] = buffer.data();
+    }
+    tensor.unique_id = 1;
+    tensor.num_output_layers = layers;
+    tensor.output_layers_info = infos.data();
+    tensor.out_buf_ptrs_host = host_ptrs.data();
+
+    auto& user = nodes_->user_metas.emplace_back();
+    user.base_meta.batch_meta = &nodes_->batch;
+    user.base_meta.meta_type = NVDSINFER_TENSOR_OUTPUT_META;
+    user.user_meta_data = &tensor;
+    frame->frame_user_meta_list = g_list_append(frame->frame_user_meta_list, &user);
+    return &tensor;
+  }
+
+  [[nodiscard]] NvDsBatchMeta* get() const noexcept {
+    return &nodes_->batch;
+  }
+  [[nodiscard]] BatchMetaView view() const noexcept {
+    return BatchMetaView{get()};
+  }
+  [[nodiscard]] std::size_t num_frames() const noexcept {
+    return nodes_->frames.size();
+  }
+  [[nodiscard]] std::size_t num_objects() const noexcept {
+    return nodes_->objects.size();
+  }
+
+private:
+  template <std::size_t N>
+    requires(N > 0)
+  static void copy_label(char (&dst)[N], std::string_view label) noexcept {
+    const auto n = std::min(label.size(), N - 1);
+    std::copy_n(label.data(), n, dst);
+    dst[n] = '\0';
+  }
+
+  // std::deque never relocates elements on emplace_back, so the raw pointers
+  // linked into the GLists stay valid.
+  struct Nodes {
+    NvDsBatchMeta batch{};
+    std::deque<NvDsFrameMeta> frames;
+    std::deque<NvDsObjectMeta> objects;
+    std::deque<NvDsClassifierMeta> classifiers;
+    std::deque<NvDsLabelInfo> labels;
+    std::deque<NvDsUserMeta> user_metas;
+    std::deque<NvDsInferTensorMeta> tensors;
+    std::deque<std::vector<NvDsInferLayerInfo>> layer_infos;
+    std::deque<std::vector<void*>> host_ptrs;
+    std::deque<std::vector<float>> buffers;
+    std::deque<std::string> strings;
+  };
+
+  std::unique_ptr<Nodes> nodes_;
+};
+
+namespace detail {
+
+// Shared by every GstBuffer copy that carries the same synthetic batch.
+struct AttachedBatch {
+  SyntheticBatch batch;
+  std::atomic<int> refs{1};
+};
+
+inline gpointer copy_attached_batch(gpointer data, gpointer /*user_data*/) {
+  auto* meta = static_cast<NvDsBatchMeta*>(data);
+  static_cast<AttachedBatch*>(meta->base_meta.uContext)->refs.fetch_add(1, std::memory_order_relaxed);
+  return data;
+}
+
+inline void release_attached_batch(gpointer data, gpointer /*user_data*/) {
+  auto* meta = static_cast<NvDsBatchMeta*>(data);
+  auto* attached = static_cast<AttachedBatch*>(meta->base_meta.uContext);
+  if(attached->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    delete attached;
+  }
+}
+
+}    // namespace detail
+
+// Attaches batch to buffer the way nvstreammux does, so
+// BatchMetaView::from_buffer() finds it downstream. The buffer (and any copies
+// of it) takes ownership. buffer must be writable.
+inline void attach_batch_meta(GstBuffer* buffer, SyntheticBatch batch) {
+  auto* attached = new detail::AttachedBatch{std::move(batch)};
+  NvDsBatchMeta* meta = attached->batch.get();
+  meta->base_meta.uContext = attached;
+  NvDsMeta* gst_meta =
+      gst_buffer_add_nvds_meta(buffer, meta, nullptr, &detail::copy_attached_batch, &detail::release_attached_batch);
+  gst_meta->meta_type = NVDS_BATCH_GST_META;
+}
+
+// Stands in for nvstreammux in CPU-only pipelines: a buffer probe on
+// `pad_name` of element (typically videotestsrc) attaches a fresh
+// SyntheticBatch to every buffer, with frame_num counting up and pts taken
+// from the buffer.
+//
+//   auto src = gst_element_factory_make("videotestsrc", nullptr);
+//   auto fake = ds::testing::FakeBatchMetaSource::attach(src, {.frames = 4}).value();
+class FakeBatchMetaSource {
+public:
+  [[nodiscard]] static nonstd::expected<FakeBatchMetaSource, Error>
+  attach(GstElement* element, SyntheticBatchConfig config = {}, std::string_view pad_name = "src") {
+    const std::string name{pad_name};
+    GstPad* pad = element != nullptr ? gst_element_get_static_pad(element, name.c_str()) : nullptr;
+    if(pad == nullptr) {
+      return nonstd::make_unexpected(Error{ErrorKind::InvalidArgument, "FakeBatchMetaSource: no static pad '" + name + "'"});
+    }
+    auto state = std::make_unique<State>();
+    state->config = config;
+    state->pad = pad;
+    state->probe_id = gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, &FakeBatchMetaSource::on_buffer, state.get(), nullptr);
+    return FakeBatchMetaSource{std::move(state)};
+  }
+
+  // Buffers that received a batch so far.
+  [[nodiscard]] std::uint64_t batches() const noexcept {
+    return state_->batches.load(std::memory_order_relaxed);
+  }
+
+  FakeBatchMetaSource(FakeBatchMetaSource&&) noexcept = default;
+  FakeBatchMetaSource& operator=(FakeBatchMetaSource&&) noexcept = default;
+  FakeBatchMetaSource(const FakeBatchMetaSource&) = delete;
+  FakeBatchMetaSource& operator=(const FakeBatchMetaSource&) = delete;
+
+  ~FakeBatchMetaSource() {
+    if(state_) {
+      gst_pad_remove_probe(state_->pad, state_->probe_id);
+      gst_object_unref(state_->pad);
+    }
+  }
+
+private:
+  struct State {
+    SyntheticBatchConfig config;
+    GstPad* pad{nullptr};
+    gulong probe_id{0};
+    std::atomic<std::uint64_t> batches{0};
+  };
+
+  explicit FakeBatchMetaSource(std::unique_ptr<State> state) : state_(std::move(state)) {}
+
+  static GstPadProbeReturn on_buffer(GstPad* /*pad*/, GstPadProbeInfo* info, gpointer user_data) {
+    auto* state = static_cast<State*>(user_data);
+    GstBuffer* buffer = gst_buffer_make_writable(GST_PAD_PROBE_INFO_BUFFER(info));
+    GST_PAD_PROBE_INFO_DATA(info) = buffer;
+
+    auto config = state->config;
+    config.frame_num = static_cast<std::int32_t>(state->batches.fetch_add(1, std::memory_order_relaxed));
+    config.pts = GST_BUFFER_PTS(buffer);
+    config.seed += static_cast<std::uint32_t>(config.frame_num);
+    attach_batch_meta(buffer, SyntheticBatch{config});
+    return GST_PAD_PROBE_OK;
+  }
+
+  std::unique_ptr<State> state_;
+};
+
+}    // namespace ds::testing
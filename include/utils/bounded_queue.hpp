@@ -0,0 +1,102 @@
+#pragma once
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace ds {
+
+// Fixed-capacity, lock-free multi-producer / multi-consumer FIFO (Vyukov's
+// bounded queue). Every slot carries a sequence number, so producers and
+// consumers only contend on their own cursor and never take a lock — safe to
+// use from GStreamer streaming threads.
+//
+// Capacity is rounded up to a power of two. try_push() fails when full and
+// try_pop() fails when empty; neither blocks nor allocates after construction.
+template <typename T>
+  requires std::is_nothrow_move_constructible_v<T> && std::is_nothrow_move_assignable_v<T> &&
+           std::is_default_constructible_v<T>
+class BoundedQueue {
+public:
+  explicit BoundedQueue(std::size_t capacity)
+      : mask_(std::bit_ceil(capacity < 2 ? std::size_t{2} : capacity) - 1), slots_(std::make_unique<Slot[]>(mask_ + 1)) {
+    for(std::size_t i = 0; i <= mask_; ++i) {
+      slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  BoundedQueue(const BoundedQueue&) = delete;
+  BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+  [[nodiscard]] std::size_t capacity() const noexcept {
+    return mask_ + 1;
+  }
+
+  // Approximate while other threads are pushing or popping.
+  [[nodiscard]] std::size_t size_approx() const noexcept {
+    const auto tail = tail_.load(std::memory_order_relaxed);
+    const auto head = head_.load(std::memory_order_relaxed);
+    return tail >= head ? tail - head : 0;
+  }
+
+  bool try_push(T value) noexcept {
+    auto pos = tail_.load(std::memory_order_relaxed);
+    for(;;) {
+      auto& slot = slots_[pos & mask_];
+      const auto seq = slot.sequence.load(std::memory_order_acquire);
+      const auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+      if(diff == 0) {
+        if(tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          slot.value = std::move(value);
+          slot.sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if(diff < 0) {
+        return false;
+      } else {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  std::optional<T> try_pop() noexcept {
+    auto pos = head_.load(std::memory_order_relaxed);
+    for(;;) {
+      auto& slot = slots_[pos & mask_];
+      const auto seq = slot.sequence.load(std::memory_order_acquire);
+      const auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos + 1);
+      if(diff == 0) {
+        if(head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          std::optional<T> value{std::move(slot.value)};
+          slot.sequence.store(pos + mask_ + 1, std::memory_order_release);
+          return value;
+        }
+      } else if(diff < 0) {
+        return std::nullopt;
+      } else {
+        pos = head_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+private:
+  // Cursors and slots sit on separate cache lines so producers and consumers
+  // do not false-share.
+  static constexpr std::size_t cache_line = 64;
+
+  struct alignas(cache_line) Slot {
+    std::atomic<std::size_t> sequence{0};
+    T value{};
+  };
+
+  std::size_t mask_;
+  std::unique_ptr<Slot[]> slots_;
+  alignas(cache_line) std::atomic<std::size_t> tail_{0};
+  alignas(cache_line) std::atomic<std::size_t> head_{0};
+};
+
+}    // namespace ds
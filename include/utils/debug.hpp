@@ -1,13 +1,27 @@
 #pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <limits>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <string>
 #include <string_view>
+#include <system_error>
+#include <thread>
 
 #include <fmt/format.h>
 
+#include <nonstd/expected.hpp>
 #include <spdlog/spdlog.h>
+#include <utils/bounded_queue.hpp>
 #include <utils/error.hpp>
 
 namespace ds {
@@ -36,6 +50,103 @@ enum class DebugLevel : int {
   return "?";
 }
 
+// Levels a message can carry (Off is a filter setting only).
+inline constexpr std::size_t debug_level_count = static_cast<std::size_t>(DebugLevel::Off);
+
+// Operations DebugLayer can time once set_timing_enabled(true) is called.
+enum class TimedOp : int {
+  BuildValidate = 0,    // Builder::build() checks before the pipeline exists
+  BuildAdd = 1,         // gst_pipeline_new + gst_bin_add of every element
+  BuildLink = 2,        // gst_element_link of neighbours
+  Build = 3,            // the whole of Builder::build()
+  StateChange = 4,      // ds::set_state()
+};
+
+inline constexpr std::size_t timed_op_count = 5;
+
+[[nodiscard]] inline std::string_view timed_op_str(TimedOp op) noexcept {
+  switch(op) {
+  case TimedOp::BuildValidate:
+    return "build.validate";
+  case TimedOp::BuildAdd:
+    return "build.add";
+  case TimedOp::BuildLink:
+    return "build.link";
+  case TimedOp::Build:
+    return "build";
+  case TimedOp::StateChange:
+    return "state_change";
+  }
+  return "?";
+}
+
+// Copy of one latency histogram. Bucket i counts durations whose bit width is
+// i: [2^(i-1), 2^i) ns, with 0 ns in bucket 0 and everything past ~2.3 minutes
+// in the last bucket. Percentiles are therefore accurate to a factor of two.
+struct LatencyHistogram {
+  static constexpr std::size_t bucket_count = 48;
+
+  std::array<std::uint64_t, bucket_count> buckets{};
+  std::uint64_t count{0};
+  std::uint64_t sum_ns{0};
+  std::uint64_t max_ns{0};
+
+  [[nodiscard]] std::chrono::nanoseconds mean() const noexcept {
+    return std::chrono::nanoseconds{count == 0 ? 0 : static_cast<std::int64_t>(sum_ns / count)};
+  }
+
+  // Upper edge of the bucket holding the p-th quantile (p in [0, 1]), capped
+  // at the largest recorded duration.
+  [[nodiscard]] std::chrono::nanoseconds percentile(double p) const noexcept {
+    if(count == 0) {
+      return std::chrono::nanoseconds{0};
+    }
+    const auto scaled = std::clamp(p, 0.0, 1.0) * static_cast<double>(count);
+    const auto rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(scaled + 0.5));
+    std::uint64_t seen = 0;
+    for(std::size_t i = 0; i < bucket_count; ++i) {
+      seen += buckets[i];
+      if(seen >= rank) {
+        const std::uint64_t upper = i == 0 ? 0 : (std::uint64_t{1} << i) - 1;
+        return std::chrono::nanoseconds{static_cast<std::int64_t>(std::min(upper, max_ns))};
+      }
+    }
+    return std::chrono::nanoseconds{static_cast<std::int64_t>(max_ns)};
+  }
+};
+
+// Point-in-time copy of DebugLayer's counters, returned by snapshot().
+struct DebugStats {
+  // log() calls per level and kind, including those below the minimum level.
+  std::array<std::array<std::uint64_t, error_kind_count>, debug_level_count> messages{};
+  std::array<LatencyHistogram, timed_op_count> timings{};
+  std::uint64_t dropped{0};    // DebugLayer::dropped()
+
+  [[nodiscard]] std::uint64_t count(DebugLevel level, ErrorKind kind) const noexcept {
+    return level == DebugLevel::Off ? 0 : messages[static_cast<std::size_t>(level)][static_cast<std::size_t>(kind)];
+  }
+  [[nodiscard]] std::uint64_t count(ErrorKind kind) const noexcept {
+    std::uint64_t total = 0;
+    for(const auto& per_level : messages) {
+      total += per_level[static_cast<std::size_t>(kind)];
+    }
+    return total;
+  }
+  [[nodiscard]] std::uint64_t count(DebugLevel level) const noexcept {
+    if(level == DebugLevel::Off) {
+      return 0;
+    }
+    std::uint64_t total = 0;
+    for(const auto n : messages[static_cast<std::size_t>(level)]) {
+      total += n;
+    }
+    return total;
+  }
+  [[nodiscard]] const LatencyHistogram& timing(TimedOp op) const noexcept {
+    return timings[static_cast<std::size_t>(op)];
+  }
+};
+
 // Structured diagnostic message delivered to the validation callback and/or spdlog.
 struct DebugMessage {
   DebugLevel level{DebugLevel::Debug};
@@ -52,6 +163,241 @@ struct DebugMessage {
   }
 };
 
+// Per-call-site state behind the rate-limited DS_*_EVERY_N / _FIRST_N / _RATE
+// macros. Each macro expansion owns one function-local static limiter; every
+// limiter links itself into a global list at construction so
+// DebugLayer::report_suppressed() can report the sites that went quiet.
+// All members are lock-free atomics, safe to share across streaming threads.
+class LogLimiter {
+public:
+  LogLimiter(DebugLevel level, const char* file, int line) noexcept : level_(level), file_(file), line_(line) {
+    next_ = head_.load(std::memory_order_relaxed);
+    while(!head_.compare_exchange_weak(next_, this, std::memory_order_release, std::memory_order_relaxed)) {
+    }
+  }
+
+  LogLimiter(const LogLimiter&) = delete;
+  LogLimiter& operator=(const LogLimiter&) = delete;
+
+  // Each decision returns the number of messages suppressed since this site
+  // last emitted when the caller should emit now, or nullopt to suppress.
+
+  // Occurrences 1, n+1, 2n+1, ...
+  [[nodiscard]] std::optional<std::uint64_t> every_n(std::uint64_t n) noexcept {
+    return decide(seen_.fetch_add(1, std::memory_order_relaxed) % std::max<std::uint64_t>(n, 1) == 0);
+  }
+
+  // The first n occurrences only.
+  [[nodiscard]] std::optional<std::uint64_t> first_n(std::uint64_t n) noexcept {
+    return decide(seen_.fetch_add(1, std::memory_order_relaxed) < n);
+  }
+
+  // At most `per_second` occurrences in each one-second window.
+  [[nodiscard]] std::optional<std::uint64_t> rate(std::uint64_t per_second) noexcept {
+    const auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+    auto start = window_start_.load(std::memory_order_relaxed);
+    constexpr auto window = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::seconds{1}).count();
+    if(now - start >= window && window_start_.compare_exchange_strong(start, now, std::memory_order_relaxed)) {
+      seen_.store(0, std::memory_order_relaxed);
+    }
+    return decide(seen_.fetch_add(1, std::memory_order_relaxed) < per_second);
+  }
+
+  // Suppressed since the last emit or report; resets the count.
+  [[nodiscard]] std::uint64_t take_suppressed() noexcept {
+    return suppressed_.exchange(0, std::memory_order_relaxed);
+  }
+
+  // Suppressed over the limiter's lifetime.
+  [[nodiscard]] std::uint64_t suppressed_total() const noexcept {
+    return suppressed_total_.load(std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] DebugLevel level() const noexcept {
+    return level_;
+  }
+  [[nodiscard]] const char* file() const noexcept {
+    return file_;
+  }
+  [[nodiscard]] int line() const noexcept {
+    return line_;
+  }
+
+  // Every limiter constructed so far, most recent first.
+  [[nodiscard]] static LogLimiter* first() noexcept {
+    return head_.load(std::memory_order_acquire);
+  }
+  [[nodiscard]] LogLimiter* next() const noexcept {
+    return next_;
+  }
+
+private:
+  std::optional<std::uint64_t> decide(bool emit) noexcept {
+    if(emit) {
+      return take_suppressed();
+    }
+    suppressed_.fetch_add(1, std::memory_order_relaxed);
+    suppressed_total_.fetch_add(1, std::memory_order_relaxed);
+    return std::nullopt;
+  }
+
+  static inline std::atomic<LogLimiter*> head_{nullptr};
+
+  DebugLevel level_;
+  const char* file_;
+  int line_;
+  LogLimiter* next_{nullptr};
+  std::atomic<std::uint64_t> seen_{0};
+  std::atomic<std::uint64_t> suppressed_{0};
+  std::atomic<std::uint64_t> suppressed_total_{0};
+  std::atomic<std::chrono::steady_clock::rep> window_start_{0};
+};
+
+namespace detail {
+
+// 12304 -> "12,304"
+[[nodiscard]] inline std::string group_thousands(std::uint64_t value) {
+  auto digits = std::to_string(value);
+  for(auto i = static_cast<std::ptrdiff_t>(digits.size()) - 3; i > 0; i -= 3) {
+    digits.insert(static_cast<std::size_t>(i), 1, ',');
+  }
+  return digits;
+}
+
+[[nodiscard]] inline std::string suppressed_note(std::uint64_t count) {
+  return fmt::format("suppressed {} similar message{}", group_thousands(count), count == 1 ? "" : "s");
+}
+
+// Appends the suppressed count to a rate-limited message that is being emitted.
+[[nodiscard]] inline std::string with_suppressed(std::string message, std::uint64_t suppressed) {
+  if(suppressed > 0) {
+    message += " [";
+    message += suppressed_note(suppressed);
+    message += ']';
+  }
+  return message;
+}
+
+// Lock-free recorder behind one LatencyHistogram.
+class AtomicHistogram {
+public:
+  void record(std::chrono::nanoseconds elapsed) noexcept {
+    const auto ns = static_cast<std::uint64_t>(std::max<std::int64_t>(elapsed.count(), 0));
+    const auto width = static_cast<std::size_t>(std::numeric_limits<std::uint64_t>::digits - std::countl_zero(ns));
+    const auto bucket = std::min(width, LatencyHistogram::bucket_count - 1);
+    buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_ns_.fetch_add(ns, std::memory_order_relaxed);
+    auto max = max_ns_.load(std::memory_order_relaxed);
+    while(ns > max && !max_ns_.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {
+    }
+  }
+
+  // Fields are read one at a time, so a snapshot taken during record() may be
+  // off by the in-flight sample.
+  [[nodiscard]] LatencyHistogram snapshot() const noexcept {
+    LatencyHistogram out;
+    for(std::size_t i = 0; i < out.buckets.size(); ++i) {
+      out.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+    }
+    out.count = count_.load(std::memory_order_relaxed);
+    out.sum_ns = sum_ns_.load(std::memory_order_relaxed);
+    out.max_ns = max_ns_.load(std::memory_order_relaxed);
+    return out;
+  }
+
+  void reset() noexcept {
+    for(auto& bucket : buckets_) {
+      bucket.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    sum_ns_.store(0, std::memory_order_relaxed);
+    max_ns_.store(0, std::memory_order_relaxed);
+  }
+
+private:
+  std::array<std::atomic<std::uint64_t>, LatencyHistogram::bucket_count> buckets_{};
+  std::atomic<std::uint64_t> count_{0};
+  std::atomic<std::uint64_t> sum_ns_{0};
+  std::atomic<std::uint64_t> max_ns_{0};
+};
+
+// DebugLayer's async ring entry: 512 bytes including the message text, so
+// producers never allocate. Longer messages are cut to fit and end in "...".
+struct DebugRecord {
+  DebugLevel level{DebugLevel::Debug};
+  ErrorKind kind{ErrorKind::Unknown};
+  int line{0};
+  std::uint32_t size{0};
+  const char* file{nullptr};
+  std::size_t file_size{0};
+  bool flush_marker{false};    // pushed by DebugLayer::flush(), never delivered
+  std::array<char, 472> text{};
+
+  void set_text(std::string_view message) noexcept {
+    if(message.size() > text.size()) {
+      constexpr std::string_view ellipsis{"..."};
+      message = message.substr(0, text.size() - ellipsis.size());
+      std::copy(ellipsis.begin(), ellipsis.end(), text.begin() + static_cast<std::ptrdiff_t>(message.size()));
+      size = static_cast<std::uint32_t>(text.size());
+    } else {
+      size = static_cast<std::uint32_t>(message.size());
+    }
+    std::copy(message.begin(), message.end(), text.begin());
+  }
+};
+
+// One async session. Producers push onto the ring's tail cursor and only take
+// the mutex to wake the consumer when it has announced, through `sleeping`,
+// that it found the ring empty and is about to wait.
+struct DebugRing {
+  explicit DebugRing(std::size_t capacity) : ring(capacity) {}
+
+  // Called by a producer after a successful push.
+  void wake_if_sleeping() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);    // pairs with the fence in wait()
+    if(sleeping.load(std::memory_order_relaxed)) {
+      notify();
+    }
+  }
+
+  void notify() {
+    { std::lock_guard lk{mutex}; }
+    wake.notify_one();
+  }
+
+  // Consumer side: sleeps until a push, stop() or the timeout, whichever is first.
+  void wait(std::optional<std::chrono::steady_clock::time_point> until) {
+    std::unique_lock lk{mutex};
+    sleeping.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);    // a push either sees sleeping or is seen here
+    const auto ready = [this] {
+      return ring.size_approx() != 0 || stopping.load(std::memory_order_acquire);
+    };
+    if(until) {
+      wake.wait_until(lk, *until, ready);
+    } else {
+      wake.wait(lk, ready);
+    }
+    sleeping.store(false, std::memory_order_relaxed);
+  }
+
+  void stop() {
+    stopping.store(true, std::memory_order_release);
+    notify();
+  }
+
+  BoundedQueue<DebugRecord> ring;
+  std::atomic<bool> stopping{false};
+  std::atomic<bool> sleeping{false};
+  std::mutex mutex;    // only for wake
+  std::condition_variable wake;
+  std::atomic<std::uint64_t> flushed{0};    // flush markers consumed; flush() sleeps on it
+  std::uint64_t flush_requests{0};          // guarded by DebugLayer::async_mutex_
+};
+
+}    // namespace detail
+
 // Vulkan-style validation / debug layer.
 //
 // Lifecycle:
@@ -64,6 +410,30 @@ struct DebugMessage {
 //
 // Minimum level filter (default: Debug — all messages pass):
 //   ds::DebugLayer::instance().set_min_level(ds::DebugLevel::Warn);
+//
+// The DS_* macros test enabled() before formatting anything, so a filtered-out
+// message costs one relaxed load and a branch. Levels below DS_MIN_LOG_LEVEL
+// are removed at compile time (see the macros at the end of this file).
+//
+// Asynchronous delivery (default: synchronous, on the logging thread):
+//   ds::DebugLayer::instance().start_async();    // callback + logger now run on a background thread
+//   ...
+//   ds::DebugLayer::instance().flush();          // wait for everything logged so far
+//   ds::DebugLayer::instance().stop_async();
+//
+// In async mode log() copies the message into a fixed-size record and pushes it
+// onto a lock-free ring; no thread that logs takes mutex_, and the consumer is
+// woken only when it had gone idle. When the ring is full the record is dropped
+// and counted in dropped(). stop_async() waits for producers already inside
+// log() to finish their push, drains the ring and frees it; calls that start
+// after it are delivered synchronously. The file argument is kept by pointer,
+// so it must have static storage duration (__FILE__ does).
+//
+// Statistics (always on; one relaxed atomic add per log() call):
+//   auto stats = ds::DebugLayer::instance().snapshot();
+//   stats.count(ds::DebugLevel::Error, ds::ErrorKind::ElementLink);    // link failures so far
+//   ds::DebugLayer::set_timing_enabled(true);                          // opt in to TimedOp histograms
+//   stats.timing(ds::TimedOp::Build).percentile(0.99);                 // build p99
 class DebugLayer {
 public:
   using Callback = std::function<void(const DebugMessage&)>;
@@ -92,20 +462,242 @@ public:
 
   // Only deliver messages at or above this level (default: Debug).
   void set_min_level(DebugLevel level) noexcept {
-    min_level_ = level;
+    min_level_.store(level, std::memory_order_relaxed);
   }
 
   [[nodiscard]] DebugLevel min_level() const noexcept {
-    return min_level_;
+    return min_level_.load(std::memory_order_relaxed);
+  }
+
+  // True if a message at level would be delivered. Static so the macros reach
+  // it without the function-local-static guard in instance().
+  [[nodiscard]] static bool enabled(DebugLevel level) noexcept {
+    return static_cast<int>(level) >= static_cast<int>(min_level_.load(std::memory_order_relaxed));
   }
 
   // Dispatch a diagnostic.  Called by DS_* macros and library internals.
   void log(DebugLevel level, ErrorKind kind, std::string message, std::string_view file, int line) {
-    if(static_cast<int>(level) < static_cast<int>(min_level_)) {
+    if(level != DebugLevel::Off) {
+      messages_[static_cast<std::size_t>(level)][static_cast<std::size_t>(kind)].fetch_add(1, std::memory_order_relaxed);
+    }
+    if(!enabled(level)) {
+      return;
+    }
+    if(async_.load(std::memory_order_relaxed) != nullptr && push_async(level, kind, message, file, line)) {
+      return;
+    }
+    deliver(DebugMessage{level, kind, std::move(message), std::string{file}, line});
+  }
+
+  // Switch to asynchronous delivery through a ring of `capacity` records
+  // (rounded up to a power of two). No-op if already asynchronous.
+  [[nodiscard]] nonstd::expected<void, Error> start_async(std::size_t capacity = 1024) {
+    std::lock_guard lk{async_mutex_};
+    if(async_.load(std::memory_order_relaxed) != nullptr) {
+      return {};
+    }
+    auto state = std::make_unique<detail::DebugRing>(capacity);
+    try {
+      async_thread_ = std::thread{&DebugLayer::run_async, this, state.get()};
+    } catch(const std::system_error& e) {
+      return nonstd::make_unexpected(Error{ErrorKind::Unknown, std::string{"Failed to start debug thread: "} + e.what()});
+    }
+    async_state_ = std::move(state);
+    async_.store(async_state_.get(), std::memory_order_seq_cst);
+    return {};
+  }
+
+  // Deliver everything already queued, then return to synchronous delivery.
+  // A log() call that raced with this either lands in the ring before the
+  // final drain or is delivered synchronously; none is lost.
+  void stop_async() {
+    std::lock_guard lk{async_mutex_};
+    auto* state = async_.exchange(nullptr, std::memory_order_seq_cst);
+    if(state == nullptr) {
       return;
     }
+    // Producers that loaded the ring before the exchange are still counted.
+    while(async_producers_.load(std::memory_order_seq_cst) != 0) {
+      std::this_thread::yield();
+    }
+    state->stop();
+    async_thread_.join();
+    async_state_.reset();
+  }
+
+  // Block until every message logged before this call has been delivered.
+  // No-op in synchronous mode. Must not be called from the callback.
+  void flush() {
+    std::lock_guard lk{async_mutex_};
+    auto* state = async_.load(std::memory_order_acquire);
+    if(state == nullptr) {
+      return;
+    }
+    detail::DebugRecord marker;
+    marker.flush_marker = true;
+    while(!state->ring.try_push(marker)) {
+      std::this_thread::yield();
+    }
+    state->wake_if_sleeping();
+    const auto ticket = ++state->flush_requests;
+    for(;;) {
+      const auto done = state->flushed.load(std::memory_order_acquire);
+      if(done >= ticket) {
+        return;
+      }
+      state->flushed.wait(done, std::memory_order_acquire);
+    }
+  }
+
+  // Logs "suppressed N similar messages" at the level and site of every
+  // rate-limited macro that has dropped messages since it last emitted, and
+  // returns the total. Call it periodically, or let the async consumer do it
+  // via set_suppressed_report_interval().
+  std::uint64_t report_suppressed() {
+    std::uint64_t total = 0;
+    for(auto* limiter = LogLimiter::first(); limiter != nullptr; limiter = limiter->next()) {
+      if(!enabled(limiter->level())) {
+        continue;
+      }
+      if(const auto count = limiter->take_suppressed(); count > 0) {
+        total += count;
+        log(limiter->level(), ErrorKind::Unknown, detail::suppressed_note(count), limiter->file(), limiter->line());
+      }
+    }
+    return total;
+  }
+
+  // In async mode, run report_suppressed() on the consumer thread at this
+  // interval. Zero (the default) disables it.
+  void set_suppressed_report_interval(std::chrono::milliseconds interval) noexcept {
+    report_interval_ms_.store(interval.count(), std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] bool is_async() const noexcept {
+    return async_.load(std::memory_order_acquire) != nullptr;
+  }
+
+  // Messages discarded because the async ring was full (cumulative).
+  [[nodiscard]] std::uint64_t dropped() const noexcept {
+    return dropped_.load(std::memory_order_relaxed);
+  }
+
+  // Latency histograms for TimedOp are off by default: ScopedTiming reads no
+  // clock until this is enabled.
+  static void set_timing_enabled(bool on) noexcept {
+    timing_enabled_.store(on, std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] static bool timing_enabled() noexcept {
+    return timing_enabled_.load(std::memory_order_relaxed);
+  }
+
+  void record_timing(TimedOp op, std::chrono::nanoseconds elapsed) noexcept {
+    timings_[static_cast<std::size_t>(op)].record(elapsed);
+  }
+
+  // Counters and histograms as of now. Each counter is read atomically; the
+  // set as a whole is not a consistent cut while other threads log.
+  [[nodiscard]] DebugStats snapshot() const noexcept {
+    DebugStats stats;
+    for(std::size_t level = 0; level < debug_level_count; ++level) {
+      for(std::size_t kind = 0; kind < error_kind_count; ++kind) {
+        stats.messages[level][kind] = messages_[level][kind].load(std::memory_order_relaxed);
+      }
+    }
+    for(std::size_t op = 0; op < timed_op_count; ++op) {
+      stats.timings[op] = timings_[op].snapshot();
+    }
+    stats.dropped = dropped();
+    return stats;
+  }
+
+  // Zero the message counters and histograms (not dropped()).
+  void reset_stats() noexcept {
+    for(auto& per_level : messages_) {
+      for(auto& counter : per_level) {
+        counter.store(0, std::memory_order_relaxed);
+      }
+    }
+    for(auto& histogram : timings_) {
+      histogram.reset();
+    }
+  }
+
+  DebugLayer(const DebugLayer&) = delete;
+  DebugLayer& operator=(const DebugLayer&) = delete;
+
+  ~DebugLayer() {
+    stop_async();
+  }
+
+private:
+  DebugLayer() = default;
+
+  // Pushes onto the async ring; false if async delivery has just been stopped,
+  // in which case the caller delivers synchronously. The producer count lets
+  // stop_async() know when no thread can still touch the ring it is freeing:
+  // the increment is ordered before the re-load, and stop_async() exchanges
+  // the pointer before it reads the count, so one of them sees the other.
+  bool push_async(DebugLevel level, ErrorKind kind, std::string_view message, std::string_view file, int line) {
+    async_producers_.fetch_add(1, std::memory_order_seq_cst);
+    auto* async = async_.load(std::memory_order_seq_cst);
+    if(async != nullptr) {
+      detail::DebugRecord record;
+      record.level = level;
+      record.kind = kind;
+      record.line = line;
+      record.file = file.data();
+      record.file_size = file.size();
+      record.set_text(message);
+      if(async->ring.try_push(record)) {
+        async->wake_if_sleeping();
+      } else {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+    async_producers_.fetch_sub(1, std::memory_order_release);
+    return async != nullptr;
+  }
+
+  void run_async(detail::DebugRing* state) {
+    const auto drain = [&] {
+      while(auto record = state->ring.try_pop()) {
+        if(record->flush_marker) {
+          state->flushed.fetch_add(1, std::memory_order_release);
+          state->flushed.notify_all();
+          continue;
+        }
+        deliver(DebugMessage{record->level,
+                             record->kind,
+                             std::string{record->text.data(), record->size},
+                             std::string{record->file, record->file_size},
+                             record->line});
+      }
+    };
+    auto last_report = std::chrono::steady_clock::now();
+    for(;;) {
+      drain();
+      std::optional<std::chrono::steady_clock::time_point> next_report;
+      if(const std::chrono::milliseconds interval{report_interval_ms_.load(std::memory_order_relaxed)}; interval.count() > 0) {
+        if(const auto now = std::chrono::steady_clock::now(); now - last_report >= interval) {
+          last_report = now;
+          report_suppressed();
+        }
+        next_report = last_report + interval;
+      }
+      if(state->stopping.load(std::memory_order_acquire)) {
+        drain();
+        return;
+      }
+      if(state->ring.size_approx() == 0) {
+        state->wait(next_report);
+      }
+    }
+  }
 
-    DebugMessage msg{level, kind, std::move(message), std::string{file}, line};
+  void deliver(const DebugMessage& msg) {
+    const auto level = msg.level;
 
     std::lock_guard lk{mutex_};
 
@@ -134,13 +726,50 @@ public:
     }
   }
 
-private:
-  DebugLayer() = default;
-
   mutable std::mutex mutex_;
   Callback callback_;
   std::shared_ptr<spdlog::logger> logger_;
-  DebugLevel min_level_{DebugLevel::Debug};
+  static inline std::atomic<DebugLevel> min_level_{DebugLevel::Debug};
+  std::atomic<detail::DebugRing*> async_{nullptr};
+  std::atomic<std::uint32_t> async_producers_{0};    // log() calls between loading async_ and finishing the push
+  std::atomic<std::uint64_t> dropped_{0};
+  std::atomic<std::chrono::milliseconds::rep> report_interval_ms_{0};
+  static inline std::atomic<bool> timing_enabled_{false};
+  std::array<std::array<std::atomic<std::uint64_t>, error_kind_count>, debug_level_count> messages_{};
+  std::array<detail::AtomicHistogram, timed_op_count> timings_{};
+  std::mutex async_mutex_;    // serialises start_async(), stop_async() and flush()
+  std::thread async_thread_;
+  std::unique_ptr<detail::DebugRing> async_state_;    // owns *async_; freed by stop_async()
+};
+
+// Times a scope into DebugLayer's histogram for `op` when timing is enabled.
+//   ds::ScopedTiming timing{ds::TimedOp::StateChange};
+// stop() records early; the destructor records otherwise.
+class ScopedTiming {
+public:
+  explicit ScopedTiming(TimedOp op) noexcept : op_(op) {
+    if(DebugLayer::timing_enabled()) {
+      start_ = std::chrono::steady_clock::now();
+    }
+  }
+
+  ScopedTiming(const ScopedTiming&) = delete;
+  ScopedTiming& operator=(const ScopedTiming&) = delete;
+
+  ~ScopedTiming() {
+    stop();
+  }
+
+  void stop() noexcept {
+    if(start_) {
+      DebugLayer::instance().record_timing(op_, std::chrono::steady_clock::now() - *start_);
+      start_.reset();
+    }
+  }
+
+private:
+  TimedOp op_;
+  std::optional<std::chrono::steady_clock::time_point> start_;
 };
 
 }    // namespace ds
@@ -150,17 +779,58 @@ private:
 // ============================================================================
 // These go through DebugLayer so the user callback and spdlog both receive them.
 // fmt-style format strings are supported: DS_DEBUG("frame {}", n);
+//
+// Arguments are only evaluated and formatted when DebugLayer::enabled() passes.
+// Define DS_MIN_LOG_LEVEL to a DebugLevel value (0 = Debug … 4 = Off) to compile
+// lower levels out entirely, e.g. -DDS_MIN_LOG_LEVEL=2 keeps DS_WARN and DS_ERROR.
+// Stripped calls still type-check their format string.
+
+#ifndef DS_MIN_LOG_LEVEL
+#  define DS_MIN_LOG_LEVEL 0
+#endif
 
 // NOLINTBEGIN(cppcoreguidelines-macro-usage)
-#define DS_DEBUG(...)                                                                                                            \
-  ::ds::DebugLayer::instance().log(::ds::DebugLevel::Debug, ::ds::ErrorKind::Unknown, fmt::format(__VA_ARGS__), __FILE__, __LINE__)
+#define DS_LOG_AT_(level, ...)                                                                                                   \
+  do {                                                                                                                           \
+    if constexpr(static_cast<int>(level) >= DS_MIN_LOG_LEVEL) {                                                                  \
+      if(::ds::DebugLayer::enabled(level)) {                                                                                     \
+        ::ds::DebugLayer::instance().log(level, ::ds::ErrorKind::Unknown, fmt::format(__VA_ARGS__), __FILE__, __LINE__);         \
+      }                                                                                                                          \
+    }                                                                                                                            \
+  } while(false)
+
+#define DS_DEBUG(...) DS_LOG_AT_(::ds::DebugLevel::Debug, __VA_ARGS__)
+#define DS_INFO(...) DS_LOG_AT_(::ds::DebugLevel::Info, __VA_ARGS__)
+#define DS_WARN(...) DS_LOG_AT_(::ds::DebugLevel::Warn, __VA_ARGS__)
+#define DS_ERROR(...) DS_LOG_AT_(::ds::DebugLevel::Error, __VA_ARGS__)
 
-#define DS_INFO(...)                                                                                                             \
-  ::ds::DebugLayer::instance().log(::ds::DebugLevel::Info, ::ds::ErrorKind::Unknown, fmt::format(__VA_ARGS__), __FILE__, __LINE__)
+// Rate-limited variants for per-frame paths. `level` is a DebugLevel
+// enumerator name; each expansion keeps its own LogLimiter, and an emitted
+// message carries "[suppressed N similar messages]" when it had been held back.
+//   DS_LOG_EVERY_N(Warn, 100, "stream {} late", id);    // 1st, 101st, 201st, ...
+//   DS_LOG_FIRST_N(Info, 3, "caps {}", caps);           // first three only
+//   DS_LOG_RATE(Warn, 5, "decode error on {}", id);     // at most 5 per second
+#define DS_LOG_LIMITED_(level, decision, ...)                                                                                    \
+  do {                                                                                                                           \
+    if constexpr(static_cast<int>(level) >= DS_MIN_LOG_LEVEL) {                                                                  \
+      if(::ds::DebugLayer::enabled(level)) {                                                                                     \
+        static ::ds::LogLimiter ds_limiter_{level, __FILE__, __LINE__};                                                          \
+        if(const auto ds_suppressed_ = ds_limiter_.decision) {                                                                   \
+          ::ds::DebugLayer::instance().log(level,                                                                                \
+                                           ::ds::ErrorKind::Unknown,                                                             \
+                                           ::ds::detail::with_suppressed(fmt::format(__VA_ARGS__), *ds_suppressed_),             \
+                                           __FILE__,                                                                             \
+                                           __LINE__);                                                                            \
+        }                                                                                                                        \
+      }                                                                                                                          \
+    }                                                                                                                            \
+  } while(false)
 
-#define DS_WARN(...)                                                                                                             \
-  ::ds::DebugLayer::instance().log(::ds::DebugLevel::Warn, ::ds::ErrorKind::Unknown, fmt::format(__VA_ARGS__), __FILE__, __LINE__)
+#define DS_LOG_EVERY_N(level, n, ...) DS_LOG_LIMITED_(::ds::DebugLevel::level, every_n(n), __VA_ARGS__)
+#define DS_LOG_FIRST_N(level, n, ...) DS_LOG_LIMITED_(::ds::DebugLevel::level, first_n(n), __VA_ARGS__)
+#define DS_LOG_RATE(level, per_second, ...) DS_LOG_LIMITED_(::ds::DebugLevel::level, rate(per_second), __VA_ARGS__)
 
-#define DS_ERROR(...)                                                                                                            \
-  ::ds::DebugLayer::instance().log(::ds::DebugLevel::Error, ::ds::ErrorKind::Unknown, fmt::format(__VA_ARGS__), __FILE__, __LINE__)
+#define DS_WARN_EVERY_N(n, ...) DS_LOG_EVERY_N(Warn, n, __VA_ARGS__)
+#define DS_WARN_FIRST_N(n, ...) DS_LOG_FIRST_N(Warn, n, __VA_ARGS__)
+#define DS_WARN_RATE(per_second, ...) DS_LOG_RATE(Warn, per_second, __VA_ARGS__)
 // NOLINTEND(cppcoreguidelines-macro-usage)
@@ -20,8 +20,20 @@ enum class ErrorKind {
   BinAdd,              // gst_bin_add rejected an element
   // Parse
   ParseLaunch,    // gst_parse_launch returned an error
+  // File I/O
+  FileIO,        // open/read/write/mmap on a library-managed file failed
+  FileFormat,    // file exists but is not in the expected format
+  // Configuration
+  InvalidArgument,    // a factory was given a value it cannot work with
+  // Serialization
+  Decode,    // byte stream is truncated, corrupt or out of sequence
+  // Runtime
+  Capacity,    // admission control refused work the pipeline cannot sustain
 };
 
+// Number of ErrorKind values; keep in step with the last enumerator above.
+inline constexpr std::size_t error_kind_count = static_cast<std::size_t>(ErrorKind::Capacity) + 1;
+
 [[nodiscard]] inline std::string_view error_kind_str(ErrorKind k) noexcept {
   switch(k) {
   case ErrorKind::Unknown:
@@ -44,6 +56,16 @@ enum class ErrorKind {
     return "BinAdd";
   case ErrorKind::ParseLaunch:
     return "ParseLaunch";
+  case ErrorKind::FileIO:
+    return "FileIO";
+  case ErrorKind::FileFormat:
+    return "FileFormat";
+  case ErrorKind::InvalidArgument:
+    return "InvalidArgument";
+  case ErrorKind::Decode:
+    return "Decode";
+  case ErrorKind::Capacity:
+    return "Capacity";
   }
   return "Unknown";
 }
@@ -0,0 +1,160 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <fmt/format.h>
+
+#include <gst/gst.h>
+
+#include <nonstd/expected.hpp>
+#include <utils/debug.hpp>
+#include <utils/error.hpp>
+
+namespace ds {
+
+struct GstDebugBridgeConfig {
+  // GST_DEBUG-style threshold list applied on install, e.g. "*:WARNING,nvstreammux:DEBUG";
+  // it replaces all current thresholds. Empty (the default) leaves them, including a
+  // GST_DEBUG an operator set in the environment, alone.
+  std::string thresholds{};
+  // Remove gst_debug_log_default so GStreamer stops writing to stderr; it is
+  // re-added by uninstall().
+  bool replace_default{true};
+};
+
+namespace detail {
+
+struct GstDebugBridgeState {
+  std::atomic<bool> installed{false};
+  std::atomic<bool> removed_default{false};
+  std::atomic<std::uint64_t> forwarded{0};
+  std::atomic<std::uint64_t> filtered{0};
+};
+
+}    // namespace detail
+
+// ============================================================================
+// GstDebugBridge — GStreamer's debug log into DebugLayer
+// ============================================================================
+//   auto bridge = ds::GstDebugBridge::install({.thresholds = "*:WARNING,v4l2*:DEBUG"}).value();
+//   ...                                   // GST_* records now arrive as DebugMessages
+//   bridge.uninstall();                   // or let it go out of scope
+//
+// Filtering happens in two places, both before any text is produced:
+//   1. The category threshold, which GStreamer checks at the GST_* call site;
+//      records above it never reach the bridge (set via config.thresholds).
+//   2. DebugLayer::enabled() for the mapped level, checked in the log function
+//      before gst_debug_message_get() formats the record.
+//
+// Levels map ERROR → Error, WARNING/FIXME → Warn, INFO → Info and everything
+// more verbose → Debug. Messages read "[category] object: text" and keep the
+// GStreamer call site as file/line. Only one bridge can be installed at a time.
+class GstDebugBridge {
+public:
+  [[nodiscard]] static nonstd::expected<GstDebugBridge, Error> install(const GstDebugBridgeConfig& config = {}) {
+    if(state_.installed.exchange(true, std::memory_order_acq_rel)) {
+      return nonstd::make_unexpected(Error{ErrorKind::InvalidArgument, "A GstDebugBridge is already installed"});
+    }
+    if(!config.thresholds.empty()) {
+      gst_debug_set_threshold_from_string(config.thresholds.c_str(), TRUE);
+    }
+    gst_debug_add_log_function(&GstDebugBridge::log_function, &state_, nullptr);
+    if(config.replace_default) {
+      gst_debug_remove_log_function(gst_debug_log_default);
+      state_.removed_default.store(true, std::memory_order_relaxed);
+    }
+    gst_debug_set_active(TRUE);
+    return GstDebugBridge{};
+  }
+
+  GstDebugBridge(GstDebugBridge&& other) noexcept : owner_(std::exchange(other.owner_, false)) {}
+  GstDebugBridge& operator=(GstDebugBridge&& other) noexcept {
+    if(this != &other) {
+      uninstall();
+      owner_ = std::exchange(other.owner_, false);
+    }
+    return *this;
+  }
+  GstDebugBridge(const GstDebugBridge&) = delete;
+  GstDebugBridge& operator=(const GstDebugBridge&) = delete;
+
+  ~GstDebugBridge() {
+    uninstall();
+  }
+
+  // Removes the log function and restores the default stderr handler if
+  // install() removed it. Thresholds are left as they are.
+  void uninstall() noexcept {
+    if(!owner_) {
+      return;
+    }
+    owner_ = false;
+    gst_debug_remove_log_function_by_data(&state_);
+    if(state_.removed_default.exchange(false, std::memory_order_relaxed)) {
+      gst_debug_add_log_function(gst_debug_log_default, nullptr, nullptr);
+    }
+    state_.installed.store(false, std::memory_order_release);
+  }
+
+  // Records delivered to DebugLayer / dropped by DebugLayer::enabled(), since
+  // the process started.
+  [[nodiscard]] static std::uint64_t forwarded() noexcept {
+    return state_.forwarded.load(std::memory_order_relaxed);
+  }
+  [[nodiscard]] static std::uint64_t filtered() noexcept {
+    return state_.filtered.load(std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] static constexpr DebugLevel map_level(GstDebugLevel level) noexcept {
+    switch(level) {
+    case GST_LEVEL_ERROR:
+      return DebugLevel::Error;
+    case GST_LEVEL_WARNING:
+    case GST_LEVEL_FIXME:
+      return DebugLevel::Warn;
+    case GST_LEVEL_INFO:
+      return DebugLevel::Info;
+    default:
+      return DebugLevel::Debug;
+    }
+  }
+
+private:
+  GstDebugBridge() = default;
+
+  static void log_function(GstDebugCategory* category,
+                           GstDebugLevel level,
+                           const gchar* file,
+                           const gchar* /*function*/,
+                           gint line,
+                           GObject* object,
+                           GstDebugMessage* message,
+                           gpointer user_data) {
+    auto* state = static_cast<detail::GstDebugBridgeState*>(user_data);
+    if(level > gst_debug_category_get_threshold(category)) {
+      return;
+    }
+    const auto ds_level = map_level(level);
+    if(!DebugLayer::enabled(ds_level)) {
+      state->filtered.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+
+    const gchar* text = gst_debug_message_get(message);
+    const gchar* category_name = gst_debug_category_get_name(category);
+    const gchar* object_name = object != nullptr && GST_IS_OBJECT(object) ? GST_OBJECT_NAME(object) : nullptr;
+    auto formatted = object_name != nullptr ? fmt::format("[{}] {}: {}", category_name, object_name, text ? text : "")
+                                            : fmt::format("[{}] {}", category_name, text ? text : "");
+    state->forwarded.fetch_add(1, std::memory_order_relaxed);
+    DebugLayer::instance().log(ds_level, ErrorKind::Unknown, std::move(formatted), file ? file : "", line);
+  }
+
+  static inline detail::GstDebugBridgeState state_;    // static: GStreamer may call log_function briefly after removal
+
+  bool owner_{true};
+};
+
+}    // namespace ds
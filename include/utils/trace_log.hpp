@@ -0,0 +1,783 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fmt/args.h>
+#include <fmt/format.h>
+
+#include <fcntl.h>
+#include <nonstd/expected.hpp>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utils/debug.hpp>
+#include <utils/error.hpp>
+
+namespace ds {
+
+// ============================================================================
+// Trace log — binary DebugLayer backend, decoded offline
+// ============================================================================
+// DS_TRACE_* calls write a site id, a timestamp and the raw argument bytes into
+// a memory-mapped file instead of formatting text. The format string, file,
+// line and level of each call site are registered once and written as a Site
+// record the first time the site is used with a given log. TraceLogReader
+// (and examples/trace-log-decode) turn the file back into text.
+//
+//   FileHeader   (32 B)  magic "DSTRACE1", version, wall/steady clock at create()
+//   Record*              RecordHeader (16 B) + payload, padded to 8 B
+//
+// Site payload:   SiteHeader (16 B) | ArgType[arg_count] | format chars | file chars
+// Event payload:  u64 steady_ns | args, each Int/UInt/Double/Bool as 8 bytes and
+//                 String as u32 length + chars
+//
+// Writers reserve space with one atomic add and never block; once the file is
+// full further records are dropped and counted. Unused space is zero, so a
+// reader stops at the first zero-sized record. Sites may be recorded after
+// events that use them; readers load every site before rendering.
+namespace trace_log {
+
+inline constexpr std::array<char, 8> file_magic{'D', 'S', 'T', 'R', 'A', 'C', 'E', '1'};
+inline constexpr std::uint32_t format_version = 1;
+inline constexpr std::uint32_t max_sites = 1U << 16;    // site 0 is reserved for "unregistered"
+
+enum class RecordType : std::uint16_t { Site = 1, Event = 2 };
+enum class ArgType : std::uint8_t { Int = 1, UInt = 2, Double = 3, Bool = 4, String = 5 };
+
+struct FileHeader {
+  std::array<char, 8> magic{file_magic};
+  std::uint32_t version{format_version};
+  std::uint32_t header_size{sizeof(FileHeader)};
+  std::int64_t wall_start_ns{0};      // system_clock at create()
+  std::int64_t steady_start_ns{0};    // steady_clock at create(); events are relative to this clock
+};
+
+struct RecordHeader {
+  std::uint32_t size{0};    // whole record including header and padding
+  RecordType type{RecordType::Event};
+  std::uint16_t arg_count{0};
+  std::uint32_t site{0};
+  std::uint32_t reserved{0};
+};
+
+struct SiteHeader {
+  std::uint8_t level{0};
+  std::uint8_t reserved0{0};
+  std::uint16_t reserved1{0};
+  std::int32_t line{0};
+  std::uint32_t format_size{0};
+  std::uint32_t file_size{0};
+};
+
+static_assert(sizeof(FileHeader) == 32);
+static_assert(sizeof(RecordHeader) == 16);
+static_assert(sizeof(SiteHeader) == 16);
+
+[[nodiscard]] constexpr std::size_t align8(std::size_t n) noexcept {
+  return (n + 7U) & ~std::size_t{7U};
+}
+
+// Argument types a trace call may carry. Anything else (enums, pointers,
+// user types) must be converted at the call site.
+template <typename T>
+concept TraceArg = std::same_as<T, bool> || (std::integral<T> && !std::same_as<T, char>) || std::floating_point<T> ||
+                   std::convertible_to<const T&, std::string_view>;
+
+template <TraceArg T>
+[[nodiscard]] constexpr ArgType arg_type() noexcept {
+  if constexpr(std::same_as<T, bool>) {
+    return ArgType::Bool;
+  } else if constexpr(std::integral<T> && std::is_signed_v<T>) {
+    return ArgType::Int;
+  } else if constexpr(std::integral<T>) {
+    return ArgType::UInt;
+  } else if constexpr(std::floating_point<T>) {
+    return ArgType::Double;
+  } else {
+    return ArgType::String;
+  }
+}
+
+// Per-call-site argument signature, computed from the argument types only.
+template <TraceArg... Args>
+struct ArgTypes {
+  static constexpr std::array<ArgType, sizeof...(Args)> types{arg_type<Args>()...};
+};
+
+// A registered DS_TRACE_* call site. format and file point at string literals.
+struct Site {
+  DebugLevel level{DebugLevel::Debug};
+  std::string_view format;
+  std::string_view file;
+  int line{0};
+  std::span<const ArgType> args;
+};
+
+namespace detail {
+
+// Only used in decltype: yields the ArgTypes of a call without evaluating it.
+template <typename... Args>
+  requires(TraceArg<std::decay_t<Args>> && ...)
+ArgTypes<std::decay_t<Args>...> arg_types_of(const Args&...);
+
+inline Error io_error(std::string_view what, std::string_view path) {
+  return Error{ErrorKind::FileIO, fmt::format("{} '{}': {}", what, path, std::strerror(errno))};
+}
+
+// Process-wide site table. Registration takes a lock, but happens once per
+// call site (the macros cache the id in a function-local static).
+class SiteRegistry {
+public:
+  [[nodiscard]] static std::uint32_t add(const Site& site) {
+    std::lock_guard lk{mutex_};
+    if(sites_.size() + 1 >= max_sites) {
+      return 0;
+    }
+    sites_.push_back(site);
+    return static_cast<std::uint32_t>(sites_.size());
+  }
+
+  [[nodiscard]] static std::optional<Site> find(std::uint32_t id) {
+    std::lock_guard lk{mutex_};
+    if(id == 0 || id > sites_.size()) {
+      return std::nullopt;
+    }
+    return sites_[id - 1];
+  }
+
+private:
+  static inline std::mutex mutex_;
+  static inline std::deque<Site> sites_;
+};
+
+template <TraceArg T>
+[[nodiscard]] std::size_t encoded_size(const T& value) noexcept {
+  if constexpr(arg_type<T>() == ArgType::String) {
+    return sizeof(std::uint32_t) + std::string_view{value}.size();
+  } else {
+    return 8;
+  }
+}
+
+template <TraceArg T>
+void encode(std::byte*& out, const T& value) noexcept {
+  if constexpr(arg_type<T>() == ArgType::String) {
+    const std::string_view text{value};
+    const auto size = static_cast<std::uint32_t>(text.size());
+    std::memcpy(out, &size, sizeof(size));
+    std::memcpy(out + sizeof(size), text.data(), text.size());
+    out += sizeof(size) + text.size();
+  } else {
+    if constexpr(arg_type<T>() == ArgType::Int) {
+      const auto v = static_cast<std::int64_t>(value);
+      std::memcpy(out, &v, 8);
+    } else if constexpr(arg_type<T>() == ArgType::UInt) {
+      const auto v = static_cast<std::uint64_t>(value);
+      std::memcpy(out, &v, 8);
+    } else if constexpr(arg_type<T>() == ArgType::Double) {
+      const auto v = static_cast<double>(value);
+      std::memcpy(out, &v, 8);
+    } else {
+      const std::uint64_t v = value ? 1U : 0U;
+      std::memcpy(out, &v, 8);
+    }
+    out += 8;
+  }
+}
+
+[[nodiscard]] inline std::int64_t steady_ns() noexcept {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// The mapped file and its cursor. Shared by TraceLog and the DS_TRACE_* macros.
+class Writer {
+public:
+  Writer(int fd, std::byte* base, std::size_t capacity)
+      : fd_(fd), base_(base), capacity_(capacity), defined_(std::make_unique<std::atomic<bool>[]>(max_sites)) {}
+
+  template <TraceArg... Args>
+  void write(std::uint32_t site, const Args&... args) noexcept {
+    if(site == 0) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    if(!defined_[site].load(std::memory_order_relaxed)) {
+      define(site);
+    }
+    const std::size_t size = align8(sizeof(RecordHeader) + sizeof(std::int64_t) + (std::size_t{0} + ... + encoded_size(args)));
+    std::byte* out = reserve(size);
+    if(out == nullptr) {
+      return;
+    }
+    const RecordHeader header{static_cast<std::uint32_t>(size),
+                              RecordType::Event,
+                              static_cast<std::uint16_t>(sizeof...(Args)),
+                              site,
+                              0};
+    const auto now = steady_ns();
+    std::memcpy(out + sizeof(header), &now, sizeof(now));
+    [[maybe_unused]] std::byte* cursor = out + sizeof(header) + sizeof(now);
+    (encode(cursor, args), ...);
+    publish(out, header);
+  }
+
+  [[nodiscard]] std::uint64_t dropped() const noexcept {
+    return dropped_.load(std::memory_order_relaxed);
+  }
+  [[nodiscard]] std::size_t bytes_used() const noexcept {
+    return std::min(cursor_.load(std::memory_order_relaxed), capacity_);
+  }
+  [[nodiscard]] int fd() const noexcept {
+    return fd_;
+  }
+  [[nodiscard]] std::byte* base() const noexcept {
+    return base_;
+  }
+  [[nodiscard]] std::size_t capacity() const noexcept {
+    return capacity_;
+  }
+
+private:
+  std::byte* reserve(std::size_t size) noexcept {
+    const auto offset = cursor_.fetch_add(size, std::memory_order_relaxed);
+    if(offset + size > capacity_) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    return base_ + offset;
+  }
+
+  // Cold path: first use of a site with this log.
+  void define(std::uint32_t id) noexcept {
+    if(defined_[id].exchange(true, std::memory_order_relaxed)) {
+      return;
+    }
+    std::optional<Site> site;
+    try {
+      site = SiteRegistry::find(id);
+    } catch(const std::system_error&) {
+    }
+    if(!site) {
+      return;
+    }
+    const std::size_t size = align8(sizeof(RecordHeader) + sizeof(SiteHeader) + site->args.size() + site->format.size() +
+                                    site->file.size());
+    std::byte* out = reserve(size);
+    if(out == nullptr) {
+      return;
+    }
+    const SiteHeader site_header{static_cast<std::uint8_t>(site->level),
+                                 0,
+                                 0,
+                                 site->line,
+                                 static_cast<std::uint32_t>(site->format.size()),
+                                 static_cast<std::uint32_t>(site->file.size())};
+    std::byte* cursor = out + sizeof(RecordHeader);
+    std::memcpy(cursor, &site_header, sizeof(site_header));
+    cursor += sizeof(site_header);
+    if(!site->args.empty()) {
+      std::memcpy(cursor, site->args.data(), site->args.size());
+    }
+    cursor += site->args.size();
+    std::memcpy(cursor, site->format.data(), site->format.size());
+    cursor += site->format.size();
+    std::memcpy(cursor, site->file.data(), site->file.size());
+    const RecordHeader header{static_cast<std::uint32_t>(size),
+                              RecordType::Site,
+                              static_cast<std::uint16_t>(site->args.size()),
+                              id,
+                              0};
+    publish(out, header);
+  }
+
+  // Writes the header with its size last, as a release store: a reader of the
+  // mapping that sees a non-zero size also sees the payload written before it.
+  static void publish(std::byte* out, const RecordHeader& header) noexcept {
+    constexpr auto size_bytes = sizeof(header.size);
+    std::memcpy(out + size_bytes, reinterpret_cast<const std::byte*>(&header) + size_bytes, sizeof(header) - size_bytes);
+    std::atomic_ref<std::uint32_t>{*reinterpret_cast<std::uint32_t*>(out)}.store(header.size, std::memory_order_release);
+  }
+
+  int fd_;
+  std::byte* base_;
+  std::size_t capacity_;
+  std::unique_ptr<std::atomic<bool>[]> defined_;
+  alignas(64) std::atomic<std::size_t> cursor_{sizeof(FileHeader)};
+  alignas(64) std::atomic<std::uint64_t> dropped_{0};
+};
+
+}    // namespace detail
+
+}    // namespace trace_log
+
+struct TraceLogConfig {
+  std::size_t capacity_bytes{std::size_t{64} << 20};    // file size; records past it are dropped
+};
+
+// ============================================================================
+// TraceLog — owns the mapped file the DS_TRACE_* macros write into
+// ============================================================================
+//   auto trace = ds::TraceLog::create("/var/log/app.dstrace").value();
+//   trace.activate();
+//   DS_TRACE_INFO("stream {} fps {:.1f}", id, fps);    // ~tens of ns, no formatting
+//   ...
+//   trace.close();
+//
+// While no log is active the DS_TRACE_* macros format and go through
+// DebugLayer::log() like DS_INFO and friends. Level filtering
+// (DebugLayer::enabled, DS_MIN_LOG_LEVEL) applies either way.
+//
+// close() waits for DS_TRACE_* calls already writing into this log to finish
+// before it unmaps the file; calls that start after it fall back to
+// DebugLayer::log(). Each call counts itself in one of two slots picked by an
+// epoch, and close() flips the epoch before waiting for the old slot to empty,
+// so threads that keep tracing cannot hold it off.
+class TraceLog {
+public:
+  // The active log, held for the duration of one DS_TRACE_* call.
+  class ActiveWriter {
+  public:
+    ActiveWriter() noexcept {
+      if(active_.load(std::memory_order_relaxed) == nullptr) {
+        return;
+      }
+      // A close() that flipped the epoch between the load and the increment may
+      // already have seen this slot empty; count again under the new epoch.
+      for(;;) {
+        const auto epoch = epoch_.load(std::memory_order_seq_cst);
+        slot_ = &writers_[epoch & 1U];
+        slot_->fetch_add(1, std::memory_order_seq_cst);
+        if(epoch_.load(std::memory_order_seq_cst) == epoch) {
+          break;
+        }
+        slot_->fetch_sub(1, std::memory_order_release);
+      }
+      writer_ = active_.load(std::memory_order_seq_cst);
+    }
+
+    ~ActiveWriter() {
+      if(slot_ != nullptr) {
+        slot_->fetch_sub(1, std::memory_order_release);
+      }
+    }
+
+    ActiveWriter(const ActiveWriter&) = delete;
+    ActiveWriter& operator=(const ActiveWriter&) = delete;
+
+    explicit operator bool() const noexcept {
+      return writer_ != nullptr;
+    }
+    trace_log::detail::Writer* operator->() const noexcept {
+      return writer_;
+    }
+
+  private:
+    std::atomic<std::uint32_t>* slot_{nullptr};
+    trace_log::detail::Writer* writer_{nullptr};
+  };
+
+  [[nodiscard]] static nonstd::expected<TraceLog, Error> create(std::string_view path, TraceLogConfig config = {}) {
+    if(config.capacity_bytes < sizeof(trace_log::FileHeader) + 64) {
+      return nonstd::make_unexpected(Error{ErrorKind::InvalidArgument, "TraceLog capacity_bytes is too small"});
+    }
+    const std::string path_str{path};
+    const int fd = ::open(path_str.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(fd < 0) {
+      return nonstd::make_unexpected(trace_log::detail::io_error("Failed to create trace log", path));
+    }
+    if(::ftruncate(fd, static_cast<off_t>(config.capacity_bytes)) != 0) {
+      auto err = trace_log::detail::io_error("Failed to size trace log", path);
+      ::close(fd);
+      return nonstd::make_unexpected(std::move(err));
+    }
+    void* map = ::mmap(nullptr, config.capacity_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(map == MAP_FAILED) {
+      auto err = trace_log::detail::io_error("Failed to mmap trace log", path);
+      ::close(fd);
+      return nonstd::make_unexpected(std::move(err));
+    }
+
+    trace_log::FileHeader header{};
+    header.wall_start_ns =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    header.steady_start_ns = trace_log::detail::steady_ns();
+    std::memcpy(map, &header, sizeof(header));
+    return TraceLog{std::make_unique<trace_log::detail::Writer>(fd, static_cast<std::byte*>(map), config.capacity_bytes)};
+  }
+
+  TraceLog(TraceLog&&) noexcept = default;
+  TraceLog& operator=(TraceLog&& other) noexcept {
+    if(this != &other) {
+      (void)close();
+      writer_ = std::move(other.writer_);
+    }
+    return *this;
+  }
+  TraceLog(const TraceLog&) = delete;
+  TraceLog& operator=(const TraceLog&) = delete;
+
+  ~TraceLog() {
+    (void)close();
+  }
+
+  // Route DS_TRACE_* to this log. Replaces any other active log.
+  void activate() noexcept {
+    if(writer_) {
+      active_.store(writer_.get(), std::memory_order_seq_cst);
+    }
+  }
+
+  void deactivate() noexcept {
+    auto* expected = writer_.get();
+    active_.compare_exchange_strong(expected, nullptr, std::memory_order_seq_cst);
+  }
+
+  // Deactivates, waits for in-flight DS_TRACE_* calls, unmaps and truncates
+  // the file to the bytes written.
+  nonstd::expected<void, Error> close() {
+    if(!writer_) {
+      return {};
+    }
+    deactivate();
+    wait_for_writers();
+    const auto used = writer_->bytes_used();
+    const int fd = writer_->fd();
+    ::munmap(writer_->base(), writer_->capacity());
+    writer_.reset();
+    const bool ok = ::ftruncate(fd, static_cast<off_t>(used)) == 0;
+    ::close(fd);
+    if(!ok) {
+      return nonstd::make_unexpected(
+          Error{ErrorKind::FileIO, fmt::format("Failed to truncate trace log: {}", std::strerror(errno))});
+    }
+    return {};
+  }
+
+  // Records that did not fit in the file.
+  [[nodiscard]] std::uint64_t dropped() const noexcept {
+    return writer_ ? writer_->dropped() : 0;
+  }
+  [[nodiscard]] std::size_t bytes_used() const noexcept {
+    return writer_ ? writer_->bytes_used() : 0;
+  }
+
+  // The active log's writer, or nullptr. Only safe to write through while an
+  // ActiveWriter is held; the DS_TRACE_* macros do that.
+  [[nodiscard]] static trace_log::detail::Writer* active() noexcept {
+    return active_.load(std::memory_order_acquire);
+  }
+
+  // Called once per call site by the DS_TRACE_* macros.
+  [[nodiscard]] static std::uint32_t register_site(DebugLevel level,
+                                                   std::string_view format,
+                                                   std::string_view file,
+                                                   int line,
+                                                   std::span<const trace_log::ArgType> args) {
+    return trace_log::detail::SiteRegistry::add(trace_log::Site{level, format, file, line, args});
+  }
+
+private:
+  explicit TraceLog(std::unique_ptr<trace_log::detail::Writer> writer) : writer_(std::move(writer)) {}
+
+  // An ActiveWriter only keeps its count once it has re-read the epoch it
+  // counted under unchanged, so every call that can still hold the log was
+  // counted in the slot of the epoch being flipped away from here: either it
+  // is seen below, or it re-reads the new epoch and retries, loading active_
+  // after the deactivate() that preceded the flip. Calls from earlier epochs
+  // were drained by the close() that flipped past them, hence the lock.
+  static void wait_for_writers() {
+    std::lock_guard lk{epoch_mutex_};
+    const auto old = epoch_.fetch_add(1, std::memory_order_seq_cst) & 1U;
+    while(writers_[old].load(std::memory_order_seq_cst) != 0) {
+      std::this_thread::yield();
+    }
+  }
+
+  static inline std::atomic<trace_log::detail::Writer*> active_{nullptr};
+  static inline std::atomic<std::uint32_t> epoch_{0};
+  static inline std::array<std::atomic<std::uint32_t>, 2> writers_{};    // ActiveWriters per epoch parity
+  static inline std::mutex epoch_mutex_;                                 // serialises wait_for_writers()
+
+  std::unique_ptr<trace_log::detail::Writer> writer_;
+};
+
+// One decoded DS_TRACE_* call.
+struct TraceEvent {
+  std::int64_t wall_ns{0};    // system_clock, reconstructed from the file header
+  DebugLevel level{DebugLevel::Debug};
+  std::string_view file;
+  int line{0};
+  std::string message;
+};
+
+// ============================================================================
+// TraceLogReader — loads a trace log and renders its events
+// ============================================================================
+//   auto trace = ds::TraceLogReader::open("/var/log/app.dstrace").value();
+//   for(std::size_t i = 0; i < trace.size(); ++i) {
+//     const auto event = trace.event(i);
+//     fmt::print("{} {}:{} {}\n", ds::debug_level_str(event.level), event.file, event.line, event.message);
+//   }
+class TraceLogReader {
+public:
+  [[nodiscard]] static nonstd::expected<TraceLogReader, Error> open(std::string_view path) {
+    const std::string path_str{path};
+    const int fd = ::open(path_str.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0) {
+      return nonstd::make_unexpected(trace_log::detail::io_error("Failed to open trace log", path));
+    }
+    struct stat st{};
+    if(::fstat(fd, &st) != 0) {
+      auto err = trace_log::detail::io_error("Failed to stat trace log", path);
+      ::close(fd);
+      return nonstd::make_unexpected(std::move(err));
+    }
+    std::vector<std::byte> data(static_cast<std::size_t>(st.st_size));
+    std::size_t done = 0;
+    while(done < data.size()) {
+      const ssize_t n = ::read(fd, data.data() + done, data.size() - done);
+      if(n < 0 && errno == EINTR) {
+        continue;
+      }
+      if(n <= 0) {
+        auto err = trace_log::detail::io_error("Failed to read trace log", path);
+        ::close(fd);
+        return nonstd::make_unexpected(std::move(err));
+      }
+      done += static_cast<std::size_t>(n);
+    }
+    ::close(fd);
+
+    trace_log::FileHeader header{};
+    if(data.size() < sizeof(header)) {
+      return nonstd::make_unexpected(Error{ErrorKind::FileFormat, fmt::format("'{}' is too small to be a trace log", path)});
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+    if(header.magic != trace_log::file_magic || header.version != trace_log::format_version) {
+      return nonstd::make_unexpected(
+          Error{ErrorKind::FileFormat, fmt::format("'{}' is not a version {} trace log", path, trace_log::format_version)});
+    }
+    TraceLogReader reader{std::move(data), header};
+    reader.scan();
+    return reader;
+  }
+
+  // Number of events, in file order (per thread this is call order).
+  [[nodiscard]] std::size_t size() const noexcept {
+    return events_.size();
+  }
+  [[nodiscard]] bool empty() const noexcept {
+    return events_.empty();
+  }
+
+  // Renders event `index`. An event whose site is missing or whose arguments
+  // do not match its format string still decodes, with a diagnostic message.
+  [[nodiscard]] TraceEvent event(std::size_t index) const {
+    const std::byte* record = data_.data() + events_[index];
+    trace_log::RecordHeader header{};
+    std::memcpy(&header, record, sizeof(header));
+    std::int64_t steady = 0;
+    std::memcpy(&steady, record + sizeof(header), sizeof(steady));
+
+    TraceEvent event;
+    event.wall_ns = header_.wall_start_ns + (steady - header_.steady_start_ns);
+    const SiteInfo* site = header.site < sites_.size() && sites_[header.site].defined ? &sites_[header.site] : nullptr;
+    if(site == nullptr || site->args.size() != header.arg_count) {
+      event.message = fmt::format("<trace site {} not found>", header.site);
+      return event;
+    }
+    event.level = site->level;
+    event.file = site->file;
+    event.line = site->line;
+
+    fmt::dynamic_format_arg_store<fmt::format_context> store;
+    const std::byte* cursor = record + sizeof(header) + sizeof(steady);
+    const std::byte* end = record + header.size;
+    for(const auto type : site->args) {
+      if(!decode_arg(type, cursor, end, store)) {
+        event.message = fmt::format("<truncated arguments for {}:{}>", site->file, site->line);
+        return event;
+      }
+    }
+    try {
+      event.message = fmt::vformat(site->format, store);
+    } catch(const fmt::format_error& e) {
+      event.message = fmt::format("<format error '{}' in \"{}\">", e.what(), site->format);
+    }
+    return event;
+  }
+
+private:
+  struct SiteInfo {
+    bool defined{false};
+    DebugLevel level{DebugLevel::Debug};
+    int line{0};
+    std::string_view format;
+    std::string_view file;
+    std::vector<trace_log::ArgType> args;
+  };
+
+  TraceLogReader(std::vector<std::byte> data, const trace_log::FileHeader& header) : data_(std::move(data)), header_(header) {}
+
+  // One pass over the records: sites go into the table, events are indexed.
+  void scan() {
+    std::size_t offset = sizeof(trace_log::FileHeader);
+    while(offset + sizeof(trace_log::RecordHeader) <= data_.size()) {
+      trace_log::RecordHeader header{};
+      std::memcpy(&header, data_.data() + offset, sizeof(header));
+      if(header.size < sizeof(header) || offset + header.size > data_.size()) {
+        break;
+      }
+      if(header.type == trace_log::RecordType::Event && header.size >= sizeof(header) + sizeof(std::int64_t)) {
+        events_.push_back(offset);
+      } else if(header.type == trace_log::RecordType::Site) {
+        load_site(offset, header);
+      }
+      offset += header.size;
+    }
+  }
+
+  void load_site(std::size_t offset, const trace_log::RecordHeader& header) {
+    trace_log::SiteHeader site_header{};
+    if(header.size < sizeof(header) + sizeof(site_header)) {
+      return;
+    }
+    const auto* payload = data_.data() + offset + sizeof(header);
+    std::memcpy(&site_header, payload, sizeof(site_header));
+    const std::size_t needed =
+        sizeof(header) + sizeof(site_header) + header.arg_count + site_header.format_size + site_header.file_size;
+    if(needed > header.size) {
+      return;
+    }
+    if(header.site >= trace_log::max_sites) {
+      return;    // corrupt: register_site() never hands out such an id
+    }
+    if(header.site >= sites_.size()) {
+      sites_.resize(static_cast<std::size_t>(header.site) + 1);
+    }
+    auto& site = sites_[header.site];
+    const auto* cursor = payload + sizeof(site_header);
+    site.args.resize(header.arg_count);
+    if(header.arg_count != 0) {
+      std::memcpy(site.args.data(), cursor, header.arg_count);
+    }
+    cursor += header.arg_count;
+    site.format = {reinterpret_cast<const char*>(cursor), site_header.format_size};
+    cursor += site_header.format_size;
+    site.file = {reinterpret_cast<const char*>(cursor), site_header.file_size};
+    site.level = static_cast<DebugLevel>(site_header.level);
+    site.line = site_header.line;
+    site.defined = true;
+  }
+
+  static bool decode_arg(trace_log::ArgType type,
+                         const std::byte*& cursor,
+                         const std::byte* end,
+                         fmt::dynamic_format_arg_store<fmt::format_context>& store) {
+    if(type == trace_log::ArgType::String) {
+      std::uint32_t size = 0;
+      if(end - cursor < static_cast<std::ptrdiff_t>(sizeof(size))) {
+        return false;
+      }
+      std::memcpy(&size, cursor, sizeof(size));
+      cursor += sizeof(size);
+      if(end - cursor < static_cast<std::ptrdiff_t>(size)) {
+        return false;
+      }
+      store.push_back(std::string{reinterpret_cast<const char*>(cursor), size});
+      cursor += size;
+      return true;
+    }
+    if(end - cursor < 8) {
+      return false;
+    }
+    switch(type) {
+    case trace_log::ArgType::Int: {
+      std::int64_t v = 0;
+      std::memcpy(&v, cursor, 8);
+      store.push_back(v);
+      break;
+    }
+    case trace_log::ArgType::UInt: {
+      std::uint64_t v = 0;
+      std::memcpy(&v, cursor, 8);
+      store.push_back(v);
+      break;
+    }
+    case trace_log::ArgType::Double: {
+      double v = 0;
+      std::memcpy(&v, cursor, 8);
+      store.push_back(v);
+      break;
+    }
+    case trace_log::ArgType::Bool: {
+      std::uint64_t v = 0;
+      std::memcpy(&v, cursor, 8);
+      store.push_back(v != 0);
+      break;
+    }
+    case trace_log::ArgType::String:
+      break;
+    }
+    cursor += 8;
+    return true;
+  }
+
+  std::vector<std::byte> data_;
+  trace_log::FileHeader header_;
+  std::vector<SiteInfo> sites_;
+  std::vector<std::size_t> events_;
+};
+
+}    // namespace ds
+
+// ============================================================================
+// Trace macros
+// ============================================================================
+// Same shape as DS_DEBUG and friends, but the format must be a string literal
+// and the arguments must satisfy ds::trace_log::TraceArg. With an active
+// TraceLog the call records raw arguments; otherwise it formats and logs.
+//   DS_TRACE_WARN("pad {} dropped {} buffers", name, count);
+
+// NOLINTBEGIN(cppcoreguidelines-macro-usage)
+#define DS_TRACE_AT_(level, format_str, ...)                                                                                     \
+  do {                                                                                                                           \
+    if constexpr(static_cast<int>(level) >= DS_MIN_LOG_LEVEL) {                                                                  \
+      if(::ds::DebugLayer::enabled(level)) {                                                                                     \
+        if(const ::ds::TraceLog::ActiveWriter ds_trace_{}; ds_trace_) {                                                          \
+          using ds_args_ = decltype(::ds::trace_log::detail::arg_types_of(__VA_ARGS__));                                         \
+          static const std::uint32_t ds_site_ =                                                                                  \
+              ::ds::TraceLog::register_site(level, "" format_str, __FILE__, __LINE__, ds_args_::types);                          \
+          ds_trace_->write(ds_site_ __VA_OPT__(, ) __VA_ARGS__);                                                                 \
+        } else {                                                                                                                 \
+          ::ds::DebugLayer::instance().log(                                                                                      \
+              level, ::ds::ErrorKind::Unknown, fmt::format(format_str __VA_OPT__(, ) __VA_ARGS__), __FILE__, __LINE__);          \
+        }                                                                                                                        \
+      }                                                                                                                          \
+    }                                                                                                                            \
+  } while(false)
+
+#define DS_TRACE_DEBUG(format_str, ...) DS_TRACE_AT_(::ds::DebugLevel::Debug, format_str __VA_OPT__(, ) __VA_ARGS__)
+#define DS_TRACE_INFO(format_str, ...) DS_TRACE_AT_(::ds::DebugLevel::Info, format_str __VA_OPT__(, ) __VA_ARGS__)
+#define DS_TRACE_WARN(format_str, ...) DS_TRACE_AT_(::ds::DebugLevel::Warn, format_str __VA_OPT__(, ) __VA_ARGS__)
+#define DS_TRACE_ERROR(format_str, ...) DS_TRACE_AT_(::ds::DebugLevel::Error, format_str __VA_OPT__(, ) __VA_ARGS__)
+// NOLINTEND(cppcoreguidelines-macro-usage)
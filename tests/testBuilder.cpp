@@ -180,6 +180,44 @@ TEST(BuilderTest, PipelineResultOwnsElements) {
   }
 }
 
+// ============================================================================
+// DebugLayer statistics
+// ============================================================================
+
+TEST(BuilderTest, FailedBuildIsCounted) {
+  auto& layer = ds::DebugLayer::instance();
+  const auto before = layer.snapshot().count(ds::DebugLevel::Error, ds::ErrorKind::NoElements);
+  EXPECT_FALSE(ds::Builder{}.build().has_value());
+  EXPECT_EQ(layer.snapshot().count(ds::DebugLevel::Error, ds::ErrorKind::NoElements), before + 1);
+}
+
+TEST(BuilderTest, BuildPhasesAreTimedWhenEnabled) {
+  auto& layer = ds::DebugLayer::instance();
+  layer.reset_stats();
+  ASSERT_TRUE(ds::Builder{}.add(make_raw("fakesrc")).add(make_raw("fakesink")).build().has_value());
+  EXPECT_EQ(layer.snapshot().timing(ds::TimedOp::Build).count, 0u);
+
+  ds::DebugLayer::set_timing_enabled(true);
+  auto result = ds::Builder{}.add(make_raw("fakesrc")).add(make_raw("fakesink")).build();
+  ASSERT_TRUE(result.has_value());
+  ASSERT_TRUE(ds::set_state(result->get(), GST_STATE_NULL).has_value());
+  ds::DebugLayer::set_timing_enabled(false);
+
+  const auto stats = layer.snapshot();
+  EXPECT_EQ(stats.timing(ds::TimedOp::Build).count, 1u);
+  EXPECT_EQ(stats.timing(ds::TimedOp::BuildValidate).count, 1u);
+  EXPECT_EQ(stats.timing(ds::TimedOp::BuildAdd).count, 1u);
+  EXPECT_EQ(stats.timing(ds::TimedOp::BuildLink).count, 1u);
+  EXPECT_EQ(stats.timing(ds::TimedOp::StateChange).count, 1u);
+  EXPECT_GE(stats.timing(ds::TimedOp::Build).max_ns, stats.timing(ds::TimedOp::BuildLink).max_ns);
+}
+
+TEST(BuilderTest, SetStateRejectsNull) {
+  auto result = ds::set_state(nullptr, GST_STATE_PLAYING);
+  ASSERT_FALSE(result.has_value());
+  EXPECT_EQ(result.error().kind, ds::ErrorKind::InvalidArgument);
+}
+
 }    // namespace
 
 int main(int argc, char** argv) {
@@ -1,5 +1,11 @@
+#include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <gst/gst.h>
@@ -9,6 +15,8 @@
 #include <gstreamer_raii.hpp>
 #include <utils/debug.hpp>
 #include <utils/error.hpp>
+#include <utils/gst_debug_bridge.hpp>
+#include <utils/trace_log.hpp>
 
 // ============================================================================
 // Fixture — resets DebugLayer state between tests
@@ -22,6 +30,8 @@ protected:
   }
 
   void TearDown() override {
+    ds::DebugLayer::instance().stop_async();
+    ds::DebugLayer::instance().set_suppressed_report_interval(std::chrono::milliseconds{0});
     ds::DebugLayer::instance().clear_callback();
     ds::DebugLayer::instance().set_min_level(ds::DebugLevel::Debug);
   }
@@ -128,6 +138,613 @@ TEST_F(DebugLayerTest, MinLevelQueryMatchesSetter) {
   EXPECT_EQ(ds::DebugLayer::instance().min_level(), ds::DebugLevel::Warn);
 }
 
+TEST_F(DebugLayerTest, EnabledTracksMinLevel) {
+  ds::DebugLayer::instance().set_min_level(ds::DebugLevel::Info);
+  EXPECT_FALSE(ds::DebugLayer::enabled(ds::DebugLevel::Debug));
+  EXPECT_TRUE(ds::DebugLayer::enabled(ds::DebugLevel::Info));
+  EXPECT_TRUE(ds::DebugLayer::enabled(ds::DebugLevel::Error));
+}
+
+TEST_F(DebugLayerTest, FilteredMacroDoesNotEvaluateArguments) {
+  int evaluated = 0;
+  const auto arg = [&evaluated] { return ++evaluated; };
+  ds::DebugLayer::instance().set_min_level(ds::DebugLevel::Warn);
+
+  DS_DEBUG("value {}", arg());
+  DS_INFO("value {}", arg());
+  EXPECT_EQ(evaluated, 0);
+
+  DS_WARN("value {}", arg());
+  EXPECT_EQ(evaluated, 1);
+}
+
+// ============================================================================
+// Rate-limited macros
+// ============================================================================
+
+TEST_F(DebugLayerTest, EveryNEmitsOneInNWithSuppressedCount) {
+  std::vector<std::string> received;
+  ds::DebugLayer::instance().set_callback([&received](const ds::DebugMessage& m) { received.push_back(m.message); });
+
+  for(int i = 0; i < 10; ++i) {
+    DS_WARN_EVERY_N(4, "late frame {}", i);
+  }
+
+  ASSERT_EQ(received.size(), 3u);
+  EXPECT_EQ(received[0], "late frame 0");
+  EXPECT_EQ(received[1], "late frame 4 [suppressed 3 similar messages]");
+  EXPECT_EQ(received[2], "late frame 8 [suppressed 3 similar messages]");
+}
+
+TEST_F(DebugLayerTest, FirstNStopsAfterN) {
+  int count = 0;
+  ds::DebugLayer::instance().set_callback([&count](const ds::DebugMessage&) { ++count; });
+
+  for(int i = 0; i < 10; ++i) {
+    DS_LOG_FIRST_N(Info, 2, "caps {}", i);
+  }
+
+  EXPECT_EQ(count, 2);
+}
+
+TEST_F(DebugLayerTest, RateCapsMessagesPerSecond) {
+  int count = 0;
+  ds::DebugLayer::instance().set_callback([&count](const ds::DebugMessage&) { ++count; });
+
+  for(int i = 0; i < 100; ++i) {
+    DS_WARN_RATE(5, "decode error {}", i);
+  }
+
+  EXPECT_EQ(count, 5);
+}
+
+TEST_F(DebugLayerTest, ReportSuppressedSummarisesQuietSites) {
+  std::vector<ds::DebugMessage> received;
+  ds::DebugLayer::instance().set_callback([&received](const ds::DebugMessage& m) { received.push_back(m); });
+
+  for(int i = 0; i < 12'305; ++i) {
+    DS_LOG_EVERY_N(Error, 1'000'000, "camera {} misbehaving", 3);
+  }
+  ASSERT_EQ(received.size(), 1u);
+
+  EXPECT_GE(ds::DebugLayer::instance().report_suppressed(), 12'304u);
+  const auto it = std::find_if(received.begin(), received.end(), [](const ds::DebugMessage& m) {
+    return m.message == "suppressed 12,304 similar messages";
+  });
+  ASSERT_NE(it, received.end());
+  EXPECT_EQ(it->level, ds::DebugLevel::Error);
+  EXPECT_EQ(it->line, received.front().line);
+
+  received.clear();
+  ds::DebugLayer::instance().report_suppressed();
+  EXPECT_TRUE(std::none_of(received.begin(), received.end(), [](const ds::DebugMessage& m) {
+    return m.message.find("12,304") != std::string::npos;
+  }));
+}
+
+TEST_F(DebugLayerTest, FilteredLimiterDoesNotCount) {
+  int count = 0;
+  ds::DebugLayer::instance().set_callback([&count](const ds::DebugMessage&) { ++count; });
+  ds::DebugLayer::instance().set_min_level(ds::DebugLevel::Error);
+  const auto emit = [] { DS_WARN_EVERY_N(3, "filtered"); };
+
+  emit();
+  emit();
+  ds::DebugLayer::instance().set_min_level(ds::DebugLevel::Debug);
+  emit();
+
+  EXPECT_EQ(count, 1);
+}
+
+// ============================================================================
+// Asynchronous delivery
+// ============================================================================
+
+TEST_F(DebugLayerTest, AsyncDeliversFromManyThreads) {
+  std::mutex received_mutex;
+  std::vector<ds::DebugMessage> received;
+  auto& layer = ds::DebugLayer::instance();
+  layer.set_callback([&](const ds::DebugMessage& m) {
+    std::lock_guard lk{received_mutex};
+    received.push_back(m);
+  });
+  const auto dropped_before = layer.dropped();
+  ASSERT_TRUE(layer.start_async(1 << 14).has_value());
+  EXPECT_TRUE(layer.is_async());
+
+  constexpr int threads = 8;
+  constexpr int per_thread = 500;
+  std::vector<std::thread> workers;
+  for(int t = 0; t < threads; ++t) {
+    workers.emplace_back([t] {
+      for(int i = 0; i < per_thread; ++i) {
+        DS_WARN("thread {} message {}", t, i);
+      }
+    });
+  }
+  for(auto& w : workers) {
+    w.join();
+  }
+  layer.flush();
+
+  std::lock_guard lk{received_mutex};
+  EXPECT_EQ(received.size() + (layer.dropped() - dropped_before), static_cast<std::size_t>(threads * per_thread));
+  ASSERT_FALSE(received.empty());
+  EXPECT_EQ(received.front().level, ds::DebugLevel::Warn);
+  EXPECT_NE(received.front().file.find("testDebug.cpp"), std::string::npos);
+}
+
+TEST_F(DebugLayerTest, AsyncDropsWhenRingIsFull) {
+  auto& layer = ds::DebugLayer::instance();
+  std::atomic<bool> entered{false};
+  std::atomic<bool> release{false};
+  std::atomic<int> count{0};
+  layer.set_callback([&](const ds::DebugMessage&) {
+    entered = true;
+    entered.notify_all();
+    release.wait(false);
+    ++count;
+  });
+  const auto dropped_before = layer.dropped();
+  ASSERT_TRUE(layer.start_async(2).has_value());
+
+  DS_ERROR("blocks the consumer");
+  entered.wait(false);
+  for(int i = 0; i < 10; ++i) {
+    DS_ERROR("burst {}", i);
+  }
+  EXPECT_EQ(layer.dropped() - dropped_before, 8u);
+
+  release = true;
+  release.notify_all();
+  layer.flush();
+  EXPECT_EQ(count.load(), 3);
+}
+
+TEST_F(DebugLayerTest, AsyncTruncatesLongMessages) {
+  std::string text;
+  ds::DebugLayer::instance().set_callback([&text](const ds::DebugMessage& m) { text = m.message; });
+  ASSERT_TRUE(ds::DebugLayer::instance().start_async().has_value());
+
+  DS_INFO("{}", std::string(2000, 'x'));
+  ds::DebugLayer::instance().flush();
+
+  EXPECT_LT(text.size(), 2000u);
+  EXPECT_TRUE(text.ends_with("..."));
+}
+
+TEST_F(DebugLayerTest, StopAsyncReturnsToSynchronousDelivery) {
+  int count = 0;
+  ds::DebugLayer::instance().set_callback([&count](const ds::DebugMessage&) { ++count; });
+  ASSERT_TRUE(ds::DebugLayer::instance().start_async().has_value());
+  DS_INFO("queued");
+  ds::DebugLayer::instance().stop_async();
+  EXPECT_FALSE(ds::DebugLayer::instance().is_async());
+  EXPECT_EQ(count, 1);
+
+  DS_INFO("direct");
+  EXPECT_EQ(count, 2);
+}
+
+TEST_F(DebugLayerTest, RestartingAsyncLosesNothing) {
+  std::atomic<std::uint64_t> received{0};
+  auto& layer = ds::DebugLayer::instance();
+  layer.set_callback([&received](const ds::DebugMessage&) { received.fetch_add(1, std::memory_order_relaxed); });
+  const auto dropped_before = layer.dropped();
+
+  constexpr int threads = 4;
+  constexpr int per_thread = 20'000;
+  std::atomic<bool> go{false};
+  std::vector<std::thread> workers;
+  for(int t = 0; t < threads; ++t) {
+    workers.emplace_back([&go] {
+      go.wait(false);
+      for(int i = 0; i < per_thread; ++i) {
+        DS_WARN("message {}", i);
+      }
+    });
+  }
+  go = true;
+  go.notify_all();
+  for(int round = 0; round < 50; ++round) {
+    ASSERT_TRUE(layer.start_async(64).has_value());
+    std::this_thread::sleep_for(std::chrono::microseconds{200});
+    layer.stop_async();
+  }
+  for(auto& w : workers) {
+    w.join();
+  }
+  layer.stop_async();
+
+  EXPECT_EQ(received.load() + (layer.dropped() - dropped_before), std::uint64_t{threads} * per_thread);
+}
+
+TEST_F(DebugLayerTest, AsyncConsumerReportsSuppressedPeriodically) {
+  std::mutex received_mutex;
+  std::vector<std::string> received;
+  auto& layer = ds::DebugLayer::instance();
+  layer.set_callback([&](const ds::DebugMessage& m) {
+    std::lock_guard lk{received_mutex};
+    received.push_back(m.message);
+  });
+  layer.set_suppressed_report_interval(std::chrono::milliseconds{1});
+  ASSERT_TRUE(layer.start_async().has_value());
+
+  for(int i = 0; i < 5; ++i) {
+    DS_WARN_EVERY_N(1'000'000, "stalled");
+  }
+
+  bool reported = false;
+  for(int attempt = 0; attempt < 200 && !reported; ++attempt) {
+    std::this_thread::sleep_for(std::chrono::milliseconds{5});
+    layer.flush();
+    std::lock_guard lk{received_mutex};
+    reported = std::find(received.begin(), received.end(), "suppressed 4 similar messages") != received.end();
+  }
+  EXPECT_TRUE(reported);
+}
+
+// ============================================================================
+// Statistics
+// ============================================================================
+
+TEST_F(DebugLayerTest, CountersTrackLevelAndKindEvenWhenFiltered) {
+  auto& layer = ds::DebugLayer::instance();
+  layer.reset_stats();
+  layer.set_min_level(ds::DebugLevel::Off);
+  layer.log(ds::DebugLevel::Error, ds::ErrorKind::ElementLink, "link failed", __FILE__, __LINE__);
+  layer.log(ds::DebugLevel::Error, ds::ErrorKind::ElementLink, "link failed", __FILE__, __LINE__);
+  layer.log(ds::DebugLevel::Warn, ds::ErrorKind::ElementLink, "slow link", __FILE__, __LINE__);
+  layer.log(ds::DebugLevel::Info, ds::ErrorKind::Unknown, "hello", __FILE__, __LINE__);
+
+  const auto stats = layer.snapshot();
+  EXPECT_EQ(stats.count(ds::DebugLevel::Error, ds::ErrorKind::ElementLink), 2u);
+  EXPECT_EQ(stats.count(ds::ErrorKind::ElementLink), 3u);
+  EXPECT_EQ(stats.count(ds::DebugLevel::Info), 1u);
+  EXPECT_EQ(stats.count(ds::DebugLevel::Error, ds::ErrorKind::FileIO), 0u);
+
+  layer.reset_stats();
+  EXPECT_EQ(layer.snapshot().count(ds::ErrorKind::ElementLink), 0u);
+}
+
+TEST_F(DebugLayerTest, CountersAreExactUnderContention) {
+  auto& layer = ds::DebugLayer::instance();
+  layer.reset_stats();
+  layer.set_min_level(ds::DebugLevel::Off);
+  constexpr int threads = 4;
+  constexpr int per_thread = 2000;
+  std::vector<std::thread> workers;
+  for(int t = 0; t < threads; ++t) {
+    workers.emplace_back([&layer] {
+      for(int i = 0; i < per_thread; ++i) {
+        layer.log(ds::DebugLevel::Warn, ds::ErrorKind::Decode, "corrupt", __FILE__, __LINE__);
+      }
+    });
+  }
+  for(auto& w : workers) {
+    w.join();
+  }
+  const auto expected = static_cast<std::uint64_t>(threads * per_thread);
+  EXPECT_EQ(layer.snapshot().count(ds::DebugLevel::Warn, ds::ErrorKind::Decode), expected);
+}
+
+TEST_F(DebugLayerTest, HistogramPercentilesAreWithinABucket) {
+  auto& layer = ds::DebugLayer::instance();
+  layer.reset_stats();
+  for(int i = 1; i <= 100; ++i) {
+    layer.record_timing(ds::TimedOp::StateChange, std::chrono::microseconds{i});
+  }
+  const auto stats = layer.snapshot();
+  const auto& h = stats.timing(ds::TimedOp::StateChange);
+  EXPECT_EQ(h.count, 100u);
+  EXPECT_EQ(h.max_ns, 100'000u);
+  EXPECT_EQ(h.mean(), std::chrono::nanoseconds{50'500});
+  const auto p50 = h.percentile(0.5);
+  EXPECT_GE(p50, std::chrono::microseconds{50});
+  EXPECT_LT(p50, std::chrono::microseconds{100});
+  EXPECT_EQ(h.percentile(0.99), std::chrono::microseconds{100});
+  EXPECT_EQ(ds::LatencyHistogram{}.percentile(0.99), std::chrono::nanoseconds{0});
+}
+
+TEST_F(DebugLayerTest, ScopedTimingRecordsOnlyWhenEnabled) {
+  auto& layer = ds::DebugLayer::instance();
+  layer.reset_stats();
+  {
+    ds::ScopedTiming timing{ds::TimedOp::Build};
+  }
+  EXPECT_EQ(layer.snapshot().timing(ds::TimedOp::Build).count, 0u);
+
+  ds::DebugLayer::set_timing_enabled(true);
+  {
+    ds::ScopedTiming timing{ds::TimedOp::Build};
+    timing.stop();
+    timing.stop();
+  }
+  ds::DebugLayer::set_timing_enabled(false);
+  EXPECT_EQ(layer.snapshot().timing(ds::TimedOp::Build).count, 1u);
+  EXPECT_EQ(ds::timed_op_str(ds::TimedOp::BuildLink), "build.link");
+}
+
+// ============================================================================
+// Trace log
+// ============================================================================
+
+namespace {
+
+std::string trace_path(std::string_view name) {
+  return ::testing::TempDir() + std::string{name} + ".dstrace";
+}
+
+}    // namespace
+
+TEST_F(DebugLayerTest, TraceLogRoundTripsEvents) {
+  const auto path = trace_path("round_trip");
+  {
+    auto trace = ds::TraceLog::create(path);
+    ASSERT_TRUE(trace.has_value()) << trace.error().message;
+    trace->activate();
+    const std::string name = "cam-0";
+    for(int i = 0; i < 3; ++i) {
+      DS_TRACE_INFO("source {} frame {} fps {:.1f} live {}", name, i, 29.97, true);
+    }
+    DS_TRACE_WARN("no arguments");
+    DS_TRACE_ERROR("negative {} unsigned {}", -5, 7u);
+    ASSERT_TRUE(trace->close().has_value());
+  }
+
+  auto reader = ds::TraceLogReader::open(path);
+  ASSERT_TRUE(reader.has_value()) << reader.error().message;
+  ASSERT_EQ(reader->size(), 5u);
+  const auto first = reader->event(0);
+  EXPECT_EQ(first.level, ds::DebugLevel::Info);
+  EXPECT_EQ(first.message, "source cam-0 frame 0 fps 30.0 live true");
+  EXPECT_EQ(first.file, __FILE__);
+  EXPECT_EQ(reader->event(2).message, "source cam-0 frame 2 fps 30.0 live true");
+  EXPECT_EQ(reader->event(3).level, ds::DebugLevel::Warn);
+  EXPECT_EQ(reader->event(3).message, "no arguments");
+  EXPECT_EQ(reader->event(4).message, "negative -5 unsigned 7");
+  EXPECT_LE(reader->event(0).wall_ns, reader->event(4).wall_ns);
+  std::remove(path.c_str());
+}
+
+TEST_F(DebugLayerTest, TraceLogDropsWhenFull) {
+  const auto path = trace_path("full");
+  auto trace = ds::TraceLog::create(path, {.capacity_bytes = 256});
+  ASSERT_TRUE(trace.has_value());
+  trace->activate();
+  for(int i = 0; i < 100; ++i) {
+    DS_TRACE_INFO("frame {}", i);
+  }
+  EXPECT_GT(trace->dropped(), 0u);
+  EXPECT_LE(trace->bytes_used(), 256u);
+  ASSERT_TRUE(trace->close().has_value());
+
+  auto reader = ds::TraceLogReader::open(path);
+  ASSERT_TRUE(reader.has_value());
+  ASSERT_FALSE(reader->empty());
+  EXPECT_EQ(reader->event(0).message, "frame 0");
+  std::remove(path.c_str());
+}
+
+TEST_F(DebugLayerTest, TraceLogAcceptsConcurrentWriters) {
+  const auto path = trace_path("concurrent");
+  auto trace = ds::TraceLog::create(path);
+  ASSERT_TRUE(trace.has_value());
+  trace->activate();
+
+  constexpr int threads = 4;
+  constexpr int per_thread = 500;
+  std::vector<std::thread> workers;
+  for(int t = 0; t < threads; ++t) {
+    workers.emplace_back([t] {
+      for(int i = 0; i < per_thread; ++i) {
+        DS_TRACE_WARN("thread {} message {}", t, i);
+      }
+    });
+  }
+  for(auto& w : workers) {
+    w.join();
+  }
+  EXPECT_EQ(trace->dropped(), 0u);
+  ASSERT_TRUE(trace->close().has_value());
+
+  auto reader = ds::TraceLogReader::open(path);
+  ASSERT_TRUE(reader.has_value());
+  EXPECT_EQ(reader->size(), static_cast<std::size_t>(threads * per_thread));
+  EXPECT_TRUE(reader->event(0).message.starts_with("thread "));
+  std::remove(path.c_str());
+}
+
+TEST_F(DebugLayerTest, TraceLogCloseWaitsForWriters) {
+  const auto path = trace_path("close_race");
+  std::atomic<int> delivered{0};
+  ds::DebugLayer::instance().set_callback([&delivered](const ds::DebugMessage&) { ++delivered; });
+  auto trace = ds::TraceLog::create(path);
+  ASSERT_TRUE(trace.has_value());
+  trace->activate();
+
+  constexpr int threads = 4;
+  constexpr int per_thread = 100'000;
+  std::vector<std::thread> workers;
+  for(int t = 0; t < threads; ++t) {
+    workers.emplace_back([t] {
+      for(int i = 0; i < per_thread; ++i) {
+        DS_TRACE_WARN("thread {} message {}", t, i);
+      }
+    });
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds{1});
+  ASSERT_TRUE(trace->close().has_value());    // writers are still running
+  for(auto& w : workers) {
+    w.join();
+  }
+
+  auto reader = ds::TraceLogReader::open(path);
+  ASSERT_TRUE(reader.has_value());
+  EXPECT_EQ(reader->size() + static_cast<std::size_t>(delivered.load()), static_cast<std::size_t>(threads * per_thread));
+  std::remove(path.c_str());
+}
+
+// Back-to-back logs: a writer that counted itself just as one close() flipped
+// the epoch must still hold off the close() of the next log.
+TEST_F(DebugLayerTest, TraceLogCloseWaitsForWritersAcrossLogs) {
+  ds::DebugLayer::instance().set_callback([](const ds::DebugMessage&) {});
+  std::atomic<bool> stop{false};
+  std::vector<std::thread> workers;
+  for(int t = 0; t < 4; ++t) {
+    workers.emplace_back([&stop, t] {
+      for(int i = 0; !stop.load(std::memory_order_relaxed); ++i) {
+        DS_TRACE_WARN("thread {} message {}", t, i);
+      }
+    });
+  }
+  for(int round = 0; round < 50; ++round) {
+    const auto path = trace_path("close_reopen");
+    auto trace = ds::TraceLog::create(path, {.capacity_bytes = 4096});
+    ASSERT_TRUE(trace.has_value());
+    trace->activate();
+    std::this_thread::yield();
+    ASSERT_TRUE(trace->close().has_value());    // unmaps while writers keep going
+    std::remove(path.c_str());
+  }
+  stop = true;
+  for(auto& w : workers) {
+    w.join();
+  }
+}
+
+TEST_F(DebugLayerTest, TraceMacrosFallBackToDebugLayerWhenInactive) {
+  std::string text;
+  ds::DebugLayer::instance().set_callback([&text](const ds::DebugMessage& m) { text = m.message; });
+  DS_TRACE_INFO("frame {} of {}", 3, "cam-1");
+  EXPECT_EQ(text, "frame 3 of cam-1");
+
+  ds::DebugLayer::instance().set_min_level(ds::DebugLevel::Warn);
+  int evaluated = 0;
+  DS_TRACE_DEBUG("{}", ++evaluated);
+  EXPECT_EQ(evaluated, 0);
+}
+
+TEST(TraceLogReaderTest, RejectsForeignFile) {
+  const auto path = trace_path("foreign");
+  std::FILE* f = std::fopen(path.c_str(), "wb");
+  ASSERT_NE(f, nullptr);
+  std::fputs("definitely not a trace log, just some text", f);
+  std::fclose(f);
+
+  auto reader = ds::TraceLogReader::open(path);
+  ASSERT_FALSE(reader.has_value());
+  EXPECT_EQ(reader.error().kind, ds::ErrorKind::FileFormat);
+  std::remove(path.c_str());
+
+  EXPECT_EQ(ds::TraceLogReader::open(trace_path("missing")).error().kind, ds::ErrorKind::FileIO);
+}
+
+TEST(TraceLogReaderTest, IgnoresSiteIdsOutOfRange) {
+  const auto path = trace_path("hostile_site");
+  ds::trace_log::RecordHeader site{};
+  site.size = static_cast<std::uint32_t>(sizeof(site) + sizeof(ds::trace_log::SiteHeader));
+  site.type = ds::trace_log::RecordType::Site;
+  site.site = 0xFFFFFFFFU;
+  const ds::trace_log::FileHeader header{};
+  const ds::trace_log::SiteHeader site_header{};
+  std::FILE* f = std::fopen(path.c_str(), "wb");
+  ASSERT_NE(f, nullptr);
+  std::fwrite(&header, sizeof(header), 1, f);
+  std::fwrite(&site, sizeof(site), 1, f);
+  std::fwrite(&site_header, sizeof(site_header), 1, f);
+  std::fclose(f);
+
+  auto reader = ds::TraceLogReader::open(path);
+  ASSERT_TRUE(reader.has_value()) << reader.error().message;
+  EXPECT_TRUE(reader->empty());
+  std::remove(path.c_str());
+}
+
+// ============================================================================
+// GStreamer debug bridge
+// ============================================================================
+
+namespace {
+
+GST_DEBUG_CATEGORY_STATIC(bridge_test_cat);
+
+GstDebugCategory* bridge_category() {
+  if(bridge_test_cat == nullptr) {
+    GST_DEBUG_CATEGORY_INIT(bridge_test_cat, "dsbridgetest", 0, "GstDebugBridge tests");
+  }
+  return bridge_test_cat;
+}
+
+}    // namespace
+
+TEST_F(DebugLayerTest, GstBridgeForwardsWithMappedLevel) {
+  std::vector<ds::DebugMessage> received;
+  ds::DebugLayer::instance().set_callback([&received](const ds::DebugMessage& m) { received.push_back(m); });
+  auto* cat = bridge_category();
+  auto bridge = ds::GstDebugBridge::install({.thresholds = "dsbridgetest:DEBUG"});
+  ASSERT_TRUE(bridge.has_value()) << bridge.error().message;
+
+  GST_CAT_WARNING(cat, "value %d", 42);
+  GST_CAT_DEBUG(cat, "verbose");
+  bridge->uninstall();
+  GST_CAT_WARNING(cat, "after uninstall");
+
+  ASSERT_EQ(received.size(), 2u);
+  EXPECT_EQ(received[0].level, ds::DebugLevel::Warn);
+  EXPECT_EQ(received[0].message, "[dsbridgetest] value 42");
+  EXPECT_NE(received[0].file.find("testDebug.cpp"), std::string::npos);
+  EXPECT_EQ(received[1].level, ds::DebugLevel::Debug);
+}
+
+TEST_F(DebugLayerTest, GstBridgeFiltersBeforeFormatting) {
+  int count = 0;
+  ds::DebugLayer::instance().set_callback([&count](const ds::DebugMessage&) { ++count; });
+  auto* cat = bridge_category();
+  auto bridge = ds::GstDebugBridge::install({.thresholds = "dsbridgetest:WARNING"});
+  ASSERT_TRUE(bridge.has_value());
+
+  GST_CAT_INFO(cat, "above the category threshold");
+  EXPECT_EQ(count, 0);
+
+  ds::DebugLayer::instance().set_min_level(ds::DebugLevel::Error);
+  const auto filtered = ds::GstDebugBridge::filtered();
+  GST_CAT_WARNING(cat, "below DebugLayer's level");
+  EXPECT_EQ(count, 0);
+  EXPECT_EQ(ds::GstDebugBridge::filtered(), filtered + 1);
+
+  GST_CAT_ERROR(cat, "delivered");
+  EXPECT_EQ(count, 1);
+}
+
+TEST_F(DebugLayerTest, GstBridgeKeepsThresholdsByDefault) {
+  auto* cat = bridge_category();
+  gst_debug_category_set_threshold(cat, GST_LEVEL_LOG);    // e.g. raised through GST_DEBUG
+  auto bridge = ds::GstDebugBridge::install();
+  ASSERT_TRUE(bridge.has_value());
+  EXPECT_EQ(gst_debug_category_get_threshold(cat), GST_LEVEL_LOG);
+}
+
+TEST_F(DebugLayerTest, GstBridgeInstallsOnce) {
+  auto first = ds::GstDebugBridge::install();
+  ASSERT_TRUE(first.has_value());
+  auto second = ds::GstDebugBridge::install();
+  ASSERT_FALSE(second.has_value());
+  EXPECT_EQ(second.error().kind, ds::ErrorKind::InvalidArgument);
+
+  first->uninstall();
+  EXPECT_TRUE(ds::GstDebugBridge::install().has_value());
+}
+
+TEST(GstDebugBridgeTest, MapsGstLevels) {
+  EXPECT_EQ(ds::GstDebugBridge::map_level(GST_LEVEL_ERROR), ds::DebugLevel::Error);
+  EXPECT_EQ(ds::GstDebugBridge::map_level(GST_LEVEL_WARNING), ds::DebugLevel::Warn);
+  EXPECT_EQ(ds::GstDebugBridge::map_level(GST_LEVEL_FIXME), ds::DebugLevel::Warn);
+  EXPECT_EQ(ds::GstDebugBridge::map_level(GST_LEVEL_INFO), ds::DebugLevel::Info);
+  EXPECT_EQ(ds::GstDebugBridge::map_level(GST_LEVEL_LOG), ds::DebugLevel::Debug);
+  EXPECT_EQ(ds::GstDebugBridge::map_level(GST_LEVEL_TRACE), ds::DebugLevel::Debug);
+}
+
 // ============================================================================
 // ErrorKind helpers
 // ============================================================================
@@ -145,6 +762,11 @@ TEST(ErrorKindTest, KindStrings) {
   EXPECT_EQ(error_kind_str(ErrorKind::PipelineCreation), "PipelineCreation");
   EXPECT_EQ(error_kind_str(ErrorKind::BinAdd), "BinAdd");
   EXPECT_EQ(error_kind_str(ErrorKind::ParseLaunch), "ParseLaunch");
+  EXPECT_EQ(error_kind_str(ErrorKind::FileIO), "FileIO");
+  EXPECT_EQ(error_kind_str(ErrorKind::FileFormat), "FileFormat");
+  EXPECT_EQ(error_kind_str(ErrorKind::InvalidArgument), "InvalidArgument");
+  EXPECT_EQ(error_kind_str(ErrorKind::Decode), "Decode");
+  EXPECT_EQ(error_kind_str(ErrorKind::Capacity), "Capacity");
 }
 
 // ============================================================================
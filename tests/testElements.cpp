@@ -1,3 +1,4 @@
+#include <chrono>
 #include <type_traits>
 
 #include <gst/gst.h>
@@ -283,6 +284,49 @@ TEST(ElementsTest, FileSinkSetterChaining) {
   EXPECT_EQ(&ref, &*result);
 }
 
+// ============================================================================
+// SplitMuxSink
+// ============================================================================
+
+TEST(ElementsTest, SplitMuxSinkMoveOnly) { assert_move_only<ds::SplitMuxSink>(); }
+
+TEST(ElementsTest, SplitMuxSinkLimitSetters) {
+  auto result = ds::SplitMuxSink::create();
+  ASSERT_TRUE(result.has_value());
+
+  result->location("/tmp/seg%05d.mp4").max_size_time(std::chrono::seconds{10}).max_size_bytes(1 << 20).max_files(4);
+
+  gchar* loc = nullptr;
+  guint64 time = 0;
+  guint64 bytes = 0;
+  guint files = 0;
+  g_object_get(
+      G_OBJECT(result->get()), "location", &loc, "max-size-time", &time, "max-size-bytes", &bytes, "max-files", &files, nullptr);
+  ASSERT_NE(loc, nullptr);
+  EXPECT_STREQ(loc, "/tmp/seg%05d.mp4");
+  g_free(loc);
+  EXPECT_EQ(time, 10 * GST_SECOND);
+  EXPECT_EQ(bytes, guint64{1} << 20);
+  EXPECT_EQ(files, 4u);
+}
+
+TEST(ElementsTest, SplitMuxSinkAsyncFinalize) {
+  auto result = ds::SplitMuxSink::create();
+  ASSERT_TRUE(result.has_value());
+  if(!result->async_finalize(true)) {
+    GTEST_SKIP() << "splitmuxsink has no async-finalize before GStreamer 1.16";
+  }
+  result->muxer_factory("matroskamux").sink_factory("filesink");
+
+  gboolean val = FALSE;
+  gchar* muxer = nullptr;
+  g_object_get(G_OBJECT(result->get()), "async-finalize", &val, "muxer-factory", &muxer, nullptr);
+  EXPECT_TRUE(val);
+  ASSERT_NE(muxer, nullptr);
+  EXPECT_STREQ(muxer, "matroskamux");
+  g_free(muxer);
+}
+
 // ============================================================================
 // UriSource (nvurisrcbin — DeepStream only)
 // ============================================================================
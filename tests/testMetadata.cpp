@@ -1,9 +1,23 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
 #include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 #include <glib.h>
+#include <gst/gst.h>
 #include <gtest/gtest.h>
 
 #include <deepstream.hpp>
+#include <testing/synthetic_batch.hpp>
+#include <unistd.h>
 
 // ============================================================================
 // Helpers — build a GList (NvDsMetaList) from stack-allocated nodes
@@ -16,6 +30,25 @@ GList* append(GList* list, T* ptr) {
   return g_list_append(list, static_cast<gpointer>(ptr));
 }
 
+// Unique scratch path under the system temp dir; removed by the caller.
+std::string temp_path(const char* name) {
+  return std::string{::testing::TempDir()} + name;
+}
+
+// Number of nodes in a MetaListView.
+template <typename View, typename Native>
+  requires ds::MetaView<View, Native>
+std::ptrdiff_t length(const ds::MetaListView<View, Native>& list) {
+  return std::distance(list.begin(), list.end());
+}
+
+std::string read_file(const std::string& path) {
+  std::ifstream in{path};
+  std::stringstream ss;
+  ss << in.rdbuf();
+  return ss.str();
+}
+
 }    // namespace
 
 // ============================================================================
@@ -403,7 +436,933 @@ TEST(MetaListViewTest, ForwardIteratorPostIncrement) {
   g_list_free(list);
 }
 
+// ============================================================================
+// BatchIndex
+// ============================================================================
+
+TEST(BatchIndexTest, LooksUpFramesBySourcePadAndBatchId) {
+  NvDsFrameMeta f0{};
+  f0.source_id = 5;
+  f0.pad_index = 5;
+  f0.batch_id = 0;
+  f0.frame_num = 100;
+  NvDsFrameMeta f1{};
+  f1.source_id = 2;
+  f1.pad_index = 1;
+  f1.batch_id = 1;
+  f1.frame_num = 200;
+
+  GList* frames = nullptr;
+  frames = append(frames, &f0);
+  frames = append(frames, &f1);
+  NvDsBatchMeta batch{};
+  batch.frame_meta_list = frames;
+
+  const ds::BatchIndex index{ds::BatchMetaView{&batch}};
+  EXPECT_EQ(index.size(), 2u);
+
+  auto by_source = index.frame_by_source(2);
+  ASSERT_TRUE(by_source.has_value());
+  EXPECT_EQ(by_source->frame_num(), 200);
+  auto by_pad = index.frame_by_pad(5);
+  ASSERT_TRUE(by_pad.has_value());
+  EXPECT_EQ(by_pad->get(), &f0);
+  auto by_batch_id = index.frame_by_batch_id(1);
+  ASSERT_TRUE(by_batch_id.has_value());
+  EXPECT_EQ(by_batch_id->get(), &f1);
+
+  EXPECT_FALSE(index.frame_by_source(3).has_value());
+  EXPECT_FALSE(index.frame_by_source(1000).has_value());
+  EXPECT_FALSE(index.frame_by_batch_id(2).has_value());
+
+  g_list_free(frames);
+}
+
+TEST(BatchIndexTest, RebuildForgetsPreviousBatch) {
+  NvDsFrameMeta f0{};
+  f0.source_id = 7;
+  GList* first = append(nullptr, &f0);
+  NvDsBatchMeta batch{};
+  batch.frame_meta_list = first;
+
+  ds::BatchIndex index;
+  EXPECT_TRUE(index.empty());
+  index.rebuild(ds::BatchMetaView{&batch});
+  EXPECT_TRUE(index.frame_by_source(7).has_value());
+
+  NvDsFrameMeta f1{};
+  f1.source_id = 1;
+  GList* second = append(nullptr, &f1);
+  batch.frame_meta_list = second;
+  index.rebuild(ds::BatchMetaView{&batch});
+
+  EXPECT_EQ(index.size(), 1u);
+  EXPECT_FALSE(index.frame_by_source(7).has_value());
+  ASSERT_TRUE(index.frame_by_source(1).has_value());
+  EXPECT_EQ(index.frame_by_source(1)->get(), &f1);
+
+  g_list_free(first);
+  g_list_free(second);
+}
+
+TEST(BatchIndexTest, LargeIdsDoNotGrowTheDenseTable) {
+  NvDsFrameMeta f0{};
+  f0.source_id = 0xFFFF'FFF0u;
+  f0.pad_index = 3;
+  f0.batch_id = ds::BatchIndex::dense_limit;
+  NvDsFrameMeta f1{};
+  f1.source_id = 0xFFFF'FFF0u;    // same source twice: the first frame wins
+  f1.pad_index = 4;
+  f1.batch_id = 1;
+
+  GList* frames = nullptr;
+  frames = append(frames, &f0);
+  frames = append(frames, &f1);
+  NvDsBatchMeta batch{};
+  batch.frame_meta_list = frames;
+
+  ds::BatchIndex index{ds::BatchMetaView{&batch}};
+  ASSERT_TRUE(index.frame_by_source(0xFFFF'FFF0u).has_value());
+  EXPECT_EQ(index.frame_by_source(0xFFFF'FFF0u)->get(), &f0);
+  ASSERT_TRUE(index.frame_by_batch_id(ds::BatchIndex::dense_limit).has_value());
+  EXPECT_EQ(index.frame_by_batch_id(ds::BatchIndex::dense_limit)->get(), &f0);
+  EXPECT_FALSE(index.frame_by_source(0xFFFF'FFF1u).has_value());
+
+  f1.source_id = 2;
+  GList* second = append(nullptr, &f1);
+  batch.frame_meta_list = second;
+  index.rebuild(ds::BatchMetaView{&batch});
+  EXPECT_FALSE(index.frame_by_source(0xFFFF'FFF0u).has_value());
+  EXPECT_FALSE(index.frame_by_batch_id(ds::BatchIndex::dense_limit).has_value());
+  ASSERT_TRUE(index.frame_by_source(2).has_value());
+  EXPECT_EQ(index.frame_by_source(2)->get(), &f1);
+
+  g_list_free(frames);
+  g_list_free(second);
+}
+
+// ============================================================================
+// TrackHistory
+// ============================================================================
+
+namespace {
+
+ds::TrackPoint point_at(std::uint64_t pts, float left) {
+  return {pts, {left, 0.f, 10.f, 10.f}, 1.f};
+}
+
+}    // namespace
+
+TEST(TrackHistoryTest, RecordsTrajectoriesFromFrames) {
+  NvDsObjectMeta tracked{};
+  tracked.object_id = 42;
+  tracked.confidence = 0.8f;
+  NvDsObjectMeta untracked{};
+  untracked.object_id = UNTRACKED_OBJECT_ID;
+  GList* objs = nullptr;
+  objs = append(objs, &tracked);
+  objs = append(objs, &untracked);
+  NvDsFrameMeta frame{};
+  frame.obj_meta_list = objs;
+
+  ds::TrackHistory history;
+  for(int i = 0; i < 3; ++i) {
+    frame.buf_pts = static_cast<std::uint64_t>(i) * 40;
+    tracked.rect_params.left = static_cast<float>(i);
+    history.update(ds::FrameMetaView{&frame});
+  }
+
+  EXPECT_EQ(history.size(), 1u);
+  EXPECT_EQ(history.frame(), 3u);
+  const auto track = history.find(42);
+  ASSERT_TRUE(track.has_value());
+  ASSERT_EQ(track->size(), 3u);
+  EXPECT_EQ(track->front().pts, 0u);
+  EXPECT_EQ(track->back().pts, 80u);
+  EXPECT_FLOAT_EQ(track->back().box.left, 2.f);
+  EXPECT_FLOAT_EQ(track->back().confidence, 0.8f);
+  EXPECT_FALSE(history.contains(UNTRACKED_OBJECT_ID));
+
+  g_list_free(objs);
+}
+
+TEST(TrackHistoryTest, RingKeepsNewestPoints) {
+  ds::TrackHistory history{{4, 3, 30}};
+  for(std::uint64_t i = 0; i < 5; ++i) {
+    history.advance();
+    history.record(1, point_at(i, static_cast<float>(i)));
+  }
+  const auto track = history.find(1);
+  ASSERT_TRUE(track.has_value());
+  ASSERT_EQ(track->size(), 3u);
+  EXPECT_EQ((*track)[0].pts, 2u);
+  EXPECT_EQ((*track)[1].pts, 3u);
+  EXPECT_EQ((*track)[2].pts, 4u);
+}
+
+TEST(TrackHistoryTest, EvictsTracksPastMaxAge) {
+  ds::TrackHistory history{{8, 4, 2}};
+  history.advance();
+  history.record(1, point_at(0, 0.f));
+  history.record(2, point_at(0, 0.f));
+
+  for(int i = 0; i < 2; ++i) {
+    history.advance();
+    history.record(2, point_at(0, 0.f));
+  }
+  EXPECT_TRUE(history.contains(1));
+  history.advance();
+  EXPECT_FALSE(history.contains(1));
+  EXPECT_TRUE(history.contains(2));
+  EXPECT_EQ(history.evicted(), 1u);
+}
+
+TEST(TrackHistoryTest, FullTableEvictsLeastRecentlySeen) {
+  ds::TrackHistory history{{2, 4, 100}};
+  history.advance();
+  history.record(10, point_at(1, 0.f));
+  history.advance();
+  history.record(11, point_at(2, 0.f));
+  history.advance();
+  history.record(12, point_at(3, 0.f));
+
+  EXPECT_EQ(history.size(), 2u);
+  EXPECT_FALSE(history.contains(10));
+  EXPECT_TRUE(history.contains(11));
+  EXPECT_TRUE(history.contains(12));
+  EXPECT_EQ(history.evicted(), 1u);
+}
+
+TEST(TrackHistoryTest, ChurnKeepsLookupsConsistent) {
+  ds::TrackHistory history{{64, 2, 3}};
+  for(std::uint64_t frame = 0; frame < 2000; ++frame) {
+    history.advance();
+    // A sliding window of ids: each lives for about eight frames.
+    for(std::uint64_t id = frame; id < frame + 8; ++id) {
+      history.record(id, point_at(frame, 0.f));
+    }
+    ASSERT_LE(history.size(), 64u);
+    for(std::uint64_t id = frame; id < frame + 8; ++id) {
+      ASSERT_TRUE(history.contains(id)) << "frame " << frame << " id " << id;
+    }
+  }
+  history.clear();
+  EXPECT_EQ(history.size(), 0u);
+}
+
+// ============================================================================
+// register_user_meta / attach / get
+// ============================================================================
+
+namespace {
+
+// Counts live instances so tests can check DeepStream's release callbacks ran.
+struct Annotation {
+  static inline int live = 0;
+
+  int value{0};
+  std::string note;
+
+  Annotation(int v, std::string n) : value(v), note(std::move(n)) {
+    ++live;
+  }
+  Annotation(const Annotation& other) : value(other.value), note(other.note) {
+    ++live;
+  }
+  Annotation(Annotation&& other) noexcept : value(other.value), note(std::move(other.note)) {
+    ++live;
+  }
+  Annotation& operator=(const Annotation&) = default;
+  Annotation& operator=(Annotation&&) = default;
+  ~Annotation() {
+    --live;
+  }
+};
+
+struct NeverRegistered {
+  int value{0};
+};
+
+// Copying an armed instance throws.
+struct Explosive {
+  bool armed{false};
+
+  explicit Explosive(bool a) : armed(a) {}
+  Explosive(const Explosive& other) : armed(other.armed) {
+    if(armed) {
+      throw std::runtime_error("Explosive copied");
+    }
+  }
+  Explosive& operator=(const Explosive&) = default;
+  ~Explosive() = default;
+};
+
+}    // namespace
+
+TEST(TypedUserMetaTest, AttachGetCopyAndRelease) {
+  auto type = ds::register_user_meta<Annotation>("DEEPSTREAM_HPP.TEST.ANNOTATION");
+  ASSERT_TRUE(type.has_value()) << type.error().what();
+  EXPECT_EQ(ds::user_meta_type<Annotation>(), *type);
+  EXPECT_EQ(ds::register_user_meta<Annotation>("DEEPSTREAM_HPP.TEST.OTHER").value(), *type);
+
+  NvDsBatchMeta* batch = nvds_create_batch_meta(1);
+  ASSERT_NE(batch, nullptr);
+  NvDsFrameMeta* frame = nvds_acquire_frame_meta_from_pool(batch);
+  nvds_add_frame_meta_to_batch(batch, frame);
+  NvDsObjectMeta* object = nvds_acquire_obj_meta_from_pool(batch);
+  nvds_add_obj_meta_to_frame(frame, object, nullptr);
+
+  const ds::FrameMetaView frame_view{frame};
+  EXPECT_EQ(ds::get<Annotation>(frame_view), nullptr);
+
+  ASSERT_TRUE(ds::attach(frame_view, Annotation{7, "frame"}).has_value());
+  const Annotation on_object{9, "object"};
+  ASSERT_TRUE(ds::attach(ds::ObjectMetaView{object}, on_object).has_value());
+  ASSERT_TRUE(ds::attach(ds::BatchMetaView{batch}, Annotation{11, "batch"}).has_value());
+
+  const auto* got = ds::get<Annotation>(frame_view);
+  ASSERT_NE(got, nullptr);
+  EXPECT_EQ(got->value, 7);
+  EXPECT_EQ(got->note, "frame");
+  ASSERT_NE(ds::get<Annotation>(ds::ObjectMetaView{object}), nullptr);
+  EXPECT_EQ(ds::get<Annotation>(ds::ObjectMetaView{object})->value, 9);
+  ASSERT_NE(ds::get<Annotation>(ds::BatchMetaView{batch}), nullptr);
+  EXPECT_EQ(ds::get<Annotation>(ds::BatchMetaView{batch})->note, "batch");
+
+  // DeepStream duplicates user meta through the generated callbacks.
+  auto* user = static_cast<NvDsUserMeta*>(frame->frame_user_meta_list->data);
+  EXPECT_EQ(user->base_meta.meta_type, *type);
+  NvDsUserMeta duplicate{};
+  duplicate.user_meta_data = user->base_meta.copy_func(user, nullptr);
+  ASSERT_NE(duplicate.user_meta_data, nullptr);
+  EXPECT_NE(duplicate.user_meta_data, user->user_meta_data);
+  EXPECT_EQ(static_cast<Annotation*>(duplicate.user_meta_data)->note, "frame");
+  user->base_meta.release_func(&duplicate, nullptr);
+  EXPECT_EQ(duplicate.user_meta_data, nullptr);
+
+  EXPECT_EQ(Annotation::live, 4);    // three attached + on_object
+  nvds_destroy_batch_meta(batch);
+  EXPECT_EQ(Annotation::live, 1);
+}
+
+TEST(TypedUserMetaTest, ThrowingConstructorAttachesNothing) {
+  ASSERT_TRUE(ds::register_user_meta<Explosive>("DEEPSTREAM_HPP.TEST.EXPLOSIVE").has_value());
+  NvDsBatchMeta* batch = nvds_create_batch_meta(1);
+  ASSERT_NE(batch, nullptr);
+  NvDsFrameMeta* frame = nvds_acquire_frame_meta_from_pool(batch);
+  nvds_add_frame_meta_to_batch(batch, frame);
+  const ds::FrameMetaView frame_view{frame};
+
+  const Explosive armed{true};
+  EXPECT_THROW((void)ds::attach(frame_view, armed), std::runtime_error);
+  EXPECT_EQ(frame->frame_user_meta_list, nullptr);
+  EXPECT_EQ(ds::get<Explosive>(frame_view), nullptr);
+
+  const Explosive safe{false};
+  ASSERT_TRUE(ds::attach(frame_view, safe).has_value());
+  ASSERT_NE(ds::get<Explosive>(frame_view), nullptr);
+  EXPECT_FALSE(ds::get<Explosive>(frame_view)->armed);
+  nvds_destroy_batch_meta(batch);
+}
+
+TEST(TypedUserMetaTest, UnregisteredTypeIsRejected) {
+  NvDsFrameMeta frame{};
+  EXPECT_EQ(ds::user_meta_type<NeverRegistered>(), NVDS_INVALID_META);
+  EXPECT_EQ(ds::get<NeverRegistered>(ds::FrameMetaView{&frame}), nullptr);
+
+  auto result = ds::attach(ds::FrameMetaView{&frame}, NeverRegistered{1});
+  ASSERT_FALSE(result.has_value());
+  EXPECT_EQ(result.error().kind, ds::ErrorKind::InvalidArgument);
+
+  auto empty = ds::register_user_meta<NeverRegistered>("");
+  ASSERT_FALSE(empty.has_value());
+  EXPECT_EQ(empty.error().kind, ds::ErrorKind::InvalidArgument);
+}
+
+// ============================================================================
+// MetaDeltaEncoder / MetaDeltaDecoder
+// ============================================================================
+
+namespace {
+
+ds::DeltaObject delta_object(std::uint64_t id, float left, float top) {
+  return {id, 1, {left, top, 50.f, 80.f}, 0.5f};
+}
+
+}    // namespace
+
+TEST(MetaDeltaTest, RoundTripsAddUpdateRemove) {
+  auto encoder = ds::MetaDeltaEncoder::create({0.25f, 1.f / 256, 0}).value();
+  ds::MetaDeltaDecoder decoder;
+
+  std::vector<ds::DeltaObject> frame{delta_object(1, 10.f, 20.f), delta_object(2, 100.f, 200.f)};
+  ASSERT_TRUE(decoder.decode(encoder.encode(0, frame)).has_value());
+  ASSERT_EQ(decoder.objects().size(), 2u);
+
+  frame[0].box.left = 12.5f;
+  frame[1].class_id = 4;
+  frame.push_back(delta_object(3, 0.f, 0.f));
+  ASSERT_TRUE(decoder.decode(encoder.encode(40, frame)).has_value());
+  EXPECT_EQ(decoder.pts(), 40u);
+  ASSERT_EQ(decoder.objects().size(), 3u);
+
+  frame.erase(frame.begin());
+  ASSERT_TRUE(decoder.decode(encoder.encode(80, frame)).has_value());
+  ASSERT_EQ(decoder.objects().size(), 2u);
+  for(const auto& expected : frame) {
+    const auto decoded = decoder.objects();
+    const auto match =
+        std::find_if(decoded.begin(), decoded.end(), [&](const auto& o) { return o.object_id == expected.object_id; });
+    ASSERT_NE(match, decoded.end());
+    EXPECT_EQ(match->class_id, expected.class_id);
+    EXPECT_FLOAT_EQ(match->box.left, expected.box.left);
+    EXPECT_FLOAT_EQ(match->box.top, expected.box.top);
+    EXPECT_FLOAT_EQ(match->box.height, expected.box.height);
+    EXPECT_FLOAT_EQ(match->confidence, expected.confidence);
+  }
+  EXPECT_EQ(encoder.keyframes(), 1u);
+}
+
+TEST(MetaDeltaTest, StaticObjectsCostOnlyTheHeader) {
+  auto encoder = ds::MetaDeltaEncoder::create({0.25f, 1.f / 256, 0}).value();
+  std::vector<ds::DeltaObject> frame;
+  for(std::uint64_t id = 0; id < 32; ++id) {
+    frame.push_back(delta_object(id, static_cast<float>(id) * 10.f, 5.f));
+  }
+  const auto key_size = encoder.encode(0, frame).size();
+  // Sub-quantum jitter does not produce records.
+  frame[5].box.left += 0.05f;
+  const auto delta_size = encoder.encode(40, frame).size();
+  EXPECT_LT(delta_size, 8u);
+  EXPECT_GT(key_size, 32u * 10u);
+}
+
+TEST(MetaDeltaTest, DecoderResyncsOnKeyframe) {
+  auto encoder = ds::MetaDeltaEncoder::create({0.25f, 1.f / 256, 3}).value();
+  ds::MetaDeltaDecoder decoder;
+  const std::vector<ds::DeltaObject> frame{delta_object(1, 0.f, 0.f)};
+
+  ASSERT_TRUE(decoder.decode(encoder.encode(0, frame)).has_value());
+  (void)encoder.encode(1, frame);    // lost in transit
+  auto gap = decoder.decode(encoder.encode(2, frame));
+  ASSERT_FALSE(gap.has_value());
+  EXPECT_EQ(gap.error().kind, ds::ErrorKind::Decode);
+  EXPECT_FALSE(decoder.synced());
+
+  ASSERT_TRUE(decoder.decode(encoder.encode(3, frame)).has_value());    // sequence 3 is a keyframe
+  EXPECT_TRUE(decoder.synced());
+  ASSERT_EQ(decoder.objects().size(), 1u);
+}
+
+TEST(MetaDeltaTest, RejectsTruncatedMessages) {
+  ds::MetaDeltaEncoder encoder;
+  const std::vector<ds::DeltaObject> frame{delta_object(1, 10.f, 10.f), delta_object(2, 20.f, 20.f)};
+  const auto bytes = encoder.encode(0, frame);
+  for(std::size_t n = 0; n < bytes.size(); ++n) {
+    ds::MetaDeltaDecoder decoder;
+    auto result = decoder.decode(bytes.first(n));
+    ASSERT_FALSE(result.has_value()) << "prefix of " << n << " bytes";
+    EXPECT_EQ(result.error().kind, ds::ErrorKind::Decode);
+  }
+}
+
+TEST(MetaDeltaTest, RejectsUnusableQuanta) {
+  for(const float quantum : {0.f, -0.25f, std::numeric_limits<float>::quiet_NaN(), std::numeric_limits<float>::infinity()}) {
+    auto box = ds::MetaDeltaEncoder::create({.box_quantum = quantum});
+    ASSERT_FALSE(box.has_value());
+    EXPECT_EQ(box.error().kind, ds::ErrorKind::InvalidArgument);
+    EXPECT_FALSE(ds::MetaDeltaEncoder::create({.confidence_quantum = quantum}).has_value());
+  }
+
+  // Keyframe header with both quanta as the bits of 0.0f.
+  const std::vector<std::byte> zero_quanta{std::byte{0x01}, std::byte{0}, std::byte{0}, std::byte{0}, std::byte{0}, std::byte{0}};
+  ds::MetaDeltaDecoder decoder;
+  auto result = decoder.decode(zero_quanta);
+  ASSERT_FALSE(result.has_value());
+  EXPECT_EQ(result.error().kind, ds::ErrorKind::Decode);
+  EXPECT_FALSE(decoder.synced());
+}
+
+TEST(MetaDeltaTest, EncodesTrackedObjectsFromFrameMeta) {
+  NvDsObjectMeta tracked{};
+  tracked.object_id = 9;
+  tracked.rect_params = {1.f, 2.f, 3.f, 4.f, 0};
+  NvDsObjectMeta untracked{};
+  untracked.object_id = UNTRACKED_OBJECT_ID;
+  GList* objs = nullptr;
+  objs = append(objs, &tracked);
+  objs = append(objs, &untracked);
+  NvDsFrameMeta frame{};
+  frame.buf_pts = 77;
+  frame.obj_meta_list = objs;
+
+  ds::MetaDeltaEncoder encoder;
+  ds::MetaDeltaDecoder decoder;
+  ASSERT_TRUE(decoder.decode(encoder.encode(ds::FrameMetaView{&frame})).has_value());
+  EXPECT_EQ(decoder.pts(), 77u);
+  ASSERT_EQ(decoder.objects().size(), 1u);
+  EXPECT_EQ(decoder.objects()[0].object_id, 9u);
+  EXPECT_FLOAT_EQ(decoder.objects()[0].box.height, 4.f);
+
+  g_list_free(objs);
+}
+
+// ============================================================================
+// MetaRecorder / MetaLogReader / write_kitti
+// ============================================================================
+
+TEST(MetaLogTest, RoundTripThroughRecorder) {
+  NvDsObjectMeta o0{};
+  o0.object_id = 7;
+  o0.class_id = 2;
+  o0.confidence = 0.5f;
+  o0.rect_params = {10.f, 20.f, 30.f, 40.f, 0};
+  std::strncpy(o0.obj_label, "car", sizeof(o0.obj_label) - 1);
+  NvDsObjectMeta o1{};
+  o1.object_id = 8;
+  o1.class_id = 0;
+  std::strncpy(o1.obj_label, "person", sizeof(o1.obj_label) - 1);
+
+  GList* objs = nullptr;
+  objs = append(objs, &o0);
+  objs = append(objs, &o1);
+
+  NvDsFrameMeta f0{};
+  f0.source_id = 3;
+  f0.pad_index = 1;
+  f0.frame_num = 12;
+  f0.buf_pts = 1000;
+  f0.obj_meta_list = objs;
+  NvDsFrameMeta f1{};
+  f1.source_id = 4;
+  f1.frame_num = 13;
+  f1.buf_pts = 2000;
+
+  GList* frames = nullptr;
+  frames = append(frames, &f0);
+  frames = append(frames, &f1);
+  NvDsBatchMeta batch{};
+  batch.frame_meta_list = frames;
+
+  const auto path = temp_path("roundtrip.dsmeta");
+  {
+    auto rec = ds::MetaRecorder::create(path, 2);
+    ASSERT_TRUE(rec.has_value()) << rec.error().what();
+    for(int i = 0; i < 5; ++i) {
+      ASSERT_TRUE(rec->record(ds::BatchMetaView{&batch}).has_value());
+    }
+    ASSERT_TRUE(rec->close().has_value());
+  }
+
+  auto log = ds::MetaLogReader::open(path);
+  ASSERT_TRUE(log.has_value()) << log.error().what();
+  EXPECT_FALSE(log->recovered());
+  ASSERT_EQ(log->size(), 5u);
+
+  const auto b = log->batch(4);
+  EXPECT_EQ(b.sequence(), 4u);
+  EXPECT_EQ(b.first_pts(), 1000u);
+  ASSERT_EQ(b.num_frames(), 2u);
+  ASSERT_EQ(b.num_objects(), 2u);
+  EXPECT_EQ(b.source_id()[0], 3u);
+  EXPECT_EQ(b.source_id()[1], 4u);
+  EXPECT_EQ(b.frame_num()[1], 13);
+  EXPECT_EQ(b.object_count()[0], 2u);
+  EXPECT_EQ(b.object_count()[1], 0u);
+  EXPECT_EQ(b.object_id()[0], 7u);
+  EXPECT_EQ(b.class_id()[0], 2);
+  EXPECT_FLOAT_EQ(b.width()[0], 30.f);
+  EXPECT_EQ(b.label(0), "car");
+  EXPECT_EQ(b.label(1), "person");
+
+  g_list_free(frames);
+  g_list_free(objs);
+  std::remove(path.c_str());
+}
+
+TEST(MetaLogTest, RecoversWithoutTrailer) {
+  ds::BatchRecord record;
+  record.add_frame(100, 0, 0, 1);
+  record.add_object(1, 0, 0.9f, 0.f, 0.f, 1.f, 1.f, "a");
+
+  const auto path = temp_path("torn.dsmeta");
+  std::uint64_t complete = 0;
+  {
+    auto writer = ds::MetaLogWriter::create(path, 64);
+    ASSERT_TRUE(writer.has_value());
+    for(std::uint64_t i = 0; i < 3; ++i) {
+      record.sequence = i;
+      record.frames.pts[0] = 100 * (i + 1);
+      ASSERT_TRUE(writer->append(record).has_value());
+    }
+    complete = writer->bytes_written();
+    ASSERT_TRUE(writer->close().has_value());
+  }
+  // Simulate a crash: drop the index and trailer, then tear a partial block on the end.
+  ASSERT_EQ(::truncate(path.c_str(), static_cast<off_t>(complete - 8)), 0);
+
+  auto log = ds::MetaLogReader::open(path);
+  ASSERT_TRUE(log.has_value());
+  EXPECT_TRUE(log->recovered());
+  ASSERT_EQ(log->size(), 2u);
+  EXPECT_EQ(log->batch(1).sequence(), 1u);
+  EXPECT_EQ(log->lower_bound_pts(150), 1u);
+  EXPECT_EQ(log->lower_bound_pts(1000), 2u);
+  std::remove(path.c_str());
+}
+
+TEST(MetaLogTest, SkipsBatchesWithInconsistentCounts) {
+  ds::BatchRecord record;
+  record.add_frame(100, 0, 0, 1);
+  record.add_object(1, 0, 0.9f, 0.f, 0.f, 1.f, 1.f, "a");
+
+  // Second block: num_labels (BatchHeader +24) and the first object's label id (payload +76).
+  for(const std::size_t field : {std::size_t{24}, std::size_t{76}}) {
+    const auto path = temp_path("corrupt.dsmeta");
+    std::uint64_t second = 0;
+    {
+      auto writer = ds::MetaLogWriter::create(path, 64);
+      ASSERT_TRUE(writer.has_value());
+      ASSERT_TRUE(writer->append(record).has_value());
+      second = writer->bytes_written();
+      ASSERT_TRUE(writer->append(record).has_value());
+    }
+    {
+      std::fstream file{path, std::ios::in | std::ios::out | std::ios::binary};
+      const std::uint32_t bad = field == 24 ? 0U : 7U;
+      file.seekp(static_cast<std::streamoff>(second + sizeof(ds::meta_log::BlockHeader) + field));
+      file.write(reinterpret_cast<const char*>(&bad), sizeof(bad));
+    }
+    auto log = ds::MetaLogReader::open(path);
+    ASSERT_TRUE(log.has_value());
+    EXPECT_TRUE(log->recovered());
+    EXPECT_EQ(log->size(), 1u);
+    std::remove(path.c_str());
+  }
+}
+
+TEST(MetaLogTest, RejectsForeignFile) {
+  const auto path = temp_path("foreign.dsmeta");
+  {
+    std::ofstream out{path};
+    out << "definitely not a metadata log, but long enough for a header";
+  }
+  auto log = ds::MetaLogReader::open(path);
+  ASSERT_FALSE(log.has_value());
+  EXPECT_EQ(log.error().kind, ds::ErrorKind::FileFormat);
+  std::remove(path.c_str());
+
+  auto missing = ds::MetaLogReader::open(temp_path("does-not-exist.dsmeta"));
+  ASSERT_FALSE(missing.has_value());
+  EXPECT_EQ(missing.error().kind, ds::ErrorKind::FileIO);
+}
+
+TEST(MetaLogTest, KittiConversionMatchesDeepStreamApp) {
+  ds::BatchRecord record;
+  record.add_frame(0, 0, 2, 5);
+  record.add_object(1, 0, 0.75f, 10.f, 20.f, 30.f, 40.f, "car");
+
+  const auto path = temp_path("kitti.dsmeta");
+  {
+    auto writer = ds::MetaLogWriter::create(path);
+    ASSERT_TRUE(writer.has_value());
+    ASSERT_TRUE(writer->append(record).has_value());
+  }
+  auto log = ds::MetaLogReader::open(path);
+  ASSERT_TRUE(log.has_value());
+
+  const std::string dir{::testing::TempDir()};
+  auto files = ds::write_kitti(*log, dir, 1);
+  ASSERT_TRUE(files.has_value()) << files.error().what();
+  EXPECT_EQ(*files, 1u);
+
+  const auto kitti = dir + "/01_002_000005.txt";
+  EXPECT_EQ(read_file(kitti), "car 0.0 0 0.0 10.000000 20.000000 40.000000 60.000000 0.0 0.0 0.0 0.0 0.0 0.0 0.0 0.750000\n");
+  std::remove(kitti.c_str());
+  std::remove(path.c_str());
+}
+
+// ============================================================================
+// MetaExporter
+// ============================================================================
+
+namespace {
+
+// Sink that holds the writer thread until release() so tests can fill the pool.
+struct GatedSink {
+  std::atomic<bool> open{false};
+  std::mutex mutex;
+  std::vector<std::uint64_t> sequences;
+
+  ds::MetaExporter::Sink sink() {
+    return [this](const ds::BatchRecord& record) -> nonstd::expected<void, ds::Error> {
+      open.wait(false);
+      const std::lock_guard lock{mutex};
+      sequences.push_back(record.sequence);
+      return {};
+    };
+  }
+
+  void release() {
+    open.store(true);
+    open.notify_all();
+  }
+};
+
+void fill_one_frame(ds::BatchRecord& record) {
+  record.add_frame(0, 0, 0, 0);
+}
+
+}    // namespace
+
+TEST(MetaExporterTest, WritesLogOnBackgroundThread) {
+  NvDsObjectMeta obj{};
+  obj.object_id = 5;
+  std::strncpy(obj.obj_label, "bus", sizeof(obj.obj_label) - 1);
+  GList* objs = append(nullptr, &obj);
+  NvDsFrameMeta frame{};
+  frame.buf_pts = 40;
+  frame.obj_meta_list = objs;
+  GList* frames = append(nullptr, &frame);
+  NvDsBatchMeta batch{};
+  batch.frame_meta_list = frames;
+
+  const auto path = temp_path("exporter.dsmeta");
+  {
+    auto exporter = ds::MetaExporter::to_log(path, {4, ds::Backpressure::Block});
+    ASSERT_TRUE(exporter.has_value()) << exporter.error().what();
+    for(int i = 0; i < 100; ++i) {
+      EXPECT_TRUE(exporter->submit(ds::BatchMetaView{&batch}));
+    }
+    exporter->close();
+    const auto stats = exporter->stats();
+    EXPECT_EQ(stats.submitted, 100u);
+    EXPECT_EQ(stats.exported, 100u);
+    EXPECT_EQ(stats.dropped, 0u);
+    EXPECT_EQ(stats.write_errors, 0u);
+  }
+
+  auto log = ds::MetaLogReader::open(path);
+  ASSERT_TRUE(log.has_value()) << log.error().what();
+  ASSERT_EQ(log->size(), 100u);
+  for(std::size_t i = 0; i < log->size(); ++i) {
+    EXPECT_EQ(log->batch(i).sequence(), i);
+  }
+  EXPECT_EQ(log->batch(99).label(0), "bus");
+
+  g_list_free(frames);
+  g_list_free(objs);
+  std::remove(path.c_str());
+}
+
+TEST(MetaExporterTest, DropNewestKeepsEarliestBatches) {
+  GatedSink gate;
+  auto exporter = ds::MetaExporter::create(gate.sink(), {2, ds::Backpressure::DropNewest});
+  ASSERT_TRUE(exporter.has_value());
+
+  std::size_t accepted = 0;
+  for(int i = 0; i < 10; ++i) {
+    accepted += exporter->submit_with(fill_one_frame) ? 1u : 0u;
+  }
+  gate.release();
+  exporter->close();
+
+  const auto stats = exporter->stats();
+  EXPECT_EQ(stats.submitted, 10u);
+  EXPECT_EQ(stats.exported, accepted);
+  EXPECT_EQ(stats.dropped, 10u - accepted);
+  ASSERT_GE(gate.sequences.size(), 2u);
+  EXPECT_EQ(gate.sequences[0], 0u);
+  EXPECT_EQ(gate.sequences[1], 1u);
+}
+
+TEST(MetaExporterTest, DropOldestKeepsLatestBatch) {
+  GatedSink gate;
+  auto exporter = ds::MetaExporter::create(gate.sink(), {2, ds::Backpressure::DropOldest});
+  ASSERT_TRUE(exporter.has_value());
+
+  for(int i = 0; i < 10; ++i) {
+    EXPECT_TRUE(exporter->submit_with(fill_one_frame));
+  }
+  gate.release();
+  exporter->close();
+
+  const auto stats = exporter->stats();
+  EXPECT_EQ(stats.submitted, 10u);
+  EXPECT_EQ(stats.exported + stats.dropped, 10u);
+  EXPECT_GT(stats.dropped, 0u);
+  ASSERT_FALSE(gate.sequences.empty());
+  EXPECT_EQ(gate.sequences.back(), 9u);
+}
+
+TEST(MetaExporterTest, ThrowingFillReturnsItsRecord) {
+  std::atomic<int> written{0};
+  auto exporter = ds::MetaExporter::create(
+      [&written](const ds::BatchRecord&) -> nonstd::expected<void, ds::Error> {
+        ++written;
+        return {};
+      },
+      {2, ds::Backpressure::Block});
+  ASSERT_TRUE(exporter.has_value());
+
+  for(int i = 0; i < 5; ++i) {
+    EXPECT_THROW(exporter->submit_with([](ds::BatchRecord&) { throw std::runtime_error{"capture failed"}; }),
+                 std::runtime_error);
+  }
+  for(int i = 0; i < 5; ++i) {
+    EXPECT_TRUE(exporter->submit_with(fill_one_frame));    // would block forever on a shrunken pool
+  }
+  exporter->close();
+
+  const auto stats = exporter->stats();
+  EXPECT_EQ(stats.dropped, 5u);
+  EXPECT_EQ(stats.exported, 5u);
+  EXPECT_EQ(written.load(), 5);
+}
+
+TEST(MetaExporterTest, CountsSinkErrorsAndLateSubmits) {
+  auto exporter = ds::MetaExporter::create(
+      [](const ds::BatchRecord&) -> nonstd::expected<void, ds::Error> {
+        return nonstd::make_unexpected(ds::Error{ds::ErrorKind::FileIO, "disk full"});
+      },
+      {});
+  ASSERT_TRUE(exporter.has_value());
+  EXPECT_TRUE(exporter->submit_with(fill_one_frame));
+  exporter->close();
+  EXPECT_FALSE(exporter->submit_with(fill_one_frame));
+
+  const auto stats = exporter->stats();
+  EXPECT_EQ(stats.write_errors, 1u);
+  EXPECT_EQ(stats.dropped, 1u);
+}
+
+TEST(MetaExporterTest, RejectsInvalidConfig) {
+  auto no_sink = ds::MetaExporter::create(nullptr);
+  ASSERT_FALSE(no_sink.has_value());
+  EXPECT_EQ(no_sink.error().kind, ds::ErrorKind::InvalidArgument);
+
+  auto no_pool = ds::MetaExporter::create([](const ds::BatchRecord&) -> nonstd::expected<void, ds::Error> { return {}; }, {0});
+  ASSERT_FALSE(no_pool.has_value());
+  EXPECT_EQ(no_pool.error().kind, ds::ErrorKind::InvalidArgument);
+}
+
+// ============================================================================
+// SyntheticBatch — host-built NvDs graphs for CPU-only tests and benchmarks
+// ============================================================================
+
+TEST(SyntheticBatchTest, BuildsConfiguredGraph) {
+  const ds::testing::SyntheticBatch batch{
+      {.frames = 3, .objects_per_frame = 4, .classifiers_per_object = 2, .labels_per_classifier = 2, .tensor_layers = 2}};
+  const auto view = batch.view();
+  EXPECT_EQ(length(view.frames()), 3);
+  EXPECT_EQ(batch.num_objects(), 12u);
+
+  std::uint32_t batch_id = 0;
+  std::vector<std::uint64_t> ids;
+  for(const auto frame : view.frames()) {
+    EXPECT_EQ(frame.batch_id(), batch_id);
+    EXPECT_EQ(frame.source_id(), batch_id);
+    ++batch_id;
+    EXPECT_EQ(frame.num_objects(), 4u);
+    for(const auto obj : frame.objects()) {
+      ids.push_back(obj.object_id());
+      EXPECT_GT(obj.confidence(), 0.f);
+      EXPECT_GT(obj.rect().width, 0.f);
+      EXPECT_EQ(std::string{obj.label()}, "class" + std::to_string(obj.class_id()));
+      EXPECT_EQ(length(obj.classifiers()), 2);
+      for(const auto classifier : obj.classifiers()) {
+        EXPECT_EQ(length(classifier.labels()), 2);
+      }
+    }
+    ASSERT_EQ(length(frame.user_meta()), 1);
+    auto tensor = (*frame.user_meta().begin()).as_tensor_meta();
+    ASSERT_TRUE(tensor.has_value());
+    EXPECT_EQ(tensor->num_output_layers(), 2u);
+    EXPECT_EQ(tensor->output_layer(1).name(), "output1");
+    EXPECT_EQ(tensor->output_layer(1).num_elements(), 16u);
+  }
+  std::ranges::sort(ids);
+  EXPECT_EQ(std::ranges::adjacent_find(ids), ids.end());
+}
+
+TEST(SyntheticBatchTest, SameSeedSameGraph) {
+  const ds::testing::SyntheticBatch a{{.objects_per_frame = 16, .seed = 7}};
+  const ds::testing::SyntheticBatch b{{.objects_per_frame = 16, .seed = 7}};
+  auto ra = (*a.view().frames().begin()).objects();
+  auto rb = (*b.view().frames().begin()).objects();
+  auto ib = rb.begin();
+  for(const auto obj : ra) {
+    EXPECT_EQ(obj.class_id(), (*ib).class_id());
+    EXPECT_FLOAT_EQ(obj.rect().left, (*ib).rect().left);
+    ++ib;
+  }
+}
+
+TEST(SyntheticBatchTest, ManualBuilderSurvivesMove) {
+  ds::testing::SyntheticBatch built;
+  auto* frame = built.add_frame(5, 42, 1000);
+  built.add_object(frame, 9, 2, {1.f, 2.f, 3.f, 4.f}, 0.5f, "car");
+  ds::testing::SyntheticBatch batch{std::move(built)};
+
+  ds::BatchIndex index{batch.view()};
+  auto found = index.frame_by_source(5);
+  ASSERT_TRUE(found.has_value());
+  EXPECT_EQ(found->frame_num(), 42);
+  EXPECT_EQ(found->buf_pts(), 1000u);
+  const auto obj = *found->objects().begin();
+  EXPECT_EQ(obj.object_id(), 9u);
+  EXPECT_EQ(obj.label(), "car");
+}
+
+TEST(SyntheticBatchTest, FakeSourceAttachesBatchToEveryBuffer) {
+  GstElement* pipeline = gst_parse_launch("videotestsrc name=src num-buffers=5 ! fakesink name=sink", nullptr);
+  ASSERT_NE(pipeline, nullptr);
+  GstElement* src = gst_bin_get_by_name(GST_BIN(pipeline), "src");
+  GstElement* sink = gst_bin_get_by_name(GST_BIN(pipeline), "sink");
+
+  auto fake = ds::testing::FakeBatchMetaSource::attach(src, {.frames = 2, .objects_per_frame = 3});
+  ASSERT_TRUE(fake.has_value());
+
+  std::atomic<int> seen{0};
+  GstPad* sink_pad = gst_element_get_static_pad(sink, "sink");
+  gst_pad_add_probe(
+      sink_pad,
+      GST_PAD_PROBE_TYPE_BUFFER,
+      [](GstPad*, GstPadProbeInfo* info, gpointer data) -> GstPadProbeReturn {
+        auto batch = ds::BatchMetaView::from_buffer(GST_PAD_PROBE_INFO_BUFFER(info));
+        if(batch && length(batch->frames()) == 2) {
+          static_cast<std::atomic<int>*>(data)->fetch_add(1);
+        }
+        return GST_PAD_PROBE_OK;
+      },
+      &seen,
+      nullptr);
+
+  gst_element_set_state(pipeline, GST_STATE_PLAYING);
+  GstBus* bus = gst_element_get_bus(pipeline);
+  GstMessage* msg =
+      gst_bus_timed_pop_filtered(bus, 5 * GST_SECOND, static_cast<GstMessageType>(GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+  ASSERT_NE(msg, nullptr);
+  EXPECT_EQ(GST_MESSAGE_TYPE(msg), GST_MESSAGE_EOS);
+  gst_message_unref(msg);
+  gst_object_unref(bus);
+  gst_element_set_state(pipeline, GST_STATE_NULL);
+
+  EXPECT_EQ(seen.load(), 5);
+  EXPECT_EQ(fake->batches(), 5u);
+
+  auto missing = ds::testing::FakeBatchMetaSource::attach(src, {}, "no-such-pad");
+  ASSERT_FALSE(missing.has_value());
+  EXPECT_EQ(missing.error().kind, ds::ErrorKind::InvalidArgument);
+
+  gst_object_unref(sink_pad);
+  gst_object_unref(sink);
+  gst_object_unref(src);
+  gst_object_unref(pipeline);
+}
+
 int main(int argc, char** argv) {
+  gst_init(&argc, &argv);
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
 }
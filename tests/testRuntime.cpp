@@ -0,0 +1,1438 @@
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <gst/gst.h>
+#include <gtest/gtest.h>
+
+#include <deepstream_raii.hpp>
+#include <runtime.hpp>
+
+namespace {
+
+// ============================================================================
+// Fixture — live videotestsrc inputs into a funnel (a standard sink_%u muxer)
+// ============================================================================
+
+class RuntimeTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    pipeline = gst_pipeline_new("runtime-test");
+    mux = gst_element_factory_make("funnel", "mux");
+    sink = gst_element_factory_make("fakesink", "sink");
+    ASSERT_NE(pipeline, nullptr);
+    ASSERT_NE(mux, nullptr);
+    ASSERT_NE(sink, nullptr);
+    g_object_set(G_OBJECT(sink), "sync", FALSE, "async", FALSE, nullptr);
+    gst_bin_add(GST_BIN(pipeline), mux);
+    gst_bin_add(GST_BIN(pipeline), sink);
+    ASSERT_TRUE(gst_element_link(mux, sink));
+    ASSERT_NE(gst_element_set_state(pipeline, GST_STATE_PLAYING), GST_STATE_CHANGE_FAILURE);
+  }
+
+  void TearDown() override {
+    gst_element_set_state(pipeline, GST_STATE_NULL);
+    gst_object_unref(pipeline);
+  }
+
+  static nonstd::expected<GstElement*, ds::Error> test_source(std::string_view /*uri*/, ds::SourceId /*id*/) {
+    GstElement* src = gst_element_factory_make("videotestsrc", nullptr);
+    if(src == nullptr) {
+      return nonstd::make_unexpected(ds::Error{ds::ErrorKind::ElementCreation, "videotestsrc unavailable"});
+    }
+    g_object_set(G_OBJECT(src), "is-live", TRUE, nullptr);
+    return src;
+  }
+
+  [[nodiscard]] ds::SourceManager manager(std::uint32_t max_sources = 0) const {
+    auto result = ds::SourceManager::attach(mux, {.make_source = &RuntimeTest::test_source, .max_sources = max_sources});
+    EXPECT_TRUE(result.has_value());
+    return std::move(*result);
+  }
+
+  [[nodiscard]] guint children() const {
+    return GST_BIN_NUMCHILDREN(GST_BIN(pipeline));
+  }
+
+  GstElement* pipeline{nullptr};
+  GstElement* mux{nullptr};
+  GstElement* sink{nullptr};
+};
+
+// ============================================================================
+// SourceManager
+// ============================================================================
+
+TEST_F(RuntimeTest, SourceManagerRejectsUnusableMuxers) {
+  GstElement* loose = gst_element_factory_make("funnel", nullptr);
+  gst_object_ref_sink(loose);
+  auto not_in_bin = ds::SourceManager::attach(loose);
+  ASSERT_FALSE(not_in_bin.has_value());
+  EXPECT_EQ(not_in_bin.error().kind, ds::ErrorKind::InvalidArgument);
+  gst_object_unref(loose);
+
+  auto no_request_pads = ds::SourceManager::attach(sink);
+  ASSERT_FALSE(no_request_pads.has_value());
+  EXPECT_EQ(no_request_pads.error().kind, ds::ErrorKind::InvalidArgument);
+}
+
+TEST_F(RuntimeTest, SourceManagerAddsSourcesOnNumberedPads) {
+  auto sources = manager();
+  for(ds::SourceId expected = 0; expected < 3; ++expected) {
+    auto id = sources.add_source("test://");
+    ASSERT_TRUE(id.has_value()) << id.error().message;
+    EXPECT_EQ(*id, expected);
+  }
+  EXPECT_EQ(sources.size(), 3u);
+  EXPECT_EQ(children(), 5u);
+  EXPECT_EQ(sources.uri(1), "test://");
+
+  GstPad* pad = gst_element_get_static_pad(mux, "sink_2");
+  ASSERT_NE(pad, nullptr);
+  EXPECT_TRUE(gst_pad_is_linked(pad));
+  gst_object_unref(pad);
+
+  GstState state = GST_STATE_NULL;
+  gst_element_get_state(sources.source(2), &state, nullptr, GST_SECOND);
+  EXPECT_EQ(state, GST_STATE_PLAYING);
+}
+
+TEST_F(RuntimeTest, SourceManagerRemovesAndReusesIds) {
+  auto sources = manager();
+  ASSERT_TRUE(sources.add_source("a").has_value());
+  ASSERT_TRUE(sources.add_source("b").has_value());
+  ASSERT_TRUE(sources.add_source("c").has_value());
+
+  ASSERT_TRUE(sources.remove_source(1).has_value());
+  EXPECT_FALSE(sources.contains(1));
+  EXPECT_EQ(sources.ids(), (std::vector<ds::SourceId>{0, 2}));
+  GstPad* released = gst_element_get_static_pad(mux, "sink_1");
+  EXPECT_EQ(released, nullptr);
+
+  auto again = sources.add_source("d");
+  ASSERT_TRUE(again.has_value());
+  EXPECT_EQ(*again, 1u);
+
+  auto missing = sources.remove_source(42);
+  ASSERT_FALSE(missing.has_value());
+  EXPECT_EQ(missing.error().kind, ds::ErrorKind::InvalidArgument);
+}
+
+// The EOS must come out of the source's own streaming thread, after its last
+// buffer: nothing may reach the muxer pad behind it.
+TEST_F(RuntimeTest, SourceManagerDrainsTheStreamBeforeReleasingItsPad) {
+  struct Seen {
+    std::atomic<int> eos{0};
+    std::atomic<int> buffers_after_eos{0};
+  };
+  auto sources = manager();
+  auto id = sources.add_source("draining");
+  ASSERT_TRUE(id.has_value());
+  auto seen = std::make_shared<Seen>();
+  gst_pad_add_probe(
+      sources.sinkpad(*id),
+      static_cast<GstPadProbeType>(GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM),
+      [](GstPad* /*pad*/, GstPadProbeInfo* info, gpointer user_data) {
+        auto& s = **static_cast<std::shared_ptr<Seen>*>(user_data);
+        if((GST_PAD_PROBE_INFO_TYPE(info) & GST_PAD_PROBE_TYPE_BUFFER) != 0) {
+          s.buffers_after_eos += s.eos.load() > 0 ? 1 : 0;
+        } else if(GST_EVENT_TYPE(GST_PAD_PROBE_INFO_EVENT(info)) == GST_EVENT_EOS) {
+          ++s.eos;
+        }
+        return GST_PAD_PROBE_OK;
+      },
+      new std::shared_ptr<Seen>(seen),
+      [](gpointer data) { delete static_cast<std::shared_ptr<Seen>*>(data); });
+  std::this_thread::sleep_for(std::chrono::milliseconds{100});
+
+  ASSERT_TRUE(sources.remove_source(*id).has_value());
+  EXPECT_EQ(seen->eos.load(), 1);
+  EXPECT_EQ(seen->buffers_after_eos.load(), 0);
+  EXPECT_EQ(mux->numsinkpads, 0u);
+}
+
+TEST_F(RuntimeTest, SourceManagerChurnLeavesPipelineUnchanged) {
+  auto sources = manager();
+  ASSERT_TRUE(sources.add_source("steady").has_value());
+  const auto baseline = children();
+
+  for(int i = 0; i < 50; ++i) {
+    auto id = sources.add_source("churn");
+    ASSERT_TRUE(id.has_value()) << id.error().message;
+    EXPECT_EQ(*id, 1u);
+    ASSERT_TRUE(sources.remove_source(*id).has_value());
+  }
+  EXPECT_EQ(children(), baseline);
+  EXPECT_EQ(mux->numsinkpads, 1u);
+
+  GstState state = GST_STATE_NULL;
+  gst_element_get_state(pipeline, &state, nullptr, GST_SECOND);
+  EXPECT_EQ(state, GST_STATE_PLAYING);
+}
+
+TEST_F(RuntimeTest, SourceManagerHonoursLimit) {
+  auto sources = manager(1);
+  ASSERT_TRUE(sources.add_source("one").has_value());
+  auto second = sources.add_source("two");
+  ASSERT_FALSE(second.has_value());
+  EXPECT_EQ(second.error().kind, ds::ErrorKind::InvalidArgument);
+  EXPECT_EQ(sources.size(), 1u);
+}
+
+TEST(RuntimeDetailTest, LogErrorReportsItsCaller) {
+  ds::DebugMessage seen;
+  ds::DebugLayer::instance().set_callback([&seen](const ds::DebugMessage& m) { seen = m; });
+  const int line = __LINE__ + 1;
+  const auto error = ds::detail::log_error(ds::ErrorKind::ElementState, "stuck");
+  ds::DebugLayer::instance().clear_callback();
+  EXPECT_EQ(error.message, "stuck");
+  EXPECT_EQ(seen.kind, ds::ErrorKind::ElementState);
+  EXPECT_EQ(seen.file, __FILE__);
+  EXPECT_EQ(seen.line, line);
+}
+
+// ============================================================================
+// SourceSupervisor
+// ============================================================================
+
+TEST(BackoffPolicyTest, GrowsCapsAndJitters) {
+  const ds::BackoffPolicy policy{.initial = std::chrono::milliseconds{100},
+                                 .max_delay = std::chrono::milliseconds{1000},
+                                 .multiplier = 2.0,
+                                 .jitter = 0.5};
+  EXPECT_EQ(policy.delay(0, 0.5), std::chrono::milliseconds{100});
+  EXPECT_EQ(policy.delay(3, 0.5), std::chrono::milliseconds{800});
+  EXPECT_EQ(policy.delay(10, 0.5), std::chrono::milliseconds{1000});
+  EXPECT_EQ(policy.delay(0, 0.0), std::chrono::milliseconds{50});
+  EXPECT_EQ(policy.delay(10, 1.0), std::chrono::milliseconds{1500});
+}
+
+TEST_F(RuntimeTest, SupervisorRejectsBadBackoff) {
+  auto supervisor = ds::SourceSupervisor::create(manager(), {.backoff = {.multiplier = 0.5}});
+  ASSERT_FALSE(supervisor.has_value());
+  EXPECT_EQ(supervisor.error().kind, ds::ErrorKind::InvalidArgument);
+}
+
+TEST_F(RuntimeTest, SupervisorRebuildsSourceOnError) {
+  auto supervisor = ds::SourceSupervisor::create(manager(), {.seed = 7}).value();
+  ASSERT_TRUE(supervisor.add_source("steady").has_value());
+  auto id = supervisor.add_source("flapping");
+  ASSERT_TRUE(id.has_value());
+  GstElement* before = supervisor.manager().source(*id);
+  GstElement* steady = supervisor.manager().source(0);
+
+  GError* error = g_error_new_literal(GST_RESOURCE_ERROR, GST_RESOURCE_ERROR_READ, "camera went away");
+  GstMessage* message = gst_message_new_error(GST_OBJECT(before), error, nullptr);
+  g_error_free(error);
+  EXPECT_TRUE(supervisor.handle_message(message));
+  gst_message_unref(message);
+
+  auto status = supervisor.status(*id);
+  ASSERT_TRUE(status.has_value());
+  EXPECT_EQ(status->health, ds::SourceHealth::Backoff);
+  EXPECT_EQ(status->last_error, "camera went away");
+  EXPECT_EQ(supervisor.status(0)->health, ds::SourceHealth::Running);
+
+  EXPECT_EQ(supervisor.poll(status->retry_at), 1u);
+  status = supervisor.status(*id);
+  EXPECT_EQ(status->health, ds::SourceHealth::Running);
+  EXPECT_EQ(status->restarts, 1u);
+  EXPECT_NE(supervisor.manager().source(*id), before);
+  EXPECT_EQ(supervisor.manager().source(0), steady);
+
+  GstState state = GST_STATE_NULL;
+  gst_element_get_state(pipeline, &state, nullptr, GST_SECOND);
+  EXPECT_EQ(state, GST_STATE_PLAYING);
+}
+
+TEST_F(RuntimeTest, SupervisorIgnoresErrorsOutsideSources) {
+  auto supervisor = ds::SourceSupervisor::create(manager()).value();
+  ASSERT_TRUE(supervisor.add_source("cam").has_value());
+  GError* error = g_error_new_literal(GST_CORE_ERROR, GST_CORE_ERROR_FAILED, "sink broke");
+  GstMessage* message = gst_message_new_error(GST_OBJECT(sink), error, nullptr);
+  g_error_free(error);
+  EXPECT_FALSE(supervisor.handle_message(message));
+  gst_message_unref(message);
+  EXPECT_FALSE(supervisor.next_retry().has_value());
+}
+
+TEST_F(RuntimeTest, SupervisorRestartsSourceAfterEos) {
+  auto factory = [](std::string_view /*uri*/, ds::SourceId /*id*/) -> nonstd::expected<GstElement*, ds::Error> {
+    GstElement* src = gst_element_factory_make("videotestsrc", nullptr);
+    g_object_set(G_OBJECT(src), "is-live", TRUE, "num-buffers", 3, nullptr);
+    return src;
+  };
+  auto sources = ds::SourceManager::attach(mux, {.make_source = factory}).value();
+  auto supervisor =
+      ds::SourceSupervisor::create(std::move(sources), {.backoff = {.initial = std::chrono::milliseconds{10}}}).value();
+  auto id = supervisor.add_source("short-file");
+  ASSERT_TRUE(id.has_value());
+
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{10};
+  while(supervisor.status(*id)->restarts < 2 && std::chrono::steady_clock::now() < deadline) {
+    supervisor.poll();
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+  }
+  EXPECT_GE(supervisor.status(*id)->restarts, 2u);
+
+  GstState state = GST_STATE_NULL;
+  gst_element_get_state(pipeline, &state, nullptr, GST_SECOND);
+  EXPECT_EQ(state, GST_STATE_PLAYING);
+  supervisor.stop();
+}
+
+TEST_F(RuntimeTest, SupervisorGivesUpAfterMaxAttempts) {
+  auto builds = std::make_shared<int>(0);
+  auto factory = [builds](std::string_view uri, ds::SourceId id) -> nonstd::expected<GstElement*, ds::Error> {
+    if((*builds)++ > 0) {
+      return nonstd::make_unexpected(ds::Error{ds::ErrorKind::ElementCreation, "camera unreachable"});
+    }
+    return RuntimeTest::test_source(uri, id);
+  };
+  auto sources = ds::SourceManager::attach(mux, {.make_source = factory}).value();
+  auto supervisor = ds::SourceSupervisor::create(std::move(sources), {.backoff = {.max_attempts = 2}}).value();
+  auto id = supervisor.add_source("cam");
+  ASSERT_TRUE(id.has_value());
+
+  GError* error = g_error_new_literal(GST_RESOURCE_ERROR, GST_RESOURCE_ERROR_OPEN_READ, "lost");
+  GstMessage* message = gst_message_new_error(GST_OBJECT(supervisor.manager().source(*id)), error, nullptr);
+  g_error_free(error);
+  EXPECT_TRUE(supervisor.handle_message(message));
+
+  const auto later = std::chrono::steady_clock::now() + std::chrono::hours{1};
+  EXPECT_EQ(supervisor.poll(later), 0u);
+  EXPECT_EQ(supervisor.status(*id)->health, ds::SourceHealth::Backoff);
+  EXPECT_EQ(supervisor.poll(later + std::chrono::hours{1}), 0u);
+  EXPECT_EQ(supervisor.status(*id)->health, ds::SourceHealth::Failed);
+  EXPECT_EQ(supervisor.status(*id)->attempts, 2u);
+  EXPECT_EQ(supervisor.manager().source(*id), nullptr);
+
+  // The torn-down element's late ERROR is not the application's problem.
+  EXPECT_TRUE(supervisor.handle_message(message));
+  gst_message_unref(message);
+
+  *builds = 0;
+  ASSERT_TRUE(supervisor.restart(*id).has_value());
+  EXPECT_EQ(supervisor.poll(later), 1u);
+  EXPECT_EQ(supervisor.status(*id)->health, ds::SourceHealth::Running);
+}
+
+// ============================================================================
+// LoadShedder
+// ============================================================================
+
+// Runs videotestsrc num-buffers=N ! fakesink to EOS with the shedder on the sink pad.
+std::optional<ds::ShedStats> shed_run(ds::ShedAction action, int buffers) {
+  GstElement* pipeline = gst_parse_launch(
+      fmt::format("videotestsrc num-buffers={} ! fakesink name=sink sync=false", buffers).c_str(), nullptr);
+  GstElement* sink = gst_bin_get_by_name(GST_BIN(pipeline), "sink");
+  GstPad* pad = gst_element_get_static_pad(sink, "sink");
+  auto shedder = ds::LoadShedder::create().value();
+  EXPECT_TRUE(shedder.attach(0, pad).has_value());
+  EXPECT_TRUE(shedder.set_action(0, action).has_value());
+
+  gst_element_set_state(pipeline, GST_STATE_PLAYING);
+  GstBus* bus = gst_element_get_bus(pipeline);
+  GstMessage* done = gst_bus_timed_pop_filtered(bus, 10 * GST_SECOND,
+                                                static_cast<GstMessageType>(GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+  EXPECT_NE(done, nullptr);
+  if(done != nullptr) {
+    gst_message_unref(done);
+  }
+  gst_element_set_state(pipeline, GST_STATE_NULL);
+  auto stats = shedder.stats(0);
+  gst_object_unref(bus);
+  gst_object_unref(pad);
+  gst_object_unref(sink);
+  gst_object_unref(pipeline);
+  return stats;
+}
+
+TEST(LoadShedderTest, IntervalPassesOneInN) {
+  const auto stats = shed_run({ds::ShedMode::Interval, 4}, 20);
+  ASSERT_TRUE(stats.has_value());
+  EXPECT_EQ(stats->passed, 5u);
+  EXPECT_EQ(stats->dropped, 15u);
+}
+
+TEST(LoadShedderTest, PauseDropsEverything) {
+  const auto stats = shed_run({ds::ShedMode::Pause}, 10);
+  ASSERT_TRUE(stats.has_value());
+  EXPECT_EQ(stats->passed, 0u);
+  EXPECT_EQ(stats->dropped, 10u);
+}
+
+TEST(LoadShedderTest, KeyframesOnlyKeepsRawFrames) {
+  const auto stats = shed_run({ds::ShedMode::KeyframesOnly}, 10);
+  ASSERT_TRUE(stats.has_value());
+  EXPECT_EQ(stats->passed, 10u);
+}
+
+TEST(LoadShedderTest, LevelShedsLowestPriorityFirst) {
+  std::vector<GstPad*> pads;
+  auto shedder = ds::LoadShedder::create().value();
+  for(ds::SourceId id = 0; id < 3; ++id) {
+    pads.push_back(GST_PAD(gst_object_ref_sink(gst_pad_new(nullptr, GST_PAD_SINK))));
+    ASSERT_TRUE(shedder.attach(id, pads.back(), static_cast<int>(id) == 1 ? 0 : 10 * static_cast<int>(id)).has_value());
+  }
+  EXPECT_EQ(shedder.max_level(), 12u);
+
+  // Priorities: id 0 → 0, id 1 → 0, id 2 → 20. Ties go by id.
+  shedder.set_level(5);
+  EXPECT_EQ(shedder.stats(0)->action, (ds::ShedAction{ds::ShedMode::Pause, 1}));
+  EXPECT_EQ(shedder.stats(1)->action, (ds::ShedAction{ds::ShedMode::Interval, 2}));
+  EXPECT_EQ(shedder.stats(2)->action, ds::ShedAction{});
+
+  ASSERT_TRUE(shedder.set_priority(2, -1).has_value());
+  shedder.set_level(2);
+  EXPECT_EQ(shedder.stats(2)->action, (ds::ShedAction{ds::ShedMode::Interval, 4}));
+  EXPECT_EQ(shedder.stats(0)->action, ds::ShedAction{});
+
+  shedder.set_level(0);
+  EXPECT_EQ(shedder.stats(2)->action, ds::ShedAction{});
+
+  EXPECT_FALSE(shedder.set_action(9, {ds::ShedMode::Pause}).has_value());
+  EXPECT_FALSE(shedder.set_action(0, {ds::ShedMode::Interval, 0}).has_value());
+  shedder.detach(1);
+  EXPECT_FALSE(shedder.stats(1).has_value());
+
+  for(GstPad* pad : pads) {
+    gst_object_unref(pad);
+  }
+}
+
+// ============================================================================
+// FrameSkipController
+// ============================================================================
+
+struct SkipRecorder {
+  std::vector<std::pair<ds::SourceId, std::uint32_t>> calls;
+
+  ds::SkipActuator actuator() {
+    return [this](ds::SourceId id, std::uint32_t interval) { calls.emplace_back(id, interval); };
+  }
+};
+
+TEST(FrameSkipControllerTest, RejectsBadConfig) {
+  SkipRecorder recorder;
+  EXPECT_FALSE(ds::FrameSkipController::create({}, {}).has_value());
+  EXPECT_FALSE(ds::FrameSkipController::create({.low_water = 1.5}, recorder.actuator()).has_value());
+  EXPECT_FALSE(ds::FrameSkipController::create({.max_interval = 0}, recorder.actuator()).has_value());
+}
+
+TEST(FrameSkipControllerTest, SkipsLowPriorityFirstAndRelaxesInReverse) {
+  using namespace std::chrono_literals;
+  SkipRecorder recorder;
+  auto skip = ds::FrameSkipController::create({.target = 100ms, .max_interval = 3, .smoothing = 1.0, .hold = 1s},
+                                              recorder.actuator())
+                  .value();
+  skip.add_source(0, 10);
+  skip.add_source(1, 0);
+  skip.add_source(2, 5, 1);    // never skipped
+
+  auto t = std::chrono::steady_clock::time_point{} + 1h;
+  auto step = [&](std::chrono::milliseconds latency) {
+    t += 1s;
+    for(ds::SourceId id = 0; id < 3; ++id) {
+      skip.observe(id, latency, t);
+    }
+    return skip.tick(t);
+  };
+
+  EXPECT_EQ(step(150ms), 1u);
+  EXPECT_FALSE(skip.tick(t + 500ms).has_value());    // hold
+  EXPECT_EQ(step(150ms), 1u);
+  EXPECT_EQ(step(150ms), 0u);    // source 1 is at its cap
+  EXPECT_EQ(step(150ms), 0u);
+  EXPECT_FALSE(step(150ms).has_value());    // everything skippable is at its cap
+  EXPECT_EQ(skip.source(2)->interval, 1u);
+
+  EXPECT_FALSE(step(80ms).has_value());    // inside the hysteresis band
+  EXPECT_EQ(step(50ms), 0u);
+  EXPECT_EQ(step(50ms), 0u);
+  EXPECT_EQ(step(50ms), 1u);
+
+  const std::vector<std::pair<ds::SourceId, std::uint32_t>> expected{{1, 2}, {1, 3}, {0, 2}, {0, 3}, {0, 2}, {0, 1}, {1, 2}};
+  EXPECT_EQ(recorder.calls, expected);
+}
+
+TEST(FrameSkipControllerTest, IgnoresStaleSamples) {
+  using namespace std::chrono_literals;
+  SkipRecorder recorder;
+  auto skip = ds::FrameSkipController::create({.target = 100ms, .stale_after = 2s}, recorder.actuator()).value();
+  skip.add_source(0);
+  const auto t = std::chrono::steady_clock::time_point{} + 1h;
+  skip.observe(0, 500ms, t);
+  EXPECT_FALSE(skip.tick(t + 3s).has_value());
+  EXPECT_TRUE(recorder.calls.empty());
+}
+
+TEST(FrameSkipControllerTest, SmoothsSamples) {
+  using namespace std::chrono_literals;
+  SkipRecorder recorder;
+  auto skip = ds::FrameSkipController::create({.smoothing = 0.5}, recorder.actuator()).value();
+  skip.add_source(3);
+  skip.observe(3, 100ms);
+  skip.observe(3, 200ms);
+  EXPECT_EQ(skip.source(3)->latency, std::chrono::nanoseconds{150ms});
+  skip.observe(9, 1s);    // unknown sources are ignored
+  EXPECT_FALSE(skip.source(9).has_value());
+}
+
+TEST(FrameSkipControllerTest, DrivesLoadShedder) {
+  using namespace std::chrono_literals;
+  GstPad* pad = GST_PAD(gst_object_ref_sink(gst_pad_new(nullptr, GST_PAD_SINK)));
+  auto shedder = ds::LoadShedder::create().value();
+  ASSERT_TRUE(shedder.attach(0, pad).has_value());
+  auto skip = ds::FrameSkipController::create({.target = 10ms}, ds::skip_with(shedder)).value();
+  skip.add_source(0);
+  skip.observe(0, 50ms);
+  EXPECT_EQ(skip.tick(), 0u);
+  EXPECT_EQ(shedder.stats(0)->action, (ds::ShedAction{ds::ShedMode::Interval, 2}));
+  gst_object_unref(pad);
+}
+
+// ============================================================================
+// CapacityModel
+// ============================================================================
+
+// A window of `frames` frames over one second with the given per-frame costs.
+ds::CapacitySample window(std::uint64_t frames, std::chrono::nanoseconds cpu_per_frame, std::chrono::nanoseconds busy_per_frame,
+                          std::uint32_t sources) {
+  const auto n = static_cast<std::int64_t>(frames);
+  return {std::chrono::seconds{1}, frames, cpu_per_frame * n, busy_per_frame * n, sources};
+}
+
+TEST(CapacityModelTest, UnknownUntilMinSamples) {
+  auto model = ds::CapacityModel::create({.cpu_budget = 1.0, .min_samples = 2}).value();
+  EXPECT_TRUE(model.admit(100).has_value());
+  model.record(window(100, std::chrono::milliseconds{1}, {}, 4));
+  EXPECT_FALSE(model.estimate().known());
+  model.record({});    // no frames: ignored
+  EXPECT_EQ(model.estimate().samples, 1u);
+
+  auto strict = ds::CapacityModel::create({.admit_when_unknown = false}).value();
+  auto refused = strict.admit(0);
+  ASSERT_FALSE(refused.has_value());
+  EXPECT_EQ(refused.error().kind, ds::ErrorKind::Capacity);
+}
+
+TEST(CapacityModelTest, RejectsBadConfig) {
+  for(const auto& config : {ds::CapacityModelConfig{.fps_target = 0.0},
+                            ds::CapacityModelConfig{.fps_target = std::numeric_limits<double>::infinity()},
+                            ds::CapacityModelConfig{.cpu_budget = -1.0},
+                            ds::CapacityModelConfig{.stage_budget = 0.0},
+                            ds::CapacityModelConfig{.smoothing = 0.0},
+                            ds::CapacityModelConfig{.smoothing = 1.5},
+                            ds::CapacityModelConfig{.smoothing = std::numeric_limits<double>::quiet_NaN()}}) {
+    auto model = ds::CapacityModel::create(config);
+    ASSERT_FALSE(model.has_value());
+    EXPECT_EQ(model.error().kind, ds::ErrorKind::InvalidArgument);
+  }
+  EXPECT_TRUE(ds::CapacityModel::create().has_value());
+}
+
+TEST(CapacityModelTest, CpuBoundPrediction) {
+  // 1 ms of CPU per frame on a budget of 1 CPU: 1000 frames/s, 40 sources at 25 fps.
+  auto model = ds::CapacityModel::create({.fps_target = 25.0, .cpu_budget = 1.0, .min_samples = 1}).value();
+  model.record(window(100, std::chrono::milliseconds{1}, {}, 4));
+  const auto est = model.estimate();
+  EXPECT_NEAR(est.max_fps, 1000.0, 1e-6);
+  EXPECT_EQ(est.max_sources, 40u);
+  EXPECT_NEAR(est.achieved_fps, 25.0, 1e-9);
+  EXPECT_TRUE(model.admit(39).has_value());
+  auto refused = model.admit(40);
+  ASSERT_FALSE(refused.has_value());
+  EXPECT_EQ(refused.error().kind, ds::ErrorKind::Capacity);
+}
+
+TEST(CapacityModelTest, StageTimeLimitsBelowCpu) {
+  // 4 ms of stage time per frame at 90% budget: 225 frames/s, 9 sources at 25 fps.
+  auto model = ds::CapacityModel::create({.fps_target = 25.0, .cpu_budget = 8.0, .stage_budget = 0.9, .min_samples = 1}).value();
+  model.record(window(100, std::chrono::milliseconds{1}, std::chrono::milliseconds{4}, 4));
+  EXPECT_NEAR(model.estimate().max_fps, 225.0, 1e-6);
+  EXPECT_EQ(model.estimate().max_sources, 9u);
+}
+
+TEST(CapacityModelTest, SmoothsCosts) {
+  auto model = ds::CapacityModel::create({.cpu_budget = 1.0, .smoothing = 0.5, .min_samples = 1}).value();
+  model.record(window(10, std::chrono::milliseconds{2}, {}, 1));
+  model.record(window(10, std::chrono::milliseconds{4}, {}, 1));
+  EXPECT_NEAR(model.estimate().cpu_per_frame_ns, 3e6, 1.0);
+}
+
+TEST_F(RuntimeTest, SourceManagerAsksAdmission) {
+  auto model = ds::CapacityModel::create({.fps_target = 25.0, .cpu_budget = 1.0, .min_samples = 1}).value();
+  model.record(window(100, std::chrono::milliseconds{20}, {}, 1));    // 50 frames/s: two sources fit
+  auto sources =
+      ds::SourceManager::attach(mux, {.make_source = &RuntimeTest::test_source, .admit = model.admission()}).value();
+  ASSERT_TRUE(sources.add_source("a").has_value());
+  ASSERT_TRUE(sources.add_source("b").has_value());
+  auto third = sources.add_source("c");
+  ASSERT_FALSE(third.has_value());
+  EXPECT_EQ(third.error().kind, ds::ErrorKind::Capacity);
+  EXPECT_EQ(sources.size(), 2u);
+}
+
+TEST_F(RuntimeTest, CapacitySamplerCountsFrames) {
+  GstPad* pad = gst_element_get_static_pad(sink, "sink");
+  auto sampler = ds::CapacitySampler::attach(pad, [](GstBuffer*) { return 4U; }).value();
+  gst_object_unref(pad);
+  auto sources = manager();
+  ASSERT_TRUE(sources.add_source("a").has_value());
+  std::this_thread::sleep_for(std::chrono::milliseconds{300});
+  const auto sample = sampler.sample(sources.size());
+  EXPECT_GT(sample.frames, 0u);
+  EXPECT_EQ(sample.frames % 4, 0u);
+  EXPECT_GT(sample.wall, std::chrono::milliseconds{250});
+  EXPECT_EQ(sample.sources, 1u);
+}
+
+// ============================================================================
+// StreamMuxTuner
+// ============================================================================
+
+TEST(StreamMuxTunerTest, TimeoutFollowsFastestSourceAndJitter) {
+  using namespace std::chrono_literals;
+  const ds::StreamMuxTunerConfig config{.jitter_margin = 2.0, .min_timeout = 5ms, .max_timeout = 100ms};
+  EXPECT_EQ(config.timeout_for(25.0, 0us), 40ms);
+  EXPECT_EQ(config.timeout_for(25.0, 3ms), 46ms);
+  EXPECT_EQ(config.timeout_for(1000.0, 0us), 5ms);
+  EXPECT_EQ(config.timeout_for(1.0, 0us), 100ms);
+  EXPECT_EQ(config.timeout_for(0.0, 0us), 100ms);
+}
+
+TEST_F(RuntimeTest, StreamMuxTunerMeasuresArrivalsAndBatches) {
+  auto sources = manager();
+  auto tuner = ds::StreamMuxTuner::attach(mux).value();
+  for(int i = 0; i < 2; ++i) {
+    auto id = sources.add_source("cam");
+    ASSERT_TRUE(id.has_value());
+    ASSERT_TRUE(tuner.watch(sources, *id).has_value());
+  }
+  std::this_thread::sleep_for(std::chrono::seconds{1});
+
+  const auto timing = tuner.timing(0);
+  ASSERT_TRUE(timing.has_value());
+  EXPECT_GT(timing->frames, 10u);
+  EXPECT_NEAR(timing->fps, 30.0, 10.0);    // videotestsrc default framerate
+
+  const auto report = tuner.tune();
+  EXPECT_TRUE(report.changed);
+  EXPECT_GT(report.batches, 0u);
+  EXPECT_EQ(report.batch_size, 2u);    // funnel has no batch-size: one batch per source
+  EXPECT_NEAR(report.fill_ratio, 0.5, 1e-9);
+  EXPECT_GE(report.timeout, std::chrono::milliseconds{25});
+
+  const auto again = tuner.tune();
+  EXPECT_FALSE(again.changed);    // within change_threshold
+  EXPECT_EQ(again.timeout, report.timeout);
+
+  tuner.unwatch(1);
+  EXPECT_FALSE(tuner.timing(1).has_value());
+}
+
+TEST(StreamMuxTunerTest, RejectsMuxerWithoutSrcPad) {
+  GstElement* sink = gst_element_factory_make("fakesink", nullptr);
+  gst_object_ref_sink(sink);
+  auto tuner = ds::StreamMuxTuner::attach(sink);
+  ASSERT_FALSE(tuner.has_value());
+  EXPECT_EQ(tuner.error().kind, ds::ErrorKind::InvalidArgument);
+  gst_object_unref(sink);
+}
+
+// ============================================================================
+// SourceTimingMonitor
+// ============================================================================
+
+// Feeds `frames` buffers 40 ms apart in PTS; arrival(i) gives each arrival time.
+template <std::invocable<int> Arrival>
+void feed(ds::detail::TimingCounters& counters, int frames, Arrival arrival) {
+  for(int i = 0; i < frames; ++i) {
+    counters.on_buffer(static_cast<std::uint64_t>(i) * 40'000'000, arrival(i));
+  }
+}
+
+TEST(SourceTimingMonitorTest, SteadySourceHasNoJitterOrDrift) {
+  ds::detail::TimingCounters counters;
+  feed(counters, 50, [](int i) { return 1'000'000'000 + std::int64_t{i} * 40'000'000; });
+  const auto t = counters.snapshot();
+  EXPECT_EQ(t.buffers, 50u);
+  EXPECT_NEAR(t.fps, 25.0, 1e-6);
+  EXPECT_NEAR(t.pts_fps, 25.0, 1e-6);
+  EXPECT_EQ(t.jitter.count(), 0);
+  EXPECT_EQ(t.drift.count(), 0);
+  EXPECT_EQ(t.pts_gaps + t.duplicate_pts + t.backwards_pts + t.missing_pts, 0u);
+}
+
+TEST(SourceTimingMonitorTest, TellsNetworkJitterFromSlowPipeline) {
+  using namespace std::chrono_literals;
+  // Network jitter: arrivals alternate 10 ms early and late, on average on time.
+  ds::detail::TimingCounters jittery;
+  feed(jittery, 200, [](int i) {
+    return 1'000'000'000 + std::int64_t{i} * 40'000'000 + (i % 2 == 0 ? -10'000'000 : 10'000'000);
+  });
+  const auto network = jittery.snapshot();
+  EXPECT_GT(network.jitter, 15ms);    // |step - 40 ms| is 20 ms every frame
+  EXPECT_LE(network.drift, 20ms);
+
+  // Slow pipeline: every frame arrives 2 ms later than the one before relative to its PTS.
+  ds::detail::TimingCounters slow;
+  feed(slow, 200, [](int i) { return 1'000'000'000 + std::int64_t{i} * 42'000'000; });
+  const auto lagging = slow.snapshot();
+  EXPECT_LT(lagging.jitter, 3ms);
+  EXPECT_EQ(lagging.drift, 199 * 2ms);
+  EXPECT_NEAR(lagging.fps, 1e9 / 42e6, 1e-6);
+  EXPECT_NEAR(lagging.pts_fps, 25.0, 1e-6);
+}
+
+TEST(SourceTimingMonitorTest, CountsGapsDuplicatesAndRestarts) {
+  using namespace std::chrono_literals;
+  ds::detail::TimingCounters counters;
+  constexpr std::uint64_t ms = 1'000'000;
+  const std::vector<std::optional<std::uint64_t>> pts{
+      0, 40 * ms, 80 * ms, 80 * ms, 120 * ms, 280 * ms, 320 * ms, std::nullopt, 360 * ms, 0, 40 * ms};
+  std::int64_t now = 1'000'000'000;
+  for(const auto& p : pts) {
+    counters.on_buffer(p, now);
+    now += 40'000'000;
+  }
+  const auto t = counters.snapshot();
+  EXPECT_EQ(t.buffers, pts.size());
+  EXPECT_EQ(t.duplicate_pts, 1u);
+  EXPECT_EQ(t.pts_gaps, 1u);
+  EXPECT_EQ(t.max_gap, 160ms);
+  EXPECT_EQ(t.missing_pts, 1u);
+  EXPECT_EQ(t.backwards_pts, 1u);
+  EXPECT_EQ(t.drift, 0ms);    // rebased on the restart
+}
+
+TEST(SourceTimingMonitorTest, AdaptsToALowerFrameRate) {
+  using namespace std::chrono_literals;
+  ds::detail::TimingCounters counters;
+  std::uint64_t pts = 0;
+  std::int64_t now = 1'000'000'000;
+  for(int i = 0; i < 100; ++i) {
+    const std::int64_t step = i < 50 ? 40'000'000 : 80'000'000;    // the camera halves its rate
+    counters.on_buffer(pts, now);
+    pts += static_cast<std::uint64_t>(step);
+    now += step;
+  }
+  const auto t = counters.snapshot();
+  EXPECT_EQ(t.pts_gaps, 2u);    // rate_change_gaps - 1, then the mean starts over
+  EXPECT_NEAR(t.pts_fps, 12.5, 1e-6);
+  EXPECT_LT(t.jitter, 1ms);
+  EXPECT_EQ(t.drift, 0ms);
+}
+
+TEST_F(RuntimeTest, SourceTimingMonitorTimesLiveSource) {
+  auto sources = manager();
+  ds::SourceTimingMonitor timing;
+  auto id = sources.add_source("cam");
+  ASSERT_TRUE(id.has_value());
+  ASSERT_TRUE(timing.watch(sources, *id).has_value());
+  std::this_thread::sleep_for(std::chrono::seconds{1});
+
+  const auto t = timing.timing(*id);
+  ASSERT_TRUE(t.has_value());
+  EXPECT_GT(t->buffers, 10u);
+  EXPECT_NEAR(t->fps, 30.0, 10.0);
+  EXPECT_NEAR(t->pts_fps, 30.0, 1.0);
+  EXPECT_EQ(t->pts_gaps + t->duplicate_pts + t->backwards_pts + t->missing_pts, 0u);
+  EXPECT_EQ(timing.snapshot().size(), 1u);
+
+  timing.unwatch(*id);
+  EXPECT_FALSE(timing.timing(*id).has_value());
+  EXPECT_FALSE(timing.watch(7, nullptr).has_value());
+}
+
+// ============================================================================
+// SnapshotEncoder
+// ============================================================================
+
+// A grey RGB frame and its caps, as a probe after videoconvert would see them.
+struct RawFrame {
+  RawFrame(int width, int height)
+      : buffer(gst_buffer_new_allocate(nullptr, static_cast<gsize>(width) * static_cast<gsize>(height) * 3, nullptr)),
+        caps(gst_caps_from_string(
+            fmt::format("video/x-raw,format=RGB,width={},height={},framerate=0/1", width, height).c_str())) {
+    GstMapInfo map;
+    gst_buffer_map(buffer, &map, GST_MAP_WRITE);
+    std::memset(map.data, 0x80, map.size);
+    gst_buffer_unmap(buffer, &map);
+  }
+  ~RawFrame() {
+    gst_buffer_unref(buffer);
+    gst_caps_unref(caps);
+  }
+  RawFrame(const RawFrame&) = delete;
+  RawFrame& operator=(const RawFrame&) = delete;
+
+  GstBuffer* buffer;
+  GstCaps* caps;
+};
+
+TEST(SnapshotEncoderTest, RejectsBadConfig) {
+  EXPECT_FALSE(ds::SnapshotEncoder::create({.pipelines = 0}).has_value());
+  EXPECT_FALSE(ds::SnapshotEncoder::create({.queue_depth = 0}).has_value());
+  EXPECT_FALSE(ds::SnapshotEncoder::create({.timeout = std::chrono::milliseconds{0}}).has_value());
+}
+
+TEST(SnapshotEncoderTest, EncodesJpegRepeatedlyWithOnePipeline) {
+  auto encoder = ds::SnapshotEncoder::create().value();
+  const RawFrame small{64, 48};
+  const RawFrame large{320, 240};
+  for(const auto* frame : {&small, &large, &small}) {
+    auto image = encoder.encode(frame->buffer, frame->caps).get();
+    ASSERT_TRUE(image.has_value()) << image.error().what();
+    ASSERT_GT(image->data.size(), 2u);
+    EXPECT_EQ(image->data[0], std::byte{0xFF});    // SOI marker
+    EXPECT_EQ(image->data[1], std::byte{0xD8});
+  }
+  const auto image = encoder.encode(large.buffer, large.caps).get();
+  ASSERT_TRUE(image.has_value());
+  EXPECT_EQ(image->width, 320);
+  EXPECT_EQ(image->height, 240);
+  EXPECT_EQ(encoder.stats().encoded, 4u);
+}
+
+TEST(SnapshotEncoderTest, SavesPngFiles) {
+  auto encoder = ds::SnapshotEncoder::create({.format = ds::SnapshotFormat::Png, .pipelines = 2}).value();
+  const RawFrame frame{64, 48};
+  std::vector<std::string> paths;
+  std::vector<std::future<nonstd::expected<void, ds::Error>>> saved;
+  for(int i = 0; i < 4; ++i) {
+    paths.push_back(std::string{::testing::TempDir()} + fmt::format("snapshot_{}.png", i));
+    saved.push_back(encoder.save(frame.buffer, frame.caps, paths.back()));
+  }
+  for(std::size_t i = 0; i < saved.size(); ++i) {
+    const auto result = saved[i].get();
+    ASSERT_TRUE(result.has_value()) << result.error().what();
+    std::ifstream in{paths[i], std::ios::binary};
+    std::string magic(4, '\0');
+    in.read(magic.data(), 4);
+    EXPECT_EQ(magic, "\x89PNG");
+    std::remove(paths[i].c_str());
+  }
+}
+
+TEST(SnapshotEncoderTest, RefusesFramesBeyondQueueDepth) {
+  auto encoder = ds::SnapshotEncoder::create({.queue_depth = 1}).value();
+  const RawFrame frame{1920, 1080};
+  std::atomic<int> done{0};
+  int refused = 0;
+  for(int i = 0; i < 32; ++i) {
+    auto queued = encoder.submit(frame.buffer, frame.caps, [&done](auto) { done.fetch_add(1); });
+    if(!queued) {
+      EXPECT_EQ(queued.error().kind, ds::ErrorKind::Capacity);
+      ++refused;
+    }
+  }
+  EXPECT_GT(refused, 0);
+  encoder.close();    // drains what was accepted
+  const auto stats = encoder.stats();
+  EXPECT_EQ(stats.submitted + stats.rejected, 32u);
+  EXPECT_EQ(stats.encoded, stats.submitted);
+  EXPECT_EQ(done.load(), static_cast<int>(stats.submitted));
+  EXPECT_FALSE(encoder.submit(frame.buffer, frame.caps, {}).has_value());
+}
+
+TEST(SnapshotEncoderTest, ReportsUnencodableFrames) {
+  auto encoder = ds::SnapshotEncoder::create({.timeout = std::chrono::milliseconds{500}}).value();
+  GstBuffer* buffer = gst_buffer_new_allocate(nullptr, 16, nullptr);
+  GstCaps* caps = gst_caps_from_string("audio/x-raw,format=S16LE,rate=8000,channels=1,layout=interleaved");
+  const auto image = encoder.encode(buffer, caps).get();
+  EXPECT_FALSE(image.has_value());
+  EXPECT_EQ(encoder.stats().failed, 1u);
+
+  const RawFrame frame{64, 48};    // the pipeline restarted and encodes again
+  EXPECT_TRUE(encoder.encode(frame.buffer, frame.caps).get().has_value());
+  gst_buffer_unref(buffer);
+  gst_caps_unref(caps);
+}
+
+// ============================================================================
+// EventRecorder
+// ============================================================================
+
+// An encoded unit of `size` bytes at `ms`; keyframes lack DELTA_UNIT.
+void push_unit(ds::detail::GopRing& ring, std::uint64_t ms, bool keyframe, gsize size = 100) {
+  GstBuffer* buffer = gst_buffer_new_allocate(nullptr, size, nullptr);
+  GST_BUFFER_PTS(buffer) = ms * GST_MSECOND;
+  if(!keyframe) {
+    GST_BUFFER_FLAG_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+  }
+  ring.push(buffer, GST_BUFFER_PTS(buffer), keyframe);
+  gst_buffer_unref(buffer);
+}
+
+TEST(EventRecorderTest, RingStartsAtKeyframeAndCoversWindow) {
+  using namespace std::chrono_literals;
+  ds::detail::GopRing ring{1s, std::size_t{1} << 20};
+  push_unit(ring, 0, false);    // nothing decodes this one
+  EXPECT_TRUE(ring.empty());
+  for(std::uint64_t i = 1; i <= 100; ++i) {
+    push_unit(ring, i * 40, i % 10 == 1);    // GOPs of 10 units (400 ms) starting at unit 1
+  }
+  const auto units = ring.copy();
+  ASSERT_FALSE(units.empty());
+  EXPECT_FALSE(GST_BUFFER_FLAG_IS_SET(units.front().buffer.get(), GST_BUFFER_FLAG_DELTA_UNIT));
+  EXPECT_GE(ring.duration(), 1s);
+  EXPECT_LT(ring.duration(), 1s + 400ms);
+  EXPECT_EQ(ring.units(), units.size());
+  EXPECT_EQ(ring.bytes(), units.size() * 100);
+  EXPECT_GT(ring.gops_dropped(), 0u);
+}
+
+TEST(EventRecorderTest, RingNeverExceedsMaxBytes) {
+  using namespace std::chrono_literals;
+  ds::detail::GopRing ring{10s, 2500};
+  for(std::uint64_t i = 0; i < 100; ++i) {
+    push_unit(ring, i * 40, i % 10 == 0);
+    EXPECT_LE(ring.bytes(), 2500u);
+  }
+  EXPECT_EQ(ring.gops(), 2u);    // the oldest 1000-byte GOP goes once a third would overflow
+  EXPECT_EQ(ring.overflows(), 0u);
+
+  ds::detail::GopRing tiny{10s, 500};
+  for(std::uint64_t i = 0; i < 10; ++i) {
+    push_unit(tiny, i * 40, i == 0);
+  }
+  EXPECT_TRUE(tiny.empty());    // one GOP over the limit: dropped until the next keyframe
+  EXPECT_EQ(tiny.overflows(), 1u);
+}
+
+class EventRecorderLiveTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    pipeline = gst_parse_launch("videotestsrc is-live=true ! video/x-raw,width=160,height=120,framerate=30/1 ! jpegenc ! "
+                                "identity name=encoded ! fakesink sync=false",
+                                nullptr);
+    ASSERT_NE(pipeline, nullptr);
+    GstElement* encoded = gst_bin_get_by_name(GST_BIN(pipeline), "encoded");
+    pad = gst_element_get_static_pad(encoded, "src");
+    gst_object_unref(encoded);
+  }
+
+  void TearDown() override {
+    gst_element_set_state(pipeline, GST_STATE_NULL);
+    gst_object_unref(pad);
+    gst_object_unref(pipeline);
+  }
+
+  GstElement* pipeline{nullptr};
+  GstPad* pad{nullptr};
+};
+
+TEST_F(EventRecorderLiveTest, RecordsPreEventAndPostEvent) {
+  using namespace std::chrono_literals;
+  auto recorder = ds::EventRecorder::attach(pad, {.pre_event = 500ms, .container = ds::RecordContainer::Mkv}).value();
+  EXPECT_FALSE(recorder.trigger("never.mkv").get().has_value());    // no caps before the stream starts
+
+  ASSERT_NE(gst_element_set_state(pipeline, GST_STATE_PLAYING), GST_STATE_CHANGE_FAILURE);
+  std::this_thread::sleep_for(1s);
+  const auto path = std::string{::testing::TempDir()} + "event.mkv";
+  auto file = recorder.trigger(path, 300ms);
+  ASSERT_EQ(file.wait_for(5s), std::future_status::ready);
+  const auto result = file.get();
+  ASSERT_TRUE(result.has_value()) << result.error().what();
+  EXPECT_GE(result->pre_event, 500ms);
+  EXPECT_GE(result->duration, 800ms);
+  EXPECT_GT(result->units, 20u);
+
+  std::ifstream in{path, std::ios::binary};
+  std::string magic(4, '\0');
+  in.read(magic.data(), 4);
+  EXPECT_EQ(magic, "\x1A\x45\xDF\xA3");    // EBML header
+  std::remove(path.c_str());
+
+  const auto stats = recorder.stats();
+  EXPECT_EQ(stats.completed, 1u);
+  EXPECT_GT(stats.ring_units, 0u);
+}
+
+TEST_F(EventRecorderLiveTest, RefusesBeyondMaxRecordings) {
+  using namespace std::chrono_literals;
+  auto recorder = ds::EventRecorder::attach(pad, {.container = ds::RecordContainer::Mkv, .max_recordings = 1}).value();
+  ASSERT_NE(gst_element_set_state(pipeline, GST_STATE_PLAYING), GST_STATE_CHANGE_FAILURE);
+  std::this_thread::sleep_for(200ms);
+  const auto path = std::string{::testing::TempDir()} + "long.mkv";
+  auto first = recorder.trigger(path, 10s);
+  auto second = recorder.trigger(path + ".2", 10s);
+  ASSERT_EQ(second.wait_for(0s), std::future_status::ready);
+  const auto refused = second.get();
+  ASSERT_FALSE(refused.has_value());
+  EXPECT_EQ(refused.error().kind, ds::ErrorKind::Capacity);
+
+  recorder.stop();    // ends the first one early
+  const auto result = first.get();
+  ASSERT_TRUE(result.has_value()) << result.error().what();
+  EXPECT_LT(result->duration, 5s);
+  std::remove(path.c_str());
+}
+
+TEST(EventRecorderTest, ParameterSetsStopAtFirstSlice) {
+  using ds::detail::NalFormat;
+  // AUD, SPS, PPS, SEI, IDR slice, then an SPS after the slice that must be ignored.
+  const std::vector<std::uint8_t> h264{0, 0, 0, 1, 0x09, 0xF0,                // AUD
+                                       0, 0, 0, 1, 0x67, 0x42, 0x00, 0x1E,    // SPS
+                                       0, 0, 1, 0x68, 0xCE, 0x3C, 0x80,       // PPS, 3-byte start code
+                                       0, 0, 1, 0x06, 0x05, 0x01,             // SEI
+                                       0, 0, 0, 1, 0x65, 0x88, 0x84,          // IDR slice
+                                       0, 0, 1, 0x67, 0x99};
+  const std::vector<std::uint8_t> expected{0, 0, 0, 1, 0x67, 0x42, 0x00, 0x1E, 0, 0, 0, 1, 0x68, 0xCE, 0x3C, 0x80};
+  EXPECT_EQ(ds::detail::leading_parameter_sets(h264, NalFormat::H264), expected);
+  EXPECT_TRUE(ds::detail::leading_parameter_sets(h264, NalFormat::None).empty());
+
+  const std::vector<std::uint8_t> delta{0, 0, 0, 1, 0x41, 0x9A, 0x22};    // non-IDR slice only
+  EXPECT_TRUE(ds::detail::leading_parameter_sets(delta, NalFormat::H264).empty());
+
+  // VPS, SPS, PPS, then an IDR_W_RADL slice.
+  const std::vector<std::uint8_t> h265{0, 0, 0, 1, 0x40, 0x01, 0x0C,    // VPS
+                                       0, 0, 0, 1, 0x42, 0x01, 0x01,    // SPS
+                                       0, 0, 0, 1, 0x44, 0x01, 0xC1,    // PPS
+                                       0, 0, 0, 1, 0x26, 0x01, 0xAF};
+  const std::vector<std::uint8_t> h265_sets{h265.begin(), h265.begin() + 21};
+  EXPECT_EQ(ds::detail::leading_parameter_sets(h265, NalFormat::H265), h265_sets);
+}
+
+// h264parse converting avc to byte-stream sends SPS/PPS with the first
+// keyframe only, so once that GOP has left the ring the recorder must supply
+// them itself.
+TEST(EventRecorderTest, RecordingAfterRingWrapKeepsParameterSets) {
+  using namespace std::chrono_literals;
+  GstElement* pipeline =
+      gst_parse_launch("videotestsrc is-live=true ! video/x-raw,width=160,height=120,framerate=30/1 ! "
+                       "x264enc tune=zerolatency key-int-max=5 ! video/x-h264,stream-format=avc ! h264parse ! "
+                       "video/x-h264,stream-format=byte-stream,alignment=au ! identity name=encoded ! fakesink sync=false",
+                       nullptr);
+  ASSERT_NE(pipeline, nullptr);
+  GstElement* encoded = gst_bin_get_by_name(GST_BIN(pipeline), "encoded");
+  GstPad* pad = gst_element_get_static_pad(encoded, "src");
+  gst_object_unref(encoded);
+
+  // The SPS NAL unit of the first keyframe, as the stream sent it.
+  std::mutex mutex;
+  std::string sps;
+  const auto capture = +[](GstPad* /*pad*/, GstPadProbeInfo* info, gpointer data) {
+    auto& [m, out] = *static_cast<std::pair<std::mutex*, std::string*>*>(data);
+    GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+    GstMapInfo map;
+    if(GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT) || gst_buffer_map(buffer, &map, GST_MAP_READ) != TRUE) {
+      return GST_PAD_PROBE_OK;
+    }
+    const auto sets = ds::detail::leading_parameter_sets({map.data, map.size}, ds::detail::NalFormat::H264);
+    gst_buffer_unmap(buffer, &map);
+    const std::string text{sets.begin(), sets.end()};
+    std::lock_guard lk{*m};
+    if(out->empty() && text.size() > 4) {
+      *out = text.substr(4, text.find(std::string{"\0\0\0\1", 4}, 4) - 4);
+    }
+    return GST_PAD_PROBE_OK;
+  };
+  std::pair<std::mutex*, std::string*> capture_data{&mutex, &sps};
+  gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, capture, &capture_data, nullptr);
+
+  auto recorder = ds::EventRecorder::attach(pad, {.pre_event = 300ms, .container = ds::RecordContainer::Mkv}).value();
+  ASSERT_NE(gst_element_set_state(pipeline, GST_STATE_PLAYING), GST_STATE_CHANGE_FAILURE);
+  for(int i = 0; i < 100 && recorder.stats().gops_dropped < 3; ++i) {
+    std::this_thread::sleep_for(50ms);
+  }
+  ASSERT_GE(recorder.stats().gops_dropped, 3u);    // the GOP that carried the SPS is gone
+
+  const auto path = std::string{::testing::TempDir()} + "event_wrapped.mkv";
+  auto file = recorder.trigger(path, 200ms);
+  ASSERT_EQ(file.wait_for(5s), std::future_status::ready);
+  const auto result = file.get();
+  ASSERT_TRUE(result.has_value()) << result.error().what();
+  EXPECT_GT(result->units, 0u);
+  recorder.close();
+  gst_element_set_state(pipeline, GST_STATE_NULL);
+
+  std::ifstream in{path, std::ios::binary};
+  const std::string written{std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+  {
+    std::lock_guard lk{mutex};
+    ASSERT_FALSE(sps.empty());
+    EXPECT_NE(written.find(sps), std::string::npos);    // in the track's codec private data
+  }
+  std::remove(path.c_str());
+  gst_object_unref(pad);
+  gst_object_unref(pipeline);
+}
+
+// ============================================================================
+// SegmentRecorder
+// ============================================================================
+
+TEST(SegmentRecorderTest, SyncFileReportsSize) {
+  const auto path = std::string{::testing::TempDir()} + "segment_sync.bin";
+  {
+    std::ofstream out{path, std::ios::binary};
+    out << std::string(1000, 'x');
+  }
+  const auto bytes = ds::detail::sync_file(path, true);
+  ASSERT_TRUE(bytes.has_value()) << bytes.error().what();
+  EXPECT_EQ(*bytes, 1000u);
+  std::remove(path.c_str());
+
+  const auto missing = ds::detail::sync_file(path, true);
+  ASSERT_FALSE(missing.has_value());
+  EXPECT_EQ(missing.error().kind, ds::ErrorKind::FileIO);
+}
+
+TEST(SegmentRecorderTest, RejectsEmptyLocation) {
+  auto recorder = ds::SegmentRecorder::create({.location = ""}, nullptr);
+  ASSERT_FALSE(recorder.has_value());
+  EXPECT_EQ(recorder.error().kind, ds::ErrorKind::InvalidArgument);
+}
+
+TEST(SegmentRecorderTest, SplitsIntoFinalizedSegments) {
+  using namespace std::chrono_literals;
+  const std::string dir = ::testing::TempDir();
+  const auto pattern = dir + "segment%02d.mkv";
+  std::mutex mutex;
+  std::vector<ds::SegmentRecorder::Result> segments;
+  auto recorder = ds::SegmentRecorder::create({.location = pattern, .max_size_time = 1s, .container = ds::RecordContainer::Mkv},
+                                              [&](ds::SegmentRecorder::Result segment) {
+                                                std::lock_guard lk{mutex};
+                                                segments.push_back(std::move(segment));
+                                              })
+                      .value();
+
+  // 3 s of 30 fps JPEG, every frame a keyframe: three 1 s fragments.
+  GstElement* pipeline = gst_parse_launch(
+      "videotestsrc num-buffers=90 ! video/x-raw,width=160,height=120,framerate=30/1 ! jpegenc name=enc", nullptr);
+  ASSERT_NE(pipeline, nullptr);
+  GstElement* enc = gst_bin_get_by_name(GST_BIN(pipeline), "enc");
+  gst_bin_add(GST_BIN(pipeline), recorder.element());
+  ASSERT_TRUE(gst_element_link(enc, recorder.element()));
+  gst_object_unref(enc);
+
+  ASSERT_NE(gst_element_set_state(pipeline, GST_STATE_PLAYING), GST_STATE_CHANGE_FAILURE);
+  GstBus* bus = gst_element_get_bus(pipeline);
+  for(;;) {
+    GstMessage* msg = gst_bus_timed_pop(bus, 10 * GST_SECOND);
+    ASSERT_NE(msg, nullptr);
+    const auto type = GST_MESSAGE_TYPE(msg);
+    if(!recorder.handle_message(msg)) {
+      EXPECT_NE(type, GST_MESSAGE_ERROR);
+    }
+    gst_message_unref(msg);
+    if(type == GST_MESSAGE_EOS || type == GST_MESSAGE_ERROR) {
+      break;
+    }
+  }
+  gst_object_unref(bus);
+  gst_element_set_state(pipeline, GST_STATE_NULL);
+  gst_object_unref(pipeline);
+  recorder.close();
+
+  const auto stats = recorder.stats();
+  EXPECT_EQ(stats.opened, 3u);
+  EXPECT_EQ(stats.finalized, 3u);
+  ASSERT_EQ(segments.size(), 3u);
+  for(std::size_t i = 0; i < segments.size(); ++i) {
+    ASSERT_TRUE(segments[i].has_value()) << segments[i].error().what();
+    EXPECT_EQ(segments[i]->index, i);
+    std::array<char, 4096> expected{};    // what splitmuxsink makes of the printf pattern
+    std::snprintf(expected.data(), expected.size(), "%ssegment%02d.mkv", dir.c_str(), static_cast<int>(i));
+    EXPECT_EQ(segments[i]->path, expected.data());
+    EXPECT_GT(segments[i]->bytes, 0u);
+    EXPECT_NEAR(std::chrono::duration<double>(segments[i]->duration).count(), 1.0, 0.15);
+    std::remove(segments[i]->path.c_str());
+  }
+}
+
+// ============================================================================
+// RenditionLadder
+// ============================================================================
+
+TEST(RenditionLadderTest, RejectsBadRenditions) {
+  auto none = ds::RenditionLadder::create({});
+  ASSERT_FALSE(none.has_value());
+  EXPECT_EQ(none.error().kind, ds::ErrorKind::InvalidArgument);
+
+  auto unsized = ds::RenditionLadder::create({.renditions = {{.name = "720p"}}});
+  ASSERT_FALSE(unsized.has_value());
+  EXPECT_EQ(unsized.error().kind, ds::ErrorKind::InvalidArgument);
+
+  auto duplicate = ds::RenditionLadder::create(
+      {.renditions = {{.name = "a", .width = 640, .height = 360}, {.name = "a", .width = 320, .height = 180}}});
+  ASSERT_FALSE(duplicate.has_value());
+  EXPECT_NE(duplicate.error().message.find("duplicate"), std::string::npos);
+}
+
+TEST(RenditionLadderTest, BitrateUnits) {
+  EXPECT_EQ(ds::detail::bitrate_unit("x264enc"), ds::detail::BitrateUnit::Kbps);
+  EXPECT_EQ(ds::detail::bitrate_unit("nvh265enc"), ds::detail::BitrateUnit::Kbps);
+  EXPECT_EQ(ds::detail::bitrate_unit("nvv4l2h264enc"), ds::detail::BitrateUnit::Bps);
+  EXPECT_EQ(ds::detail::bitrate_unit("openh264enc"), ds::detail::BitrateUnit::Bps);
+  EXPECT_EQ(ds::detail::bitrate_unit("someenc"), std::nullopt);
+}
+
+TEST(RenditionLadderTest, ReportsAnEncoderItCannotSetTheBitrateOf) {
+  GstElementFactory* f = gst_element_factory_find("h264parse");
+  if(f == nullptr) {
+    GTEST_SKIP() << "h264parse not available";
+  }
+  gst_object_unref(f);
+  auto ladder = ds::RenditionLadder::create(
+      {.renditions = {{.name = "a", .width = 320, .height = 240, .bitrate = 500'000, .encoder = "identity"}},
+       .scaler = "identity",
+       .nvmm = false});
+  ASSERT_FALSE(ladder.has_value());
+  EXPECT_EQ(ladder.error().kind, ds::ErrorKind::InvalidArgument);
+  EXPECT_NE(ladder.error().message.find("bitrate"), std::string::npos);
+}
+
+TEST(RenditionLadderTest, EncodesEveryRenditionFromOneStream) {
+  for(const auto* factory : {"x264enc", "videoscale", "h264parse"}) {
+    GstElementFactory* f = gst_element_factory_find(factory);
+    if(f == nullptr) {
+      GTEST_SKIP() << factory << " not available";
+    }
+    gst_object_unref(f);
+  }
+  auto ladder = ds::RenditionLadder::create(
+                    {.renditions = {{.name = "high", .width = 320, .height = 240, .bitrate = 500'000, .encoder = "x264enc"},
+                                    {.name = "low", .width = 160, .height = 120, .bitrate = 200'000, .encoder = "x264enc"}},
+                     .scaler = "videoscale",
+                     .nvmm = false})
+                    .value();
+  ASSERT_EQ(ladder.size(), 2u);
+  guint kbps = 0;
+  g_object_get(G_OBJECT(ladder.encoder("high")), "bitrate", &kbps, nullptr);
+  EXPECT_EQ(kbps, 500u);
+  EXPECT_EQ(ds::detail::get_bitrate(ladder.encoder("high")).value(), 500'000u);
+
+  GstElement* pipeline = gst_parse_launch(
+      "videotestsrc num-buffers=30 ! video/x-raw,format=I420,width=640,height=480,framerate=30/1 ! identity name=in "
+      "fakesink name=high_sink fakesink name=low_sink",
+      nullptr);
+  ASSERT_NE(pipeline, nullptr);
+  gst_bin_add(GST_BIN(pipeline), ladder.element());
+  GstElement* in = gst_bin_get_by_name(GST_BIN(pipeline), "in");
+  GstElement* high = gst_bin_get_by_name(GST_BIN(pipeline), "high_sink");
+  GstElement* low = gst_bin_get_by_name(GST_BIN(pipeline), "low_sink");
+  EXPECT_TRUE(gst_element_link(in, ladder.element()));
+  EXPECT_TRUE(gst_element_link_pads(ladder.element(), "high", high, nullptr));
+  EXPECT_TRUE(gst_element_link_pads(ladder.element(), "low", low, nullptr));
+  gst_object_unref(in);
+  gst_object_unref(high);
+  gst_object_unref(low);
+
+  ASSERT_NE(gst_element_set_state(pipeline, GST_STATE_PLAYING), GST_STATE_CHANGE_FAILURE);
+  GstBus* bus = gst_element_get_bus(pipeline);
+  GstMessage* msg =
+      gst_bus_timed_pop_filtered(bus, 10 * GST_SECOND, static_cast<GstMessageType>(GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+  ASSERT_NE(msg, nullptr);
+  EXPECT_EQ(GST_MESSAGE_TYPE(msg), GST_MESSAGE_EOS);
+  gst_message_unref(msg);
+  gst_object_unref(bus);
+
+  gst::CapsPtr caps{gst_pad_get_current_caps(ladder.src_pad("low"))};
+  ASSERT_TRUE(caps);
+  const GstStructure* s = gst_caps_get_structure(caps.get(), 0);
+  int width = 0;
+  EXPECT_TRUE(gst_structure_has_name(s, "video/x-h264"));
+  EXPECT_TRUE(gst_structure_get_int(s, "width", &width));
+  EXPECT_EQ(width, 160);
+  EXPECT_EQ(ladder.src_pad("missing"), nullptr);
+
+  gst_element_set_state(pipeline, GST_STATE_NULL);
+  gst_object_unref(pipeline);
+}
+
+// A rendition nobody consumes must not end the stream for the others.
+TEST(RenditionLadderTest, UnlinkedRenditionOnlyStopsItsOwnBranch) {
+  for(const auto* factory : {"x264enc", "videoscale", "h264parse"}) {
+    GstElementFactory* f = gst_element_factory_find(factory);
+    if(f == nullptr) {
+      GTEST_SKIP() << factory << " not available";
+    }
+    gst_object_unref(f);
+  }
+  auto ladder = ds::RenditionLadder::create({.renditions = {{.name = "high", .width = 320, .height = 240, .encoder = "x264enc"},
+                                                            {.name = "low", .width = 160, .height = 120, .encoder = "x264enc"}},
+                                             .scaler = "videoscale",
+                                             .nvmm = false})
+                    .value();
+  GstPad* sinkpad = gst_element_get_static_pad(ladder.element(), "sink");
+  GstPad* target = gst_ghost_pad_get_target(GST_GHOST_PAD(sinkpad));
+  GstElement* tee = gst_pad_get_parent_element(target);
+  gboolean allow = FALSE;
+  g_object_get(G_OBJECT(tee), "allow-not-linked", &allow, nullptr);
+  EXPECT_TRUE(allow);
+  gst_object_unref(tee);
+  gst_object_unref(target);
+  gst_object_unref(sinkpad);
+
+  GstElement* pipeline = gst_parse_launch(
+      "videotestsrc num-buffers=30 ! video/x-raw,format=I420,width=640,height=480,framerate=30/1 ! identity name=in "
+      "fakesink name=high_sink",
+      nullptr);
+  ASSERT_NE(pipeline, nullptr);
+  gst_bin_add(GST_BIN(pipeline), ladder.element());
+  GstElement* in = gst_bin_get_by_name(GST_BIN(pipeline), "in");
+  GstElement* high = gst_bin_get_by_name(GST_BIN(pipeline), "high_sink");
+  EXPECT_TRUE(gst_element_link(in, ladder.element()));
+  EXPECT_TRUE(gst_element_link_pads(ladder.element(), "high", high, nullptr));    // "low" stays unlinked
+  gst_object_unref(in);
+  gst_object_unref(high);
+
+  ASSERT_NE(gst_element_set_state(pipeline, GST_STATE_PLAYING), GST_STATE_CHANGE_FAILURE);
+  GstBus* bus = gst_element_get_bus(pipeline);
+  GstMessage* msg =
+      gst_bus_timed_pop_filtered(bus, 10 * GST_SECOND, static_cast<GstMessageType>(GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+  ASSERT_NE(msg, nullptr);
+  EXPECT_EQ(GST_MESSAGE_TYPE(msg), GST_MESSAGE_EOS);
+  gst_message_unref(msg);
+  gst_object_unref(bus);
+
+  gst_element_set_state(pipeline, GST_STATE_NULL);
+  gst_object_unref(pipeline);
+}
+
+// ============================================================================
+// BitrateController
+// ============================================================================
+
+TEST(BitrateControllerTest, PolicyCutsOnCongestionAndRaisesWhenClear) {
+  using namespace std::chrono_literals;
+  ds::detail::BitratePolicy policy;
+  policy.config = {.min_bitrate = 1'000'000, .max_bitrate = 4'000'000, .decrease = 0.5, .increase = 500'000,
+                   .hold = 1s, .recover_after = 3s};
+  policy.bitrate = 4'000'000;
+  const auto t0 = std::chrono::steady_clock::now();
+
+  EXPECT_EQ(policy.step({.fill = 0.8}, t0), 2'000'000u);
+  EXPECT_EQ(policy.step({.overruns = 1}, t0 + 500ms), std::nullopt);    // within hold
+  EXPECT_EQ(policy.step({.late = 2}, t0 + 1s), 1'000'000u);
+  EXPECT_EQ(policy.step({.fill = 1.0}, t0 + 2s), std::nullopt);    // at min_bitrate
+  EXPECT_EQ(policy.bitrate, 1'000'000u);
+
+  EXPECT_EQ(policy.step({}, t0 + 4s + 500ms), std::nullopt);    // congested 2.5 s ago
+  EXPECT_EQ(policy.step({}, t0 + 5s), 1'500'000u);
+  EXPECT_EQ(policy.step({.fill = 0.3}, t0 + 6s), std::nullopt);    // between the water marks
+  EXPECT_EQ(policy.step({}, t0 + 7s), 2'000'000u);
+}
+
+TEST(BitrateControllerTest, PolicyStaysWithinRange) {
+  using namespace std::chrono_literals;
+  ds::detail::BitratePolicy policy;
+  policy.config = {.min_bitrate = 1'000'000, .max_bitrate = 1'200'000, .hold = 0ms, .recover_after = 0ms};
+  policy.bitrate = 1'100'000;
+  const auto t0 = std::chrono::steady_clock::now();
+  EXPECT_EQ(policy.step({}, t0), 1'200'000u);
+  EXPECT_EQ(policy.step({}, t0 + 1s), std::nullopt);
+  EXPECT_EQ(policy.step({.overruns = 5}, t0 + 2s), 1'000'000u);
+}
+
+TEST(BitrateControllerTest, RejectsEncoderWithoutBitrate) {
+  GstElement* identity = gst_element_factory_make("identity", nullptr);
+  ASSERT_NE(identity, nullptr);
+  gst_object_ref_sink(identity);
+  auto controller = ds::BitrateController::create(identity);
+  ASSERT_FALSE(controller.has_value());
+  EXPECT_EQ(controller.error().kind, ds::ErrorKind::InvalidArgument);
+  EXPECT_NE(controller.error().message.find("no bitrate property"), std::string::npos);
+  gst_object_unref(identity);
+  EXPECT_FALSE(ds::BitrateController::create(nullptr).has_value());
+}
+
+// udpsink -> udpsrc over loopback; identity sleep-time throttles the sending
+// side below the frame rate, so the queue in front of it fills up.
+TEST(BitrateControllerTest, LowersBitrateWhenTheSendQueueBacksUp) {
+  using namespace std::chrono_literals;
+  for(const auto* factory : {"x264enc", "rtph264pay", "udpsink", "udpsrc"}) {
+    GstElementFactory* f = gst_element_factory_find(factory);
+    if(f == nullptr) {
+      GTEST_SKIP() << factory << " not available";
+    }
+    gst_object_unref(f);
+  }
+  GstElement* receiver = gst_parse_launch("udpsrc name=src port=0 ! fakesink sync=false", nullptr);
+  ASSERT_NE(receiver, nullptr);
+  ASSERT_NE(gst_element_set_state(receiver, GST_STATE_PLAYING), GST_STATE_CHANGE_FAILURE);
+  GstElement* udpsrc = gst_bin_get_by_name(GST_BIN(receiver), "src");
+  gint port = 0;
+  g_object_get(G_OBJECT(udpsrc), "port", &port, nullptr);
+  gst_object_unref(udpsrc);
+  ASSERT_GT(port, 0);
+
+  GstElement* sender = gst_parse_launch(
+      fmt::format("videotestsrc is-live=true ! video/x-raw,width=320,height=240,framerate=30/1 ! "
+                  "x264enc name=enc tune=zerolatency bitrate=2000 ! queue name=q max-size-buffers=20 ! "
+                  "identity sleep-time=50000 ! rtph264pay ! udpsink name=out host=127.0.0.1 port={}",
+                  port)
+          .c_str(),
+      nullptr);
+  ASSERT_NE(sender, nullptr);
+  GstElement* enc = gst_bin_get_by_name(GST_BIN(sender), "enc");
+  GstElement* queue = gst_bin_get_by_name(GST_BIN(sender), "q");
+  GstElement* out = gst_bin_get_by_name(GST_BIN(sender), "out");
+  auto controller =
+      ds::BitrateController::create(enc, {.min_bitrate = 250'000, .max_bitrate = 4'000'000, .hold = 200ms}).value();
+  EXPECT_EQ(controller.bitrate(), 2'000'000u);
+  guint kbps_before = 0;
+  g_object_get(G_OBJECT(enc), "bitrate", &kbps_before, nullptr);
+  ASSERT_EQ(kbps_before, 2000u);
+  ASSERT_TRUE(controller.watch_queue(queue).has_value());
+  ASSERT_TRUE(controller.watch_sink(out).has_value());
+
+  ASSERT_NE(gst_element_set_state(sender, GST_STATE_PLAYING), GST_STATE_CHANGE_FAILURE);
+  GstBus* bus = gst_element_get_bus(sender);
+  bool lowered = false;
+  for(int i = 0; i < 20 && !lowered; ++i) {
+    std::this_thread::sleep_for(200ms);
+    while(GstMessage* msg = gst_bus_pop(bus)) {
+      controller.handle_message(msg);
+      EXPECT_NE(GST_MESSAGE_TYPE(msg), GST_MESSAGE_ERROR);
+      gst_message_unref(msg);
+    }
+    lowered = controller.tick().changed && controller.bitrate() < 2'000'000u;
+  }
+  EXPECT_TRUE(lowered);
+  // The encoder itself must have been told, not just the controller's policy.
+  guint kbps = 0;
+  g_object_get(G_OBJECT(enc), "bitrate", &kbps, nullptr);
+  EXPECT_LT(kbps, kbps_before);
+  EXPECT_EQ(kbps * 1000U, controller.bitrate());
+  EXPECT_EQ(ds::detail::get_bitrate(enc).value(), controller.bitrate());
+
+  gst_object_unref(bus);
+  gst_element_set_state(sender, GST_STATE_NULL);
+  gst_element_set_state(receiver, GST_STATE_NULL);
+  gst_object_unref(enc);
+  gst_object_unref(queue);
+  gst_object_unref(out);
+  gst_object_unref(sender);
+  gst_object_unref(receiver);
+}
+
+}    // namespace
+
+int main(int argc, char** argv) {
+  gst_init(&argc, &argv);
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,84 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <utils/bounded_queue.hpp>
+
+// ============================================================================
+// BoundedQueue
+// ============================================================================
+
+TEST(BoundedQueueTest, CapacityRoundsUpToPowerOfTwo) {
+  EXPECT_EQ(ds::BoundedQueue<int>{0}.capacity(), 2u);
+  EXPECT_EQ(ds::BoundedQueue<int>{5}.capacity(), 8u);
+  EXPECT_EQ(ds::BoundedQueue<int>{8}.capacity(), 8u);
+}
+
+TEST(BoundedQueueTest, FifoUntilFullThenEmpty) {
+  ds::BoundedQueue<int> queue{4};
+  for(int i = 0; i < 4; ++i) {
+    EXPECT_TRUE(queue.try_push(i));
+  }
+  EXPECT_FALSE(queue.try_push(4));
+  EXPECT_EQ(queue.size_approx(), 4u);
+
+  for(int i = 0; i < 4; ++i) {
+    auto value = queue.try_pop();
+    ASSERT_TRUE(value.has_value());
+    EXPECT_EQ(*value, i);
+  }
+  EXPECT_FALSE(queue.try_pop().has_value());
+}
+
+TEST(BoundedQueueTest, WrapsAroundManyTimes) {
+  ds::BoundedQueue<std::uint64_t> queue{2};
+  for(std::uint64_t i = 0; i < 1000; ++i) {
+    ASSERT_TRUE(queue.try_push(i));
+    auto value = queue.try_pop();
+    ASSERT_TRUE(value.has_value());
+    EXPECT_EQ(*value, i);
+  }
+}
+
+TEST(BoundedQueueTest, ConcurrentProducersAndConsumersLoseNothing) {
+  constexpr std::uint64_t per_producer = 20000;
+  constexpr int producers = 4;
+  constexpr int consumers = 2;
+
+  ds::BoundedQueue<std::uint64_t> queue{64};
+  std::atomic<std::uint64_t> sum{0};
+  std::atomic<std::uint64_t> popped{0};
+
+  std::vector<std::thread> threads;
+  for(int p = 0; p < producers; ++p) {
+    threads.emplace_back([&queue] {
+      for(std::uint64_t i = 1; i <= per_producer; ++i) {
+        while(!queue.try_push(i)) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for(int c = 0; c < consumers; ++c) {
+    threads.emplace_back([&] {
+      while(popped.load() < per_producer * producers) {
+        if(auto value = queue.try_pop()) {
+          sum.fetch_add(*value);
+          popped.fetch_add(1);
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for(auto& t : threads) {
+    t.join();
+  }
+
+  EXPECT_EQ(popped.load(), per_producer * producers);
+  EXPECT_EQ(sum.load(), producers * per_producer * (per_producer + 1) / 2);
+}